@@ -0,0 +1,96 @@
+/*
+ * Copyright © 2019 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#include "config.h"
+
+#include "libjoystick-inline.h"
+#include "bench-cxx.h"
+
+static uint64_t
+consume_event(struct js_event *event)
+{
+	struct js_device *device = js_event_get_device(event);
+	uint64_t sum = 0;
+	size_t n;
+
+	switch (js_event_get_type(event)) {
+	case JS_EVENT_BUTTON:
+		n = js_device_get_button_count(device);
+		for (unsigned int i = 0; i < n; i++) {
+			struct js_button *button = js_device_get_button(device, i);
+			uint16_t value;
+			bool state;
+
+			if (js_event_button_state_has_changed(event, button)) {
+				js_event_button_get_state(event, button, &state);
+				sum += state + i;
+			}
+			if (js_event_button_value_has_changed(event, button)) {
+				js_event_button_get_value(event, button, &value);
+				sum += value;
+			}
+		}
+		break;
+	case JS_EVENT_AXIS:
+		n = js_device_get_axis_count(device);
+		for (unsigned int i = 0; i < n; i++) {
+			struct js_axis *axis = js_device_get_axis(device, i);
+			int16_t x, y, z;
+
+			if (js_event_axis_has_changed(event, axis)) {
+				js_event_axis_get_value(event, axis, &x, &y, &z);
+				sum += (uint16_t)x + (uint16_t)y + (uint16_t)z;
+			}
+		}
+		break;
+	case JS_EVENT_DPAD:
+		n = js_device_get_dpad_count(device);
+		for (unsigned int i = 0; i < n; i++) {
+			uint32_t state;
+
+			if (js_event_dpad_get_state(event,
+						    js_device_get_dpad(device, i),
+						    &state))
+				sum += state;
+		}
+		break;
+	case JS_EVENT_SYNC:
+		sum += 1;
+		break;
+	default:
+		break;
+	}
+
+	return sum;
+}
+
+uint64_t
+bench_consume_c(struct js_ctx *ctx, uint64_t *nevents)
+{
+	struct js_event *event;
+	uint64_t sum = 0;
+
+	while ((event = js_ctx_get_event(ctx))) {
+		sum += consume_event(event);
+		js_event_destroy(event);
+		(*nevents)++;
+	}
+
+	return sum;
+}
@@ -0,0 +1,315 @@
+/*
+ * Copyright © 2019 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+/*
+ * The cost of the C++ wrapper.
+ *
+ * The recorded sessions are replayed and the events consumed by the same
+ * loop written three times: in C with the accessors of
+ * libjoystick-inline.h (bench-cxx-c.c), with the libjoystick.hpp
+ * handles and visitor, and with the span-based bulk accessors of
+ * libjoystick.hpp. The consumers are compiled with optimization
+ * regardless of the build type, and all three must compute the same
+ * checksum. Only the consuming loop is timed, one result is printed
+ * for each consumer.
+ */
+
+#include "config.h"
+
+#include <getopt.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "libjoystick.hpp"
+
+extern "C" {
+#include "mock-backend.h"
+#include "bench-util.h"
+#include "bench-cxx.h"
+}
+
+static const struct session {
+	const char *device;
+	const char *recording;
+} sessions[] = {
+	{ "microsoft-xbox-360-pad", "xbox-360-pad-buttons" },
+	{ "sony-dualshock-4", "sony-dualshock-4-gameplay" },
+	{ "generic-racing-wheel", "generic-racing-wheel-lap" },
+	{ "logitech-extreme-3d-pro", "logitech-extreme-3d-pro-flight" },
+};
+
+#define NSESSIONS (sizeof(sessions)/sizeof(sessions[0]))
+
+static uint64_t
+consume_cxx(const js::context &ctx, uint64_t *nevents)
+{
+	uint64_t sum = 0;
+
+	*nevents += ctx.drain(js::overloaded{
+		[&](js::button_event ev) {
+			js_device *device = ev.device();
+			std::size_t n = ev.count();
+
+			for (unsigned int i = 0; i < n; i++) {
+				js_button *button = js_device_get_button(device, i);
+
+				if (ev.state_changed(button))
+					sum += ev.pressed(button) + i;
+				if (ev.value_changed(button))
+					sum += ev.value(button);
+			}
+		},
+		[&](js::axis_event ev) {
+			js_device *device = ev.device();
+			std::size_t n = ev.count();
+
+			for (unsigned int i = 0; i < n; i++) {
+				js_axis *axis = js_device_get_axis(device, i);
+				int16_t x, y, z;
+
+				if (ev.changed(axis)) {
+					ev.value(axis, x, y, z);
+					sum += (uint16_t)x + (uint16_t)y + (uint16_t)z;
+				}
+			}
+		},
+		[&](js::dpad_event ev) {
+			js_device *device = ev.device();
+			std::size_t n = ev.count();
+
+			for (unsigned int i = 0; i < n; i++) {
+				uint32_t state;
+
+				if (js_event_dpad_get_state(ev.get(),
+							    js_device_get_dpad(device, i),
+							    &state))
+					sum += state;
+			}
+		},
+		[&](js::sync_event) {
+			sum += 1;
+		},
+	});
+
+	return sum;
+}
+
+static uint64_t
+consume_cxx_span(const js::context &ctx, uint64_t *nevents)
+{
+	uint64_t sum = 0;
+
+	*nevents += ctx.drain(js::overloaded{
+		[&](js::button_event ev) {
+			auto values = ev.values();
+			auto state = ev.state_bits();
+			auto state_changed = ev.state_changed_bits();
+			auto value_changed = ev.value_changed_bits();
+
+			for (std::size_t i = 0; i < values.size(); i++) {
+				if (js::bit_is_set(state_changed, i))
+					sum += js::bit_is_set(state, i) + i;
+				if (js::bit_is_set(value_changed, i))
+					sum += values[i];
+			}
+		},
+		[&](js::axis_event ev) {
+			auto values = ev.values();
+			auto changed = ev.changed_bits();
+
+			for (std::size_t i = 0; i < values.size(); i++) {
+				if (js::bit_is_set(changed, i))
+					sum += (uint16_t)values[i][0] +
+					       (uint16_t)values[i][1] +
+					       (uint16_t)values[i][2];
+			}
+		},
+		[&](js::dpad_event ev) {
+			auto states = ev.states();
+			auto changed = ev.changed_bits();
+
+			for (std::size_t i = 0; i < states.size(); i++) {
+				if (js::bit_is_set(changed, i))
+					sum += states[i];
+			}
+		},
+		[&](js::sync_event) {
+			sum += 1;
+		},
+	});
+
+	return sum;
+}
+
+enum consumer {
+	CONSUMER_C,
+	CONSUMER_CXX,
+	CONSUMER_CXX_SPAN,
+	CONSUMER_COUNT,
+};
+
+static const char *consumer_names[CONSUMER_COUNT] = {
+	"c",
+	"cxx",
+	"cxx-span",
+};
+
+static uint64_t
+consume(enum consumer consumer, const js::context &ctx, uint64_t *nevents)
+{
+	switch (consumer) {
+	case CONSUMER_C:
+		return bench_consume_c(ctx.get(), nevents);
+	case CONSUMER_CXX:
+		return consume_cxx(ctx, nevents);
+	case CONSUMER_CXX_SPAN:
+		return consume_cxx_span(ctx, nevents);
+	default:
+		abort();
+	}
+}
+
+static void
+play(struct mock_device *device, const char *recording)
+{
+	int rc = mock_device_play(device, recording);
+
+	if (rc < 0) {
+		fprintf(stderr, "Failed to replay %s: %d\n", recording, rc);
+		exit(1);
+	}
+}
+
+static void
+usage(void)
+{
+	printf("Usage: bench-cxx [options]\n"
+	       "  --name=NAME            the result name prefix (default: cxx)\n"
+	       "  --output=FILE          append the JSON results to FILE\n"
+	       "  --iterations=N         number of times each session is replayed (default: 200)\n");
+}
+
+int
+main(int argc, char **argv)
+{
+	enum {
+		OPT_NAME,
+		OPT_OUTPUT,
+		OPT_ITERATIONS,
+	};
+	static const struct option long_options[] = {
+		{ "name", required_argument, 0, OPT_NAME },
+		{ "output", required_argument, 0, OPT_OUTPUT },
+		{ "iterations", required_argument, 0, OPT_ITERATIONS },
+		{ "help", no_argument, 0, 'h' },
+		{ 0, 0, 0, 0 },
+	};
+	const char *name = "cxx";
+	const char *output = NULL;
+	unsigned int iterations = 200;
+	struct mock_device *devices[NSESSIONS];
+	struct bench_result results[CONSUMER_COUNT] = {};
+	uint64_t checksums[CONSUMER_COUNT] = {};
+
+	while (1) {
+		int c = getopt_long(argc, argv, "h", long_options, NULL);
+
+		if (c == -1)
+			break;
+
+		switch (c) {
+		case OPT_NAME:
+			name = optarg;
+			break;
+		case OPT_OUTPUT:
+			output = optarg;
+			break;
+		case OPT_ITERATIONS:
+			iterations = atoi(optarg);
+			break;
+		case 'h':
+			usage();
+			return 0;
+		default:
+			usage();
+			return 1;
+		}
+	}
+
+	js::context ctx{ mock_ctx_new() };
+
+	for (size_t i = 0; i < NSESSIONS; i++)
+		devices[i] = mock_device_new(ctx.get(), sessions[i].device);
+	ctx.dispatch();
+	mock_drain_events(ctx.get());
+
+	/* One replay to get every device into the state the recording
+	 * leaves it in, from there on each replay gives the same events */
+	for (size_t i = 0; i < NSESSIONS; i++)
+		play(devices[i], sessions[i].recording);
+	ctx.dispatch();
+	mock_drain_events(ctx.get());
+
+	for (unsigned int it = 0; it < iterations; it++) {
+		for (size_t i = 0; i < NSESSIONS; i++) {
+			for (int c = 0; c < CONSUMER_COUNT; c++) {
+				/* Rotate the order, so no consumer always
+				 * runs on the coldest cache */
+				enum consumer consumer = (enum consumer)((c + it) % CONSUMER_COUNT);
+				struct bench_result *r = &results[consumer];
+				uint64_t start;
+
+				play(devices[i], sessions[i].recording);
+				ctx.dispatch();
+
+				start = bench_now_ns();
+				checksums[consumer] += consume(consumer, ctx, &r->events);
+				r->elapsed_ns += bench_now_ns() - start;
+			}
+		}
+	}
+
+	for (int c = 0; c < CONSUMER_COUNT; c++) {
+		struct bench_result *r = &results[c];
+		char *result_name;
+
+		if (checksums[c] != checksums[CONSUMER_C] ||
+		    r->events != results[CONSUMER_C].events) {
+			fprintf(stderr,
+				"%s: checksum %" PRIu64 " over %" PRIu64 " events, "
+				"expected %" PRIu64 " over %" PRIu64 "\n",
+				consumer_names[c], checksums[c], r->events,
+				checksums[CONSUMER_C], results[CONSUMER_C].events);
+			return 1;
+		}
+
+		if (asprintf(&result_name, "%s-%s", name, consumer_names[c]) < 0)
+			abort();
+		/* There is no input to count here, the per-event costs
+		 * are per consumed event */
+		r->name = result_name;
+		r->input_events = r->events;
+		bench_result_print(r, output, "\"consumer\": \"%s\"",
+				   consumer_names[c]);
+		free(result_name);
+	}
+
+	return 0;
+}
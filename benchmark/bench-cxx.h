@@ -0,0 +1,38 @@
+/*
+ * Copyright © 2019 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#pragma once
+
+/*
+ * The hand-written C consumer of bench-cxx, in its own C translation
+ * unit so it is compiled by the C compiler.
+ */
+
+#include <stdint.h>
+
+#include "libjoystick.h"
+
+/**
+ * Retrieve, consume and destroy all queued events. Every changed control
+ * of an event is read and folded into a checksum.
+ *
+ * @return the checksum, the number of events is added to nevents
+ */
+uint64_t
+bench_consume_c(struct js_ctx *ctx, uint64_t *nevents);
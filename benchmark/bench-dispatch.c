@@ -0,0 +1,303 @@
+/*
+ * Copyright © 2019 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+/*
+ * Dispatch throughput benchmark.
+ *
+ * A number of mock devices each write a number of frames, then the
+ * context is dispatched and drained until all frames have been turned
+ * into events. Only the dispatch and the event retrieval is timed, the
+ * mock devices writing into their pipes is the kernel's side and excluded.
+ *
+ * Allocations and syscalls are counted by wrapping the respective libc
+ * functions at link time, see the benchmark section in meson.build.
+ */
+
+#include "config.h"
+
+#include <getopt.h>
+#include <stdio.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+#include "libjoystick-private.h"
+#include "mock-backend.h"
+#include "bench-util.h"
+
+#define MAX_DEVICES 256
+#define MAX_CONTROLS 64
+/* Stay well below the default 64k pipe buffer */
+#define MAX_EVENTS_PER_DISPATCH 2048
+
+struct control {
+	unsigned int type;
+	unsigned int code;
+	int values[2];
+};
+
+struct bench_device {
+	struct mock_device *mock;
+	struct control controls[MAX_CONTROLS];
+	size_t ncontrols;
+};
+
+struct options {
+	const char *name;
+	const char *device;
+	const char *output;
+	unsigned int ndevices;
+	unsigned int ncontrols;
+	unsigned int frames_per_dispatch;
+	unsigned int iterations;
+};
+
+static void
+bench_device_init(struct bench_device *b, struct js_ctx *ctx,
+		  const struct options *opts)
+{
+	struct libevdev *evdev;
+
+	b->mock = mock_device_new(ctx, opts->device);
+	evdev = mock_device_get_device(b->mock)->evdev;
+
+	for (unsigned int code = BTN_MISC; code < KEY_CNT; code++) {
+		struct control *c = &b->controls[b->ncontrols];
+
+		if (b->ncontrols == opts->ncontrols)
+			return;
+
+		if (!libevdev_has_event_code(evdev, EV_KEY, code))
+			continue;
+
+		c->type = EV_KEY;
+		c->code = code;
+		c->values[0] = 1;
+		c->values[1] = 0;
+		b->ncontrols++;
+	}
+
+	for (unsigned int code = 0; code < ABS_CNT; code++) {
+		struct control *c = &b->controls[b->ncontrols];
+		const struct input_absinfo *absinfo;
+
+		if (b->ncontrols == opts->ncontrols)
+			return;
+
+		absinfo = libevdev_get_abs_info(evdev, code);
+		if (!absinfo)
+			continue;
+
+		c->type = EV_ABS;
+		c->code = code;
+		c->values[0] = absinfo->maximum;
+		c->values[1] = absinfo->minimum;
+		b->ncontrols++;
+	}
+}
+
+/* Every control changes in every frame, so every frame results in
+ * at least one event followed by a JS_EVENT_SYNC */
+static size_t
+bench_device_write_frames(struct bench_device *b, unsigned int nframes,
+			  unsigned int *frame)
+{
+	size_t nevents = 0;
+
+	for (unsigned int f = 0; f < nframes; f++) {
+		for (size_t i = 0; i < b->ncontrols; i++) {
+			struct control *c = &b->controls[i];
+
+			mock_device_event(b->mock, c->type, c->code,
+					  c->values[*frame % 2]);
+			nevents++;
+		}
+		mock_device_frame(b->mock);
+		nevents++;
+		(*frame)++;
+	}
+
+	return nevents;
+}
+
+static void
+usage(void)
+{
+	printf("Usage: bench-dispatch [options]\n"
+	       "  --name=NAME            the name used in the JSON output\n"
+	       "  --device=NAME          the mock device description (default: microsoft-xbox-360-pad)\n"
+	       "  --devices=N            number of devices, 1-%d (default: 1)\n"
+	       "  --controls=N           number of controls changed per frame (default: 4)\n"
+	       "  --frames-per-dispatch=N\n"
+	       "                         frames per device between two dispatches (default: 8)\n"
+	       "  --iterations=N         number of dispatch iterations (default: 2000)\n"
+	       "  --output=FILE          append the JSON result to FILE\n",
+	       MAX_DEVICES);
+}
+
+static int
+parse_options(int argc, char **argv, struct options *opts)
+{
+	enum {
+		OPT_NAME,
+		OPT_DEVICE,
+		OPT_DEVICES,
+		OPT_CONTROLS,
+		OPT_FRAMES,
+		OPT_ITERATIONS,
+		OPT_OUTPUT,
+	};
+	static const struct option long_options[] = {
+		{ "name", required_argument, 0, OPT_NAME },
+		{ "device", required_argument, 0, OPT_DEVICE },
+		{ "devices", required_argument, 0, OPT_DEVICES },
+		{ "controls", required_argument, 0, OPT_CONTROLS },
+		{ "frames-per-dispatch", required_argument, 0, OPT_FRAMES },
+		{ "iterations", required_argument, 0, OPT_ITERATIONS },
+		{ "output", required_argument, 0, OPT_OUTPUT },
+		{ "help", no_argument, 0, 'h' },
+		{ 0, 0, 0, 0 },
+	};
+
+	while (1) {
+		int c = getopt_long(argc, argv, "h", long_options, NULL);
+
+		if (c == -1)
+			break;
+
+		switch (c) {
+		case OPT_NAME:
+			opts->name = optarg;
+			break;
+		case OPT_DEVICE:
+			opts->device = optarg;
+			break;
+		case OPT_DEVICES:
+			opts->ndevices = atoi(optarg);
+			break;
+		case OPT_CONTROLS:
+			opts->ncontrols = atoi(optarg);
+			break;
+		case OPT_FRAMES:
+			opts->frames_per_dispatch = atoi(optarg);
+			break;
+		case OPT_ITERATIONS:
+			opts->iterations = atoi(optarg);
+			break;
+		case OPT_OUTPUT:
+			opts->output = optarg;
+			break;
+		case 'h':
+			usage();
+			exit(0);
+		default:
+			usage();
+			return -1;
+		}
+	}
+
+	if (opts->ndevices < 1 || opts->ndevices > MAX_DEVICES ||
+	    opts->ncontrols < 1 || opts->ncontrols > MAX_CONTROLS ||
+	    opts->frames_per_dispatch < 1 || opts->iterations < 1) {
+		usage();
+		return -1;
+	}
+
+	if (opts->frames_per_dispatch * (opts->ncontrols + 1) >
+	    MAX_EVENTS_PER_DISPATCH) {
+		fprintf(stderr,
+			"Too many events per dispatch, the pipes would overflow\n");
+		return -1;
+	}
+
+	return 0;
+}
+
+int
+main(int argc, char **argv)
+{
+	struct options opts = {
+		.name = "dispatch",
+		.device = "microsoft-xbox-360-pad",
+		.ndevices = 1,
+		.ncontrols = 4,
+		.frames_per_dispatch = 8,
+		.iterations = 2000,
+	};
+	static struct bench_device devices[MAX_DEVICES];
+	struct bench_counters start, end;
+	struct bench_result result = {0};
+	unsigned int frame = 0;
+	struct js_ctx *ctx;
+	uint64_t elapsed = 0;
+
+	if (parse_options(argc, argv, &opts) != 0)
+		return 1;
+
+	ctx = mock_ctx_new();
+	for (unsigned int i = 0; i < opts.ndevices; i++)
+		bench_device_init(&devices[i], ctx, &opts);
+	mock_drain_events(ctx);
+
+	for (unsigned int it = 0; it < opts.iterations; it++) {
+		uint64_t nframes = (uint64_t)opts.ndevices *
+				   opts.frames_per_dispatch;
+		unsigned int f = 0;
+		uint64_t t0;
+
+		for (unsigned int i = 0; i < opts.ndevices; i++) {
+			f = frame;
+			result.input_events +=
+				bench_device_write_frames(&devices[i],
+							  opts.frames_per_dispatch,
+							  &f);
+		}
+		frame = f;
+
+		bench_counters_get(&start);
+		t0 = bench_now_ns();
+
+		while (nframes > 0) {
+			struct js_event *event;
+
+			js_ctx_dispatch(ctx);
+			while ((event = js_ctx_get_event(ctx))) {
+				if (js_event_get_type(event) == JS_EVENT_SYNC)
+					nframes--;
+				result.events++;
+				js_event_destroy(event);
+			}
+		}
+
+		elapsed += bench_now_ns() - t0;
+		bench_counters_get(&end);
+		bench_counters_accumulate(&result.counters, &start, &end);
+	}
+
+	js_ctx_unref(ctx);
+
+	result.name = opts.name;
+	result.elapsed_ns = elapsed;
+	bench_result_print(&result, opts.output,
+			   "\"devices\": %u, \"controls\": %u, "
+			   "\"frames_per_dispatch\": %u",
+			   opts.ndevices, (unsigned int)devices[0].ncontrols,
+			   opts.frames_per_dispatch);
+
+	return 0;
+}
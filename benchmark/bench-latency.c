@@ -0,0 +1,392 @@
+/*
+ * Copyright © 2019 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+/*
+ * End-to-end latency benchmark.
+ *
+ * A uinput gamepad sends frames at a fixed rate while a number of
+ * background uinput devices generate noise. The latency is measured from
+ * the kernel timestamp of each of the gamepad's frames to the return of
+ * js_ctx_get_event() for the frame's JS_EVENT_SYNC.
+ *
+ * This benchmark needs write access to /dev/uinput and read access to the
+ * created event nodes, it exits with 77 (skipped) otherwise.
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <libevdev/libevdev.h>
+#include <libevdev/libevdev-uinput.h>
+#include <libjoystick.h>
+
+#include "bench-util.h"
+
+#define EXIT_SKIP 77
+#define MAX_NOISE_DEVICES 64
+
+struct injector {
+	pthread_t thread;
+	struct libevdev_uinput **devices;
+	size_t ndevices;
+	unsigned int rate;		/* frames/s per device */
+	atomic_bool *stop;
+};
+
+struct options {
+	const char *name;
+	const char *output;
+	unsigned int rate;
+	unsigned int noise_devices;
+	unsigned int noise_rate;
+	unsigned int samples;
+};
+
+static int
+open_restricted(const char *path, int flags, void *user_data)
+{
+	int fd = open(path, flags);
+
+	return fd < 0 ? -errno : fd;
+}
+
+static void
+close_restricted(int fd, void *user_data)
+{
+	close(fd);
+}
+
+static const struct js_interface interface = {
+	.open_restricted = open_restricted,
+	.close_restricted = close_restricted,
+};
+
+static struct libevdev_uinput *
+create_gamepad(const char *name)
+{
+	static const unsigned int buttons[] = {
+		BTN_SOUTH, BTN_EAST, BTN_NORTH, BTN_WEST,
+		BTN_TL, BTN_TR, BTN_SELECT, BTN_START,
+	};
+	struct input_absinfo absinfo = {
+		.minimum = -32768,
+		.maximum = 32767,
+	};
+	struct libevdev_uinput *uinput = NULL;
+	struct libevdev *evdev;
+	int rc;
+
+	evdev = libevdev_new();
+	libevdev_set_name(evdev, name);
+	for (size_t i = 0; i < sizeof(buttons)/sizeof(buttons[0]); i++)
+		libevdev_enable_event_code(evdev, EV_KEY, buttons[i], NULL);
+	libevdev_enable_event_code(evdev, EV_ABS, ABS_X, &absinfo);
+	libevdev_enable_event_code(evdev, EV_ABS, ABS_Y, &absinfo);
+
+	rc = libevdev_uinput_create_from_device(evdev,
+						LIBEVDEV_UINPUT_OPEN_MANAGED,
+						&uinput);
+	libevdev_free(evdev);
+
+	if (rc != 0) {
+		fprintf(stderr, "Failed to create uinput device: %s\n",
+			strerror(-rc));
+		return NULL;
+	}
+
+	return uinput;
+}
+
+static void
+sleep_until(uint64_t deadline_ns)
+{
+	struct timespec ts = {
+		.tv_sec = deadline_ns / 1000000000,
+		.tv_nsec = deadline_ns % 1000000000,
+	};
+
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+		;
+}
+
+static void *
+injector_thread(void *data)
+{
+	struct injector *injector = data;
+	uint64_t interval = 1000000000ULL / injector->rate;
+	uint64_t deadline = bench_now_ns();
+	unsigned int frame = 0;
+
+	while (!atomic_load(injector->stop)) {
+		for (size_t i = 0; i < injector->ndevices; i++) {
+			struct libevdev_uinput *u = injector->devices[i];
+
+			libevdev_uinput_write_event(u, EV_ABS, ABS_X,
+						    frame % 2 ? 32767 : -32768);
+			libevdev_uinput_write_event(u, EV_SYN, SYN_REPORT, 0);
+		}
+		frame++;
+
+		deadline += interval;
+		sleep_until(deadline);
+	}
+
+	return NULL;
+}
+
+static void
+usage(void)
+{
+	printf("Usage: bench-latency [options]\n"
+	       "  --name=NAME            the name used in the JSON output\n"
+	       "  --rate=HZ              frame rate of the measured device (default: 1000)\n"
+	       "  --noise-devices=N      number of background devices, 0-%d (default: 4)\n"
+	       "  --noise-rate=HZ        frame rate of each background device (default: 1000)\n"
+	       "  --samples=N            number of frames to measure (default: 5000)\n"
+	       "  --output=FILE          append the JSON result to FILE\n",
+	       MAX_NOISE_DEVICES);
+}
+
+static int
+parse_options(int argc, char **argv, struct options *opts)
+{
+	enum {
+		OPT_NAME,
+		OPT_RATE,
+		OPT_NOISE_DEVICES,
+		OPT_NOISE_RATE,
+		OPT_SAMPLES,
+		OPT_OUTPUT,
+	};
+	static const struct option long_options[] = {
+		{ "name", required_argument, 0, OPT_NAME },
+		{ "rate", required_argument, 0, OPT_RATE },
+		{ "noise-devices", required_argument, 0, OPT_NOISE_DEVICES },
+		{ "noise-rate", required_argument, 0, OPT_NOISE_RATE },
+		{ "samples", required_argument, 0, OPT_SAMPLES },
+		{ "output", required_argument, 0, OPT_OUTPUT },
+		{ "help", no_argument, 0, 'h' },
+		{ 0, 0, 0, 0 },
+	};
+
+	while (1) {
+		int c = getopt_long(argc, argv, "h", long_options, NULL);
+
+		if (c == -1)
+			break;
+
+		switch (c) {
+		case OPT_NAME:
+			opts->name = optarg;
+			break;
+		case OPT_RATE:
+			opts->rate = atoi(optarg);
+			break;
+		case OPT_NOISE_DEVICES:
+			opts->noise_devices = atoi(optarg);
+			break;
+		case OPT_NOISE_RATE:
+			opts->noise_rate = atoi(optarg);
+			break;
+		case OPT_SAMPLES:
+			opts->samples = atoi(optarg);
+			break;
+		case OPT_OUTPUT:
+			opts->output = optarg;
+			break;
+		case 'h':
+			usage();
+			exit(0);
+		default:
+			usage();
+			return -1;
+		}
+	}
+
+	if (opts->rate < 1 || opts->samples < 1 ||
+	    opts->noise_devices > MAX_NOISE_DEVICES ||
+	    (opts->noise_devices > 0 && opts->noise_rate < 1)) {
+		usage();
+		return -1;
+	}
+
+	return 0;
+}
+
+int
+main(int argc, char **argv)
+{
+	struct options opts = {
+		.name = "latency",
+		.rate = 1000,
+		.noise_devices = 4,
+		.noise_rate = 1000,
+		.samples = 5000,
+	};
+	static struct js_histogram histogram;
+	struct libevdev_uinput *target;
+	struct libevdev_uinput *noise[MAX_NOISE_DEVICES];
+	struct injector target_injector, noise_injector;
+	struct js_device *target_device;
+	struct js_ctx *ctx;
+	atomic_bool stop = false;
+	char buckets[8192];
+	int rc = 0;
+
+	if (parse_options(argc, argv, &opts) != 0)
+		return 1;
+
+	if (access("/dev/uinput", R_OK | W_OK) != 0) {
+		printf("Skipping, /dev/uinput is not available: %m\n");
+		return EXIT_SKIP;
+	}
+
+	target = create_gamepad("libjoystick latency gamepad");
+	if (!target)
+		return EXIT_SKIP;
+
+	for (unsigned int i = 0; i < opts.noise_devices; i++) {
+		noise[i] = create_gamepad("libjoystick latency noise");
+		if (!noise[i]) {
+			opts.noise_devices = i;
+			rc = EXIT_SKIP;
+			goto out;
+		}
+	}
+
+	ctx = js_ctx_path_create_context(&interface, NULL);
+	target_device = js_ctx_path_add_device(ctx,
+					       libevdev_uinput_get_devnode(target));
+	if (!target_device) {
+		printf("Skipping, failed to open %s\n",
+		       libevdev_uinput_get_devnode(target));
+		js_ctx_unref(ctx);
+		rc = EXIT_SKIP;
+		goto out;
+	}
+
+	for (unsigned int i = 0; i < opts.noise_devices; i++) {
+		if (!js_ctx_path_add_device(ctx,
+					    libevdev_uinput_get_devnode(noise[i]))) {
+			js_ctx_unref(ctx);
+			rc = EXIT_SKIP;
+			goto out;
+		}
+	}
+
+	target_injector = (struct injector) {
+		.devices = &target,
+		.ndevices = 1,
+		.rate = opts.rate,
+		.stop = &stop,
+	};
+	noise_injector = (struct injector) {
+		.devices = noise,
+		.ndevices = opts.noise_devices,
+		.rate = opts.noise_rate,
+		.stop = &stop,
+	};
+
+	pthread_create(&target_injector.thread, NULL,
+		       injector_thread, &target_injector);
+	if (opts.noise_devices > 0)
+		pthread_create(&noise_injector.thread, NULL,
+			       injector_thread, &noise_injector);
+
+	while (histogram.count < opts.samples) {
+		struct pollfd fds = {
+			.fd = js_ctx_get_fd(ctx),
+			.events = POLLIN,
+		};
+		struct js_event *event;
+
+		if (poll(&fds, 1, 1000) == 0) {
+			fprintf(stderr, "Timeout waiting for events\n");
+			rc = 1;
+			break;
+		}
+
+		js_ctx_dispatch(ctx);
+		while ((event = js_ctx_get_event(ctx))) {
+			uint64_t now = bench_now_ns();
+
+			if (js_event_get_type(event) == JS_EVENT_SYNC &&
+			    js_event_get_device(event) == target_device) {
+				uint64_t time = js_event_get_time_usec(event) * 1000;
+
+				js_histogram_record(&histogram,
+						       now > time ? now - time : 0);
+			}
+			js_event_destroy(event);
+		}
+	}
+
+	atomic_store(&stop, true);
+	pthread_join(target_injector.thread, NULL);
+	if (opts.noise_devices > 0)
+		pthread_join(noise_injector.thread, NULL);
+
+	js_ctx_unref(ctx);
+
+	if (rc == 0) {
+		bench_histogram_format(&histogram, buckets, sizeof(buckets));
+		bench_print_json(opts.output,
+				 "\"name\": \"%s\", "
+				 "\"rate\": %u, "
+				 "\"noise_devices\": %u, "
+				 "\"noise_rate\": %u, "
+				 "\"samples\": %" PRIu64 ", "
+				 "\"min_ns\": %" PRIu64 ", "
+				 "\"p50_ns\": %" PRIu64 ", "
+				 "\"p99_ns\": %" PRIu64 ", "
+				 "\"p999_ns\": %" PRIu64 ", "
+				 "\"max_ns\": %" PRIu64 ", "
+				 "\"histogram_ns\": %s",
+				 opts.name,
+				 opts.rate,
+				 opts.noise_devices,
+				 opts.noise_rate,
+				 histogram.count,
+				 histogram.min,
+				 js_histogram_percentile(&histogram, 50.0),
+				 js_histogram_percentile(&histogram, 99.0),
+				 js_histogram_percentile(&histogram, 99.9),
+				 histogram.max,
+				 buckets);
+	}
+
+out:
+	for (unsigned int i = 0; i < opts.noise_devices; i++)
+		libevdev_uinput_destroy(noise[i]);
+	libevdev_uinput_destroy(target);
+
+	return rc;
+}
@@ -0,0 +1,268 @@
+/*
+ * Copyright © 2019 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+/*
+ * Startup benchmark.
+ *
+ * A temporary directory is filled with links to the test suite's device
+ * descriptions, this is our fake device tree. Each iteration creates a
+ * mock context, assigns the directory as seat and dispatches until all
+ * JS_EVENT_DEVICE_ADDED events have been retrieved. The time spent in
+ * each phase of the device setup is reported separately.
+ */
+
+#include "config.h"
+
+#include <getopt.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "libjoystick-private.h"
+#include "mock-backend.h"
+#include "bench-util.h"
+
+#define MAX_DEVICES 1024
+
+static const char *device_descriptions[] = {
+	"microsoft-xbox-360-pad",
+	"sony-dualshock-4",
+	"logitech-extreme-3d-pro",
+	"generic-racing-wheel",
+};
+
+struct options {
+	const char *name;
+	const char *output;
+	unsigned int ndevices;
+	unsigned int iterations;
+};
+
+static char *
+create_device_tree(unsigned int ndevices)
+{
+	char *dir = safe_strdup("/tmp/libjoystick-bench-XXXXXX");
+
+	if (!mkdtemp(dir)) {
+		perror("Failed to create the device directory");
+		exit(1);
+	}
+
+	for (unsigned int i = 0; i < ndevices; i++) {
+		char *target, *link;
+		const char *name = device_descriptions[i % ARRAY_LENGTH(device_descriptions)];
+
+		if (asprintf(&target, "%s/devices/%s.evemu",
+			     JS_TEST_DATA_DIR, name) < 0 ||
+		    asprintf(&link, "%s/event%04u.evemu", dir, i) < 0)
+			abort();
+
+		if (symlink(target, link) != 0) {
+			perror(link);
+			exit(1);
+		}
+
+		free(target);
+		free(link);
+	}
+
+	return dir;
+}
+
+static void
+remove_device_tree(char *dir, unsigned int ndevices)
+{
+	for (unsigned int i = 0; i < ndevices; i++) {
+		char *link;
+
+		if (asprintf(&link, "%s/event%04u.evemu", dir, i) < 0)
+			abort();
+		unlink(link);
+		free(link);
+	}
+
+	rmdir(dir);
+	zfree(dir);
+}
+
+static int
+compare_u64(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static void
+usage(void)
+{
+	printf("Usage: bench-startup [options]\n"
+	       "  --name=NAME            the name used in the JSON output\n"
+	       "  --devices=N            number of devices, 1-%d (default: 1)\n"
+	       "  --iterations=N         number of startups (default: 100)\n"
+	       "  --output=FILE          append the JSON result to FILE\n",
+	       MAX_DEVICES);
+}
+
+static int
+parse_options(int argc, char **argv, struct options *opts)
+{
+	enum {
+		OPT_NAME,
+		OPT_DEVICES,
+		OPT_ITERATIONS,
+		OPT_OUTPUT,
+	};
+	static const struct option long_options[] = {
+		{ "name", required_argument, 0, OPT_NAME },
+		{ "devices", required_argument, 0, OPT_DEVICES },
+		{ "iterations", required_argument, 0, OPT_ITERATIONS },
+		{ "output", required_argument, 0, OPT_OUTPUT },
+		{ "help", no_argument, 0, 'h' },
+		{ 0, 0, 0, 0 },
+	};
+
+	while (1) {
+		int c = getopt_long(argc, argv, "h", long_options, NULL);
+
+		if (c == -1)
+			break;
+
+		switch (c) {
+		case OPT_NAME:
+			opts->name = optarg;
+			break;
+		case OPT_DEVICES:
+			opts->ndevices = atoi(optarg);
+			break;
+		case OPT_ITERATIONS:
+			opts->iterations = atoi(optarg);
+			break;
+		case OPT_OUTPUT:
+			opts->output = optarg;
+			break;
+		case 'h':
+			usage();
+			exit(0);
+		default:
+			usage();
+			return -1;
+		}
+	}
+
+	if (opts->ndevices < 1 || opts->ndevices > MAX_DEVICES ||
+	    opts->iterations < 1) {
+		usage();
+		return -1;
+	}
+
+	return 0;
+}
+
+int
+main(int argc, char **argv)
+{
+	struct options opts = {
+		.name = "startup",
+		.ndevices = 1,
+		.iterations = 100,
+	};
+	struct mock_startup_times times = {0};
+	struct bench_counters start, end, counters = {0};
+	uint64_t *totals;
+	uint64_t teardown = 0;
+	char *dir;
+
+	if (parse_options(argc, argv, &opts) != 0)
+		return 1;
+
+	dir = create_device_tree(opts.ndevices);
+	totals = zalloc(opts.iterations * sizeof(*totals));
+
+	for (unsigned int it = 0; it < opts.iterations; it++) {
+		unsigned int nadded = 0;
+		struct js_ctx *ctx;
+		uint64_t t0, t1;
+
+		bench_counters_get(&start);
+		t0 = bench_now_ns();
+
+		ctx = mock_ctx_new();
+		if (mock_ctx_assign_seat(ctx, dir, &times) != (int)opts.ndevices) {
+			fprintf(stderr, "Failed to add all devices\n");
+			return 1;
+		}
+
+		while (nadded < opts.ndevices) {
+			struct js_event *event;
+
+			js_ctx_dispatch(ctx);
+			while ((event = js_ctx_get_event(ctx))) {
+				if (js_event_get_type(event) ==
+				    JS_EVENT_DEVICE_ADDED)
+					nadded++;
+				js_event_destroy(event);
+			}
+		}
+
+		t1 = bench_now_ns();
+		totals[it] = t1 - t0;
+		bench_counters_get(&end);
+		bench_counters_accumulate(&counters, &start, &end);
+
+		js_ctx_unref(ctx);
+		teardown += bench_now_ns() - t1;
+	}
+
+	remove_device_tree(dir, opts.ndevices);
+
+	qsort(totals, opts.iterations, sizeof(*totals), compare_u64);
+
+	bench_print_json(opts.output,
+			 "\"name\": \"%s\", "
+			 "\"devices\": %u, "
+			 "\"iterations\": %u, "
+			 "\"enumerate_ns\": %" PRIu64 ", "
+			 "\"open_ns\": %" PRIu64 ", "
+			 "\"probe_ns\": %" PRIu64 ", "
+			 "\"classify_ns\": %" PRIu64 ", "
+			 "\"add_ns\": %" PRIu64 ", "
+			 "\"total_ns\": %" PRIu64 ", "
+			 "\"total_ns_min\": %" PRIu64 ", "
+			 "\"teardown_ns\": %" PRIu64 ", "
+			 "\"allocations_per_device\": %.2f, "
+			 "\"syscalls_per_device\": %.2f",
+			 opts.name,
+			 opts.ndevices,
+			 opts.iterations,
+			 times.enumerate_ns / opts.iterations,
+			 times.open_ns / opts.iterations,
+			 times.probe_ns / opts.iterations,
+			 times.classify_ns / opts.iterations,
+			 times.add_ns / opts.iterations,
+			 totals[opts.iterations / 2],
+			 totals[0],
+			 teardown / opts.iterations,
+			 (double)counters.allocations / opts.iterations / opts.ndevices,
+			 (double)counters.syscalls / opts.iterations / opts.ndevices);
+
+	zfree(totals);
+
+	return 0;
+}
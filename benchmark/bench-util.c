@@ -0,0 +1,224 @@
+/*
+ * Copyright © 2019 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#include "config.h"
+
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+#include "bench-util.h"
+
+static struct bench_counters counters;
+
+/* The linker redirects the calls to these, see meson.build */
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t nmemb, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void __real_free(void *ptr);
+ssize_t __real_read(int fd, void *buf, size_t count);
+ssize_t __real_write(int fd, const void *buf, size_t count);
+int __real_epoll_wait(int epfd, struct epoll_event *events,
+		      int maxevents, int timeout);
+int __real_epoll_ctl(int epfd, int op, int fd, struct epoll_event *event);
+int __real_close(int fd);
+
+void *__wrap_malloc(size_t size);
+void *__wrap_calloc(size_t nmemb, size_t size);
+void *__wrap_realloc(void *ptr, size_t size);
+void __wrap_free(void *ptr);
+ssize_t __wrap_read(int fd, void *buf, size_t count);
+ssize_t __wrap_write(int fd, const void *buf, size_t count);
+int __wrap_epoll_wait(int epfd, struct epoll_event *events,
+		      int maxevents, int timeout);
+int __wrap_epoll_ctl(int epfd, int op, int fd, struct epoll_event *event);
+int __wrap_close(int fd);
+
+void *
+__wrap_malloc(size_t size)
+{
+	counters.allocations++;
+	return __real_malloc(size);
+}
+
+void *
+__wrap_calloc(size_t nmemb, size_t size)
+{
+	counters.allocations++;
+	return __real_calloc(nmemb, size);
+}
+
+void *
+__wrap_realloc(void *ptr, size_t size)
+{
+	counters.allocations++;
+	return __real_realloc(ptr, size);
+}
+
+void
+__wrap_free(void *ptr)
+{
+	if (ptr)
+		counters.frees++;
+	__real_free(ptr);
+}
+
+ssize_t
+__wrap_read(int fd, void *buf, size_t count)
+{
+	counters.syscalls++;
+	return __real_read(fd, buf, count);
+}
+
+ssize_t
+__wrap_write(int fd, const void *buf, size_t count)
+{
+	counters.syscalls++;
+	return __real_write(fd, buf, count);
+}
+
+int
+__wrap_epoll_wait(int epfd, struct epoll_event *events,
+		  int maxevents, int timeout)
+{
+	counters.syscalls++;
+	return __real_epoll_wait(epfd, events, maxevents, timeout);
+}
+
+int
+__wrap_epoll_ctl(int epfd, int op, int fd, struct epoll_event *event)
+{
+	counters.syscalls++;
+	return __real_epoll_ctl(epfd, op, fd, event);
+}
+
+int
+__wrap_close(int fd)
+{
+	counters.syscalls++;
+	return __real_close(fd);
+}
+
+void
+bench_counters_get(struct bench_counters *c)
+{
+	*c = counters;
+}
+
+void
+bench_counters_accumulate(struct bench_counters *total,
+			  const struct bench_counters *start,
+			  const struct bench_counters *end)
+{
+	total->allocations += end->allocations - start->allocations;
+	total->frees += end->frees - start->frees;
+	total->syscalls += end->syscalls - start->syscalls;
+}
+
+static void
+bench_print_json_va(FILE *fp, const char *format, va_list args)
+{
+	fprintf(fp, "{");
+	vfprintf(fp, format, args);
+	fprintf(fp, "}\n");
+}
+
+void
+bench_print_json(const char *output, const char *format, ...)
+{
+	va_list args;
+
+	va_start(args, format);
+	bench_print_json_va(stdout, format, args);
+	va_end(args);
+
+	if (output) {
+		FILE *fp = fopen(output, "a");
+
+		if (!fp) {
+			perror(output);
+			return;
+		}
+
+		va_start(args, format);
+		bench_print_json_va(fp, format, args);
+		va_end(args);
+		fclose(fp);
+	}
+}
+
+void
+bench_result_print(const struct bench_result *result,
+		   const char *output,
+		   const char *extra_format, ...)
+{
+	double nevents = result->input_events ? result->input_events : 1;
+	char extra[512];
+	va_list args;
+
+	va_start(args, extra_format);
+	vsnprintf(extra, sizeof(extra), extra_format, args);
+	va_end(args);
+
+	bench_print_json(output,
+			 "\"name\": \"%s\", %s%s"
+			 "\"input_events\": %" PRIu64 ", "
+			 "\"events\": %" PRIu64 ", "
+			 "\"elapsed_ns\": %" PRIu64 ", "
+			 "\"events_per_sec\": %.1f, "
+			 "\"ns_per_event\": %.2f, "
+			 "\"allocations_per_event\": %.4f, "
+			 "\"frees_per_event\": %.4f, "
+			 "\"syscalls_per_event\": %.4f",
+			 result->name,
+			 extra, *extra ? ", " : "",
+			 result->input_events,
+			 result->events,
+			 result->elapsed_ns,
+			 result->elapsed_ns ?
+				 result->input_events * 1e9 / result->elapsed_ns : 0.0,
+			 result->elapsed_ns / nevents,
+			 result->counters.allocations / nevents,
+			 result->counters.frees / nevents,
+			 result->counters.syscalls / nevents);
+}
+
+void
+bench_histogram_format(const struct js_histogram *h,
+		       char *buf, size_t size)
+{
+	uint64_t upper_bound, count;
+	size_t len = 0;
+
+	len += snprintf(buf + len, size - len, "[");
+	for (unsigned int i = 0;
+	     len < size && js_histogram_get_bucket(h, i, &upper_bound, &count);
+	     i++) {
+		len += snprintf(buf + len, size - len,
+				"%s[%" PRIu64 ", %" PRIu64 "]",
+				i == 0 ? "" : ", ",
+				upper_bound, count);
+	}
+	if (len < size)
+		snprintf(buf + len, size - len, "]");
+}
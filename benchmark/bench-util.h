@@ -0,0 +1,93 @@
+/*
+ * Copyright © 2019 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "histogram.h"
+
+/**
+ * Counters for the calls libjoystick makes into libc. Only calls from
+ * objects linked with the --wrap flags are counted, i.e. libjoystick
+ * itself and the mock backend but not other shared libraries.
+ */
+struct bench_counters {
+	uint64_t allocations;	/* malloc, calloc, realloc */
+	uint64_t frees;
+	uint64_t syscalls;	/* read, write, close, epoll_wait, epoll_ctl */
+};
+
+struct bench_result {
+	const char *name;
+	uint64_t input_events;	/* struct input_event written */
+	uint64_t events;	/* struct js_event returned */
+	uint64_t elapsed_ns;
+	struct bench_counters counters;
+};
+
+static inline uint64_t
+bench_now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+void
+bench_counters_get(struct bench_counters *counters);
+
+/**
+ * Add the difference between start and end to total.
+ */
+void
+bench_counters_accumulate(struct bench_counters *total,
+			  const struct bench_counters *start,
+			  const struct bench_counters *end);
+
+/**
+ * Print a single-line JSON object to stdout and, if output is not NULL,
+ * append it to the file. The format string is the object's members
+ * without the enclosing braces.
+ */
+void
+bench_print_json(const char *output, const char *format, ...)
+	__attribute__((format(printf, 2, 3)));
+
+/**
+ * Print the result with bench_print_json(). The extra format string is
+ * inserted verbatim as additional JSON members.
+ */
+void
+bench_result_print(const struct bench_result *result,
+		   const char *output,
+		   const char *extra_format, ...)
+	__attribute__((format(printf, 3, 4)));
+
+/**
+ * Format the non-empty buckets as JSON array of [upper bound, count]
+ * pairs into buf.
+ */
+void
+bench_histogram_format(const struct js_histogram *h,
+		       char *buf, size_t size);
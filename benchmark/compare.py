@@ -0,0 +1,94 @@
+#!/usr/bin/env python3
+#
+# Copyright © 2019 Red Hat, Inc.
+#
+# This library is free software; you can redistribute it and/or
+# modify it under the terms of the GNU Lesser General Public
+# License as published by the Free Software Foundation; either
+# version 2.1 of the License, or (at your option) any later version.
+#
+# This library is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+# Lesser General Public License for more details.
+#
+# You should have received a copy of the GNU Lesser General Public
+# License along with this library; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+# MA 02110-1301 USA
+#
+# Compare benchmark results against a baseline and flag regressions.
+#
+# Both files contain one JSON object per line as written by the
+# benchmarks' --output option. Results are matched by their "name".
+# Timings are compared with a relative threshold, the allocation and
+# syscall counts are deterministic and any increase is a regression.
+#
+# Usage: compare.py [--threshold=PERCENT] baseline.json results.json
+
+import argparse
+import json
+import sys
+
+TIMED_KEYS = ['ns_per_event', 'total_ns']
+COUNTED_KEYS = ['allocations_per_event', 'syscalls_per_event',
+                'allocations_per_device', 'syscalls_per_device']
+
+
+def load(path):
+    results = {}
+    with open(path) as f:
+        for line in f:
+            line = line.strip()
+            if not line or line.startswith('#'):
+                continue
+            result = json.loads(line)
+            # later runs override earlier ones
+            results[result['name']] = result
+    return results
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Compare benchmark results')
+    parser.add_argument('--threshold', type=float, default=10.0,
+                        help='allowed slowdown in percent (default: 10)')
+    parser.add_argument('baseline')
+    parser.add_argument('results')
+    args = parser.parse_args()
+
+    baseline = load(args.baseline)
+    results = load(args.results)
+    regressions = 0
+
+    for name, result in sorted(results.items()):
+        base = baseline.get(name)
+        if base is None:
+            print('{}: no baseline'.format(name))
+            continue
+
+        for key in TIMED_KEYS + COUNTED_KEYS:
+            old, new = base.get(key), result.get(key)
+            if old is None or new is None:
+                continue
+
+            change = (new - old) / old * 100 if old else 0.0
+            if key in TIMED_KEYS:
+                regressed = change > args.threshold
+            else:
+                regressed = new > old + 1e-4
+
+            print('{:<32} {:<24} {:>12.4f} -> {:>12.4f} ({:+6.1f}%){}'.format(
+                  name, key, old, new, change,
+                  '  REGRESSION' if regressed else ''))
+            if regressed:
+                regressions += 1
+
+    if regressions:
+        print('{} regression(s)'.format(regressions))
+        return 1
+
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,194 @@
+/*
+ * Copyright © 2019 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+/*
+ * Training workload for profile-guided optimization, see the
+ * "Optimized builds" section in the README.
+ *
+ * The recorded sessions in test/recordings are replayed through the mock
+ * backend and the whole dispatch pipeline, and the events are consumed
+ * the way a game would: every control of the device is queried on every
+ * event. Every few iterations, one device is unplugged and plugged back
+ * in and the statistics are read, so the profile has the cold paths
+ * too, at roughly their real-world weight.
+ */
+
+#include "config.h"
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "mock-backend.h"
+
+static const struct session {
+	const char *device;
+	const char *recording;
+} sessions[] = {
+	{ "microsoft-xbox-360-pad", "xbox-360-pad-buttons" },
+	{ "sony-dualshock-4", "sony-dualshock-4-gameplay" },
+	{ "generic-racing-wheel", "generic-racing-wheel-lap" },
+	{ "logitech-extreme-3d-pro", "logitech-extreme-3d-pro-flight" },
+};
+
+#define NSESSIONS (sizeof(sessions)/sizeof(sessions[0]))
+
+static void
+consume_event(struct js_ctx *ctx, struct js_event *event)
+{
+	struct js_device *device = js_event_get_device(event);
+	unsigned int n;
+
+	switch (js_event_get_type(event)) {
+	case JS_EVENT_BUTTON:
+		n = js_device_get_button_count(device);
+		for (unsigned int i = 0; i < n; i++) {
+			struct js_button *button = js_device_get_button(device, i);
+			uint16_t value;
+			bool state;
+
+			if (js_event_button_state_has_changed(event, button))
+				js_event_button_get_state(event, button, &state);
+			if (js_event_button_value_has_changed(event, button))
+				js_event_button_get_value(event, button, &value);
+		}
+		break;
+	case JS_EVENT_AXIS:
+		n = js_device_get_axis_count(device);
+		for (unsigned int i = 0; i < n; i++) {
+			struct js_axis *axis = js_device_get_axis(device, i);
+			int16_t x, y, z;
+
+			if (js_event_axis_has_changed(event, axis))
+				js_event_axis_get_value(event, axis, &x, &y, &z);
+		}
+		break;
+	case JS_EVENT_DPAD:
+		n = js_device_get_dpad_count(device);
+		for (unsigned int i = 0; i < n; i++) {
+			uint32_t state;
+
+			js_event_dpad_get_state(event,
+						js_device_get_dpad(device, i),
+						&state);
+		}
+		break;
+	case JS_EVENT_SYNC:
+		js_ctx_mark_consumed(ctx, js_event_get_frame_id(event));
+		break;
+	default:
+		break;
+	}
+}
+
+static unsigned int
+dispatch_and_consume(struct js_ctx *ctx)
+{
+	struct js_event *event;
+	unsigned int nevents = 0;
+
+	js_ctx_dispatch(ctx);
+	while ((event = js_ctx_get_event(ctx))) {
+		consume_event(ctx, event);
+		js_event_destroy(event);
+		nevents++;
+	}
+
+	return nevents;
+}
+
+static void
+usage(void)
+{
+	printf("Usage: pgo-train [options]\n"
+	       "  --iterations=N         number of times each session is replayed (default: 50)\n");
+}
+
+int
+main(int argc, char **argv)
+{
+	enum {
+		OPT_ITERATIONS,
+	};
+	static const struct option long_options[] = {
+		{ "iterations", required_argument, 0, OPT_ITERATIONS },
+		{ "help", no_argument, 0, 'h' },
+		{ 0, 0, 0, 0 },
+	};
+	struct mock_device *devices[NSESSIONS];
+	unsigned int iterations = 50;
+	uint64_t nevents = 0;
+	struct js_ctx *ctx;
+
+	while (1) {
+		int c = getopt_long(argc, argv, "h", long_options, NULL);
+
+		if (c == -1)
+			break;
+
+		switch (c) {
+		case OPT_ITERATIONS:
+			iterations = atoi(optarg);
+			break;
+		case 'h':
+			usage();
+			return 0;
+		default:
+			usage();
+			return 1;
+		}
+	}
+
+	ctx = mock_ctx_new();
+	for (size_t i = 0; i < NSESSIONS; i++)
+		devices[i] = mock_device_new(ctx, sessions[i].device);
+	dispatch_and_consume(ctx);
+
+	for (unsigned int it = 0; it < iterations; it++) {
+		for (size_t i = 0; i < NSESSIONS; i++) {
+			int rc = mock_device_play(devices[i],
+						  sessions[i].recording);
+
+			if (rc < 0) {
+				fprintf(stderr, "Failed to replay %s: %d\n",
+					sessions[i].recording, rc);
+				return 1;
+			}
+			nevents += dispatch_and_consume(ctx);
+		}
+
+		if (it % 10 == 9) {
+			size_t i = (it / 10) % NSESSIONS;
+
+			mock_device_unplug(devices[i]);
+			dispatch_and_consume(ctx);
+			devices[i] = mock_device_plug(ctx, sessions[i].device);
+			dispatch_and_consume(ctx);
+
+			js_stats_destroy(js_ctx_get_stats(ctx));
+		}
+	}
+
+	js_ctx_unref(ctx);
+
+	printf("pgo-train: %u iterations, %llu events\n",
+	       iterations, (unsigned long long)nevents);
+
+	return 0;
+}
@@ -0,0 +1,1294 @@
+/*
+ * Copyright © 2019 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#include "config.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include "libjoystick-private.h"
+#include "simd.h"
+
+/* Logical state thresholds for analog buttons, the gap between the two
+ * avoids jitter around a single threshold */
+#define BUTTON_PRESS_THRESHOLD 0x8000
+#define BUTTON_RELEASE_THRESHOLD 0x4000
+
+#define BUTTON_CAP(c_) js_button_cap_bit(JS_BUTTON_CAP_##c_)
+
+static const struct button_description {
+	unsigned int code;
+	uint32_t capabilities;
+	int priority;
+} button_descriptions[] = {
+	{ BTN_SOUTH,	BUTTON_CAP(OK), 3 },
+	{ BTN_EAST,	BUTTON_CAP(CANCEL), 3 },
+	{ BTN_NORTH,	0, 3 },
+	{ BTN_WEST,	0, 3 },
+	{ BTN_C,	0, 3 },
+	{ BTN_Z,	0, 3 },
+	{ BTN_TL,	BUTTON_CAP(LEFT) | BUTTON_CAP(SHOULDER), 2 },
+	{ BTN_TR,	BUTTON_CAP(RIGHT) | BUTTON_CAP(SHOULDER), 2 },
+	{ BTN_TL2,	BUTTON_CAP(LEFT) | BUTTON_CAP(TRIGGER), 1 },
+	{ BTN_TR2,	BUTTON_CAP(RIGHT) | BUTTON_CAP(TRIGGER), 1 },
+	{ BTN_SELECT,	BUTTON_CAP(SELECT) | BUTTON_CAP(BACK), 0 },
+	{ BTN_START,	BUTTON_CAP(START) | BUTTON_CAP(FORWARD), 0 },
+	{ BTN_MODE,	BUTTON_CAP(SYSTEM), 0 },
+	{ BTN_THUMBL,	BUTTON_CAP(LEFT), 1 },
+	{ BTN_THUMBR,	BUTTON_CAP(RIGHT), 1 },
+	{ BTN_TRIGGER,	BUTTON_CAP(TRIGGER), 3 },
+	{ BTN_THUMB,	0, 2 },
+	{ BTN_GEAR_DOWN, BUTTON_CAP(LEFT), 2 },
+	{ BTN_GEAR_UP,	BUTTON_CAP(RIGHT), 2 },
+};
+
+/* Gamepads commonly expose the analog triggers as absolute axes, the
+ * digital button (if any) is merged into the analog one */
+static const struct trigger_description {
+	unsigned int code;
+	unsigned int button;
+	uint32_t capabilities;
+} trigger_descriptions[] = {
+	{ ABS_Z,	BTN_TL2, BUTTON_CAP(LEFT) },
+	{ ABS_BRAKE,	BTN_TL2, BUTTON_CAP(LEFT) },
+	{ ABS_RZ,	BTN_TR2, BUTTON_CAP(RIGHT) },
+	{ ABS_GAS,	BTN_TR2, BUTTON_CAP(RIGHT) },
+};
+
+static const int axis_descriptions[][3] = {
+	{ ABS_X, ABS_Y, ABS_Z },
+	{ ABS_RX, ABS_RY, ABS_RZ },
+	{ ABS_THROTTLE, -1, -1 },
+	{ ABS_RUDDER, -1, -1 },
+	{ ABS_WHEEL, -1, -1 },
+	{ ABS_GAS, -1, -1 },
+	{ ABS_BRAKE, -1, -1 },
+};
+
+static const struct hat_description {
+	unsigned int x, y;
+} hat_descriptions[] = {
+	{ ABS_HAT0X, ABS_HAT0Y },
+	{ ABS_HAT1X, ABS_HAT1Y },
+	{ ABS_HAT2X, ABS_HAT2Y },
+	{ ABS_HAT3X, ABS_HAT3Y },
+};
+
+static const struct dpad_button_description {
+	unsigned int code;
+	uint32_t direction;
+} dpad_button_descriptions[] = {
+	{ BTN_DPAD_UP,		JS_DPAD_N },
+	{ BTN_DPAD_RIGHT,	JS_DPAD_E },
+	{ BTN_DPAD_DOWN,	JS_DPAD_S },
+	{ BTN_DPAD_LEFT,	JS_DPAD_W },
+};
+
+static void
+evdev_process_key(struct js_device *device, unsigned int code, int value);
+static void
+evdev_process_abs(struct js_device *device, unsigned int code, int value);
+
+static inline struct js_control_map *
+key_map(struct js_device *device, unsigned int code)
+{
+	if (code < JS_KEY_MAP_FIRST || code > JS_KEY_MAP_LAST)
+		return NULL;
+
+	return &device->key_map[code - JS_KEY_MAP_FIRST];
+}
+
+static inline bool
+is_gamepad(struct js_device *device)
+{
+	return !!(device->types & js_type_bit(JS_TYPE_GAMEPAD));
+}
+
+static inline bool
+is_dpad_button(unsigned int code)
+{
+	return code >= BTN_DPAD_UP && code <= BTN_DPAD_RIGHT;
+}
+
+static inline bool
+is_button_code(struct js_device *device, unsigned int code)
+{
+	/* BTN_DIGI is for tablets and touchscreens */
+	if (code >= BTN_DIGI && code < BTN_WHEEL)
+		return false;
+
+	if (is_dpad_button(code))
+		return false;
+
+	if (code > BTN_GEAR_UP && code < BTN_TRIGGER_HAPPY)
+		return false;
+
+	return libevdev_has_event_code(device->evdev, EV_KEY, code);
+}
+
+static const struct trigger_description *
+trigger_description(struct js_device *device, unsigned int code)
+{
+	const struct trigger_description *t;
+
+	if (!is_gamepad(device))
+		return NULL;
+
+	ARRAY_FOR_EACH(trigger_descriptions, t) {
+		if (t->code == code)
+			return t;
+	}
+
+	return NULL;
+}
+
+static bool
+is_trigger_axis(struct js_device *device, unsigned int code)
+{
+	return trigger_description(device, code) != NULL &&
+	       libevdev_has_event_code(device->evdev, EV_ABS, code);
+}
+
+/* zalloc() and add the size to the given memory usage counter */
+static inline void *
+accounted_zalloc(size_t *account, size_t size)
+{
+	*account += size;
+	return zalloc(size);
+}
+
+/* An array of the device, from device->storage if the build has fixed
+ * capacities, see JS_FIXED_CONTROLS */
+#if JS_FIXED_CONTROLS
+#define device_array(device_, account_, field_, size_) \
+	(assert((size_) <= sizeof((device_)->storage.field_)), \
+	 *(account_) += sizeof((device_)->storage.field_), \
+	 (void *)(device_)->storage.field_)
+#else
+#define device_array(device_, account_, field_, size_) \
+	accounted_zalloc(account_, size_)
+#endif
+
+static void
+evdev_device_classify_type(struct js_device *device)
+{
+	struct libevdev *evdev = device->evdev;
+	const char *name = libevdev_get_name(evdev);
+	uint32_t types = 0;
+
+	if (libevdev_has_event_code(evdev, EV_KEY, BTN_GAMEPAD))
+		types |= js_type_bit(JS_TYPE_GAMEPAD);
+
+	if (libevdev_has_event_code(evdev, EV_KEY, BTN_JOYSTICK) ||
+	    (!(types & js_type_bit(JS_TYPE_GAMEPAD)) &&
+	     libevdev_has_event_code(evdev, EV_ABS, ABS_X) &&
+	     libevdev_has_event_code(evdev, EV_ABS, ABS_Y)))
+		types |= js_type_bit(JS_TYPE_JOYSTICK);
+
+	if (libevdev_has_event_code(evdev, EV_ABS, ABS_WHEEL) ||
+	    libevdev_has_event_code(evdev, EV_KEY, BTN_GEAR_DOWN) ||
+	    libevdev_has_event_code(evdev, EV_KEY, BTN_GEAR_UP))
+		types |= js_type_bit(JS_TYPE_WHEEL);
+
+	if (libevdev_has_event_code(evdev, EV_ABS, ABS_THROTTLE))
+		types |= js_type_bit(JS_TYPE_THROTTLE);
+
+	/* Gamepads use gas/brake for the triggers */
+	if (!(types & js_type_bit(JS_TYPE_GAMEPAD)) &&
+	    (libevdev_has_event_code(evdev, EV_ABS, ABS_GAS) ||
+	     libevdev_has_event_code(evdev, EV_ABS, ABS_BRAKE) ||
+	     libevdev_has_event_code(evdev, EV_ABS, ABS_RUDDER)))
+		types |= js_type_bit(JS_TYPE_PEDALS);
+
+	if (name && strstr(name, "Wii Remote"))
+		types |= js_type_bit(JS_TYPE_REMOTE);
+
+	device->types = types;
+}
+
+static void
+evdev_device_init_button(struct js_device *device,
+			 unsigned int type,
+			 unsigned int code)
+{
+	struct js_button *button = &device->buttons[device->nbuttons];
+	const struct button_description *desc;
+
+	button->device = device;
+	button->index = device->nbuttons;
+	button->type = type;
+	button->code = code;
+
+	ARRAY_FOR_EACH(button_descriptions, desc) {
+		if (desc->code == code) {
+			button->capabilities = desc->capabilities;
+			button->priority = desc->priority;
+			break;
+		}
+	}
+
+	device->nbuttons++;
+}
+
+static void
+evdev_device_classify_buttons(struct js_device *device)
+{
+	const struct trigger_description *t;
+	size_t nbuttons = 0;
+
+	for (unsigned int code = JS_KEY_MAP_FIRST; code <= JS_KEY_MAP_LAST; code++) {
+		if (is_button_code(device, code))
+			nbuttons++;
+	}
+	ARRAY_FOR_EACH(trigger_descriptions, t) {
+		if (is_trigger_axis(device, t->code))
+			nbuttons++;
+	}
+	nbuttons = min(nbuttons, JS_BUTTON_LIMIT);
+
+	device->buttons = device_array(device, &device->memory.descriptors,
+				       buttons,
+				       max(nbuttons, 1U) *
+				       sizeof(*device->buttons));
+
+	for (unsigned int code = JS_KEY_MAP_FIRST; code <= JS_KEY_MAP_LAST; code++) {
+		struct js_control_map *map;
+
+		if (!is_button_code(device, code))
+			continue;
+
+		/* Buttons beyond the compile-time limit are ignored */
+		if (device->nbuttons == nbuttons)
+			break;
+
+		map = key_map(device, code);
+		map->type = JS_CONTROL_BUTTON;
+		map->index = device->nbuttons;
+		evdev_device_init_button(device, EV_KEY, code);
+	}
+
+	ARRAY_FOR_EACH(trigger_descriptions, t) {
+		struct js_control_map *map;
+		struct js_button *button;
+
+		if (!is_trigger_axis(device, t->code))
+			continue;
+
+		/* If we have a digital button for this trigger already,
+		 * it takes its value from the axis instead */
+		map = key_map(device, t->button);
+		if (map->type == JS_CONTROL_BUTTON &&
+		    device->buttons[map->index].type == EV_KEY) {
+			button = &device->buttons[map->index];
+			map->type = JS_CONTROL_NONE;
+		} else if (device->nbuttons < nbuttons) {
+			button = &device->buttons[device->nbuttons];
+			evdev_device_init_button(device, EV_ABS, t->code);
+			button->capabilities = t->capabilities |
+					       BUTTON_CAP(TRIGGER);
+			button->priority = 1;
+		} else {
+			continue;
+		}
+
+		button->type = EV_ABS;
+		button->code = t->code;
+		button->capabilities |= BUTTON_CAP(ANALOG);
+		button->absinfo = *libevdev_get_abs_info(device->evdev, t->code);
+
+		device->abs_map[t->code].type = JS_CONTROL_BUTTON;
+		device->abs_map[t->code].index = button->index;
+	}
+}
+
+static void
+evdev_device_classify_axes(struct js_device *device)
+{
+	const int (*codes)[3];
+
+	size_t naxes = min(ARRAY_LENGTH(axis_descriptions), JS_AXIS_LIMIT);
+
+	device->axes = device_array(device, &device->memory.descriptors, axes,
+				    naxes * sizeof(*device->axes));
+
+	ARRAY_FOR_EACH(axis_descriptions, codes) {
+		struct js_axis *axis = &device->axes[device->naxes];
+		bool have_axis = false;
+
+		/* Axes beyond the compile-time limit are ignored */
+		if (device->naxes == naxes)
+			break;
+
+		for (int dim = 0; dim < 3; dim++) {
+			int code = (*codes)[dim];
+
+			axis->codes[dim] = -1;
+
+			if (code == -1 ||
+			    !libevdev_has_event_code(device->evdev, EV_ABS, code) ||
+			    device->abs_map[code].type != JS_CONTROL_NONE ||
+			    is_trigger_axis(device, code))
+				continue;
+
+			axis->codes[dim] = code;
+			axis->absinfo[dim] = *libevdev_get_abs_info(device->evdev, code);
+			device->abs_map[code].type = JS_CONTROL_AXIS;
+			device->abs_map[code].dim = dim;
+			device->abs_map[code].index = device->naxes;
+			have_axis = true;
+		}
+
+		if (!have_axis)
+			continue;
+
+		axis->device = device;
+		axis->index = device->naxes;
+		axis->capabilities = js_axis_cap_bit(JS_AXIS_CAP_ANALOG);
+
+		if (is_gamepad(device)) {
+			if ((*codes)[0] == ABS_X)
+				axis->capabilities |= js_axis_cap_bit(JS_AXIS_CAP_LEFT);
+			else if ((*codes)[0] == ABS_RX)
+				axis->capabilities |= js_axis_cap_bit(JS_AXIS_CAP_RIGHT);
+		}
+
+		device->naxes++;
+	}
+}
+
+static void
+evdev_device_init_dpad(struct js_device *device)
+{
+	struct js_dpad *dpad = &device->dpads[device->ndpads];
+
+	dpad->device = device;
+	dpad->index = device->ndpads;
+
+	/* The first dpad on a gamepad is the one on the left side */
+	if (dpad->index == 0 && is_gamepad(device))
+		dpad->capabilities = js_dpad_cap_bit(JS_DPAD_CAP_LEFT);
+
+	device->ndpads++;
+}
+
+static void
+evdev_device_classify_dpads(struct js_device *device)
+{
+	const struct dpad_button_description *b;
+	const struct hat_description *h;
+	bool have_dpad_buttons = false;
+
+	device->dpads = device_array(device, &device->memory.descriptors, dpads,
+				     (ARRAY_LENGTH(hat_descriptions) + 1) *
+				     sizeof(*device->dpads));
+
+	ARRAY_FOR_EACH(dpad_button_descriptions, b) {
+		struct js_control_map *map;
+
+		if (!libevdev_has_event_code(device->evdev, EV_KEY, b->code))
+			continue;
+
+		map = key_map(device, b->code);
+		map->type = JS_CONTROL_DPAD;
+		map->dim = __builtin_ctz(b->direction);
+		map->index = device->ndpads;
+		have_dpad_buttons = true;
+	}
+
+	if (have_dpad_buttons)
+		evdev_device_init_dpad(device);
+
+	ARRAY_FOR_EACH(hat_descriptions, h) {
+		bool has_x = libevdev_has_event_code(device->evdev, EV_ABS, h->x),
+		     has_y = libevdev_has_event_code(device->evdev, EV_ABS, h->y);
+
+		if (!has_x && !has_y)
+			continue;
+
+		if (has_x) {
+			device->abs_map[h->x].type = JS_CONTROL_DPAD;
+			device->abs_map[h->x].dim = 0;
+			device->abs_map[h->x].index = device->ndpads;
+		}
+		if (has_y) {
+			device->abs_map[h->y].type = JS_CONTROL_DPAD;
+			device->abs_map[h->y].dim = 1;
+			device->abs_map[h->y].index = device->ndpads;
+		}
+
+		evdev_device_init_dpad(device);
+	}
+}
+
+/* Take the device's current state as our initial state, so the first
+ * frame only contains actual changes */
+static void
+evdev_device_init_state(struct js_device *device)
+{
+	for (unsigned int code = JS_KEY_MAP_FIRST; code <= JS_KEY_MAP_LAST; code++) {
+		if (key_map(device, code)->type != JS_CONTROL_NONE)
+			evdev_process_key(device, code,
+					  libevdev_get_event_value(device->evdev,
+								   EV_KEY,
+								   code));
+	}
+
+	for (unsigned int code = 0; code < ABS_CNT; code++) {
+		if (device->abs_map[code].type != JS_CONTROL_NONE)
+			evdev_process_abs(device, code,
+					  libevdev_get_event_value(device->evdev,
+								   EV_ABS,
+								   code));
+	}
+
+	memset(device->frame.button_value_changed, 0,
+	       NLONGS(device->nbuttons) * sizeof(unsigned long));
+	memset(device->frame.button_state_changed, 0,
+	       NLONGS(device->nbuttons) * sizeof(unsigned long));
+	memset(device->frame.axis_changed, 0,
+	       NLONGS(device->naxes) * sizeof(unsigned long));
+	memset(device->frame.dpad_changed, 0,
+	       NLONGS(device->ndpads) * sizeof(unsigned long));
+}
+
+void
+evdev_device_classify(struct js_device *device)
+{
+	struct js_device_state *state = &device->frame.state;
+	size_t *account = &device->memory.state;
+
+	evdev_device_classify_type(device);
+	evdev_device_classify_buttons(device);
+	evdev_device_classify_dpads(device);
+	evdev_device_classify_axes(device);
+
+	state->button_value = device_array(device, account, button_value,
+					   max(device->nbuttons, 1U) *
+					   sizeof(*state->button_value));
+	state->button_state = device_array(device, account, button_state,
+					   max(NLONGS(device->nbuttons), 1U) *
+					   sizeof(unsigned long));
+	state->axis_value = device_array(device, account, axis_value,
+					 max(device->naxes, 1U) *
+					 sizeof(*state->axis_value));
+	state->dpad_state = device_array(device, account, dpad_state,
+					 max(device->ndpads, 1U) *
+					 sizeof(*state->dpad_state));
+	device->frame.button_value_changed =
+		device_array(device, account, button_value_changed,
+			     max(NLONGS(device->nbuttons), 1U) *
+			     sizeof(unsigned long));
+	device->frame.button_state_changed =
+		device_array(device, account, button_state_changed,
+			     max(NLONGS(device->nbuttons), 1U) *
+			     sizeof(unsigned long));
+	device->frame.axis_changed =
+		device_array(device, account, axis_changed,
+			     max(NLONGS(device->naxes), 1U) *
+			     sizeof(unsigned long));
+	device->frame.dpad_changed =
+		device_array(device, account, dpad_changed,
+			     max(NLONGS(device->ndpads), 1U) *
+			     sizeof(unsigned long));
+
+	evdev_device_init_state(device);
+}
+
+static inline int16_t
+normalize_axis(const struct input_absinfo *absinfo, int value)
+{
+	return js_normalize_abs(absinfo->minimum, absinfo->maximum, value) -
+	       0x8000;
+}
+
+static inline uint16_t
+normalize_button(const struct input_absinfo *absinfo, int value)
+{
+	return js_normalize_abs(absinfo->minimum, absinfo->maximum, value);
+}
+
+static void
+button_set_value(struct js_device *device, unsigned int index, uint16_t value)
+{
+	struct js_device_state *state = &device->frame.state;
+	bool down, new_down;
+
+	if (state->button_value[index] == value)
+		return;
+
+	state->button_value[index] = value;
+	long_set_bit(device->frame.button_value_changed, index);
+
+	down = long_bit_is_set(state->button_state, index);
+	if (down)
+		new_down = value >= BUTTON_RELEASE_THRESHOLD;
+	else
+		new_down = value >= BUTTON_PRESS_THRESHOLD;
+
+	if (new_down != down) {
+		long_set_bit_state(state->button_state, index, new_down);
+		long_set_bit(device->frame.button_state_changed, index);
+	}
+}
+
+static void
+axis_set_value(struct js_device *device, unsigned int index,
+	       unsigned int dim, int16_t value)
+{
+	struct js_device_state *state = &device->frame.state;
+
+	if (state->axis_value[index][dim] == value)
+		return;
+
+	state->axis_value[index][dim] = value;
+	long_set_bit(device->frame.axis_changed, index);
+}
+
+static void
+dpad_set_bits(struct js_device *device, unsigned int index,
+	      uint32_t mask, uint32_t bits)
+{
+	struct js_device_state *state = &device->frame.state;
+	uint32_t old_state = state->dpad_state[index];
+	uint32_t new_state = (old_state & ~mask) | bits;
+
+	if (old_state == new_state)
+		return;
+
+	state->dpad_state[index] = new_state;
+	long_set_bit(device->frame.dpad_changed, index);
+}
+
+static void
+evdev_process_key(struct js_device *device, unsigned int code, int value)
+{
+	struct js_control_map *map = key_map(device, code);
+	uint32_t bit;
+
+	if (!map)
+		return;
+
+	switch (map->type) {
+	case JS_CONTROL_BUTTON:
+		button_set_value(device, map->index, value ? 0xffff : 0);
+		break;
+	case JS_CONTROL_DPAD:
+		bit = 1U << map->dim;
+		dpad_set_bits(device, map->index, bit, value ? bit : 0);
+		break;
+	default:
+		break;
+	}
+}
+
+static void
+evdev_process_abs(struct js_device *device, unsigned int code, int value)
+{
+	struct js_control_map *map;
+	struct js_axis *axis;
+	uint32_t mask, bits = 0;
+
+	if (code >= ABS_CNT)
+		return;
+
+	map = &device->abs_map[code];
+	switch (map->type) {
+	case JS_CONTROL_BUTTON:
+		button_set_value(device, map->index,
+				 normalize_button(&device->buttons[map->index].absinfo,
+						  value));
+		break;
+	case JS_CONTROL_AXIS:
+		axis = &device->axes[map->index];
+		axis_set_value(device, map->index, map->dim,
+			       normalize_axis(&axis->absinfo[map->dim], value));
+		break;
+	case JS_CONTROL_DPAD:
+		if (map->dim == 0) {
+			mask = JS_DPAD_W | JS_DPAD_E;
+			if (value < 0)
+				bits = JS_DPAD_W;
+			else if (value > 0)
+				bits = JS_DPAD_E;
+		} else {
+			mask = JS_DPAD_N | JS_DPAD_S;
+			if (value < 0)
+				bits = JS_DPAD_N;
+			else if (value > 0)
+				bits = JS_DPAD_S;
+		}
+		dpad_set_bits(device, map->index, mask, bits);
+		break;
+	default:
+		break;
+	}
+}
+
+static struct js_event *
+evdev_frame_event_new(struct js_device *device,
+		      enum js_event_type type,
+		      uint64_t time,
+		      size_t payload_size)
+{
+	struct js_event *event;
+
+	event = js_event_new(device, type, time, payload_size);
+	event->frame_id = device->frame.id;
+
+	if (device->frame.has_device_time) {
+		event->has_device_time = true;
+		event->device_time = device->frame.device_time;
+		event->corrected_time = device->frame.corrected_time;
+	}
+
+	return event;
+}
+
+static void
+evdev_queue_button_event(struct js_device *device, uint64_t time)
+{
+	size_t nlongs = NLONGS(device->nbuttons);
+	struct js_event *event;
+
+	event = evdev_frame_event_new(device, JS_EVENT_BUTTON, time,
+				      3 * nlongs * sizeof(unsigned long) +
+				      device->nbuttons * sizeof(uint16_t));
+
+	event->button.state = event->payload;
+	event->button.value_changed = event->payload + nlongs;
+	event->button.state_changed = event->payload + 2 * nlongs;
+	event->button.value = (uint16_t*)(event->payload + 3 * nlongs);
+
+	memcpy(event->button.state, device->frame.state.button_state,
+	       nlongs * sizeof(unsigned long));
+	memcpy(event->button.value_changed, device->frame.button_value_changed,
+	       nlongs * sizeof(unsigned long));
+	memcpy(event->button.state_changed, device->frame.button_state_changed,
+	       nlongs * sizeof(unsigned long));
+	memcpy(event->button.value, device->frame.state.button_value,
+	       device->nbuttons * sizeof(uint16_t));
+
+	memset(device->frame.button_value_changed, 0,
+	       nlongs * sizeof(unsigned long));
+	memset(device->frame.button_state_changed, 0,
+	       nlongs * sizeof(unsigned long));
+
+	js_ctx_queue_event(device->ctx, event);
+}
+
+static void
+evdev_queue_axis_event(struct js_device *device, uint64_t time)
+{
+	size_t nlongs = NLONGS(device->naxes);
+	struct js_event *event;
+
+	event = evdev_frame_event_new(device, JS_EVENT_AXIS, time,
+				      nlongs * sizeof(unsigned long) +
+				      device->naxes * sizeof(*event->axis.value));
+
+	event->axis.changed = event->payload;
+	event->axis.value = (int16_t (*)[3])(event->payload + nlongs);
+
+	memcpy(event->axis.changed, device->frame.axis_changed,
+	       nlongs * sizeof(unsigned long));
+	memcpy(event->axis.value, device->frame.state.axis_value,
+	       device->naxes * sizeof(*event->axis.value));
+
+	memset(device->frame.axis_changed, 0, nlongs * sizeof(unsigned long));
+
+	js_ctx_queue_event(device->ctx, event);
+}
+
+static void
+evdev_queue_dpad_event(struct js_device *device, uint64_t time)
+{
+	size_t nlongs = NLONGS(device->ndpads);
+	struct js_event *event;
+
+	event = evdev_frame_event_new(device, JS_EVENT_DPAD, time,
+				      nlongs * sizeof(unsigned long) +
+				      device->ndpads * sizeof(uint32_t));
+
+	event->dpad.changed = event->payload;
+	event->dpad.state = (uint32_t*)(event->payload + nlongs);
+
+	memcpy(event->dpad.changed, device->frame.dpad_changed,
+	       nlongs * sizeof(unsigned long));
+	memcpy(event->dpad.state, device->frame.state.dpad_state,
+	       device->ndpads * sizeof(uint32_t));
+
+	memset(device->frame.dpad_changed, 0, nlongs * sizeof(unsigned long));
+
+	js_ctx_queue_event(device->ctx, event);
+}
+
+static void
+evdev_device_flush_frame(struct js_device *device, uint64_t time)
+{
+	struct js_ctx *ctx = device->ctx;
+	bool axis_changed, button_changed, dpad_changed;
+	struct js_perf_sample sample;
+	struct js_event *sync;
+
+	axis_changed = long_any_bit_set(device->frame.axis_changed,
+					NLONGS(device->naxes));
+	button_changed = long_any_bit_set(device->frame.button_value_changed,
+					  NLONGS(device->nbuttons));
+	dpad_changed = long_any_bit_set(device->frame.dpad_changed,
+					NLONGS(device->ndpads));
+
+	if (!axis_changed && !button_changed && !dpad_changed)
+		return;
+
+	/* The queue is full, drop the frame. The changed bits stay set, so
+	 * the next frame reports these changes too. */
+	if (!js_ctx_can_queue(ctx,
+			      1 + axis_changed + button_changed + dpad_changed)) {
+		js_stats_add(device, queue_overflows, 1);
+		return;
+	}
+
+	js_perf_begin(ctx, &sample);
+
+	device->frame.id = js_ctx_new_frame(ctx, time);
+	js_stats_add(device, frames, 1);
+	js_stats_record_wake(device, time);
+
+	js_trace(frame_decoded, device, device->frame.id, time);
+
+	if (axis_changed)
+		evdev_queue_axis_event(device, time);
+	if (button_changed)
+		evdev_queue_button_event(device, time);
+	if (dpad_changed)
+		evdev_queue_dpad_event(device, time);
+
+	sync = evdev_frame_event_new(device, JS_EVENT_SYNC, time, 0);
+	js_ctx_queue_event(ctx, sync);
+
+	js_perf_end(ctx, JS_STAGE_QUEUE, &sample,
+		    1 + axis_changed + button_changed + dpad_changed);
+}
+
+static const struct input_absinfo *
+abs_map_absinfo(struct js_device *device, const struct js_control_map *map)
+{
+	switch (map->type) {
+	case JS_CONTROL_BUTTON:
+		return &device->buttons[map->index].absinfo;
+	case JS_CONTROL_AXIS:
+		return &device->axes[map->index].absinfo[map->dim];
+	default:
+		return NULL;
+	}
+}
+
+/* Like evdev_process_abs() for all axes at once, the normalization is
+ * done in one batch */
+static void
+evdev_device_sync_abs(struct js_device *device, const int32_t *abs)
+{
+	int32_t value[ABS_CNT], minimum[ABS_CNT], maximum[ABS_CNT];
+	int32_t normalized[ABS_CNT];
+	uint8_t codes[ABS_CNT];
+	size_t n = 0;
+
+	for (unsigned int code = 0; code < ABS_CNT; code++) {
+		const struct js_control_map *map = &device->abs_map[code];
+		const struct input_absinfo *absinfo;
+
+		if (map->type == JS_CONTROL_NONE)
+			continue;
+
+		absinfo = abs_map_absinfo(device, map);
+		if (!absinfo) {
+			evdev_process_abs(device, code, abs[code]);
+			continue;
+		}
+
+		codes[n] = code;
+		value[n] = abs[code];
+		minimum[n] = absinfo->minimum;
+		maximum[n] = absinfo->maximum;
+		n++;
+	}
+
+	js_simd->normalize_abs(value, minimum, maximum, normalized, n);
+
+	for (size_t i = 0; i < n; i++) {
+		const struct js_control_map *map = &device->abs_map[codes[i]];
+
+		if (map->type == JS_CONTROL_BUTTON)
+			button_set_value(device, map->index, normalized[i]);
+		else
+			axis_set_value(device, map->index, map->dim,
+				       normalized[i] - 0x8000);
+	}
+}
+
+static void
+evdev_device_sync(struct js_device *device, uint64_t time)
+{
+	unsigned long keys[NLONGS(KEY_CNT)] = {0};
+	int32_t abs[ABS_CNT] = {0};
+	int rc;
+
+	rc = device->interface->sync_state(device, keys, abs);
+	if (rc != 0) {
+		js_log_error(device->ctx,
+			     "%s: failed to sync device state (%s)\n",
+			     js_device_get_name(device),
+			     strerror(-rc));
+		evdev_device_flush_frame(device, time);
+		return;
+	}
+
+	for (unsigned int code = JS_KEY_MAP_FIRST; code <= JS_KEY_MAP_LAST; code++) {
+		if (key_map(device, code)->type != JS_CONTROL_NONE)
+			evdev_process_key(device, code, long_bit_is_set(keys, code));
+	}
+
+	evdev_device_sync_abs(device, abs);
+
+	evdev_device_flush_frame(device, time);
+}
+
+#define BACKGROUND_BUTTON_CAPS \
+	(js_button_cap_bit(JS_BUTTON_CAP_SYSTEM) | \
+	 js_button_cap_bit(JS_BUTTON_CAP_START))
+
+static bool
+is_background_key(struct js_device *device, unsigned int code)
+{
+	const struct js_control_map *map = key_map(device, code);
+
+	/* e.g. KEY_HOMEPAGE or KEY_RECORD on some pads */
+	if (!map)
+		return false;
+
+	return map->type == JS_CONTROL_BUTTON &&
+	       (device->buttons[map->index].capabilities & BACKGROUND_BUTTON_CAPS);
+}
+
+void
+evdev_device_process_event(struct js_device *device,
+			   const struct input_event *ev)
+{
+	uint64_t time = s2us(ev->input_event_sec) + ev->input_event_usec;
+
+	/* After a SYN_DROPPED, everything up to the next SYN_REPORT is
+	 * garbage and we need to re-sync with the kernel state */
+	if (device->frame.dropped) {
+		if (ev->type == EV_SYN && ev->code == SYN_REPORT) {
+			device->frame.dropped = false;
+			timestamp_resync(device);
+			evdev_device_sync(device, time);
+		} else {
+			js_stats_add(device, events_dropped, 1);
+		}
+		return;
+	}
+
+	if (device->filter_events && ev->type != EV_SYN &&
+	    (ev->type != EV_KEY || !is_background_key(device, ev->code)))
+		return;
+
+	switch (ev->type) {
+	case EV_SYN:
+		if (ev->code == SYN_REPORT) {
+			timestamp_update(device, time);
+			evdev_device_flush_frame(device, time);
+		} else if (ev->code == SYN_DROPPED) {
+			device->frame.dropped = true;
+			js_trace(syn_dropped, device, time);
+			js_stats_add(device, syn_dropped, 1);
+		}
+		break;
+	case EV_KEY:
+		evdev_process_key(device, ev->code, ev->value);
+		break;
+	case EV_ABS:
+		evdev_process_abs(device, ev->code, ev->value);
+		break;
+	case EV_MSC:
+		if (ev->code == MSC_TIMESTAMP)
+			timestamp_process(device, ev->value);
+		break;
+	default:
+		break;
+	}
+}
+
+static void
+evdev_device_dispatch(void *data)
+{
+	struct js_device *device = data;
+	struct js_ctx *ctx = device->ctx;
+	struct input_event ev[JS_READ_BUFFER_SIZE];
+	struct js_perf_sample sample;
+	ssize_t len;
+
+	do {
+		size_t count;
+
+		js_perf_begin(ctx, &sample);
+		len = read(device->fd, ev, sizeof(ev));
+		js_stats_add(device, syscalls, 1);
+		if (len < 0) {
+			if (errno == ENODEV)
+				evdev_device_removed(device);
+			return;
+		}
+
+		if (len == 0 || len % sizeof(ev[0]) != 0) {
+			js_log_error(ctx,
+				     "%s: invalid read size %zd\n",
+				     js_device_get_name(device),
+				     len);
+			return;
+		}
+
+		count = len / sizeof(ev[0]);
+		js_stats_add(device, events_read, count);
+		js_perf_end(ctx, JS_STAGE_READ, &sample, count);
+
+		for (size_t i = 0; i < count; i++)
+			evdev_device_process_event(device, &ev[i]);
+		js_perf_end(ctx, JS_STAGE_DECODE, &sample, count);
+	} while ((size_t)len == sizeof(ev));
+}
+
+int
+evdev_device_open(struct js_ctx *ctx, const char *devnode,
+		  struct libevdev **evdev_out)
+{
+	struct libevdev *evdev;
+	int fd, rc;
+	int clockid = CLOCK_MONOTONIC;
+
+	fd = js_ctx_open_restricted(ctx, devnode,
+				    O_RDWR | O_NONBLOCK | O_CLOEXEC);
+	if (fd < 0) {
+		js_log_error(ctx, "%s: failed to open device (%s)\n",
+			     devnode, strerror(-fd));
+		return fd;
+	}
+
+	rc = libevdev_new_from_fd(fd, &evdev);
+	if (rc != 0) {
+		js_log_error(ctx, "%s: failed to create device (%s)\n",
+			     devnode, strerror(-rc));
+		js_ctx_close_restricted(ctx, fd);
+		return rc;
+	}
+
+	/* Failure here only means our timestamps are CLOCK_REALTIME */
+	ioctl(fd, EVIOCSCLOCKID, &clockid);
+
+	*evdev_out = evdev;
+
+	return fd;
+}
+
+int
+evdev_device_sync_state_fd(struct js_device *device,
+			   unsigned long *keys,
+			   int32_t *abs)
+{
+	size_t keys_size = NLONGS(KEY_CNT) * sizeof(unsigned long);
+
+	if (ioctl(device->fd, EVIOCGKEY(keys_size), keys) < 0)
+		return -errno;
+
+	for (unsigned int code = 0; code < ABS_CNT; code++) {
+		struct input_absinfo absinfo;
+
+		if (!libevdev_has_event_code(device->evdev, EV_ABS, code))
+			continue;
+
+		if (ioctl(device->fd, EVIOCGABS(code), &absinfo) < 0)
+			return -errno;
+
+		abs[code] = absinfo.value;
+	}
+
+	return 0;
+}
+
+int
+evdev_device_upload_effect_fd(struct js_device *device,
+			      struct ff_effect *effect)
+{
+	js_stats_add(device, syscalls, 1);
+	if (ioctl(device->fd, EVIOCSFF, effect) < 0)
+		return -errno;
+
+	return 0;
+}
+
+int
+evdev_device_erase_effect_fd(struct js_device *device, int id)
+{
+	js_stats_add(device, syscalls, 1);
+	if (ioctl(device->fd, EVIOCRMFF, id) < 0)
+		return -errno;
+
+	return 0;
+}
+
+int
+evdev_device_write_fd(struct js_device *device,
+		      const struct input_event *events,
+		      size_t count)
+{
+	ssize_t len;
+
+	js_stats_add(device, syscalls, 1);
+	len = write(device->fd, events, count * sizeof(*events));
+	if (len < 0)
+		return -errno;
+	if ((size_t)len != count * sizeof(*events))
+		return -EIO;
+
+	return 0;
+}
+
+int
+evdev_device_set_event_mask_fd(struct js_device *device,
+			       unsigned int type,
+			       const unsigned long *codes,
+			       size_t ncodes)
+{
+#ifdef EVIOCSMASK
+	struct input_mask mask = {
+		.type = type,
+		.codes_size = NLONGS(ncodes) * sizeof(*codes),
+		.codes_ptr = (uintptr_t)codes,
+	};
+
+	js_stats_add(device, syscalls, 1);
+	if (ioctl(device->fd, EVIOCSMASK, &mask) < 0)
+		return -errno;
+
+	return 0;
+#else
+	return -ENOTSUP;
+#endif
+}
+
+void
+evdev_device_init(struct js_device *device,
+		  struct js_ctx *ctx,
+		  struct libevdev *evdev,
+		  int fd,
+		  const struct js_device_interface *interface)
+{
+	device->ctx = ctx;
+	device->refcount = 1;
+	device->pool = ctx->device_pool;
+	device->interface = interface;
+	device->evdev = evdev;
+	device->fd = fd;
+	list_init(&device->link);
+	list_init(&device->output.link);
+	device->battery.percent = -1;
+	device->output.rumble_effect.type = FF_RUMBLE;
+	device->output.rumble_effect.id = -1;
+}
+
+static unsigned int
+evdev_device_find_user_index(struct js_ctx *ctx)
+{
+	unsigned int index = 0;
+	struct js_device *d;
+	bool in_use;
+
+	do {
+		in_use = false;
+		list_for_each(d, &ctx->devices, link) {
+			if (d->user_index == index) {
+				in_use = true;
+				index++;
+				break;
+			}
+		}
+	} while (in_use);
+
+	return index;
+}
+
+int
+evdev_device_added(struct js_device *device)
+{
+	struct js_ctx *ctx = device->ctx;
+	struct js_event *event;
+
+	if (JS_DEVICE_LIMIT != SIZE_MAX) {
+		struct js_device *d;
+		size_t ndevices = 0;
+
+		list_for_each(d, &ctx->devices, link)
+			ndevices++;
+		if (ndevices >= JS_DEVICE_LIMIT)
+			return -ENOSPC;
+	}
+
+	device->source = js_ctx_add_device_fd(ctx, device->fd,
+					      evdev_device_dispatch, device);
+	if (!device->source)
+		return -errno;
+
+	device->user_index = evdev_device_find_user_index(ctx);
+	list_append(&ctx->devices, &device->link);
+
+	if (ctx->power_mode != JS_POWER_MODE_ACTIVE)
+		evdev_device_set_power_mode(device);
+
+	js_trace(device_added, device, device->fd,
+		 js_device_get_name(device), device->user_index);
+
+	event = js_event_new(device, JS_EVENT_DEVICE_ADDED,
+			     js_ctx_now(device->ctx), 0);
+	js_ctx_queue_event(ctx, event);
+
+	return 0;
+}
+
+void
+evdev_device_set_battery(struct js_device *device,
+			 bool present,
+			 enum js_battery_status status,
+			 int percent)
+{
+	struct js_event *event;
+
+	if (!present) {
+		status = JS_BATTERY_STATUS_UNKNOWN;
+		percent = -1;
+	}
+
+	if (device->battery.present == present &&
+	    device->battery.status == status &&
+	    device->battery.percent == percent)
+		return;
+
+	device->battery.present = present;
+	device->battery.status = status;
+	device->battery.percent = percent;
+
+	/* Before the device is added, the value is part of the
+	 * JS_EVENT_DEVICE_ADDED */
+	if (device->removed || list_empty(&device->link))
+		return;
+
+	event = js_event_new(device, JS_EVENT_DEVICE_POWER,
+			     js_ctx_now(device->ctx), 0);
+	if (!event) {
+		/* The values are still available with
+		 * js_device_get_battery() */
+		js_stats_add(device, queue_overflows, 1);
+		return;
+	}
+	js_ctx_queue_event(device->ctx, event);
+}
+
+void
+evdev_device_set_power_mode(struct js_device *device)
+{
+	static const struct {
+		unsigned int type;
+		size_t ncodes;
+	} masks[] = {
+		{ EV_KEY, KEY_CNT },
+		{ EV_ABS, ABS_CNT },
+		{ EV_MSC, MSC_CNT },
+	};
+	bool background = device->ctx->power_mode == JS_POWER_MODE_BACKGROUND;
+	unsigned long keys[NLONGS(KEY_CNT)];
+	unsigned long others[NLONGS(KEY_CNT)];
+	int rc = -ENOTSUP;
+
+	memset(keys, background ? 0 : 0xff, sizeof(keys));
+	memset(others, background ? 0 : 0xff, sizeof(others));
+
+	if (background) {
+		for (size_t i = 0; i < device->nbuttons; i++) {
+			const struct js_button *button = &device->buttons[i];
+
+			if (button->type == EV_KEY &&
+			    (button->capabilities & BACKGROUND_BUTTON_CAPS))
+				long_set_bit(keys, button->code);
+		}
+	}
+
+	/* EV_SYN cannot be masked, the kernel drops the frames that are
+	 * left empty */
+	if (device->interface->set_event_mask) {
+		for (size_t i = 0; i < ARRAY_LENGTH(masks); i++) {
+			rc = device->interface->set_event_mask(device,
+							       masks[i].type,
+							       masks[i].type == EV_KEY ? keys : others,
+							       masks[i].ncodes);
+			if (rc != 0)
+				break;
+		}
+	}
+
+	device->filter_events = background && rc != 0;
+	timestamp_resync(device);
+
+	/* Whatever changed while masked is only known to the kernel */
+	if (!background)
+		evdev_device_sync(device, js_ctx_now(device->ctx));
+}
+
+void
+evdev_device_removed(struct js_device *device)
+{
+	struct js_ctx *ctx = device->ctx;
+	struct js_event *event;
+
+	if (device->removed)
+		return;
+
+	device->removed = true;
+
+	js_trace(device_removed, device, device->fd,
+		 js_device_get_name(device), device->user_index);
+
+	if (device->source) {
+		js_ctx_remove_source(ctx, device->source);
+		device->source = NULL;
+	}
+
+	list_remove(&device->link);
+	js_device_cancel_output(device);
+	device->interface->remove(device);
+	device->fd = -1;
+
+	event = js_event_new(device, JS_EVENT_DEVICE_REMOVED,
+			     js_ctx_now(device->ctx), 0);
+	js_ctx_queue_event(ctx, event);
+
+	/* drop the context's reference */
+	js_device_unref(device);
+}
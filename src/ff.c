@@ -0,0 +1,335 @@
+/*
+ * Copyright © 2019 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#include "config.h"
+
+#include <errno.h>
+
+#include "libjoystick-private.h"
+
+struct js_ff_effect {
+	struct js_device *device;
+	enum js_ff_effect_type type;
+
+	/* What the device has or will get, the id is -1 until the
+	 * first upload */
+	struct ff_effect effect;
+	bool playing;
+};
+
+static const uint16_t ff_effect_codes[] = {
+	[JS_FF_EFFECT_RUMBLE] = FF_RUMBLE,
+	[JS_FF_EFFECT_CONSTANT] = FF_CONSTANT,
+	[JS_FF_EFFECT_PERIODIC] = FF_PERIODIC,
+	[JS_FF_EFFECT_SPRING] = FF_SPRING,
+};
+
+static const uint16_t ff_waveform_codes[] = {
+	[JS_FF_WAVEFORM_SQUARE] = FF_SQUARE,
+	[JS_FF_WAVEFORM_TRIANGLE] = FF_TRIANGLE,
+	[JS_FF_WAVEFORM_SINE] = FF_SINE,
+	[JS_FF_WAVEFORM_SAW_UP] = FF_SAW_UP,
+	[JS_FF_WAVEFORM_SAW_DOWN] = FF_SAW_DOWN,
+};
+
+static bool
+device_has_ff_code(struct js_device *device, unsigned int code)
+{
+	return device->interface->upload_effect &&
+	       libevdev_has_event_code(device->evdev, EV_FF, code);
+}
+
+_public_ bool
+js_device_has_ff_effect(struct js_device *device,
+			enum js_ff_effect_type type)
+{
+	if (type < JS_FF_EFFECT_RUMBLE || type > JS_FF_EFFECT_SPRING)
+		return false;
+
+	return device_has_ff_code(device, ff_effect_codes[type]);
+}
+
+_public_ struct js_ff_effect *
+js_device_create_ff_effect(struct js_device *device,
+			   enum js_ff_effect_type type)
+{
+	struct js_ff_effect *effect;
+
+	if (!js_device_has_ff_effect(device, type))
+		return NULL;
+
+	effect = zalloc(sizeof(*effect));
+	effect->device = js_device_ref(device);
+	effect->type = type;
+	effect->effect.type = ff_effect_codes[type];
+	effect->effect.id = -1;
+	effect->effect.direction = 0x4000;
+
+	return effect;
+}
+
+_public_ void
+js_ff_effect_destroy(struct js_ff_effect *effect)
+{
+	struct js_device *device;
+
+	if (!effect)
+		return;
+
+	device = effect->device;
+
+	/* The kernel stops the effect when it is erased */
+	if (effect->effect.id != -1 && !device->removed)
+		device->interface->erase_effect(device, effect->effect.id);
+
+	js_device_unref(device);
+	zfree(effect);
+}
+
+_public_ struct js_device *
+js_ff_effect_get_device(struct js_ff_effect *effect)
+{
+	return effect->device;
+}
+
+/* Effects that were never played are only updated in memory, the first
+ * js_ff_effect_play() uploads them. After that, every change is uploaded
+ * in place. */
+static int
+ff_effect_update(struct js_ff_effect *effect, const struct ff_effect *new)
+{
+	struct js_device *device = effect->device;
+	int rc;
+
+	if (device->removed)
+		return -ENODEV;
+
+	if (memcmp(&effect->effect, new, sizeof(*new)) == 0)
+		return 0;
+
+	if (new->id != -1) {
+		struct ff_effect upload = *new;
+
+		rc = device->interface->upload_effect(device, &upload);
+		if (rc < 0)
+			return rc;
+	}
+
+	effect->effect = *new;
+	return 0;
+}
+
+_public_ int
+js_ff_effect_set_rumble(struct js_ff_effect *effect,
+			uint16_t strong,
+			uint16_t weak)
+{
+	struct ff_effect new = effect->effect;
+
+	if (effect->type != JS_FF_EFFECT_RUMBLE)
+		return -EINVAL;
+
+	new.u.rumble.strong_magnitude = strong;
+	new.u.rumble.weak_magnitude = weak;
+
+	return ff_effect_update(effect, &new);
+}
+
+_public_ int
+js_ff_effect_set_constant(struct js_ff_effect *effect, int16_t level)
+{
+	struct ff_effect new = effect->effect;
+
+	if (effect->type != JS_FF_EFFECT_CONSTANT)
+		return -EINVAL;
+
+	new.u.constant.level = level;
+
+	return ff_effect_update(effect, &new);
+}
+
+_public_ int
+js_ff_effect_set_periodic(struct js_ff_effect *effect,
+			  enum js_ff_waveform waveform,
+			  uint16_t period_ms,
+			  int16_t magnitude,
+			  int16_t offset)
+{
+	struct ff_effect new = effect->effect;
+
+	if (effect->type != JS_FF_EFFECT_PERIODIC ||
+	    waveform < JS_FF_WAVEFORM_SQUARE ||
+	    waveform > JS_FF_WAVEFORM_SAW_DOWN)
+		return -EINVAL;
+
+	if (!device_has_ff_code(effect->device, ff_waveform_codes[waveform]))
+		return -ENOTSUP;
+
+	new.u.periodic.waveform = ff_waveform_codes[waveform];
+	new.u.periodic.period = period_ms;
+	new.u.periodic.magnitude = magnitude;
+	new.u.periodic.offset = offset;
+
+	return ff_effect_update(effect, &new);
+}
+
+_public_ int
+js_ff_effect_set_spring(struct js_ff_effect *effect,
+			int16_t center,
+			int16_t coefficient,
+			uint16_t deadband)
+{
+	struct ff_effect new = effect->effect;
+
+	if (effect->type != JS_FF_EFFECT_SPRING)
+		return -EINVAL;
+
+	for (size_t i = 0; i < ARRAY_LENGTH(new.u.condition); i++) {
+		struct ff_condition_effect *c = &new.u.condition[i];
+
+		c->right_saturation = 0xffff;
+		c->left_saturation = 0xffff;
+		c->right_coeff = coefficient;
+		c->left_coeff = coefficient;
+		c->deadband = deadband;
+		c->center = center;
+	}
+
+	return ff_effect_update(effect, &new);
+}
+
+_public_ int
+js_ff_effect_set_direction(struct js_ff_effect *effect, uint16_t direction)
+{
+	struct ff_effect new = effect->effect;
+
+	new.direction = direction;
+
+	return ff_effect_update(effect, &new);
+}
+
+_public_ int
+js_ff_effect_set_duration(struct js_ff_effect *effect, uint16_t duration_ms)
+{
+	struct ff_effect new = effect->effect;
+
+	new.replay.length = duration_ms;
+
+	return ff_effect_update(effect, &new);
+}
+
+static int
+ff_write(struct js_device *device, uint16_t code, int32_t value)
+{
+	struct input_event ev[2] = {
+		{ .type = EV_FF, .code = code, .value = value },
+		{ .type = EV_SYN, .code = SYN_REPORT, .value = 0 },
+	};
+
+	return device->interface->write_events(device, ev, ARRAY_LENGTH(ev));
+}
+
+_public_ int
+js_ff_effect_play(struct js_ff_effect *effect)
+{
+	struct js_device *device = effect->device;
+	int rc;
+
+	if (device->removed)
+		return -ENODEV;
+
+	if (effect->effect.id == -1) {
+		rc = device->interface->upload_effect(device, &effect->effect);
+		if (rc < 0)
+			return rc;
+	} else if (effect->playing && effect->effect.replay.length == 0) {
+		/* An infinite effect never ends by itself, a finite one
+		 * may have and is started again */
+		return 0;
+	}
+
+	rc = ff_write(device, effect->effect.id, 1);
+	if (rc < 0)
+		return rc;
+
+	effect->playing = true;
+	return 0;
+}
+
+_public_ int
+js_ff_effect_stop(struct js_ff_effect *effect)
+{
+	struct js_device *device = effect->device;
+	int rc;
+
+	if (device->removed)
+		return -ENODEV;
+
+	if (effect->effect.id == -1 || !effect->playing)
+		return 0;
+
+	rc = ff_write(device, effect->effect.id, 0);
+	if (rc < 0)
+		return rc;
+
+	effect->playing = false;
+	return 0;
+}
+
+_public_ int
+js_device_set_ff_gain(struct js_device *device, uint16_t gain)
+{
+	if (device->removed)
+		return -ENODEV;
+
+	if (!device_has_ff_code(device, FF_GAIN))
+		return -ENOTSUP;
+
+	return ff_write(device, FF_GAIN, gain);
+}
+
+int
+ff_device_write_rumble(struct js_device *device)
+{
+	struct ff_effect *effect = &device->output.rumble_effect;
+	bool stop = device->output.rumble[0] == 0 &&
+		    device->output.rumble[1] == 0;
+	int rc;
+
+	if (stop) {
+		if (!device->output.rumble_playing)
+			return 0;
+
+		rc = ff_write(device, effect->id, 0);
+		if (rc == 0)
+			device->output.rumble_playing = false;
+		return rc;
+	}
+
+	effect->u.rumble.strong_magnitude = device->output.rumble[0];
+	effect->u.rumble.weak_magnitude = device->output.rumble[1];
+	rc = device->interface->upload_effect(device, effect);
+	if (rc < 0 || device->output.rumble_playing)
+		return rc;
+
+	rc = ff_write(device, effect->id, 1);
+	if (rc == 0)
+		device->output.rumble_playing = true;
+	return rc;
+}
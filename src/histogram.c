@@ -0,0 +1,140 @@
+/*
+ * Copyright © 2019 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+
+#include "config.h"
+
+#include "histogram.h"
+#include "util.h"
+
+#define SUB_BUCKETS (1 << JS_HISTOGRAM_SUB_BITS)
+
+
+/* Values below SUB_BUCKETS are exact, everything above is bucketed by its
+ * most significant bit and the next JS_HISTOGRAM_SUB_BITS bits. Values
+ * beyond the last bucket end up in the last bucket. */
+static inline void
+histogram_index(uint64_t value, unsigned int *bucket, unsigned int *sub)
+{
+	unsigned int msb;
+
+	if (value < SUB_BUCKETS) {
+		*bucket = 0;
+		*sub = value;
+		return;
+	}
+
+	msb = 63 - __builtin_clzll(value);
+	*bucket = msb - JS_HISTOGRAM_SUB_BITS + 1;
+	*sub = (value >> (msb - JS_HISTOGRAM_SUB_BITS)) & (SUB_BUCKETS - 1);
+
+	if (*bucket >= JS_HISTOGRAM_BUCKETS) {
+		*bucket = JS_HISTOGRAM_BUCKETS - 1;
+		*sub = SUB_BUCKETS - 1;
+	}
+}
+
+static inline uint64_t
+histogram_upper_bound(unsigned int bucket, unsigned int sub)
+{
+	if (bucket == 0)
+		return sub;
+
+	return (((uint64_t)SUB_BUCKETS + sub + 1) << (bucket - 1)) - 1;
+}
+
+void
+js_histogram_record(struct js_histogram *h, uint64_t value)
+{
+	unsigned int bucket, sub;
+
+	histogram_index(value, &bucket, &sub);
+	h->counts[bucket][sub]++;
+
+	if (h->count == 0 || value < h->min)
+		h->min = value;
+	if (value > h->max)
+		h->max = value;
+	h->count++;
+}
+
+uint64_t
+js_histogram_percentile(const struct js_histogram *h, double percentile)
+{
+	uint64_t target, seen = 0;
+
+	if (h->count == 0)
+		return 0;
+
+	if (percentile <= 0.0)
+		return h->min;
+	if (percentile >= 100.0)
+		return h->max;
+
+	target = (uint64_t)(h->count * percentile / 100.0 + 0.5);
+	if (target == 0)
+		target = 1;
+
+	for (unsigned int b = 0; b < JS_HISTOGRAM_BUCKETS; b++) {
+		for (unsigned int s = 0; s < SUB_BUCKETS; s++) {
+			seen += h->counts[b][s];
+			if (seen >= target)
+				return min(histogram_upper_bound(b, s), h->max);
+		}
+	}
+
+	return h->max;
+}
+
+unsigned int
+js_histogram_get_bucket_count(const struct js_histogram *h)
+{
+	unsigned int count = 0;
+
+	for (unsigned int b = 0; b < JS_HISTOGRAM_BUCKETS; b++) {
+		for (unsigned int s = 0; s < SUB_BUCKETS; s++) {
+			if (h->counts[b][s] > 0)
+				count++;
+		}
+	}
+
+	return count;
+}
+
+bool
+js_histogram_get_bucket(const struct js_histogram *h,
+			unsigned int index,
+			uint64_t *upper_bound,
+			uint64_t *count)
+{
+	for (unsigned int b = 0; b < JS_HISTOGRAM_BUCKETS; b++) {
+		for (unsigned int s = 0; s < SUB_BUCKETS; s++) {
+			if (h->counts[b][s] == 0)
+				continue;
+
+			if (index-- == 0) {
+				*upper_bound = histogram_upper_bound(b, s);
+				*count = h->counts[b][s];
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
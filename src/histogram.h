@@ -0,0 +1,67 @@
+/*
+ * Copyright © 2019 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * A log-linear histogram in the style of HdrHistogram, shared by the
+ * latency statistics and the benchmarks. Values are bucketed by their
+ * most significant bit, each of these is split into
+ * 2^JS_HISTOGRAM_SUB_BITS linear sub-buckets. The relative error of a
+ * percentile is thus at most 1/2^JS_HISTOGRAM_SUB_BITS.
+ */
+#define JS_HISTOGRAM_SUB_BITS 3
+#define JS_HISTOGRAM_BUCKETS 40
+
+struct js_histogram {
+	uint64_t counts[JS_HISTOGRAM_BUCKETS][1 << JS_HISTOGRAM_SUB_BITS];
+	uint64_t count;
+	uint64_t min, max;
+};
+
+void
+js_histogram_record(struct js_histogram *h, uint64_t value);
+
+/**
+ * @return the upper bound of the bucket containing the given percentile
+ * (0.0 - 100.0), or 0 if the histogram is empty
+ */
+uint64_t
+js_histogram_percentile(const struct js_histogram *h, double percentile);
+
+/**
+ * @return the number of non-empty buckets
+ */
+unsigned int
+js_histogram_get_bucket_count(const struct js_histogram *h);
+
+/**
+ * Get the index-th non-empty bucket, in increasing order.
+ *
+ * @return false if there are not that many non-empty buckets
+ */
+bool
+js_histogram_get_bucket(const struct js_histogram *h,
+			unsigned int index,
+			uint64_t *upper_bound,
+			uint64_t *count);
@@ -0,0 +1,128 @@
+/*
+ * Copyright © 2019 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#pragma once
+
+#include <memory>
+#include <utility>
+
+#ifdef LIBJOYSTICK_ASIO_STANDALONE
+#include <asio.hpp>
+#else
+#include <boost/asio.hpp>
+#endif
+
+#include "libjoystick-loop.h"
+
+namespace js {
+
+#ifdef LIBJOYSTICK_ASIO_STANDALONE
+namespace asio_impl = ::asio;
+#else
+namespace asio_impl = ::boost::asio;
+#endif
+
+/**
+ * @ingroup loop
+ *
+ * Watches a context on an Asio executor, with Boost.Asio or, if
+ * LIBJOYSTICK_ASIO_STANDALONE is defined, standalone Asio. The handler
+ * is called with each js_event *. Asio has no priorities, input is
+ * handled in the order the executor runs completion handlers.
+ *
+ * The fd stays owned by the context, it is released rather than closed
+ * when the source is destroyed.
+ *
+ * @code
+ * boost::asio::io_context io;
+ * js::asio_source source{ io.get_executor(), ctx, [](js_event *event) { ... } };
+ * io.run();
+ * @endcode
+ */
+template<typename Handler>
+class asio_source {
+public:
+	template<typename Executor>
+	asio_source(const Executor &executor, js_ctx *ctx, Handler handler)
+		: ctx_(js_ctx_ref(ctx)),
+		  descriptor_(executor, js_ctx_get_fd(ctx)),
+		  handler_(std::move(handler)),
+		  alive_(std::make_shared<bool>(true))
+	{
+		std::weak_ptr<bool> alive = alive_;
+
+		/* Deliver the events queued before we were created */
+		asio_impl::post(descriptor_.get_executor(), [this, alive]() {
+			if (alive.expired())
+				return;
+			dispatch();
+		});
+		wait();
+	}
+
+	asio_source(const asio_source &) = delete;
+	asio_source &operator=(const asio_source &) = delete;
+
+	~asio_source()
+	{
+		alive_.reset();
+		descriptor_.cancel();
+		descriptor_.release();
+		js_ctx_unref(ctx_);
+	}
+
+private:
+	static void
+	call_handler(js_event *event, void *data)
+	{
+		(*static_cast<Handler *>(data))(event);
+	}
+
+	void
+	dispatch()
+	{
+		js_loop_dispatch(ctx_, call_handler, &handler_);
+	}
+
+	void
+	wait()
+	{
+		std::weak_ptr<bool> alive = alive_;
+
+		descriptor_.async_wait(asio_impl::posix::stream_descriptor::wait_read,
+				       [this, alive](const auto &error) {
+			if (error || alive.expired())
+				return;
+			dispatch();
+			/* The handler may have destroyed us */
+			if (!alive.expired())
+				wait();
+		});
+	}
+
+	js_ctx *ctx_;
+	asio_impl::posix::stream_descriptor descriptor_;
+	Handler handler_;
+	std::shared_ptr<bool> alive_;
+};
+
+template<typename Executor, typename Handler>
+asio_source(const Executor &, js_ctx *, Handler) -> asio_source<Handler>;
+
+} /* namespace js */
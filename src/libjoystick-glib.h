@@ -0,0 +1,136 @@
+/*
+ * Copyright © 2019 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#pragma once
+
+#include <glib.h>
+
+#include "libjoystick-loop.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @ingroup loop
+ *
+ * A GSource for a context. Input is dispatched at G_PRIORITY_DEFAULT,
+ * i.e. before GTK's redraw and idle sources, change it with
+ * g_source_set_priority() before attaching.
+ *
+ * @code
+ * GSource *source = js_glib_source_new(ctx);
+ * js_glib_source_set_handler(source, handle_event, data, NULL);
+ * g_source_attach(source, NULL);
+ * g_source_unref(source);
+ * @endcode
+ */
+struct js_glib_source {
+	GSource base;
+	struct js_ctx *ctx;
+	gpointer fd_tag;
+	gboolean pending;	/* events queued before the first dispatch */
+};
+
+static inline gboolean
+js_glib_source_prepare(GSource *base, gint *timeout)
+{
+	struct js_glib_source *source = (struct js_glib_source *)base;
+
+	*timeout = -1;
+	return source->pending;
+}
+
+static inline gboolean
+js_glib_source_check(GSource *base)
+{
+	struct js_glib_source *source = (struct js_glib_source *)base;
+
+	return source->pending ||
+	       (g_source_query_unix_fd(base, source->fd_tag) & G_IO_IN);
+}
+
+static inline gboolean
+js_glib_source_dispatch(GSource *base, GSourceFunc callback, gpointer user_data)
+{
+	struct js_glib_source *source = (struct js_glib_source *)base;
+
+	source->pending = FALSE;
+	js_loop_dispatch(source->ctx, (js_loop_handler)(void (*)(void))callback,
+			 user_data);
+
+	return G_SOURCE_CONTINUE;
+}
+
+static inline void
+js_glib_source_finalize(GSource *base)
+{
+	struct js_glib_source *source = (struct js_glib_source *)base;
+
+	js_ctx_unref(source->ctx);
+}
+
+/**
+ * @ingroup loop
+ *
+ * Create a new GSource for the context, the source keeps a reference
+ * to it. The source is not attached yet.
+ */
+static inline GSource *
+js_glib_source_new(struct js_ctx *ctx)
+{
+	static GSourceFuncs funcs = {
+		js_glib_source_prepare,
+		js_glib_source_check,
+		js_glib_source_dispatch,
+		js_glib_source_finalize,
+		NULL,
+		NULL,
+	};
+	GSource *base = g_source_new(&funcs, sizeof(struct js_glib_source));
+	struct js_glib_source *source = (struct js_glib_source *)base;
+
+	source->ctx = js_ctx_ref(ctx);
+	source->fd_tag = g_source_add_unix_fd(base, js_ctx_get_fd(ctx), G_IO_IN);
+	source->pending = TRUE;
+	g_source_set_priority(base, G_PRIORITY_DEFAULT);
+	g_source_set_name(base, "libjoystick");
+
+	return base;
+}
+
+/**
+ * @ingroup loop
+ *
+ * Set the handler called for each event, a type-safe
+ * g_source_set_callback().
+ */
+static inline void
+js_glib_source_set_handler(GSource *source,
+			   js_loop_handler handler,
+			   gpointer user_data,
+			   GDestroyNotify destroy)
+{
+	g_source_set_callback(source, (GSourceFunc)(void (*)(void))handler,
+			      user_data, destroy);
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,326 @@
+/*
+ * Copyright © 2019 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#pragma once
+
+#include "libjoystick.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @defgroup inline Inline event accessors
+ *
+ * libjoystick-inline.h is an optional header with inline versions of the
+ * per-event accessors called in a caller's input loop, avoiding a PLT
+ * call per button or axis. Including it redirects the regular function
+ * names to the inline versions, define LIBJOYSTICK_INLINE_NO_REDIRECT
+ * before including the header to only get the js_inline_ functions.
+ *
+ * The inline functions behave exactly like the exported ones. They rely
+ * on the layouts below, which are part of the ABI and never change.
+ */
+
+/**
+ * @ingroup inline
+ *
+ * The start of every struct js_event.
+ */
+struct js_inline_event {
+	enum js_event_type type;
+	struct js_device *device;
+	uint64_t time;
+	uint64_t frame_id;
+	union {
+		struct {
+			uint16_t *value;
+			unsigned long *state;
+			unsigned long *value_changed;
+			unsigned long *state_changed;
+		} button;
+		struct {
+			int16_t (*value)[3];
+			unsigned long *changed;
+		} axis;
+		struct {
+			uint32_t *state;
+			unsigned long *changed;
+		} dpad;
+	} u;
+};
+
+/**
+ * @ingroup inline
+ *
+ * The start of every struct js_button, struct js_axis and struct js_dpad.
+ */
+struct js_inline_control {
+	struct js_device *device;
+	unsigned int index;
+};
+
+#define JS_INLINE_LONG_BITS (sizeof(unsigned long) * 8)
+
+static inline bool
+js_inline_bit_is_set(const unsigned long *array, unsigned int bit)
+{
+	return !!(array[bit / JS_INLINE_LONG_BITS] &
+		  (1UL << (bit % JS_INLINE_LONG_BITS)));
+}
+
+static inline const struct js_inline_event *
+js_inline_event(struct js_event *event)
+{
+	return (const struct js_inline_event *)event;
+}
+
+static inline const struct js_inline_control *
+js_inline_control(const void *control)
+{
+	return (const struct js_inline_control *)control;
+}
+
+static inline bool
+js_inline_event_has_control(struct js_event *event,
+			    enum js_event_type type,
+			    const void *control)
+{
+	return js_inline_event(event)->type == type &&
+	       control != NULL &&
+	       js_inline_control(control)->device == js_inline_event(event)->device;
+}
+
+/**
+ * @ingroup inline
+ *
+ * @see js_event_get_type
+ */
+static inline enum js_event_type
+js_inline_event_get_type(struct js_event *event)
+{
+	return js_inline_event(event)->type;
+}
+
+/**
+ * @ingroup inline
+ *
+ * @see js_event_get_device
+ */
+static inline struct js_device *
+js_inline_event_get_device(struct js_event *event)
+{
+	return js_inline_event(event)->device;
+}
+
+/**
+ * @ingroup inline
+ *
+ * @see js_event_get_time_usec
+ */
+static inline uint64_t
+js_inline_event_get_time_usec(struct js_event *event)
+{
+	return js_inline_event(event)->time;
+}
+
+/**
+ * @ingroup inline
+ *
+ * @see js_event_get_frame_id
+ */
+static inline uint64_t
+js_inline_event_get_frame_id(struct js_event *event)
+{
+	return js_inline_event(event)->frame_id;
+}
+
+/**
+ * @ingroup inline
+ *
+ * @see js_event_axis_has_changed
+ */
+static inline bool
+js_inline_event_axis_has_changed(struct js_event *event,
+				 struct js_axis *axis)
+{
+	if (!js_inline_event_has_control(event, JS_EVENT_AXIS, axis))
+		return false;
+
+	return js_inline_bit_is_set(js_inline_event(event)->u.axis.changed,
+				    js_inline_control(axis)->index);
+}
+
+/**
+ * @ingroup inline
+ *
+ * @see js_event_axis_get_value
+ */
+static inline bool
+js_inline_event_axis_get_value(struct js_event *event,
+			       struct js_axis *axis,
+			       int16_t *x, int16_t *y, int16_t *z)
+{
+	const struct js_inline_event *e = js_inline_event(event);
+	const int16_t *value;
+	unsigned int index;
+
+	if (!js_inline_event_has_control(event, JS_EVENT_AXIS, axis)) {
+		if (x)
+			*x = 0;
+		if (y)
+			*y = 0;
+		if (z)
+			*z = 0;
+		return false;
+	}
+
+	index = js_inline_control(axis)->index;
+	value = e->u.axis.value[index];
+	if (x)
+		*x = value[0];
+	if (y)
+		*y = value[1];
+	if (z)
+		*z = value[2];
+
+	return js_inline_bit_is_set(e->u.axis.changed, index);
+}
+
+/**
+ * @ingroup inline
+ *
+ * @see js_event_button_value_has_changed
+ */
+static inline bool
+js_inline_event_button_value_has_changed(struct js_event *event,
+					 struct js_button *button)
+{
+	if (!js_inline_event_has_control(event, JS_EVENT_BUTTON, button))
+		return false;
+
+	return js_inline_bit_is_set(js_inline_event(event)->u.button.value_changed,
+				    js_inline_control(button)->index);
+}
+
+/**
+ * @ingroup inline
+ *
+ * @see js_event_button_state_has_changed
+ */
+static inline bool
+js_inline_event_button_state_has_changed(struct js_event *event,
+					 struct js_button *button)
+{
+	if (!js_inline_event_has_control(event, JS_EVENT_BUTTON, button))
+		return false;
+
+	return js_inline_bit_is_set(js_inline_event(event)->u.button.state_changed,
+				    js_inline_control(button)->index);
+}
+
+/**
+ * @ingroup inline
+ *
+ * @see js_event_button_get_value
+ */
+static inline bool
+js_inline_event_button_get_value(struct js_event *event,
+				 struct js_button *button,
+				 uint16_t *value)
+{
+	const struct js_inline_event *e = js_inline_event(event);
+	unsigned int index;
+
+	if (!js_inline_event_has_control(event, JS_EVENT_BUTTON, button)) {
+		*value = 0;
+		return false;
+	}
+
+	index = js_inline_control(button)->index;
+	*value = e->u.button.value[index];
+
+	return js_inline_bit_is_set(e->u.button.value_changed, index);
+}
+
+/**
+ * @ingroup inline
+ *
+ * @see js_event_button_get_state
+ */
+static inline bool
+js_inline_event_button_get_state(struct js_event *event,
+				 struct js_button *button,
+				 bool *state)
+{
+	const struct js_inline_event *e = js_inline_event(event);
+	unsigned int index;
+
+	if (!js_inline_event_has_control(event, JS_EVENT_BUTTON, button)) {
+		*state = false;
+		return false;
+	}
+
+	index = js_inline_control(button)->index;
+	*state = js_inline_bit_is_set(e->u.button.state, index);
+
+	return js_inline_bit_is_set(e->u.button.state_changed, index);
+}
+
+/**
+ * @ingroup inline
+ *
+ * @see js_event_dpad_get_state
+ */
+static inline bool
+js_inline_event_dpad_get_state(struct js_event *event,
+			       struct js_dpad *dpad,
+			       uint32_t *state)
+{
+	const struct js_inline_event *e = js_inline_event(event);
+	unsigned int index;
+
+	if (!js_inline_event_has_control(event, JS_EVENT_DPAD, dpad)) {
+		*state = 0;
+		return false;
+	}
+
+	index = js_inline_control(dpad)->index;
+	*state = e->u.dpad.state[index];
+
+	return js_inline_bit_is_set(e->u.dpad.changed, index);
+}
+
+#ifndef LIBJOYSTICK_INLINE_NO_REDIRECT
+#define js_event_get_type js_inline_event_get_type
+#define js_event_get_device js_inline_event_get_device
+#define js_event_get_time_usec js_inline_event_get_time_usec
+#define js_event_get_frame_id js_inline_event_get_frame_id
+#define js_event_axis_has_changed js_inline_event_axis_has_changed
+#define js_event_axis_get_value js_inline_event_axis_get_value
+#define js_event_button_value_has_changed js_inline_event_button_value_has_changed
+#define js_event_button_state_has_changed js_inline_event_button_state_has_changed
+#define js_event_button_get_value js_inline_event_button_get_value
+#define js_event_button_get_state js_inline_event_button_get_state
+#define js_event_dpad_get_state js_inline_event_dpad_get_state
+#endif
+
+#ifdef __cplusplus
+}
+#endif
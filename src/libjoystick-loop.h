@@ -0,0 +1,77 @@
+/*
+ * Copyright © 2019 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#pragma once
+
+#include "libjoystick.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @defgroup loop Event loop integration
+ *
+ * Header-only adapters that hook a context into an existing event loop:
+ * libjoystick-glib.h, libjoystick-sd-event.h, libjoystick-uv.h and, for
+ * C++, libjoystick-asio.hpp. None of them adds a dependency to
+ * libjoystick itself, include the one for the loop in use.
+ *
+ * All adapters behave the same: they wait for js_ctx_get_fd() to become
+ * readable, call js_ctx_dispatch() once and then pass every queued event
+ * to the handler before destroying it. Events queued before the adapter
+ * was attached, e.g. the @ref JS_EVENT_DEVICE_ADDED events of a new
+ * context, are delivered on the first loop iteration.
+ */
+
+/**
+ * @ingroup loop
+ *
+ * Called for each event. The event is destroyed when the handler returns.
+ */
+typedef void (*js_loop_handler)(struct js_event *event, void *user_data);
+
+/**
+ * @ingroup loop
+ *
+ * Dispatch the context and pass all queued events to the handler. This
+ * is what the adapters call when the fd is readable.
+ *
+ * @return the number of events handled
+ */
+static inline unsigned int
+js_loop_dispatch(struct js_ctx *ctx, js_loop_handler handler, void *user_data)
+{
+	struct js_event *event;
+	unsigned int n = 0;
+
+	js_ctx_dispatch(ctx);
+	while ((event = js_ctx_get_event(ctx))) {
+		if (handler)
+			handler(event, user_data);
+		js_event_destroy(event);
+		n++;
+	}
+
+	return n;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,911 @@
+/*
+ * Copyright © 2019 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#pragma once
+
+#include "config.h"
+
+#include <linux/input.h>
+#include <libevdev/libevdev.h>
+
+#include "histogram.h"
+#include "libjoystick.h"
+#include "trace.h"
+#include "util.h"
+
+/* Number of struct input_event read from a device fd in one go */
+#define JS_READ_BUFFER_SIZE 64
+
+/* The largest event payload served from the event pool, enough for
+ * about 90 buttons, larger events are allocated individually. With a
+ * compile-time button and axis limit, every event fits. */
+#if JS_MAX_BUTTONS > 0 && JS_MAX_AXES > 0
+#define JS_EVENT_POOL_PAYLOAD_SIZE \
+	max(max(3 * NLONGS(JS_MAX_BUTTONS) * sizeof(unsigned long) + \
+		JS_MAX_BUTTONS * sizeof(uint16_t), \
+		NLONGS(JS_MAX_AXES) * sizeof(unsigned long) + \
+		JS_MAX_AXES * 3 * sizeof(int16_t)), \
+	    (size_t)64 /* dpads */)
+#else
+#define JS_EVENT_POOL_PAYLOAD_SIZE 256
+#endif
+
+/* Slots in an event pool, see js_pool_reserve() */
+#define JS_EVENT_SLOT_SIZE (sizeof(struct js_event) + JS_EVENT_POOL_PAYLOAD_SIZE)
+
+/* With max-queued-events, events never come from the allocator. The
+ * pool keeps two slots per device for the device added and removed
+ * events, which are never dropped. A device holds its slot until its
+ * last event is destroyed, so there are never more of these in
+ * flight. */
+#if JS_MAX_QUEUED_EVENTS > 0
+#define JS_FIXED_EVENTS 1
+#define JS_EVENT_POOL_HOTPLUG_SLOTS (2 * JS_MAX_DEVICES)
+#else
+#define JS_FIXED_EVENTS 0
+#define JS_EVENT_POOL_HOTPLUG_SLOTS 0
+#endif
+
+/* With max-buttons and max-axes, the per-device arrays are part of
+ * struct js_device, see js_device.storage */
+#define JS_FIXED_CONTROLS (JS_MAX_BUTTONS > 0 && JS_MAX_AXES > 0)
+
+/* Four hats plus the dpad buttons */
+#define JS_MAX_DPADS 5
+
+/* The range of EV_KEY codes we map to buttons and dpads */
+#define JS_KEY_MAP_FIRST BTN_MISC
+#define JS_KEY_MAP_LAST BTN_TRIGGER_HAPPY40
+#define JS_KEY_MAP_SIZE (JS_KEY_MAP_LAST - JS_KEY_MAP_FIRST + 1)
+
+/* Converts the public capability enums into a bit within a mask */
+#define js_button_cap_bit(cap_) (1U << (cap_))
+#define js_axis_cap_bit(cap_) (1U << ((cap_) - JS_AXIS_CAP_LEFT))
+#define js_dpad_cap_bit(cap_) (1U << ((cap_) - JS_DPAD_CAP_LEFT))
+#define js_type_bit(type_) (1U << (type_))
+#define js_output_bit(output_) (1U << (output_))
+
+/* Number of frames remembered for js_ctx_mark_consumed() */
+#define JS_FRAME_HISTORY 64
+
+/* Compile-time capacities, 0 in config.h means no limit */
+#define JS_LIMIT(max_) ((max_) > 0 ? (size_t)(max_) : SIZE_MAX)
+#define JS_DEVICE_LIMIT JS_LIMIT(JS_MAX_DEVICES)
+#define JS_BUTTON_LIMIT JS_LIMIT(JS_MAX_BUTTONS)
+#define JS_AXIS_LIMIT JS_LIMIT(JS_MAX_AXES)
+
+typedef void (*js_source_dispatch_t)(void *data);
+
+struct js_source {
+	js_source_dispatch_t dispatch;
+	void *user_data;
+	int fd;
+	int epoll_fd;		/* the epoll the fd is registered with */
+	struct list link;
+};
+
+/**
+ * Each backend (udev, the test suite's mock backend, ...) embeds a struct
+ * js_ctx as the first member of its own context struct.
+ */
+struct js_backend_interface {
+	/**
+	 * Called once the context refcount drops to zero, after all devices
+	 * have been removed. The backend must release its own resources,
+	 * the context itself is freed by the caller.
+	 */
+	void (*destroy)(struct js_ctx *ctx);
+
+	/**
+	 * The size of the backend's device struct. With max-devices, the
+	 * context allocates that many of them when it is created, see
+	 * js_ctx_new_device().
+	 */
+	size_t device_size;
+};
+
+/**
+ * The statistics kept for a context and for each device, see
+ * js_ctx_get_stats() and js_device_get_stats().
+ */
+struct js_stats_data {
+	uint64_t events_read;
+	uint64_t frames;
+	uint64_t syscalls;
+	uint64_t events_queued;
+	uint64_t events_dequeued;
+	uint64_t queue_depth;
+	uint64_t queue_high_water;
+	uint64_t events_dropped;
+	uint64_t syn_dropped;
+	uint64_t timestamped_reports;
+	uint64_t timestamp_gaps;
+	uint64_t reports_lost;
+	uint64_t report_jitter;		/* device only */
+	uint64_t queue_overflows;
+	struct js_histogram dequeue_latency;
+};
+
+/* Per-stage CPU cost, only collected while perf counters are enabled,
+ * see js_ctx_set_perf_counters() */
+enum js_stage {
+	JS_STAGE_READ,
+	JS_STAGE_DECODE,
+	JS_STAGE_QUEUE,
+	JS_STAGE_COUNT,
+};
+
+struct js_stage_cost {
+	uint64_t cycles;
+	uint64_t instructions;
+	uint64_t events;
+};
+
+struct js_perf_sample {
+	bool valid;		/* false if the counters could not be read */
+	uint64_t cycles;
+	uint64_t instructions;
+	/* The cost accounted to stages at the time of the sample, a stage
+	 * does not include the stages nested in it */
+	uint64_t nested_cycles;
+	uint64_t nested_instructions;
+};
+
+struct js_perf;
+struct js_pool;
+
+/* The device clock from MSC_TIMESTAMP, see timestamp.c */
+struct js_device_clock {
+	bool pending;		/* MSC_TIMESTAMP in this frame */
+	uint32_t pending_raw;
+
+	uint64_t nsamples;
+	uint32_t last_raw;
+	uint64_t device_time;	/* unwrapped last_raw */
+	uint64_t host_time;	/* of the last report */
+	bool resync;		/* the next interval is not a gap */
+
+	uint32_t interval;	/* nominal report interval in µs */
+	double jitter;		/* in µs */
+
+	/* Exponentially weighted least squares fit of the offset
+	 * host - device over the device time in seconds, relative
+	 * to the last report and offset_base */
+	int64_t offset_base;
+	double w, wx, wxx, wy, wxy;
+	double offset;		/* at the last report, in µs */
+	double drift;		/* in ppm */
+};
+
+struct js_ctx {
+	int refcount;
+	int epoll_fd;
+
+	const struct js_interface *interface;
+	void *user_data;
+	const struct js_backend_interface *backend;
+
+	struct list source_destroy_list;
+	struct list devices;		/* struct js_device.link */
+	struct list event_queue;	/* struct js_event.link */
+	struct list output_pending;	/* struct js_device.output.link */
+
+	uint64_t last_frame_id;
+	enum js_power_mode power_mode;
+
+	/* See js_ctx_set_clock(), NULL for CLOCK_MONOTONIC */
+	struct {
+		js_clock_func_t now;
+		void *user_data;
+	} clock;
+
+	/* See js_ctx_set_latency_tolerance(). While enabled, the device
+	 * fds are in their own epoll. That epoll is in epoll_fd until a
+	 * device becomes readable, then the timer takes its place and the
+	 * devices are read once per tolerance period until a period
+	 * passes without input. */
+	struct {
+		uint32_t tolerance;	/* in µs, 0 if disabled */
+		int epoll_fd;
+		int timer_fd;
+		struct js_source *epoll_source;
+		struct js_source *timer_source;
+		bool waiting;		/* the timer is armed */
+	} batch;
+
+	/* See js_ctx_set_busy_poll() */
+	struct {
+		uint32_t window;	/* in µs, 0 if disabled */
+		uint64_t deadline;	/* CLOCK_MONOTONIC µs */
+		uint64_t last_frame_id;
+	} busy_poll;
+
+#if HAVE_STATISTICS
+	struct js_stats_data stats;
+	struct js_histogram consumed_latency;
+	struct js_histogram wake_latency;
+
+	/* Ring buffer of the last frames' kernel timestamps, indexed by
+	 * frame id % JS_FRAME_HISTORY */
+	struct {
+		uint64_t id;
+		uint64_t time;
+	} frame_history[JS_FRAME_HISTORY];
+	uint64_t last_consumed_frame_id;
+
+	struct js_perf *perf;		/* NULL unless enabled */
+	struct js_stage_cost stage_cost[JS_STAGE_COUNT];
+#endif
+
+	/* Bytes held by the events in event_queue */
+	size_t queued_memory;
+
+	/* See js_ctx_reserve() */
+	struct js_pool *event_pool;		/* NULL unless reserved */
+	struct js_pool *device_pool;		/* NULL without max-devices */
+	struct list free_sources;		/* struct js_source.link */
+	size_t nfree_sources;
+};
+
+enum js_control_type {
+	JS_CONTROL_NONE = 0,
+	JS_CONTROL_BUTTON,
+	JS_CONTROL_AXIS,
+	JS_CONTROL_DPAD,
+};
+
+/**
+ * Maps an evdev code to the control that it updates. For axes, dim is the
+ * x/y/z dimension, for dpads dim is the JS_DPAD_* direction bit (or the
+ * axis for hats, see evdev.c).
+ */
+struct js_control_map {
+	uint8_t type;
+	uint8_t dim;
+	uint16_t index;
+};
+
+struct js_button {
+	struct js_device *device;
+	unsigned int index;
+	unsigned int type;	/* EV_KEY or EV_ABS */
+	unsigned int code;
+	uint32_t capabilities;
+	int priority;
+	struct input_absinfo absinfo;
+};
+
+struct js_axis {
+	struct js_device *device;
+	unsigned int index;
+	int codes[3];		/* ABS_* per dimension or -1 */
+	struct input_absinfo absinfo[3];
+	uint32_t capabilities;
+};
+
+struct js_dpad {
+	struct js_device *device;
+	unsigned int index;
+	uint32_t capabilities;
+};
+
+/**
+ * Backends embed a struct js_device as the first member of their own
+ * device struct.
+ */
+struct js_device_interface {
+	/**
+	 * Fetch the current device state after a SYN_DROPPED. keys is a
+	 * bitmask of NLONGS(KEY_CNT), abs an array of ABS_CNT values.
+	 *
+	 * @return 0 on success or a negative errno on failure
+	 */
+	int (*sync_state)(struct js_device *device,
+			  unsigned long *keys,
+			  int32_t *abs);
+
+	/**
+	 * The device was removed from the context. The backend should
+	 * release the fd, the device itself may still be referenced by
+	 * the caller.
+	 */
+	void (*remove)(struct js_device *device);
+
+	/**
+	 * Upload a force feedback effect like EVIOCSFF: an id of -1 is a
+	 * new effect and the backend assigns the id, an existing id is
+	 * updated in place.
+	 *
+	 * @return 0 on success or a negative errno on failure
+	 */
+	int (*upload_effect)(struct js_device *device,
+			     struct ff_effect *effect);
+
+	/**
+	 * Remove an uploaded force feedback effect like EVIOCRMFF.
+	 *
+	 * @return 0 on success or a negative errno on failure
+	 */
+	int (*erase_effect)(struct js_device *device, int id);
+
+	/**
+	 * Write events to the device, i.e. EV_FF to play effects.
+	 *
+	 * @return 0 on success or a negative errno on failure
+	 */
+	int (*write_events)(struct js_device *device,
+			    const struct input_event *events,
+			    size_t count);
+
+	/**
+	 * Only deliver the events of the given type whose bit is set in
+	 * codes, an array of NLONGS(ncodes), like EVIOCSMASK. May be NULL
+	 * if the backend cannot filter events.
+	 *
+	 * @return 0 on success or a negative errno on failure
+	 */
+	int (*set_event_mask)(struct js_device *device,
+			      unsigned int type,
+			      const unsigned long *codes,
+			      size_t ncodes);
+
+	/**
+	 * Write the current value of an LED output in device->output to
+	 * the device. Only called for the outputs the backend set in
+	 * device->output.supported, may be NULL if it never does.
+	 *
+	 * @return 0 on success or a negative errno on failure
+	 */
+	int (*write_output)(struct js_device *device, enum js_output output);
+
+	/**
+	 * The last reference to the device was dropped. The backend must
+	 * release its own resources, the device itself is freed by the
+	 * caller. May be NULL if the backend has none.
+	 */
+	void (*destroy)(struct js_device *device);
+};
+
+/**
+ * The state of all controls on a device, in normalized form.
+ */
+struct js_device_state {
+	uint16_t *button_value;
+	unsigned long *button_state;
+	int16_t (*axis_value)[3];
+	uint32_t *dpad_state;
+};
+
+struct js_device {
+	struct js_ctx *ctx;
+	int refcount;
+	struct list link;		/* js_ctx.devices */
+	struct js_pool *pool;		/* NULL if allocated individually */
+
+	const struct js_device_interface *interface;
+	struct libevdev *evdev;
+	int fd;
+	struct js_source *source;
+
+	unsigned int user_index;
+	uint32_t types;
+	bool removed;
+
+	size_t nbuttons;
+	struct js_button *buttons;
+	size_t naxes;
+	struct js_axis *axes;
+	size_t ndpads;
+	struct js_dpad *dpads;
+
+	struct js_control_map key_map[JS_KEY_MAP_SIZE];
+	struct js_control_map abs_map[ABS_CNT];
+
+	struct {
+		struct js_device_state state;
+		unsigned long *button_value_changed;
+		unsigned long *button_state_changed;
+		unsigned long *axis_changed;
+		unsigned long *dpad_changed;
+		uint64_t time;
+		uint64_t id;
+
+		/* From the frame's MSC_TIMESTAMP, see
+		 * js_event_get_device_time_usec() */
+		bool has_device_time;
+		uint64_t device_time;
+		uint64_t corrected_time;
+
+		/* true after SYN_DROPPED until the next SYN_REPORT */
+		bool dropped;
+	} frame;
+
+	/* See js_device_get_clock_estimate() */
+	struct js_device_clock clock;
+
+	/* Drop the events the backend could not mask for the background
+	 * power mode */
+	bool filter_events;
+
+	/* See js_device_get_battery(), set by the backend */
+	struct {
+		bool present;
+		enum js_battery_status status;
+		int percent;
+	} battery;
+
+	/* See js_device_set_rumble() and friends, bits are
+	 * 1 << enum js_output */
+	struct {
+		uint32_t supported;	/* LED outputs, set by the backend */
+		uint32_t pending;	/* in ctx->output_pending if non-zero */
+		uint32_t written;	/* on_device is valid */
+		struct list link;
+
+		/* The latest values */
+		uint16_t rumble[2];	/* strong, weak */
+		uint32_t player_indicator;
+		uint8_t lightbar[3];
+
+		/* The values last written successfully */
+		struct {
+			uint16_t rumble[2];
+			uint32_t player_indicator;
+			uint8_t lightbar[3];
+		} on_device;
+
+		/* The rumble effect, id -1 until uploaded. The kernel
+		 * erases it when the fd is closed. */
+		struct ff_effect rumble_effect;
+		bool rumble_playing;
+	} output;
+
+#if HAVE_STATISTICS
+	struct js_stats_data stats;
+#endif
+
+#if JS_FIXED_CONTROLS
+	/* The arrays above point into this storage */
+	struct {
+		struct js_button buttons[JS_MAX_BUTTONS];
+		struct js_axis axes[JS_MAX_AXES];
+		struct js_dpad dpads[JS_MAX_DPADS];
+		uint16_t button_value[JS_MAX_BUTTONS];
+		unsigned long button_state[NLONGS(JS_MAX_BUTTONS)];
+		int16_t axis_value[JS_MAX_AXES][3];
+		uint32_t dpad_state[JS_MAX_DPADS];
+		unsigned long button_value_changed[NLONGS(JS_MAX_BUTTONS)];
+		unsigned long button_state_changed[NLONGS(JS_MAX_BUTTONS)];
+		unsigned long axis_changed[NLONGS(JS_MAX_AXES)];
+		unsigned long dpad_changed[NLONGS(JS_MAX_DPADS)];
+	} storage;
+#endif
+
+	/* Bytes allocated for the arrays above, see
+	 * js_device_get_memory_usage() */
+	struct {
+		size_t descriptors;
+		size_t state;
+		size_t queued;
+	} memory;
+};
+
+/* Everything up to and including the union is mirrored by struct
+ * js_inline_event in libjoystick-inline.h and must not change */
+struct js_event {
+	enum js_event_type type;
+	struct js_device *device;
+	uint64_t time;			/* in µs, CLOCK_MONOTONIC */
+	uint64_t frame_id;		/* 0 for non-frame events */
+
+	union {
+		struct {
+			uint16_t *value;
+			unsigned long *state;
+			unsigned long *value_changed;
+			unsigned long *state_changed;
+		} button;
+		struct {
+			int16_t (*value)[3];
+			unsigned long *changed;
+		} axis;
+		struct {
+			uint32_t *state;
+			unsigned long *changed;
+		} dpad;
+	};
+
+	/* See js_event_get_device_time_usec(), frame events only */
+	bool has_device_time;
+	uint64_t device_time;
+	uint64_t corrected_time;
+
+	size_t size;			/* allocated bytes incl. payload,
+					   0 if from the pool */
+	struct js_pool *pool;		/* NULL if allocated individually */
+	struct list link;		/* js_ctx.event_queue */
+
+	/* The arrays above point into this storage */
+	unsigned long payload[];
+};
+
+void
+js_log_error(struct js_ctx *ctx, const char *format, ...)
+	__attribute__((format(printf, 2, 3)));
+
+int
+js_ctx_init(struct js_ctx *ctx,
+	    const struct js_interface *interface,
+	    void *user_data,
+	    const struct js_backend_interface *backend);
+
+struct js_source *
+js_ctx_add_fd(struct js_ctx *ctx,
+	      int fd,
+	      js_source_dispatch_t dispatch,
+	      void *user_data);
+
+/**
+ * Like js_ctx_add_fd() for a device fd, which is subject to the
+ * context's latency tolerance.
+ */
+struct js_source *
+js_ctx_add_device_fd(struct js_ctx *ctx,
+		     int fd,
+		     js_source_dispatch_t dispatch,
+		     void *user_data);
+
+void
+js_ctx_remove_source(struct js_ctx *ctx, struct js_source *source);
+
+int
+js_ctx_open_restricted(struct js_ctx *ctx, const char *path, int flags);
+
+void
+js_ctx_close_restricted(struct js_ctx *ctx, int fd);
+
+struct js_event *
+js_event_new(struct js_device *device,
+	     enum js_event_type type,
+	     uint64_t time,
+	     size_t payload_size);
+
+void
+js_ctx_queue_event(struct js_ctx *ctx, struct js_event *event);
+
+/**
+ * Create the pool if needed and grow it to nslots slots of slot_size
+ * bytes. The slot size of a pool never changes.
+ *
+ * @return 0 on success, -EINVAL if nslots is larger than a pool can be
+ * or -ENOMEM
+ */
+int
+js_pool_reserve(struct js_pool **pool, size_t slot_size, size_t nslots);
+
+/**
+ * @return a zeroed slot of at least size bytes, or NULL if no more than
+ * keep slots are free or the slot is too small
+ */
+void *
+js_pool_get(struct js_pool *pool, size_t size, size_t keep);
+
+void
+js_pool_put(struct js_pool *pool, void *slot);
+
+/**
+ * @return the number of free slots, 0 for a NULL pool
+ */
+size_t
+js_pool_get_free(struct js_pool *pool);
+
+void
+js_pool_unref(struct js_pool *pool);
+
+size_t
+js_pool_get_memory_usage(struct js_pool *pool);
+
+/**
+ * @return the memory of the pool that is not in a slot in use
+ */
+size_t
+js_pool_get_unused_memory(struct js_pool *pool);
+
+/**
+ * Allocate a zeroed backend device struct of the given size. With
+ * max-devices, it comes from the context's device pool.
+ *
+ * @return the device or NULL if the device pool is exhausted
+ */
+void *
+js_ctx_new_device(struct js_ctx *ctx, size_t size);
+
+/**
+ * @return true if the event pool can take nevents more frame events,
+ * always true without max-queued-events
+ */
+bool
+js_ctx_can_queue(struct js_ctx *ctx, size_t nevents);
+
+/**
+ * @return the context's current time in µs, see js_ctx_set_clock()
+ */
+static inline uint64_t
+js_ctx_now(struct js_ctx *ctx)
+{
+	if (ctx->clock.now)
+		return ctx->clock.now(ctx->clock.user_data);
+
+	return now_in_us();
+}
+
+/**
+ * Allocate the next frame id and remember the frame's time for
+ * js_ctx_mark_consumed().
+ */
+uint64_t
+js_ctx_new_frame(struct js_ctx *ctx, uint64_t time);
+
+#if HAVE_STATISTICS
+/* Add n to a counter of the device and its context */
+#define js_stats_add(device_, counter_, n_) \
+	do { \
+		(device_)->stats.counter_ += (n_); \
+		(device_)->ctx->stats.counter_ += (n_); \
+	} while (0)
+
+#define js_ctx_stats_add(ctx_, counter_, n_) \
+	do { (ctx_)->stats.counter_ += (n_); } while (0)
+
+static inline void
+stats_update_queue(struct js_stats_data *stats, int delta)
+{
+	if (delta > 0) {
+		stats->events_queued++;
+		stats->queue_depth++;
+		if (stats->queue_depth > stats->queue_high_water)
+			stats->queue_high_water = stats->queue_depth;
+	} else {
+		stats->events_dequeued++;
+		stats->queue_depth--;
+	}
+}
+
+/**
+ * Update the queue depth statistics after an event was queued (delta 1)
+ * or dequeued (delta -1).
+ */
+static inline void
+js_stats_update_queue(struct js_ctx *ctx, struct js_event *event, int delta)
+{
+	stats_update_queue(&ctx->stats, delta);
+	stats_update_queue(&event->device->stats, delta);
+}
+
+/**
+ * Record the dequeue latency of a JS_EVENT_SYNC.
+ */
+static inline void
+js_stats_record_dequeue(struct js_ctx *ctx, struct js_event *event)
+{
+	uint64_t now = now_in_us();
+	uint64_t latency = now > event->time ? now - event->time : 0;
+
+	js_histogram_record(&ctx->stats.dequeue_latency, latency);
+	js_histogram_record(&event->device->stats.dequeue_latency, latency);
+}
+
+/**
+ * Record the wake latency of a frame that was just read.
+ */
+static inline void
+js_stats_record_wake(struct js_device *device, uint64_t time)
+{
+	uint64_t now = now_in_us();
+	uint64_t latency = now > time ? now - time : 0;
+
+	js_histogram_record(&device->ctx->wake_latency, latency);
+}
+#else
+#define js_stats_add(device_, counter_, n_) do { } while (0)
+#define js_ctx_stats_add(ctx_, counter_, n_) do { } while (0)
+
+static inline void
+js_stats_update_queue(struct js_ctx *ctx, struct js_event *event, int delta)
+{
+}
+
+static inline void
+js_stats_record_dequeue(struct js_ctx *ctx, struct js_event *event)
+{
+}
+
+static inline void
+js_stats_record_wake(struct js_device *device, uint64_t time)
+{
+}
+#endif
+
+void
+js_perf_sample(struct js_ctx *ctx, struct js_perf_sample *sample);
+
+void
+js_perf_account(struct js_ctx *ctx, enum js_stage stage,
+		struct js_perf_sample *sample, uint64_t nevents);
+
+void
+js_perf_destroy(struct js_ctx *ctx);
+
+size_t
+js_perf_get_memory_usage(struct js_ctx *ctx);
+
+/**
+ * Start measuring a stage. This is a no-op unless perf counters are
+ * enabled.
+ */
+static inline void
+js_perf_begin(struct js_ctx *ctx, struct js_perf_sample *sample)
+{
+#if HAVE_STATISTICS
+	if (ctx->perf)
+		js_perf_sample(ctx, sample);
+#endif
+}
+
+/**
+ * Account the cost since the sample to the stage and reset the sample to
+ * the current counter values, so the next stage can start from there.
+ */
+static inline void
+js_perf_end(struct js_ctx *ctx, enum js_stage stage,
+	    struct js_perf_sample *sample, uint64_t nevents)
+{
+#if HAVE_STATISTICS
+	if (ctx->perf)
+		js_perf_account(ctx, stage, sample, nevents);
+#endif
+}
+
+/**
+ * Open the device node through the context's open_restricted, create the
+ * libevdev context and switch the fd to CLOCK_MONOTONIC.
+ *
+ * @return the fd or a negative errno
+ */
+int
+evdev_device_open(struct js_ctx *ctx, const char *devnode,
+		  struct libevdev **evdev);
+
+/**
+ * A js_device_interface.sync_state implementation for kernel devices,
+ * fetches the state with the EVIOCGKEY and EVIOCGABS ioctls.
+ */
+int
+evdev_device_sync_state_fd(struct js_device *device,
+			   unsigned long *keys,
+			   int32_t *abs);
+
+/**
+ * The js_device_interface force feedback implementations for kernel
+ * devices, with the EVIOCSFF and EVIOCRMFF ioctls and write().
+ */
+int
+evdev_device_upload_effect_fd(struct js_device *device,
+			      struct ff_effect *effect);
+
+int
+evdev_device_erase_effect_fd(struct js_device *device, int id);
+
+int
+evdev_device_write_fd(struct js_device *device,
+		      const struct input_event *events,
+		      size_t count);
+
+/**
+ * A js_device_interface.set_event_mask implementation for kernel
+ * devices, with the EVIOCSMASK ioctl.
+ */
+int
+evdev_device_set_event_mask_fd(struct js_device *device,
+			       unsigned int type,
+			       const unsigned long *codes,
+			       size_t ncodes);
+
+/**
+ * Set the rumble effect to the device's current output.rumble value,
+ * stopping it for a value of zero.
+ *
+ * @return 0 on success or a negative errno on failure
+ */
+int
+ff_device_write_rumble(struct js_device *device);
+
+/**
+ * Record the MSC_TIMESTAMP of the current frame.
+ */
+static inline void
+timestamp_process(struct js_device *device, int32_t value)
+{
+	device->clock.pending = true;
+	device->clock.pending_raw = value;
+}
+
+/**
+ * Called for each SYN_REPORT with the kernel time of the report. Updates
+ * the device clock estimate and link statistics and sets the frame's
+ * device time if the report had an MSC_TIMESTAMP.
+ */
+void
+timestamp_update(struct js_device *device, uint64_t time);
+
+/**
+ * The reports until the next timestamp are not from the device's
+ * regular stream, e.g. after SYN_DROPPED or while masked. The next
+ * interval is neither a gap nor jitter and the frames synthesized until
+ * then have no device time.
+ */
+static inline void
+timestamp_resync(struct js_device *device)
+{
+	device->clock.pending = false;
+	device->clock.resync = true;
+	device->frame.has_device_time = false;
+}
+
+/**
+ * Drop the device's pending output, for devices that are removed.
+ */
+void
+js_device_cancel_output(struct js_device *device);
+
+void
+evdev_device_init(struct js_device *device,
+		  struct js_ctx *ctx,
+		  struct libevdev *evdev,
+		  int fd,
+		  const struct js_device_interface *interface);
+
+void
+evdev_device_classify(struct js_device *device);
+
+int
+evdev_device_added(struct js_device *device);
+
+void
+evdev_device_removed(struct js_device *device);
+
+/**
+ * Update the device's battery and queue a JS_EVENT_DEVICE_POWER if
+ * anything changed. A percent of -1 means unknown.
+ */
+void
+evdev_device_set_battery(struct js_device *device,
+			 bool present,
+			 enum js_battery_status status,
+			 int percent);
+
+/**
+ * Apply the context's power mode to the device.
+ */
+void
+evdev_device_set_power_mode(struct js_device *device);
+
+void
+evdev_device_process_event(struct js_device *device,
+			   const struct input_event *ev);
@@ -0,0 +1,139 @@
+/*
+ * Copyright © 2019 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#pragma once
+
+#include <errno.h>
+#include <stdlib.h>
+#include <systemd/sd-event.h>
+
+#include "libjoystick-loop.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @ingroup loop
+ *
+ * An sd-event source for a context. Input is dispatched at
+ * SD_EVENT_PRIORITY_IMPORTANT, i.e. before the sources at the default
+ * priority; change it with sd_event_source_set_priority() on
+ * js_sd_event_source::io.
+ */
+struct js_sd_event_source {
+	struct js_ctx *ctx;
+	sd_event_source *io;
+	sd_event_source *pending;	/* delivers the events queued before */
+	js_loop_handler handler;
+	void *user_data;
+};
+
+static inline int
+js_sd_event_source_handle_io(sd_event_source *s, int fd, uint32_t revents,
+			     void *data)
+{
+	struct js_sd_event_source *source = (struct js_sd_event_source *)data;
+
+	(void)s;
+	(void)fd;
+	(void)revents;
+	js_loop_dispatch(source->ctx, source->handler, source->user_data);
+	return 0;
+}
+
+static inline int
+js_sd_event_source_handle_pending(sd_event_source *s, void *data)
+{
+	struct js_sd_event_source *source = (struct js_sd_event_source *)data;
+
+	(void)s;
+	js_loop_dispatch(source->ctx, source->handler, source->user_data);
+	return 0;
+}
+
+/**
+ * @ingroup loop
+ *
+ * Remove the source from its event loop and free it, this releases the
+ * reference to the context.
+ */
+static inline void
+js_sd_event_source_free(struct js_sd_event_source *source)
+{
+	if (!source)
+		return;
+
+	sd_event_source_disable_unref(source->io);
+	sd_event_source_disable_unref(source->pending);
+	js_ctx_unref(source->ctx);
+	free(source);
+}
+
+/**
+ * @ingroup loop
+ *
+ * Add the context to the sd-event loop, the source keeps a reference
+ * to the context.
+ *
+ * @return 0 on success or a negative errno
+ */
+static inline int
+js_sd_event_add(sd_event *event,
+		struct js_ctx *ctx,
+		js_loop_handler handler,
+		void *user_data,
+		struct js_sd_event_source **source_out)
+{
+	struct js_sd_event_source *source;
+	int rc;
+
+	source = (struct js_sd_event_source *)calloc(1, sizeof(*source));
+	if (!source)
+		return -ENOMEM;
+
+	source->ctx = js_ctx_ref(ctx);
+	source->handler = handler;
+	source->user_data = user_data;
+
+	rc = sd_event_add_io(event, &source->io, js_ctx_get_fd(ctx), EPOLLIN,
+			     js_sd_event_source_handle_io, source);
+	if (rc < 0)
+		goto error;
+	sd_event_source_set_priority(source->io, SD_EVENT_PRIORITY_IMPORTANT);
+	sd_event_source_set_description(source->io, "libjoystick");
+
+	/* Defer sources are one-shot */
+	rc = sd_event_add_defer(event, &source->pending,
+				js_sd_event_source_handle_pending, source);
+	if (rc < 0)
+		goto error;
+	sd_event_source_set_priority(source->pending, SD_EVENT_PRIORITY_IMPORTANT);
+
+	*source_out = source;
+	return 0;
+
+error:
+	js_sd_event_source_free(source);
+	return rc;
+}
+
+#ifdef __cplusplus
+}
+#endif
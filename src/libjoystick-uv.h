@@ -0,0 +1,151 @@
+/*
+ * Copyright © 2019 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#pragma once
+
+#include <uv.h>
+
+#include "libjoystick-loop.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @ingroup loop
+ *
+ * A libuv poll handle for a context, allocated by the caller. libuv has
+ * no priorities, input is dispatched in the loop's poll phase.
+ *
+ * @code
+ * static struct js_uv_source source;
+ *
+ * js_uv_source_start(&source, uv_default_loop(), ctx, handle_event, data);
+ * ...
+ * js_uv_source_close(&source, NULL);
+ * @endcode
+ */
+struct js_uv_source {
+	uv_poll_t poll;
+	uv_timer_t pending;	/* delivers the events queued before */
+	struct js_ctx *ctx;
+	js_loop_handler handler;
+	void *user_data;
+	void (*close_cb)(struct js_uv_source *source);
+	int nhandles;
+};
+
+static inline void
+js_uv_source_handle_poll(uv_poll_t *poll, int status, int events)
+{
+	struct js_uv_source *source = (struct js_uv_source *)poll->data;
+
+	(void)events;
+	if (status < 0)
+		return;
+
+	js_loop_dispatch(source->ctx, source->handler, source->user_data);
+}
+
+static inline void
+js_uv_source_handle_pending(uv_timer_t *timer)
+{
+	struct js_uv_source *source = (struct js_uv_source *)timer->data;
+
+	js_loop_dispatch(source->ctx, source->handler, source->user_data);
+}
+
+static inline void
+js_uv_source_handle_closed(uv_handle_t *handle)
+{
+	struct js_uv_source *source = (struct js_uv_source *)handle->data;
+
+	if (--source->nhandles > 0)
+		return;
+
+	js_ctx_unref(source->ctx);
+	source->ctx = NULL;
+	if (source->close_cb)
+		source->close_cb(source);
+}
+
+/**
+ * @ingroup loop
+ *
+ * Start watching the context, the source keeps a reference to it until
+ * it is closed. Close the source with js_uv_source_close() whether or
+ * not this succeeds.
+ *
+ * @return 0 on success or a libuv error code
+ */
+static inline int
+js_uv_source_start(struct js_uv_source *source,
+		   uv_loop_t *loop,
+		   struct js_ctx *ctx,
+		   js_loop_handler handler,
+		   void *user_data)
+{
+	int rc;
+
+	source->ctx = NULL;
+	rc = uv_poll_init(loop, &source->poll, js_ctx_get_fd(ctx));
+	if (rc < 0)
+		return rc;
+
+	uv_timer_init(loop, &source->pending);
+	source->poll.data = source;
+	source->pending.data = source;
+	source->ctx = js_ctx_ref(ctx);
+	source->handler = handler;
+	source->user_data = user_data;
+	source->close_cb = NULL;
+	source->nhandles = 2;
+
+	rc = uv_poll_start(&source->poll, UV_READABLE, js_uv_source_handle_poll);
+	if (rc == 0)
+		rc = uv_timer_start(&source->pending, js_uv_source_handle_pending, 0, 0);
+
+	return rc;
+}
+
+/**
+ * @ingroup loop
+ *
+ * Stop watching and close the handles. close_cb, if any, is called once
+ * the source is no longer used by libuv and may be freed.
+ */
+static inline void
+js_uv_source_close(struct js_uv_source *source,
+		   void (*close_cb)(struct js_uv_source *source))
+{
+	/* uv_poll_init() failed, there is nothing to close */
+	if (!source->ctx) {
+		if (close_cb)
+			close_cb(source);
+		return;
+	}
+
+	source->close_cb = close_cb;
+	uv_close((uv_handle_t *)&source->poll, js_uv_source_handle_closed);
+	uv_close((uv_handle_t *)&source->pending, js_uv_source_handle_closed);
+}
+
+#ifdef __cplusplus
+}
+#endif
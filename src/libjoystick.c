@@ -0,0 +1,1030 @@
+/*
+ * Copyright © 2019 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#include "config.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include "libjoystick-private.h"
+
+/* For the layout checks only, the accessors below are the reference */
+#define LIBJOYSTICK_INLINE_NO_REDIRECT
+#include "libjoystick-inline.h"
+
+void
+js_log_error(struct js_ctx *ctx, const char *format, ...)
+{
+	va_list args;
+
+	fprintf(stderr, "libjoystick: ");
+	va_start(args, format);
+	vfprintf(stderr, format, args);
+	va_end(args);
+}
+
+int
+js_ctx_init(struct js_ctx *ctx,
+	    const struct js_interface *interface,
+	    void *user_data,
+	    const struct js_backend_interface *backend)
+{
+#if JS_MAX_QUEUED_EVENTS > 0
+	struct js_source *source, *tmp;
+#endif
+#if JS_MAX_DEVICES > 0 || JS_MAX_QUEUED_EVENTS > 0
+	int rc;
+#endif
+
+	assert(backend != NULL);
+
+	ctx->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	if (ctx->epoll_fd < 0)
+		return -errno;
+
+	ctx->refcount = 1;
+	ctx->interface = interface;
+	ctx->user_data = user_data;
+	ctx->backend = backend;
+	ctx->batch.epoll_fd = -1;
+	ctx->batch.timer_fd = -1;
+	list_init(&ctx->source_destroy_list);
+	list_init(&ctx->devices);
+	list_init(&ctx->event_queue);
+	list_init(&ctx->output_pending);
+	list_init(&ctx->free_sources);
+
+#if JS_MAX_DEVICES > 0
+	rc = js_pool_reserve(&ctx->device_pool, backend->device_size,
+			     JS_MAX_DEVICES);
+	if (rc < 0) {
+		js_pool_unref(ctx->device_pool);
+		close(ctx->epoll_fd);
+		return rc;
+	}
+#endif
+
+#if JS_MAX_QUEUED_EVENTS > 0
+	/* Fixed capacities, allocate everything now */
+	rc = js_ctx_reserve(ctx, JS_MAX_DEVICES, JS_MAX_QUEUED_EVENTS);
+	if (rc < 0) {
+		list_for_each_safe(source, tmp, &ctx->free_sources, link)
+			zfree(source);
+		js_pool_unref(ctx->event_pool);
+		js_pool_unref(ctx->device_pool);
+		close(ctx->epoll_fd);
+		return rc;
+	}
+#endif
+
+	return 0;
+}
+
+static struct js_source *
+js_ctx_get_source(struct js_ctx *ctx)
+{
+	struct js_source *source;
+
+	if (list_empty(&ctx->free_sources))
+		return zalloc(sizeof *source);
+
+	source = list_first_entry(&ctx->free_sources, source, link);
+	list_remove(&source->link);
+	ctx->nfree_sources--;
+	memset(source, 0, sizeof *source);
+
+	return source;
+}
+
+/* Sources are kept for reuse, see js_ctx_reserve() */
+static void
+js_ctx_put_source(struct js_ctx *ctx, struct js_source *source)
+{
+	list_insert(&ctx->free_sources, &source->link);
+	ctx->nfree_sources++;
+}
+
+static struct js_source *
+js_ctx_add_source(struct js_ctx *ctx,
+		  int epoll_fd,
+		  int fd,
+		  js_source_dispatch_t dispatch,
+		  void *user_data)
+{
+	struct js_source *source;
+	struct epoll_event ep;
+
+	source = js_ctx_get_source(ctx);
+	source->dispatch = dispatch;
+	source->user_data = user_data;
+	source->fd = fd;
+	source->epoll_fd = epoll_fd;
+
+	memset(&ep, 0, sizeof ep);
+	ep.events = EPOLLIN;
+	ep.data.ptr = source;
+
+	if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ep) < 0) {
+		int saved_errno = errno;
+
+		js_ctx_put_source(ctx, source);
+		errno = saved_errno;
+		return NULL;
+	}
+
+	return source;
+}
+
+struct js_source *
+js_ctx_add_fd(struct js_ctx *ctx,
+	      int fd,
+	      js_source_dispatch_t dispatch,
+	      void *user_data)
+{
+	return js_ctx_add_source(ctx, ctx->epoll_fd, fd, dispatch, user_data);
+}
+
+struct js_source *
+js_ctx_add_device_fd(struct js_ctx *ctx,
+		     int fd,
+		     js_source_dispatch_t dispatch,
+		     void *user_data)
+{
+	int epoll_fd = ctx->batch.tolerance ? ctx->batch.epoll_fd : ctx->epoll_fd;
+
+	return js_ctx_add_source(ctx, epoll_fd, fd, dispatch, user_data);
+}
+
+void
+js_ctx_remove_source(struct js_ctx *ctx, struct js_source *source)
+{
+	epoll_ctl(source->epoll_fd, EPOLL_CTL_DEL, source->fd, NULL);
+	source->fd = -1;
+	list_insert(&ctx->source_destroy_list, &source->link);
+}
+
+static void
+js_ctx_drop_destroyed_sources(struct js_ctx *ctx)
+{
+	struct js_source *source, *tmp;
+
+	list_for_each_safe(source, tmp, &ctx->source_destroy_list, link) {
+		list_remove(&source->link);
+		js_ctx_put_source(ctx, source);
+	}
+	list_init(&ctx->source_destroy_list);
+}
+
+int
+js_ctx_open_restricted(struct js_ctx *ctx, const char *path, int flags)
+{
+	return ctx->interface->open_restricted(path, flags, ctx->user_data);
+}
+
+void
+js_ctx_close_restricted(struct js_ctx *ctx, int fd)
+{
+	ctx->interface->close_restricted(fd, ctx->user_data);
+}
+
+struct js_event *
+js_event_new(struct js_device *device,
+	     enum js_event_type type,
+	     uint64_t time,
+	     size_t payload_size)
+{
+	struct js_pool *pool = device->ctx->event_pool;
+	struct js_event *event = NULL;
+	size_t size = sizeof *event + payload_size;
+	size_t keep = JS_EVENT_POOL_HOTPLUG_SLOTS;
+
+	/* Only the hotplug events may use the slots kept for them */
+	if (type == JS_EVENT_DEVICE_ADDED || type == JS_EVENT_DEVICE_REMOVED)
+		keep = 0;
+
+	if (pool)
+		event = js_pool_get(pool, size, keep);
+
+	if (event) {
+		event->pool = pool;
+	} else if (JS_FIXED_EVENTS) {
+		return NULL;
+	} else {
+		event = zalloc(size);
+		event->size = size;
+	}
+
+	event->type = type;
+	event->device = js_device_ref(device);
+	event->time = time;
+
+	return event;
+}
+
+bool
+js_ctx_can_queue(struct js_ctx *ctx, size_t nevents)
+{
+	if (!JS_FIXED_EVENTS)
+		return true;
+
+	return js_pool_get_free(ctx->event_pool) >=
+	       nevents + JS_EVENT_POOL_HOTPLUG_SLOTS;
+}
+
+void *
+js_ctx_new_device(struct js_ctx *ctx, size_t size)
+{
+	if (!ctx->device_pool)
+		return zalloc(size);
+
+	return js_pool_get(ctx->device_pool, size, 0);
+}
+
+void
+js_ctx_queue_event(struct js_ctx *ctx, struct js_event *event)
+{
+	list_append(&ctx->event_queue, &event->link);
+
+	js_trace(event_queued, event, event->type, event->device,
+		 event->frame_id, event->time);
+
+	js_stats_update_queue(ctx, event, 1);
+	ctx->queued_memory += event->size;
+	event->device->memory.queued += event->size;
+}
+
+_public_ int
+js_ctx_get_fd(struct js_ctx *ctx)
+{
+	return ctx->epoll_fd;
+}
+
+static int
+js_ctx_dispatch_epoll(struct js_ctx *ctx, int epoll_fd)
+{
+	struct epoll_event ep[32];
+	int count;
+
+	count = epoll_wait(epoll_fd, ep, ARRAY_LENGTH(ep), 0);
+	js_ctx_stats_add(ctx, syscalls, 1);
+	if (count < 0)
+		return -errno;
+
+	for (int i = 0; i < count; ++i) {
+		struct js_source *source = ep[i].data.ptr;
+
+		/* A previous dispatch may have removed this source */
+		if (source->fd == -1)
+			continue;
+
+		js_trace(fd_readable, source->fd, ep[i].events);
+		source->dispatch(source->user_data);
+	}
+
+	return count;
+}
+
+/* Read all devices until a frame arrives or the window after the last
+ * frame expires */
+static void
+js_ctx_busy_poll(struct js_ctx *ctx)
+{
+	uint64_t now = now_in_us();
+
+	while (ctx->last_frame_id == ctx->busy_poll.last_frame_id &&
+	       now < ctx->busy_poll.deadline) {
+		struct js_device *device, *tmp;
+
+		list_for_each_safe(device, tmp, &ctx->devices, link)
+			device->source->dispatch(device->source->user_data);
+
+		now = now_in_us();
+	}
+
+	if (ctx->last_frame_id != ctx->busy_poll.last_frame_id) {
+		ctx->busy_poll.last_frame_id = ctx->last_frame_id;
+		ctx->busy_poll.deadline = now + ctx->busy_poll.window;
+	}
+}
+
+_public_ void
+js_ctx_dispatch(struct js_ctx *ctx)
+{
+	js_ctx_dispatch_epoll(ctx, ctx->epoll_fd);
+	if (ctx->busy_poll.window)
+		js_ctx_busy_poll(ctx);
+	js_ctx_drop_destroyed_sources(ctx);
+	js_ctx_flush_output(ctx);
+}
+
+_public_ void
+js_ctx_set_clock(struct js_ctx *ctx, js_clock_func_t now, void *user_data)
+{
+	ctx->clock.now = now;
+	ctx->clock.user_data = now ? user_data : NULL;
+}
+
+_public_ int
+js_ctx_set_busy_poll(struct js_ctx *ctx, uint32_t usec)
+{
+	if (usec && ctx->batch.tolerance)
+		return -EBUSY;
+
+	ctx->busy_poll.window = usec;
+	ctx->busy_poll.deadline = 0;
+	ctx->busy_poll.last_frame_id = ctx->last_frame_id;
+
+	return 0;
+}
+
+static int
+batch_set_timer(struct js_ctx *ctx, uint32_t usec)
+{
+	struct itimerspec its = {
+		.it_interval = { usec / 1000000, (usec % 1000000) * 1000 },
+		.it_value = { usec / 1000000, (usec % 1000000) * 1000 },
+	};
+
+	js_ctx_stats_add(ctx, syscalls, 1);
+	if (timerfd_settime(ctx->batch.timer_fd, 0, &its, NULL) < 0)
+		return -errno;
+
+	return 0;
+}
+
+static int
+batch_watch_devices(struct js_ctx *ctx, bool watch)
+{
+	struct epoll_event ep = {
+		.events = watch ? EPOLLIN : 0,
+		.data.ptr = ctx->batch.epoll_source,
+	};
+
+	js_ctx_stats_add(ctx, syscalls, 1);
+	if (epoll_ctl(ctx->epoll_fd, EPOLL_CTL_MOD, ctx->batch.epoll_fd, &ep) < 0)
+		return -errno;
+
+	return 0;
+}
+
+/* A device became readable, give the others until the tolerance expires
+ * to catch up */
+static void
+batch_devices_readable(void *data)
+{
+	struct js_ctx *ctx = data;
+
+	if (batch_set_timer(ctx, ctx->batch.tolerance) < 0)
+		return;
+
+	ctx->batch.waiting = true;
+	batch_watch_devices(ctx, false);
+}
+
+static void
+batch_timer_expired(void *data)
+{
+	struct js_ctx *ctx = data;
+	uint64_t expirations;
+
+	js_ctx_stats_add(ctx, syscalls, 1);
+	if (read(ctx->batch.timer_fd, &expirations, sizeof(expirations)) < 0)
+		return;
+
+	/* Keep the timer running while there is input, go back to waiting
+	 * for the devices after a period without */
+	if (js_ctx_dispatch_epoll(ctx, ctx->batch.epoll_fd) > 0 ||
+	    !ctx->batch.waiting)
+		return;
+
+	ctx->batch.waiting = false;
+	batch_set_timer(ctx, 0);
+	batch_watch_devices(ctx, true);
+}
+
+static int
+batch_move_devices(struct js_ctx *ctx, int epoll_fd)
+{
+	struct js_device *device;
+
+	list_for_each(device, &ctx->devices, link) {
+		struct js_source *source = device->source;
+		struct epoll_event ep = {
+			.events = EPOLLIN,
+			.data.ptr = source,
+		};
+
+		if (!source || source->epoll_fd == epoll_fd)
+			continue;
+
+		if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, source->fd, &ep) < 0)
+			return -errno;
+		epoll_ctl(source->epoll_fd, EPOLL_CTL_DEL, source->fd, NULL);
+		source->epoll_fd = epoll_fd;
+	}
+
+	return 0;
+}
+
+static void
+batch_disable(struct js_ctx *ctx)
+{
+	batch_move_devices(ctx, ctx->epoll_fd);
+
+	if (ctx->batch.epoll_source)
+		js_ctx_remove_source(ctx, ctx->batch.epoll_source);
+	if (ctx->batch.timer_source)
+		js_ctx_remove_source(ctx, ctx->batch.timer_source);
+	if (ctx->batch.epoll_fd != -1)
+		close(ctx->batch.epoll_fd);
+	if (ctx->batch.timer_fd != -1)
+		close(ctx->batch.timer_fd);
+
+	ctx->batch.epoll_source = NULL;
+	ctx->batch.timer_source = NULL;
+	ctx->batch.epoll_fd = -1;
+	ctx->batch.timer_fd = -1;
+	ctx->batch.waiting = false;
+	ctx->batch.tolerance = 0;
+}
+
+static int
+batch_enable(struct js_ctx *ctx, uint32_t usec)
+{
+	int rc;
+
+	ctx->batch.epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	ctx->batch.timer_fd = timerfd_create(CLOCK_MONOTONIC,
+					     TFD_NONBLOCK | TFD_CLOEXEC);
+	if (ctx->batch.epoll_fd < 0 || ctx->batch.timer_fd < 0)
+		goto error;
+
+	ctx->batch.epoll_source = js_ctx_add_fd(ctx, ctx->batch.epoll_fd,
+						batch_devices_readable, ctx);
+	if (!ctx->batch.epoll_source)
+		goto error;
+
+	ctx->batch.timer_source = js_ctx_add_fd(ctx, ctx->batch.timer_fd,
+						batch_timer_expired, ctx);
+	if (!ctx->batch.timer_source)
+		goto error;
+
+	rc = batch_move_devices(ctx, ctx->batch.epoll_fd);
+	if (rc < 0) {
+		errno = -rc;
+		goto error;
+	}
+
+	ctx->batch.tolerance = usec;
+	return 0;
+
+error:
+	rc = -errno;
+	batch_disable(ctx);
+	return rc;
+}
+
+_public_ int
+js_ctx_set_latency_tolerance(struct js_ctx *ctx, uint32_t usec)
+{
+	if (usec == ctx->batch.tolerance)
+		return 0;
+
+	if (usec && ctx->busy_poll.window)
+		return -EBUSY;
+
+	if (usec == 0) {
+		/* Whatever is waiting goes out with the next dispatch */
+		batch_disable(ctx);
+		return 0;
+	}
+
+	if (ctx->batch.tolerance == 0)
+		return batch_enable(ctx, usec);
+
+	ctx->batch.tolerance = usec;
+	if (ctx->batch.waiting)
+		return batch_set_timer(ctx, usec);
+
+	return 0;
+}
+
+_public_ int
+js_ctx_set_power_mode(struct js_ctx *ctx, enum js_power_mode mode)
+{
+	struct js_device *device;
+
+	if (mode != JS_POWER_MODE_ACTIVE && mode != JS_POWER_MODE_BACKGROUND)
+		return -EINVAL;
+
+	if (ctx->power_mode == mode)
+		return 0;
+
+	ctx->power_mode = mode;
+	list_for_each(device, &ctx->devices, link)
+		evdev_device_set_power_mode(device);
+
+	return 0;
+}
+
+_public_ struct js_event *
+js_ctx_get_event(struct js_ctx *ctx)
+{
+	struct js_event *event;
+
+	if (list_empty(&ctx->event_queue))
+		return NULL;
+
+	event = list_first_entry(&ctx->event_queue, event, link);
+	list_remove(&event->link);
+
+	js_trace(event_dequeued, event, event->type, event->device,
+		 event->frame_id, event->time);
+
+	js_stats_update_queue(ctx, event, -1);
+	ctx->queued_memory -= event->size;
+	event->device->memory.queued -= event->size;
+
+	if (event->type == JS_EVENT_SYNC)
+		js_stats_record_dequeue(ctx, event);
+
+	return event;
+}
+
+_public_ void
+js_set_allocator(const struct js_allocator *allocator)
+{
+	if (allocator) {
+		alloc_hooks.malloc = allocator->malloc;
+		alloc_hooks.free = allocator->free;
+		alloc_hooks.user_data = allocator->user_data;
+	} else {
+		memset(&alloc_hooks, 0, sizeof(alloc_hooks));
+	}
+}
+
+_public_ int
+js_ctx_reserve(struct js_ctx *ctx,
+	       unsigned int max_devices,
+	       unsigned int max_queued_events)
+{
+	size_t nsources;
+
+	/* The kernel has at most 1024 evdev minors */
+	if (max_devices > min(JS_DEVICE_LIMIT, 1024U))
+		return -EINVAL;
+
+	/* One source per device plus one for the backend, e.g. the udev
+	 * monitor, and two for js_ctx_set_latency_tolerance() */
+	nsources = max_devices + 3;
+	while (ctx->nfree_sources < nsources) {
+		struct js_source *source = try_zalloc(sizeof *source);
+
+		if (!source)
+			return -ENOMEM;
+		js_ctx_put_source(ctx, source);
+	}
+
+	if (max_queued_events > 0)
+		return js_pool_reserve(&ctx->event_pool, JS_EVENT_SLOT_SIZE,
+				       (size_t)max_queued_events +
+				       JS_EVENT_POOL_HOTPLUG_SLOTS);
+
+	return 0;
+}
+
+_public_ void
+js_ctx_set_user_data(struct js_ctx *ctx, void *user_data)
+{
+	ctx->user_data = user_data;
+}
+
+_public_ void *
+js_ctx_get_user_data(struct js_ctx *ctx)
+{
+	return ctx->user_data;
+}
+
+_public_ struct js_ctx *
+js_ctx_ref(struct js_ctx *ctx)
+{
+	ctx->refcount++;
+	return ctx;
+}
+
+_public_ struct js_ctx *
+js_ctx_unref(struct js_ctx *ctx)
+{
+	struct js_device *device, *tmp;
+	struct js_source *source, *tmp_source;
+	struct js_event *event;
+
+	if (ctx == NULL)
+		return NULL;
+
+	assert(ctx->refcount > 0);
+	ctx->refcount--;
+	if (ctx->refcount > 0)
+		return NULL;
+
+	list_for_each_safe(device, tmp, &ctx->devices, link)
+		evdev_device_removed(device);
+
+	while ((event = js_ctx_get_event(ctx)))
+		js_event_destroy(event);
+
+	ctx->backend->destroy(ctx);
+	batch_disable(ctx);
+
+	js_perf_destroy(ctx);
+	js_ctx_drop_destroyed_sources(ctx);
+	list_for_each_safe(source, tmp_source, &ctx->free_sources, link)
+		zfree(source);
+	js_pool_unref(ctx->event_pool);
+	js_pool_unref(ctx->device_pool);
+	close(ctx->epoll_fd);
+	zfree(ctx);
+
+	return NULL;
+}
+
+_public_ struct js_device *
+js_device_ref(struct js_device *device)
+{
+	device->refcount++;
+	return device;
+}
+
+_public_ struct js_device *
+js_device_unref(struct js_device *device)
+{
+	if (device == NULL)
+		return NULL;
+
+	assert(device->refcount > 0);
+	device->refcount--;
+	if (device->refcount > 0)
+		return NULL;
+
+#if !JS_FIXED_CONTROLS
+	zfree(device->buttons);
+	zfree(device->axes);
+	zfree(device->dpads);
+	zfree(device->frame.state.button_value);
+	zfree(device->frame.state.button_state);
+	zfree(device->frame.state.axis_value);
+	zfree(device->frame.state.dpad_state);
+	zfree(device->frame.button_value_changed);
+	zfree(device->frame.button_state_changed);
+	zfree(device->frame.axis_changed);
+	zfree(device->frame.dpad_changed);
+#endif
+	libevdev_free(device->evdev);
+
+	if (device->interface->destroy)
+		device->interface->destroy(device);
+
+	if (device->pool)
+		js_pool_put(device->pool, device);
+	else
+		zfree(device);
+
+	return NULL;
+}
+
+_public_ int
+js_device_get_battery(struct js_device *device,
+		      enum js_battery_status *status,
+		      int *percent)
+{
+	if (!device->battery.present)
+		return -ENOENT;
+
+	*status = device->battery.status;
+	*percent = device->battery.percent;
+
+	return 0;
+}
+
+_public_ const char *
+js_device_get_name(struct js_device *device)
+{
+	return libevdev_get_name(device->evdev);
+}
+
+_public_ unsigned int
+js_device_get_user_index(struct js_device *device)
+{
+	return device->user_index;
+}
+
+_public_ bool
+js_device_has_type(struct js_device *device, enum js_device_type type)
+{
+	return !!(device->types & js_type_bit(type));
+}
+
+_public_ size_t
+js_device_get_button_count(struct js_device *device)
+{
+	return device->nbuttons;
+}
+
+_public_ struct js_button *
+js_device_get_button(struct js_device *device, unsigned int index)
+{
+	if (index >= device->nbuttons)
+		return NULL;
+
+	return &device->buttons[index];
+}
+
+_public_ size_t
+js_device_get_axis_count(struct js_device *device)
+{
+	return device->naxes;
+}
+
+_public_ struct js_axis *
+js_device_get_axis(struct js_device *device, unsigned int index)
+{
+	if (index >= device->naxes)
+		return NULL;
+
+	return &device->axes[index];
+}
+
+_public_ size_t
+js_device_get_dpad_count(struct js_device *device)
+{
+	return device->ndpads;
+}
+
+_public_ struct js_dpad *
+js_device_get_dpad(struct js_device *device, unsigned int index)
+{
+	if (index >= device->ndpads)
+		return NULL;
+
+	return &device->dpads[index];
+}
+
+_public_ bool
+js_button_has_capability(struct js_button *button,
+			 enum js_button_capability cap)
+{
+	if (cap < JS_BUTTON_CAP_LEFT || cap > JS_BUTTON_CAP_INACCESSIBLE)
+		return false;
+
+	return !!(button->capabilities & js_button_cap_bit(cap));
+}
+
+_public_ int
+js_button_compare_priority(struct js_button *b1, struct js_button *b2)
+{
+	if (b1->priority < b2->priority)
+		return -1;
+	if (b1->priority > b2->priority)
+		return 1;
+	return 0;
+}
+
+_public_ bool
+js_axis_has_capability(struct js_axis *axis, enum js_axis_capability cap)
+{
+	if (cap < JS_AXIS_CAP_LEFT || cap > JS_AXIS_CAP_ANALOG)
+		return false;
+
+	return !!(axis->capabilities & js_axis_cap_bit(cap));
+}
+
+_public_ bool
+js_dpad_has_capability(struct js_dpad *dpad, enum js_dpad_capability cap)
+{
+	if (cap < JS_DPAD_CAP_LEFT || cap > JS_DPAD_CAP_8BUTTON)
+		return false;
+
+	return !!(dpad->capabilities & js_dpad_cap_bit(cap));
+}
+
+_public_ enum js_event_type
+js_event_get_type(struct js_event *event)
+{
+	return event->type;
+}
+
+_public_ void
+js_event_destroy(struct js_event *event)
+{
+	if (event == NULL)
+		return;
+
+	js_device_unref(event->device);
+
+	if (event->pool)
+		js_pool_put(event->pool, event);
+	else
+		zfree(event);
+}
+
+_public_ struct js_device *
+js_event_get_device(struct js_event *event)
+{
+	return event->device;
+}
+
+_public_ uint64_t
+js_event_get_time_usec(struct js_event *event)
+{
+	return event->time;
+}
+
+_public_ uint64_t
+js_event_get_frame_id(struct js_event *event)
+{
+	return event->frame_id;
+}
+
+_public_ bool
+js_event_get_device_time_usec(struct js_event *event, uint64_t *time)
+{
+	if (!event->has_device_time)
+		return false;
+
+	*time = event->device_time;
+
+	return true;
+}
+
+_public_ uint64_t
+js_event_get_corrected_time_usec(struct js_event *event)
+{
+	return event->has_device_time ? event->corrected_time : event->time;
+}
+
+/* struct js_inline_event and struct js_inline_control mirror the start
+ * of the structs below, see libjoystick-inline.h */
+#define assert_inline_abi(type_, member_, inline_type_, inline_member_)	\
+	static_assert(offsetof(type_, member_) ==				\
+		      offsetof(inline_type_, inline_member_) &&		\
+		      sizeof(((type_ *)0)->member_) ==			\
+		      sizeof(((inline_type_ *)0)->inline_member_),		\
+		      #type_ "." #member_ " is part of the inline ABI")
+
+assert_inline_abi(struct js_event, type, struct js_inline_event, type);
+assert_inline_abi(struct js_event, device, struct js_inline_event, device);
+assert_inline_abi(struct js_event, time, struct js_inline_event, time);
+assert_inline_abi(struct js_event, frame_id, struct js_inline_event, frame_id);
+assert_inline_abi(struct js_event, button, struct js_inline_event, u.button);
+assert_inline_abi(struct js_event, axis, struct js_inline_event, u.axis);
+assert_inline_abi(struct js_event, dpad, struct js_inline_event, u.dpad);
+assert_inline_abi(struct js_button, device, struct js_inline_control, device);
+assert_inline_abi(struct js_button, index, struct js_inline_control, index);
+assert_inline_abi(struct js_axis, device, struct js_inline_control, device);
+assert_inline_abi(struct js_axis, index, struct js_inline_control, index);
+assert_inline_abi(struct js_dpad, device, struct js_inline_control, device);
+assert_inline_abi(struct js_dpad, index, struct js_inline_control, index);
+
+static inline bool
+event_has_axis(struct js_event *event, struct js_axis *axis)
+{
+	return event->type == JS_EVENT_AXIS &&
+	       axis != NULL &&
+	       axis->device == event->device;
+}
+
+static inline bool
+event_has_button(struct js_event *event, struct js_button *button)
+{
+	return event->type == JS_EVENT_BUTTON &&
+	       button != NULL &&
+	       button->device == event->device;
+}
+
+static inline bool
+event_has_dpad(struct js_event *event, struct js_dpad *dpad)
+{
+	return event->type == JS_EVENT_DPAD &&
+	       dpad != NULL &&
+	       dpad->device == event->device;
+}
+
+_public_ bool
+js_event_axis_has_changed(struct js_event *event, struct js_axis *axis)
+{
+	if (!event_has_axis(event, axis))
+		return false;
+
+	return long_bit_is_set(event->axis.changed, axis->index);
+}
+
+_public_ bool
+js_event_axis_get_value(struct js_event *event,
+			struct js_axis *axis,
+			int16_t *x, int16_t *y, int16_t *z)
+{
+	int16_t *value;
+
+	if (!event_has_axis(event, axis)) {
+		if (x)
+			*x = 0;
+		if (y)
+			*y = 0;
+		if (z)
+			*z = 0;
+		return false;
+	}
+
+	value = event->axis.value[axis->index];
+	if (x)
+		*x = value[0];
+	if (y)
+		*y = value[1];
+	if (z)
+		*z = value[2];
+
+	return long_bit_is_set(event->axis.changed, axis->index);
+}
+
+_public_ bool
+js_event_button_value_has_changed(struct js_event *event,
+				  struct js_button *button)
+{
+	if (!event_has_button(event, button))
+		return false;
+
+	return long_bit_is_set(event->button.value_changed, button->index);
+}
+
+_public_ bool
+js_event_button_state_has_changed(struct js_event *event,
+				  struct js_button *button)
+{
+	if (!event_has_button(event, button))
+		return false;
+
+	return long_bit_is_set(event->button.state_changed, button->index);
+}
+
+_public_ bool
+js_event_button_get_value(struct js_event *event, struct js_button *button,
+			  uint16_t *value)
+{
+	if (!event_has_button(event, button)) {
+		*value = 0;
+		return false;
+	}
+
+	*value = event->button.value[button->index];
+
+	return long_bit_is_set(event->button.value_changed, button->index);
+}
+
+_public_ bool
+js_event_button_get_state(struct js_event *event, struct js_button *button,
+			  bool *state)
+{
+	if (!event_has_button(event, button)) {
+		*state = false;
+		return false;
+	}
+
+	*state = long_bit_is_set(event->button.state, button->index);
+
+	return long_bit_is_set(event->button.state_changed, button->index);
+}
+
+_public_ bool
+js_event_dpad_get_state(struct js_event *event, struct js_dpad *dpad,
+			uint32_t *state)
+{
+	if (!event_has_dpad(event, dpad)) {
+		*state = 0;
+		return false;
+	}
+
+	*state = event->dpad.state[dpad->index];
+
+	return long_bit_is_set(event->dpad.changed, dpad->index);
+}
@@ -39,6 +39,18 @@ extern "C" {
  * @defgroup device Querying and manipulating devices
  */
 
+/**
+ * @defgroup stats Runtime statistics
+ */
+
+/**
+ * @defgroup ff Force feedback
+ */
+
+/**
+ * @defgroup output Rumble and LEDs
+ */
+
 /**
  * @ingroup base
  * @struct js_ctx
@@ -118,6 +130,17 @@ struct js_touch;
  */
 struct js_event;
 
+/**
+ * @ingroup stats
+ * @struct js_stats
+ *
+ * A snapshot of the statistics of a context or a device, see
+ * js_ctx_get_stats() and js_device_get_stats().
+ *
+ * This struct is not refcounted, use js_stats_destroy() to free it.
+ */
+struct js_stats;
+
 /**
  * @ingroup base
  * @struct js_interface
@@ -151,6 +174,45 @@ struct js_interface {
 	void (*close_restricted)(int fd, void *user_data);
 };
 
+/**
+ * @ingroup base
+ * @struct js_allocator
+ *
+ * Allocator hooks for all memory allocated by libjoystick itself, see
+ * js_set_allocator().
+ */
+struct js_allocator {
+	/**
+	 * Allocate size bytes, the memory must be suitably aligned for any
+	 * type. libjoystick aborts if this returns NULL.
+	 */
+	void *(*malloc)(size_t size, void *user_data);
+	/**
+	 * Free memory returned by malloc. ptr is never NULL.
+	 */
+	void (*free)(void *ptr, void *user_data);
+	/**
+	 * Passed to malloc and free.
+	 */
+	void *user_data;
+};
+
+/**
+ * @ingroup base
+ *
+ * Route all allocations made by libjoystick through the given hooks. The
+ * hooks are process-wide and must be set before the first context is
+ * created; changing them while any libjoystick object exists results in
+ * memory being freed with the wrong hook.
+ *
+ * Memory allocated by libudev and libevdev is not affected.
+ *
+ * @param allocator The hooks, copied by libjoystick, or NULL to restore
+ * the libc allocator
+ */
+void
+js_set_allocator(const struct js_allocator *allocator);
+
 /**
  * @ingroup base
  *
@@ -176,6 +238,45 @@ js_ctx_udev_create_context(const struct js_interface *interface,
 int
 js_ctx_udev_assign_seat(struct js_ctx *ctx, const char *seat);
 
+/**
+ * @ingroup base
+ *
+ * Create a new libjoystick context that does not use udev. Devices are
+ * added and removed by the caller with js_ctx_path_add_device() and
+ * js_ctx_path_remove_device(). The devices are not filtered, any evdev
+ * device added is handled as joystick.
+ *
+ * The returned context has a refcount of at least 1, use js_ctx_unref() to
+ * release it.
+ */
+struct js_ctx *
+js_ctx_path_create_context(const struct js_interface *interface,
+			   void *userdata);
+
+/**
+ * @ingroup base
+ *
+ * Add the device at the given /dev/input/event path to a context created
+ * with js_ctx_path_create_context(). A @ref JS_EVENT_DEVICE_ADDED event is
+ * queued for this device.
+ *
+ * The device is owned by the context, use js_device_ref() to keep a
+ * reference beyond the device's removal.
+ *
+ * @return the new device or NULL on failure
+ */
+struct js_device *
+js_ctx_path_add_device(struct js_ctx *ctx, const char *path);
+
+/**
+ * @ingroup base
+ *
+ * Remove a device previously added with js_ctx_path_add_device(). A @ref
+ * JS_EVENT_DEVICE_REMOVED event is queued for this device.
+ */
+void
+js_ctx_path_remove_device(struct js_device *device);
+
 /**
  * @ingroup base
  *
@@ -199,6 +300,9 @@ js_ctx_get_fd(struct js_ctx *js);
  * descriptor returned by js_ctx_get_fd(). Any delay in calling
  * js_ctx_dispatch() may result in lost events.
  *
+ * Pending output is written at the end of each dispatch, see
+ * js_ctx_flush_output().
+ *
  * @param ctx A previously initialized libjoystick context
  */
 void
@@ -215,6 +319,152 @@ js_ctx_dispatch(struct js_ctx *ctx);
 struct js_event *
 js_ctx_get_event(struct js_ctx *ctx);
 
+/**
+ * @ingroup base
+ *
+ * How much input the context asks the devices for, see
+ * js_ctx_set_power_mode().
+ */
+enum js_power_mode {
+	/**
+	 * All events, the default.
+	 */
+	JS_POWER_MODE_ACTIVE = 0,
+	/**
+	 * Only JS_BUTTON_CAP_SYSTEM and JS_BUTTON_CAP_START buttons and
+	 * hotplug, e.g. while the application is unfocused or paused.
+	 */
+	JS_POWER_MODE_BACKGROUND,
+};
+
+/**
+ * @ingroup base
+ *
+ * Switch all devices of the context, including devices added later, to
+ * the given power mode.
+ *
+ * In background mode the kernel is told to drop all other events with
+ * EVIOCSMASK, so moving a stick or pressing any other button does not
+ * wake up the caller at all. On kernels without EVIOCSMASK the events
+ * are still read but dropped by libjoystick.
+ *
+ * When switching back to active mode, each device's state is fetched
+ * from the kernel and the controls that changed in the meantime are
+ * sent as one frame, like after a SYN_DROPPED.
+ *
+ * @return 0 on success or a negative errno
+ */
+int
+js_ctx_set_power_mode(struct js_ctx *ctx, enum js_power_mode mode);
+
+/**
+ * @ingroup base
+ *
+ * Allow input to wait up to usec microseconds before the fd returned by
+ * js_ctx_get_fd() becomes readable, 0 (the default) disables the delay.
+ * This cannot be combined with js_ctx_set_busy_poll().
+ *
+ * With a tolerance, the first input from any device starts a timer and
+ * the fd becomes readable when it expires, with the input of all devices
+ * from that period ready to be dispatched. As long as input keeps
+ * coming, the devices are read once per period, so a device reporting at
+ * 1 kHz wakes up the caller 1000 / (usec / 1000) times per second
+ * instead of 1000 times. Hotplug is not delayed.
+ *
+ * The timestamps of the events are not affected, only their delivery.
+ *
+ * @return 0 on success, -EBUSY if busy polling is enabled or another
+ * negative errno
+ */
+int
+js_ctx_set_latency_tolerance(struct js_ctx *ctx, uint32_t usec);
+
+/**
+ * @ingroup base
+ *
+ * Keep reading the devices for usec microseconds after each frame
+ * instead of waiting for the kernel to wake up the caller, 0 (the
+ * default) disables busy polling.
+ *
+ * Within the window, js_ctx_dispatch() spins on non-blocking reads of
+ * all device fds and returns as soon as a frame was read or the window
+ * expired. A caller that wants the lowest latency calls
+ * js_ctx_dispatch() again without waiting for js_ctx_get_fd() for as
+ * long as the previous call queued events. This trades a CPU core for
+ * skipping the scheduler wakeup, the @ref JS_STATS_LATENCY_WAKE
+ * histogram shows the latency achieved.
+ *
+ * Busy polling and js_ctx_set_latency_tolerance() work against each
+ * other, only one of them can be enabled.
+ *
+ * @return 0 on success or -EBUSY if a latency tolerance is set
+ */
+int
+js_ctx_set_busy_poll(struct js_ctx *ctx, uint32_t usec);
+
+/**
+ * @ingroup base
+ *
+ * A clock for js_ctx_set_clock().
+ *
+ * @return the current time in microseconds
+ */
+typedef uint64_t (*js_clock_func_t)(void *user_data);
+
+/**
+ * @ingroup base
+ *
+ * Replace the clock the context reads the current time from, NULL
+ * restores the default CLOCK_MONOTONIC. The clock should be set before
+ * any devices are added and must not go backwards.
+ *
+ * The clock provides the timestamps of the events that are not
+ * generated by a frame, e.g. @ref JS_EVENT_DEVICE_ADDED. Frame events
+ * keep the kernel timestamps of their evdev events. With a simulated
+ * clock, a replay through a backend that timestamps its events with the
+ * same clock produces the same events at any replay speed.
+ *
+ * Latencies are measured from the kernel timestamps, the latency
+ * statistics and js_ctx_mark_consumed() therefore always use
+ * CLOCK_MONOTONIC. Waiting is not affected either: the timers of
+ * js_ctx_set_latency_tolerance() and the window of
+ * js_ctx_set_busy_poll() run on CLOCK_MONOTONIC.
+ */
+void
+js_ctx_set_clock(struct js_ctx *ctx, js_clock_func_t now, void *user_data);
+
+/**
+ * @ingroup base
+ *
+ * Allocate the context's pools up-front, so that dispatching and
+ * retrieving events does not allocate memory, provided the number of
+ * devices and the number of events in flight stay within these limits.
+ * Events in flight are the events in the queue plus the events retrieved
+ * but not yet destroyed by the caller. Events beyond the limit or with
+ * an unusually large payload are allocated individually. In a build with
+ * the max-queued-events option, frames beyond the limit are dropped
+ * instead, see @ref JS_STATS_QUEUE_OVERFLOWS.
+ *
+ * The per-device descriptors and state are allocated once when a device
+ * is added, their size depends on the device. In a build with the
+ * max-devices, max-buttons and max-axes options, they are part of the
+ * devices allocated when the context is created.
+ *
+ * This function may be called more than once, the pools only grow.
+ *
+ * @param max_devices The maximum number of devices at any time, at most
+ * 1024 or the build's max-devices option
+ * @param max_queued_events The maximum number of events in flight, the
+ * limit depends on the size of an event and is several thousand
+ *
+ * @return 0 on success, -EINVAL if a limit is larger than supported or
+ * -ENOMEM if the allocator failed. The pools may have grown partially.
+ */
+int
+js_ctx_reserve(struct js_ctx *ctx,
+	       unsigned int max_devices,
+	       unsigned int max_queued_events);
+
 /**
  * @ingroup base
  *
@@ -266,6 +516,31 @@ js_ctx_ref(struct js_ctx *ctx);
 struct js_ctx *
 js_ctx_unref(struct js_ctx *ctx);
 
+/**
+ * @ingroup device
+ *
+ * Add a reference to the device. A device is destroyed whenever the
+ * reference count reaches 0. See @ref js_device_unref.
+ *
+ * @param device A previously obtained libjoystick device
+ * @return The passed device
+ */
+struct js_device *
+js_device_ref(struct js_device *device);
+
+/**
+ * @ingroup device
+ *
+ * Dereference the device. After this, the device may have been destroyed,
+ * if the last reference was dereferenced. If so, the device is invalid and
+ * may not be interacted with.
+ *
+ * @param device A previously obtained libjoystick device
+ * @return Always NULL
+ */
+struct js_device *
+js_device_unref(struct js_device *device);
+
 /**
  * @ingroup device
  *
@@ -282,6 +557,70 @@ js_device_get_name(struct js_device *device);
 unsigned int
 js_device_get_user_index(struct js_device *device);
 
+/**
+ * @ingroup device
+ *
+ * For devices that send a device timestamp with their reports, see
+ * js_event_get_device_time_usec(), libjoystick estimates the relation
+ * between the device clock and CLOCK_MONOTONIC:
+ *
+ *     monotonic time = device time + offset
+ *
+ * The offset includes the average delay of the link and changes by the
+ * drift of the device clock against CLOCK_MONOTONIC. The estimate
+ * follows the last seconds of reports.
+ *
+ * @param offset_usec Set to the offset at the most recent report in
+ * microseconds
+ * @param drift_ppm Set to the drift in µs per second, positive if the
+ * device clock is slow
+ *
+ * @return 0 on success or -ENODATA if the device did not send enough
+ * timestamps yet
+ */
+int
+js_device_get_clock_estimate(struct js_device *device,
+			     int64_t *offset_usec,
+			     double *drift_ppm);
+
+/**
+ * @ingroup device
+ *
+ * The charging state of a device's battery, see js_device_get_battery().
+ */
+enum js_battery_status {
+	JS_BATTERY_STATUS_UNKNOWN = 0,
+	JS_BATTERY_STATUS_DISCHARGING,
+	JS_BATTERY_STATUS_CHARGING,
+	JS_BATTERY_STATUS_FULL,
+	/**
+	 * Connected to power but not charging, e.g. because the charger
+	 * stopped below full.
+	 */
+	JS_BATTERY_STATUS_NOT_CHARGING,
+};
+
+/**
+ * @ingroup device
+ *
+ * Get the state of the device's battery, as last reported by the
+ * kernel's power_supply class device. The values are updated from udev
+ * change events, each change is announced with a @ref
+ * JS_EVENT_DEVICE_POWER event, this function does not access sysfs.
+ *
+ * Batteries are only found in contexts created with
+ * js_ctx_udev_create_context().
+ *
+ * @param status Set to the charging state
+ * @param percent Set to the charge in percent or -1 if unknown
+ *
+ * @return 0 on success or -ENOENT if the device has no battery
+ */
+int
+js_device_get_battery(struct js_device *device,
+		      enum js_battery_status *status,
+		      int *percent);
+
 /**
  * @ingroup device
  *
@@ -546,6 +885,12 @@ enum js_event_type {
 	 */
 	JS_EVENT_DEVICE_CHANGED,
 
+	/**
+	 * The battery of a device has changed its status or charge, or a
+	 * battery was found or removed. See js_device_get_battery().
+	 */
+	JS_EVENT_DEVICE_POWER,
+
 	/**
 	 * Marks the end of a hardware scanout cycle. All previous events
 	 * accumulated represent the state of the device at the time of the
@@ -615,6 +960,67 @@ js_event_destroy(struct js_event *event);
 struct js_device *
 js_event_get_device(struct js_event *event);
 
+/**
+ * @ingroup event
+ *
+ * The timestamp is in CLOCK_MONOTONIC and taken from the kernel event
+ * that completed this event. For device added and removed events, the
+ * timestamp is the time the device was added or removed.
+ *
+ * @return the event time in microseconds
+ */
+uint64_t
+js_event_get_time_usec(struct js_event *event);
+
+/**
+ * @ingroup event
+ *
+ * All events generated from the same evdev frame share the same frame id,
+ * including the terminating @ref JS_EVENT_SYNC. Frame ids are unique
+ * within a context and strictly increasing.
+ *
+ * @return the frame id of this event or 0 for events not generated by a
+ * frame, e.g. @ref JS_EVENT_DEVICE_ADDED
+ *
+ * @see js_ctx_mark_consumed
+ */
+uint64_t
+js_event_get_frame_id(struct js_event *event);
+
+/**
+ * @ingroup event
+ *
+ * Some devices timestamp their reports with their own clock and the
+ * kernel forwards this timestamp as MSC_TIMESTAMP. Unlike the kernel
+ * timestamp, it is not affected by the delays of the wireless link.
+ * libjoystick removes the wraparound of the 32-bit kernel value, the
+ * clock starts at an arbitrary value.
+ *
+ * @param time Set to the device timestamp of the event's frame in
+ * microseconds
+ *
+ * @return true if the frame had a device timestamp, false for devices
+ * without timestamps and for events not generated by a frame
+ *
+ * @see js_event_get_corrected_time_usec
+ */
+bool
+js_event_get_device_time_usec(struct js_event *event, uint64_t *time);
+
+/**
+ * @ingroup event
+ *
+ * The device timestamp of the event converted to CLOCK_MONOTONIC with the
+ * device's clock estimate, see js_device_get_clock_estimate(). The
+ * intervals between these timestamps are the device's report intervals
+ * without the jitter of the link, e.g. to integrate sensor data.
+ *
+ * @return the corrected event time in microseconds or the same value as
+ * js_event_get_time_usec() while no estimate is available
+ */
+uint64_t
+js_event_get_corrected_time_usec(struct js_event *event);
+
 /**
  * @ingroup event
  *
@@ -757,6 +1163,662 @@ bool
 js_event_dpad_get_state(struct js_event *event, struct js_dpad *dpad,
 			uint32_t *state);
 
+/**
+ * @ingroup stats
+ *
+ * The counters available in a struct js_stats.
+ */
+enum js_stats_counter {
+	/**
+	 * The number of evdev events read from the kernel.
+	 */
+	JS_STATS_EVENTS_READ = 1,
+	/**
+	 * The number of frames that resulted in libjoystick events.
+	 */
+	JS_STATS_FRAMES,
+	/**
+	 * The number of read(2) calls and, for a context, epoll_wait(2)
+	 * calls.
+	 */
+	JS_STATS_SYSCALLS,
+	/**
+	 * The number of libjoystick events added to the event queue.
+	 */
+	JS_STATS_EVENTS_QUEUED,
+	/**
+	 * The number of libjoystick events retrieved with
+	 * js_ctx_get_event().
+	 */
+	JS_STATS_EVENTS_DEQUEUED,
+	/**
+	 * The number of libjoystick events currently in the queue.
+	 */
+	JS_STATS_QUEUE_DEPTH,
+	/**
+	 * The highest number of libjoystick events in the queue at any time.
+	 */
+	JS_STATS_QUEUE_HIGH_WATER,
+	/**
+	 * The number of evdev events discarded after a SYN_DROPPED.
+	 */
+	JS_STATS_EVENTS_DROPPED,
+	/**
+	 * The number of SYN_DROPPED events, i.e. kernel buffer overflows.
+	 */
+	JS_STATS_SYN_DROPPED,
+	/**
+	 * The number of reports with a device timestamp, see
+	 * js_event_get_device_time_usec().
+	 */
+	JS_STATS_TIMESTAMPED_REPORTS,
+	/**
+	 * The number of times the device timestamp jumped by more than
+	 * the device's usual report interval, i.e. reports were lost on
+	 * the link.
+	 */
+	JS_STATS_TIMESTAMP_GAPS,
+	/**
+	 * The estimated number of reports lost in these gaps.
+	 */
+	JS_STATS_REPORTS_LOST,
+	/**
+	 * The smoothed difference in µs between the intervals at which a
+	 * device's reports arrive and the intervals of their device
+	 * timestamps, like the interarrival jitter of RFC 3550. Always 0
+	 * for a context.
+	 */
+	JS_STATS_REPORT_JITTER,
+	/**
+	 * The number of frames and power events dropped because the event
+	 * pool was exhausted. Only in builds with the max-queued-events
+	 * option, other builds allocate events beyond the pool.
+	 */
+	JS_STATS_QUEUE_OVERFLOWS,
+};
+
+/**
+ * @ingroup stats
+ *
+ * The latency histograms available in a struct js_stats. All latencies
+ * are in microseconds.
+ */
+enum js_stats_latency {
+	/**
+	 * The time from the kernel timestamp of a frame to the
+	 * js_ctx_get_event() call that returns the frame's @ref
+	 * JS_EVENT_SYNC.
+	 */
+	JS_STATS_LATENCY_DEQUEUE = 1,
+	/**
+	 * The time from the kernel timestamp of a frame to the
+	 * js_ctx_mark_consumed() call for this frame. This histogram is only
+	 * available for a context.
+	 */
+	JS_STATS_LATENCY_CONSUMED,
+	/**
+	 * The time from the kernel timestamp of a frame to the read(2)
+	 * that returned its SYN_REPORT, i.e. how long it took libjoystick
+	 * to wake up and read the frame. See js_ctx_set_busy_poll(). This
+	 * histogram is only available for a context.
+	 */
+	JS_STATS_LATENCY_WAKE,
+};
+
+/**
+ * @ingroup stats
+ *
+ * Take a snapshot of the statistics of this context. The statistics
+ * cover all devices ever added to this context.
+ *
+ * @return a new snapshot, use js_stats_destroy() to free it
+ */
+struct js_stats *
+js_ctx_get_stats(struct js_ctx *ctx);
+
+/**
+ * @ingroup stats
+ *
+ * Take a snapshot of the statistics of this device. The @ref
+ * JS_STATS_LATENCY_CONSUMED and @ref JS_STATS_LATENCY_WAKE histograms
+ * are always empty for a device.
+ *
+ * @return a new snapshot, use js_stats_destroy() to free it
+ */
+struct js_stats *
+js_device_get_stats(struct js_device *device);
+
+/**
+ * @ingroup stats
+ *
+ * Free the snapshot.
+ */
+void
+js_stats_destroy(struct js_stats *stats);
+
+/**
+ * @ingroup stats
+ *
+ * @return the value of the counter at the time of the snapshot
+ */
+uint64_t
+js_stats_get_counter(struct js_stats *stats, enum js_stats_counter counter);
+
+/**
+ * @ingroup stats
+ *
+ * @return the number of samples in the latency histogram
+ */
+uint64_t
+js_stats_get_latency_count(struct js_stats *stats,
+			   enum js_stats_latency latency);
+
+/**
+ * @ingroup stats
+ *
+ * The histogram is log-linear, the returned value is the upper bound of
+ * the bucket that contains the percentile and is accurate to 12.5%. A
+ * percentile of 0 returns the minimum, a percentile of 100 the maximum
+ * latency recorded.
+ *
+ * @param percentile The percentile, 0.0 to 100.0
+ *
+ * @return the latency in µs or 0 if the histogram is empty
+ */
+uint64_t
+js_stats_get_latency_percentile(struct js_stats *stats,
+				enum js_stats_latency latency,
+				double percentile);
+
+/**
+ * @ingroup stats
+ *
+ * @return the number of non-empty buckets in the latency histogram
+ */
+unsigned int
+js_stats_get_latency_bucket_count(struct js_stats *stats,
+				  enum js_stats_latency latency);
+
+/**
+ * @ingroup stats
+ *
+ * Return the upper bound in µs and the number of samples of the
+ * non-empty bucket with the given index. Buckets are in ascending order.
+ *
+ * @return false if the index is out of range
+ */
+bool
+js_stats_get_latency_bucket(struct js_stats *stats,
+			    enum js_stats_latency latency,
+			    unsigned int index,
+			    uint64_t *upper_bound,
+			    uint64_t *count);
+
+/**
+ * @ingroup stats
+ *
+ * Notify libjoystick that the caller has consumed the input of all frames
+ * up to and including the given frame id, e.g. because a frame rendered
+ * with that input is now on screen. The latency from the kernel timestamp
+ * to this call is recorded in the @ref JS_STATS_LATENCY_CONSUMED
+ * histogram for each frame not previously marked as consumed.
+ *
+ * Only the last 64 frames are remembered, older frames are skipped.
+ *
+ * @param frame_id A frame id as returned by js_event_get_frame_id()
+ *
+ * @return the number of frames recorded or a negative errno if the frame
+ * id is invalid, -ENOTSUP if libjoystick was built without statistics
+ */
+int
+js_ctx_mark_consumed(struct js_ctx *ctx, uint64_t frame_id);
+
+/**
+ * @ingroup stats
+ *
+ * The stages of the event pipeline for js_stats_get_stage_cost().
+ */
+enum js_stats_stage {
+	/**
+	 * Reading the evdev events from the kernel. Where the
+	 * perf_event_paranoid setting does not allow counting kernel
+	 * events, this only includes the cost in user space.
+	 */
+	JS_STATS_STAGE_READ = 1,
+	/**
+	 * Decoding, filtering and normalizing the evdev events into the
+	 * device state. The event count is the number of evdev events.
+	 */
+	JS_STATS_STAGE_DECODE,
+	/**
+	 * Creating and queuing the libjoystick events at the end of a
+	 * frame. The event count is the number of libjoystick events.
+	 */
+	JS_STATS_STAGE_QUEUE,
+};
+
+/**
+ * @ingroup stats
+ *
+ * Enable or disable the per-stage CPU cost counters. While enabled,
+ * libjoystick reads the CPU's cycle and instruction counters through
+ * perf_event_open(2) around each stage of the event pipeline, see
+ * js_stats_get_stage_cost(). This adds a few syscalls per dispatch,
+ * while disabled there is no overhead.
+ *
+ * The counters count the thread that enables them. Stages run on any
+ * other thread, e.g. by a js_ctx_dispatch() from a worker thread, are
+ * not accounted. Enable the counters from the thread that dispatches.
+ *
+ * Disabling the counters keeps the costs collected so far.
+ *
+ * @return 0 on success or a negative errno if the counters are not
+ * available, e.g. -ENOENT if the CPU has no hardware counters (common in
+ * virtual machines), -EACCES if perf_event_paranoid forbids their use or
+ * -ENOTSUP if libjoystick was built without statistics
+ */
+int
+js_ctx_set_perf_counters(struct js_ctx *ctx, bool enable);
+
+/**
+ * @ingroup stats
+ *
+ * Return the total cycles and instructions spent in the given stage while
+ * perf counters were enabled, and the number of events processed by that
+ * stage in that time. Stages do not overlap, the cost of a stage excludes
+ * the cost of the stages it invokes.
+ *
+ * @return false if the snapshot is not from js_ctx_get_stats(), in which
+ * case the arguments are left untouched
+ *
+ * @see js_ctx_set_perf_counters
+ */
+bool
+js_stats_get_stage_cost(struct js_stats *stats,
+			enum js_stats_stage stage,
+			uint64_t *cycles,
+			uint64_t *instructions,
+			uint64_t *events);
+
+/**
+ * @ingroup stats
+ *
+ * The categories for js_ctx_get_memory_usage() and
+ * js_device_get_memory_usage().
+ *
+ * The memory allocated by libevdev and by the backend in addition to
+ * the core context and device structs is not included.
+ */
+enum js_memory_category {
+	/**
+	 * The sum of all categories below.
+	 */
+	JS_MEMORY_TOTAL = 1,
+	/**
+	 * The context itself, excluding the statistics. Always 0 for a
+	 * device.
+	 */
+	JS_MEMORY_CONTEXT,
+	/**
+	 * The device structs including the evdev code maps, excluding the
+	 * statistics.
+	 */
+	JS_MEMORY_DEVICES,
+	/**
+	 * The button, axis and dpad descriptors.
+	 */
+	JS_MEMORY_DESCRIPTORS,
+	/**
+	 * The current device state and the per-frame change masks.
+	 */
+	JS_MEMORY_STATE,
+	/**
+	 * The events in the event queue, i.e. not yet retrieved with
+	 * js_ctx_get_event().
+	 */
+	JS_MEMORY_EVENT_QUEUE,
+	/**
+	 * The counters, latency histograms and frame history, see
+	 * js_ctx_get_stats().
+	 */
+	JS_MEMORY_STATISTICS,
+};
+
+/**
+ * @ingroup stats
+ *
+ * Return the number of bytes currently held by libjoystick for this
+ * context in the given category. The device categories include all
+ * devices currently in the context, devices removed but still referenced
+ * by the caller are not included.
+ *
+ * @return the memory usage in bytes
+ */
+size_t
+js_ctx_get_memory_usage(struct js_ctx *ctx,
+			enum js_memory_category category);
+
+/**
+ * @ingroup stats
+ *
+ * Return the number of bytes currently held by libjoystick for this
+ * device in the given category.
+ *
+ * @return the memory usage in bytes
+ */
+size_t
+js_device_get_memory_usage(struct js_device *device,
+			   enum js_memory_category category);
+
+/**
+ * @ingroup ff
+ * @struct js_ff_effect
+ *
+ * A force feedback effect on a device. The effect is uploaded to the
+ * device the first time it is played and stays uploaded until it is
+ * destroyed, later parameter changes update it in place.
+ */
+struct js_ff_effect;
+
+/**
+ * @ingroup ff
+ */
+enum js_ff_effect_type {
+	/**
+	 * A strong and a weak rumble motor, see js_ff_effect_set_rumble()
+	 */
+	JS_FF_EFFECT_RUMBLE = 1,
+	/**
+	 * A constant force, see js_ff_effect_set_constant()
+	 */
+	JS_FF_EFFECT_CONSTANT,
+	/**
+	 * A periodic force, see js_ff_effect_set_periodic()
+	 */
+	JS_FF_EFFECT_PERIODIC,
+	/**
+	 * A force towards a center position, see js_ff_effect_set_spring()
+	 */
+	JS_FF_EFFECT_SPRING,
+};
+
+/**
+ * @ingroup ff
+ */
+enum js_ff_waveform {
+	JS_FF_WAVEFORM_SQUARE = 1,
+	JS_FF_WAVEFORM_TRIANGLE,
+	JS_FF_WAVEFORM_SINE,
+	JS_FF_WAVEFORM_SAW_UP,
+	JS_FF_WAVEFORM_SAW_DOWN,
+};
+
+/**
+ * @ingroup ff
+ *
+ * Check if the device supports the given effect type.
+ */
+bool
+js_device_has_ff_effect(struct js_device *device,
+			enum js_ff_effect_type type);
+
+/**
+ * @ingroup ff
+ *
+ * Create a new effect with all parameters zero, the effect keeps a
+ * reference to the device. Nothing is sent to the device until the
+ * effect is played.
+ *
+ * @return the new effect or NULL if the device does not support the
+ * effect type
+ */
+struct js_ff_effect *
+js_device_create_ff_effect(struct js_device *device,
+			   enum js_ff_effect_type type);
+
+/**
+ * @ingroup ff
+ *
+ * Stop the effect, remove it from the device and free it.
+ */
+void
+js_ff_effect_destroy(struct js_ff_effect *effect);
+
+/**
+ * @ingroup ff
+ *
+ * @return the device this effect was created for
+ */
+struct js_device *
+js_ff_effect_get_device(struct js_ff_effect *effect);
+
+/**
+ * @ingroup ff
+ *
+ * Set the strength of the two rumble motors of a @ref
+ * JS_FF_EFFECT_RUMBLE effect.
+ *
+ * All js_ff_effect_set_ functions behave the same: setting the current
+ * values does nothing; once the effect has been played, new values are
+ * uploaded immediately with a single ioctl and a playing effect keeps
+ * playing with the new values. An effect of a different type is left
+ * untouched.
+ *
+ * @return 0 on success, -EINVAL for an effect of a different type,
+ * -ENODEV if the device was removed or a negative errno from the upload
+ */
+int
+js_ff_effect_set_rumble(struct js_ff_effect *effect,
+			uint16_t strong,
+			uint16_t weak);
+
+/**
+ * @ingroup ff
+ *
+ * Set the level of a @ref JS_FF_EFFECT_CONSTANT effect, the sign
+ * selects the side of the direction, see js_ff_effect_set_direction().
+ *
+ * @return 0 on success or a negative errno, see js_ff_effect_set_rumble()
+ */
+int
+js_ff_effect_set_constant(struct js_ff_effect *effect, int16_t level);
+
+/**
+ * @ingroup ff
+ *
+ * Set the waveform of a @ref JS_FF_EFFECT_PERIODIC effect.
+ *
+ * @param period_ms The period of the waveform in ms
+ * @param magnitude The peak value of the waveform
+ * @param offset The mean value of the waveform
+ *
+ * @return 0 on success, -ENOTSUP if the device does not support the
+ * waveform or a negative errno, see js_ff_effect_set_rumble()
+ */
+int
+js_ff_effect_set_periodic(struct js_ff_effect *effect,
+			  enum js_ff_waveform waveform,
+			  uint16_t period_ms,
+			  int16_t magnitude,
+			  int16_t offset);
+
+/**
+ * @ingroup ff
+ *
+ * Set a @ref JS_FF_EFFECT_SPRING effect, e.g. the self-centering of a
+ * wheel. The same condition applies to all axes of the device.
+ *
+ * @param center The position the force pulls towards
+ * @param coefficient The force per distance from the center
+ * @param deadband The distance around the center without force
+ *
+ * @return 0 on success or a negative errno, see js_ff_effect_set_rumble()
+ */
+int
+js_ff_effect_set_spring(struct js_ff_effect *effect,
+			int16_t center,
+			int16_t coefficient,
+			uint16_t deadband);
+
+/**
+ * @ingroup ff
+ *
+ * Set the direction of the effect, 0x0000 is down, 0x4000 left, 0x8000
+ * up and 0xc000 right. The default is 0x4000.
+ *
+ * @return 0 on success or a negative errno, see js_ff_effect_set_rumble()
+ */
+int
+js_ff_effect_set_direction(struct js_ff_effect *effect, uint16_t direction);
+
+/**
+ * @ingroup ff
+ *
+ * Set how long the effect plays in ms, 0 (the default) plays it until
+ * it is stopped.
+ *
+ * @return 0 on success or a negative errno, see js_ff_effect_set_rumble()
+ */
+int
+js_ff_effect_set_duration(struct js_ff_effect *effect, uint16_t duration_ms);
+
+/**
+ * @ingroup ff
+ *
+ * Play the effect, uploading it first if needed. Playing an effect
+ * without a duration that is already playing does nothing.
+ *
+ * @return 0 on success, -ENODEV if the device was removed or another
+ * negative errno
+ */
+int
+js_ff_effect_play(struct js_ff_effect *effect);
+
+/**
+ * @ingroup ff
+ *
+ * Stop the effect. It stays uploaded and can be played again.
+ *
+ * @return 0 on success, -ENODEV if the device was removed or another
+ * negative errno
+ */
+int
+js_ff_effect_stop(struct js_ff_effect *effect);
+
+/**
+ * @ingroup ff
+ *
+ * Set the overall strength of all effects on the device, 0xffff is the
+ * full strength.
+ *
+ * @return 0 on success, -ENOTSUP if the device has no gain control,
+ * -ENODEV if the device was removed or another negative errno
+ */
+int
+js_device_set_ff_gain(struct js_device *device, uint16_t gain);
+
+/**
+ * @ingroup output
+ *
+ * The outputs of a device that can be set without managing effects or
+ * LEDs by hand.
+ *
+ * Setting an output only records the new value. All pending output is
+ * written once by js_ctx_flush_output() or at the end of
+ * js_ctx_dispatch(), only the latest value of each output is written
+ * and values that were superseded before the flush never reach the
+ * device. Setting an output to its current value does nothing.
+ */
+enum js_output {
+	/**
+	 * A strong (low frequency) and a weak (high frequency) motor, see
+	 * js_device_set_rumble(). Available if the device supports
+	 * JS_FF_EFFECT_RUMBLE.
+	 */
+	JS_OUTPUT_RUMBLE = 1,
+	/**
+	 * The LEDs that show the player number, see
+	 * js_device_set_player_indicator().
+	 */
+	JS_OUTPUT_PLAYER_INDICATOR,
+	/**
+	 * A color LED, see js_device_set_lightbar().
+	 */
+	JS_OUTPUT_LIGHTBAR,
+};
+
+/**
+ * @ingroup output
+ *
+ * The LED outputs are only available in contexts created with
+ * js_ctx_udev_create_context(). They are found through sysfs and their
+ * attributes, e.g. /sys/class/leds/<led>/brightness, are opened with
+ * open(2) when the device is added, not through the context's
+ * js_interface. The process itself needs write access to them, usually
+ * granted by a udev rule. Without it, the device does not have the
+ * output.
+ *
+ * @return true if the device has the given output, false otherwise
+ */
+bool
+js_device_has_output(struct js_device *device, enum js_output output);
+
+/**
+ * @ingroup output
+ *
+ * Set the speed of the rumble motors, 0xffff is the full speed and 0 for
+ * both stops rumbling. The rumble continues until changed.
+ *
+ * This uses an effect of its own and must not be combined with a
+ * JS_FF_EFFECT_RUMBLE effect created by the caller.
+ *
+ * @return 0 on success, -ENOTSUP if the device has no rumble or -ENODEV
+ * if the device was removed
+ */
+int
+js_device_set_rumble(struct js_device *device,
+		     uint16_t strong,
+		     uint16_t weak);
+
+/**
+ * @ingroup output
+ *
+ * Set the player indicator LEDs, bit n of the mask turns on LED n + 1.
+ * Bits for LEDs the device does not have are ignored.
+ *
+ * @return 0 on success, -ENOTSUP if the device has no player indicator
+ * or -ENODEV if the device was removed
+ */
+int
+js_device_set_player_indicator(struct js_device *device, uint32_t mask);
+
+/**
+ * @ingroup output
+ *
+ * Set the color of the lightbar.
+ *
+ * @return 0 on success, -ENOTSUP if the device has no lightbar or
+ * -ENODEV if the device was removed
+ */
+int
+js_device_set_lightbar(struct js_device *device,
+		       uint8_t red,
+		       uint8_t green,
+		       uint8_t blue);
+
+/**
+ * @ingroup output
+ *
+ * Write the pending output of all devices now instead of at the end of
+ * the next js_ctx_dispatch(). A write that fails is not retried, the
+ * next value set on the output is written as usual.
+ *
+ * @return 0 on success or the negative errno of the first write that
+ * failed
+ */
+int
+js_ctx_flush_output(struct js_ctx *ctx);
+
 #ifdef __cplusplus
 }
 #endif
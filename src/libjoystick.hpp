@@ -0,0 +1,1272 @@
+/*
+ * Copyright © 2019 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#pragma once
+
+/**
+ * @defgroup cxx C++ bindings
+ *
+ * libjoystick.hpp is a header-only C++17 wrapper around the C API:
+ * move-only handles that release their reference when they go out of
+ * scope, and typed views of the events. Everything is inline and
+ * compiles to the same calls a C caller would make, there are no
+ * exceptions, virtual functions or allocations.
+ *
+ * The accessors go through libjoystick-inline.h, which is included by
+ * this header.
+ *
+ * @code
+ * ctx.dispatch();
+ * ctx.drain(js::overloaded{
+ *	[&](js::button_event ev) { ... },
+ *	[&](js::axis_event ev) { ... },
+ * });
+ * @endcode
+ */
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#if __cplusplus >= 202002L && __has_include(<span>)
+#include <span>
+#endif
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#include <coroutine>
+#define LIBJOYSTICK_HAVE_COROUTINES 1
+#endif
+
+#include "libjoystick.h"
+#include "libjoystick-inline.h"
+
+namespace js {
+
+#if defined(__cpp_lib_span)
+template<typename T>
+using span = std::span<T>;
+#else
+/**
+ * @ingroup cxx
+ *
+ * A minimal std::span for C++17.
+ */
+template<typename T>
+class span {
+public:
+	constexpr span() noexcept = default;
+	constexpr span(T *data, std::size_t size) noexcept
+		: data_(data), size_(size) {}
+
+	constexpr T *data() const noexcept { return data_; }
+	constexpr std::size_t size() const noexcept { return size_; }
+	constexpr bool empty() const noexcept { return size_ == 0; }
+	constexpr T &operator[](std::size_t i) const noexcept { return data_[i]; }
+	constexpr T *begin() const noexcept { return data_; }
+	constexpr T *end() const noexcept { return data_ + size_; }
+
+private:
+	T *data_ = nullptr;
+	std::size_t size_ = 0;
+};
+#endif
+
+/**
+ * @ingroup cxx
+ *
+ * Test a bit in one of the bitmasks of the typed event views.
+ */
+inline bool
+bit_is_set(span<const unsigned long> bits, std::size_t bit) noexcept
+{
+	return js_inline_bit_is_set(bits.data(), bit);
+}
+
+namespace detail {
+
+/* A move-only owner of one reference, released with Release */
+template<typename T, typename Release>
+class handle {
+public:
+	constexpr handle() noexcept = default;
+	explicit constexpr handle(T *ptr) noexcept : ptr_(ptr) {}
+	handle(handle &&other) noexcept : ptr_(other.release()) {}
+	handle(const handle &) = delete;
+	~handle() { reset(); }
+
+	handle &
+	operator=(handle &&other) noexcept
+	{
+		reset(other.release());
+		return *this;
+	}
+	handle &operator=(const handle &) = delete;
+
+	T *get() const noexcept { return ptr_; }
+	explicit operator bool() const noexcept { return ptr_ != nullptr; }
+
+	/* Give up ownership without releasing the reference */
+	T *
+	release() noexcept
+	{
+		T *ptr = ptr_;
+
+		ptr_ = nullptr;
+		return ptr;
+	}
+
+	void
+	reset(T *ptr = nullptr) noexcept
+	{
+		T *old = ptr_;
+
+		ptr_ = ptr;
+		if (old)
+			Release{}(old);
+	}
+
+private:
+	T *ptr_ = nullptr;
+};
+
+struct ctx_release {
+	void operator()(js_ctx *ctx) const noexcept { js_ctx_unref(ctx); }
+};
+
+struct device_release {
+	void operator()(js_device *device) const noexcept { js_device_unref(device); }
+};
+
+struct event_release {
+	void operator()(js_event *event) const noexcept { js_event_destroy(event); }
+};
+
+constexpr std::size_t
+nlongs(std::size_t bits)
+{
+	return (bits + sizeof(unsigned long) * 8 - 1) / (sizeof(unsigned long) * 8);
+}
+
+} /* namespace detail */
+
+/**
+ * @ingroup cxx
+ *
+ * Combine lambdas into one visitor, see visit().
+ */
+template<typename... Ts>
+struct overloaded : Ts... {
+	using Ts::operator()...;
+};
+template<typename... Ts>
+overloaded(Ts...) -> overloaded<Ts...>;
+
+/**
+ * @ingroup cxx
+ *
+ * The part common to all typed event views. A view does not own the
+ * event, it is valid as long as the event is.
+ */
+class event_view {
+public:
+	explicit event_view(js_event *event) noexcept : event_(event) {}
+
+	js_event *get() const noexcept { return event_; }
+	js_device *device() const noexcept { return js_event_get_device(event_); }
+	uint64_t time_usec() const noexcept { return js_event_get_time_usec(event_); }
+	uint64_t frame_id() const noexcept { return js_event_get_frame_id(event_); }
+	uint64_t corrected_time_usec() const noexcept { return js_event_get_corrected_time_usec(event_); }
+
+	std::optional<uint64_t> device_time_usec() const noexcept
+	{
+		uint64_t time;
+
+		if (!js_event_get_device_time_usec(event_, &time))
+			return std::nullopt;
+		return time;
+	}
+
+protected:
+	js_event *event_;
+};
+
+/** @ingroup cxx */
+class device_added_event : public event_view {
+	using event_view::event_view;
+};
+
+/** @ingroup cxx */
+class device_removed_event : public event_view {
+	using event_view::event_view;
+};
+
+/** @ingroup cxx */
+class device_changed_event : public event_view {
+	using event_view::event_view;
+};
+
+/** @ingroup cxx */
+class device_power_event : public event_view {
+	using event_view::event_view;
+};
+
+/** @ingroup cxx */
+class sync_event : public event_view {
+	using event_view::event_view;
+};
+
+/**
+ * @ingroup cxx
+ *
+ * A @ref JS_EVENT_BUTTON event. The spans cover all buttons of the
+ * device, indexed like js_device_get_button(); the bitmasks are
+ * arrays of unsigned long with one bit per button.
+ */
+class button_event : public event_view {
+public:
+	using event_view::event_view;
+
+	bool
+	state_changed(js_button *button) const noexcept
+	{
+		return js_event_button_state_has_changed(event_, button);
+	}
+
+	bool
+	value_changed(js_button *button) const noexcept
+	{
+		return js_event_button_value_has_changed(event_, button);
+	}
+
+	bool
+	pressed(js_button *button) const noexcept
+	{
+		bool state;
+
+		js_event_button_get_state(event_, button, &state);
+		return state;
+	}
+
+	uint16_t
+	value(js_button *button) const noexcept
+	{
+		uint16_t value;
+
+		js_event_button_get_value(event_, button, &value);
+		return value;
+	}
+
+	std::size_t count() const noexcept { return js_device_get_button_count(device()); }
+
+	span<const uint16_t>
+	values() const noexcept
+	{
+		return { js_inline_event(event_)->u.button.value, count() };
+	}
+
+	span<const unsigned long>
+	state_bits() const noexcept
+	{
+		return { js_inline_event(event_)->u.button.state,
+			 detail::nlongs(count()) };
+	}
+
+	span<const unsigned long>
+	state_changed_bits() const noexcept
+	{
+		return { js_inline_event(event_)->u.button.state_changed,
+			 detail::nlongs(count()) };
+	}
+
+	span<const unsigned long>
+	value_changed_bits() const noexcept
+	{
+		return { js_inline_event(event_)->u.button.value_changed,
+			 detail::nlongs(count()) };
+	}
+};
+
+/**
+ * @ingroup cxx
+ *
+ * A @ref JS_EVENT_AXIS event, values() holds the x, y and z value of
+ * each axis of the device.
+ */
+class axis_event : public event_view {
+public:
+	using event_view::event_view;
+
+	bool
+	changed(js_axis *axis) const noexcept
+	{
+		return js_event_axis_has_changed(event_, axis);
+	}
+
+	bool
+	value(js_axis *axis, int16_t &x, int16_t &y, int16_t &z) const noexcept
+	{
+		return js_event_axis_get_value(event_, axis, &x, &y, &z);
+	}
+
+	std::size_t count() const noexcept { return js_device_get_axis_count(device()); }
+
+	span<const int16_t[3]>
+	values() const noexcept
+	{
+		return { js_inline_event(event_)->u.axis.value, count() };
+	}
+
+	span<const unsigned long>
+	changed_bits() const noexcept
+	{
+		return { js_inline_event(event_)->u.axis.changed,
+			 detail::nlongs(count()) };
+	}
+};
+
+/**
+ * @ingroup cxx
+ *
+ * A @ref JS_EVENT_DPAD event, states() holds the @ref js_dpad_state
+ * bits of each dpad of the device.
+ */
+class dpad_event : public event_view {
+public:
+	using event_view::event_view;
+
+	bool
+	changed(js_dpad *dpad) const noexcept
+	{
+		uint32_t state;
+
+		return js_event_dpad_get_state(event_, dpad, &state);
+	}
+
+	uint32_t
+	state(js_dpad *dpad) const noexcept
+	{
+		uint32_t state;
+
+		js_event_dpad_get_state(event_, dpad, &state);
+		return state;
+	}
+
+	std::size_t count() const noexcept { return js_device_get_dpad_count(device()); }
+
+	span<const uint32_t>
+	states() const noexcept
+	{
+		return { js_inline_event(event_)->u.dpad.state, count() };
+	}
+
+	span<const unsigned long>
+	changed_bits() const noexcept
+	{
+		return { js_inline_event(event_)->u.dpad.changed,
+			 detail::nlongs(count()) };
+	}
+};
+
+namespace detail {
+
+template<typename View, typename Visitor>
+inline void
+invoke_if(Visitor &visitor, js_event *event)
+{
+	if constexpr (std::is_invocable_v<Visitor &, View>)
+		visitor(View{event});
+}
+
+} /* namespace detail */
+
+/**
+ * @ingroup cxx
+ *
+ * Call the visitor with the typed view of the event, e.g. a
+ * button_event for a @ref JS_EVENT_BUTTON. Event types the visitor has
+ * no overload for are skipped at compile time, a generic lambda
+ * receives all of them.
+ */
+template<typename Visitor>
+inline void
+visit(js_event *event, Visitor &&visitor)
+{
+	switch (js_event_get_type(event)) {
+	case JS_EVENT_DEVICE_ADDED:
+		detail::invoke_if<device_added_event>(visitor, event);
+		break;
+	case JS_EVENT_DEVICE_REMOVED:
+		detail::invoke_if<device_removed_event>(visitor, event);
+		break;
+	case JS_EVENT_DEVICE_CHANGED:
+		detail::invoke_if<device_changed_event>(visitor, event);
+		break;
+	case JS_EVENT_DEVICE_POWER:
+		detail::invoke_if<device_power_event>(visitor, event);
+		break;
+	case JS_EVENT_SYNC:
+		detail::invoke_if<sync_event>(visitor, event);
+		break;
+	case JS_EVENT_AXIS:
+		detail::invoke_if<axis_event>(visitor, event);
+		break;
+	case JS_EVENT_BUTTON:
+		detail::invoke_if<button_event>(visitor, event);
+		break;
+	case JS_EVENT_DPAD:
+		detail::invoke_if<dpad_event>(visitor, event);
+		break;
+	default:
+		break;
+	}
+}
+
+/**
+ * @ingroup cxx
+ *
+ * An event retrieved with context::next_event(), destroyed with the
+ * handle.
+ */
+class event : public detail::handle<js_event, detail::event_release> {
+public:
+	using handle::handle;
+
+	enum js_event_type type() const noexcept { return js_event_get_type(get()); }
+	js_device *device() const noexcept { return js_event_get_device(get()); }
+	uint64_t time_usec() const noexcept { return js_event_get_time_usec(get()); }
+	uint64_t frame_id() const noexcept { return js_event_get_frame_id(get()); }
+
+	template<typename Visitor>
+	void
+	visit(Visitor &&visitor) const
+	{
+		js::visit(get(), std::forward<Visitor>(visitor));
+	}
+};
+
+/**
+ * @ingroup cxx
+ *
+ * A reference to a device. Devices are owned by their context, a handle
+ * keeps the device valid beyond its removal.
+ */
+class device : public detail::handle<js_device, detail::device_release> {
+public:
+	using handle::handle;
+
+	/* Take a new reference, e.g. to the device of an event */
+	static device
+	ref(js_device *device) noexcept
+	{
+		return js::device{ js_device_ref(device) };
+	}
+
+	const char *name() const noexcept { return js_device_get_name(get()); }
+	unsigned int user_index() const noexcept { return js_device_get_user_index(get()); }
+
+	bool
+	has_type(enum js_device_type type) const noexcept
+	{
+		return js_device_has_type(get(), type);
+	}
+
+	std::size_t button_count() const noexcept { return js_device_get_button_count(get()); }
+	js_button *button(unsigned int index) const noexcept { return js_device_get_button(get(), index); }
+	std::size_t axis_count() const noexcept { return js_device_get_axis_count(get()); }
+	js_axis *axis(unsigned int index) const noexcept { return js_device_get_axis(get(), index); }
+	std::size_t dpad_count() const noexcept { return js_device_get_dpad_count(get()); }
+	js_dpad *dpad(unsigned int index) const noexcept { return js_device_get_dpad(get(), index); }
+};
+
+/**
+ * @ingroup cxx
+ *
+ * A libjoystick context. The factories return an empty handle on
+ * failure.
+ */
+class context : public detail::handle<js_ctx, detail::ctx_release> {
+public:
+	using handle::handle;
+
+	/* The context keeps the interface pointer, the interface must
+	 * outlive it */
+	static context
+	udev(const js_interface *interface, void *user_data = nullptr) noexcept
+	{
+		return context{ js_ctx_udev_create_context(interface, user_data) };
+	}
+
+	static context
+	path(const js_interface *interface, void *user_data = nullptr) noexcept
+	{
+		return context{ js_ctx_path_create_context(interface, user_data) };
+	}
+
+	int assign_seat(const char *seat) const noexcept { return js_ctx_udev_assign_seat(get(), seat); }
+	js_device *add_device(const char *path) const noexcept { return js_ctx_path_add_device(get(), path); }
+	int fd() const noexcept { return js_ctx_get_fd(get()); }
+	void dispatch() const noexcept { js_ctx_dispatch(get()); }
+	event next_event() const noexcept { return event{ js_ctx_get_event(get()) }; }
+
+	int
+	reserve(unsigned int max_devices, unsigned int max_queued_events) const noexcept
+	{
+		return js_ctx_reserve(get(), max_devices, max_queued_events);
+	}
+
+	int
+	mark_consumed(uint64_t frame_id) const noexcept
+	{
+		return js_ctx_mark_consumed(get(), frame_id);
+	}
+
+	/* Visit and destroy all queued events, returns the number of
+	 * events */
+	template<typename Visitor>
+	std::size_t
+	drain(Visitor &&visitor) const
+	{
+		std::size_t n = 0;
+		js_event *e;
+
+		while ((e = js_ctx_get_event(get()))) {
+			js::visit(e, visitor);
+			js_event_destroy(e);
+			n++;
+		}
+
+		return n;
+	}
+};
+
+/**
+ * @ingroup cxx
+ *
+ * A control a layout requires: the first control of the device that has
+ * all of the capabilities and is not yet used by an earlier slot. Unused
+ * capability entries are 0.
+ */
+struct button_slot {
+	enum js_button_capability caps[2];
+};
+
+/** @ingroup cxx */
+struct axis_slot {
+	enum js_axis_capability caps[2];
+};
+
+/** @ingroup cxx */
+struct dpad_slot {
+	enum js_dpad_capability caps[2];
+};
+
+namespace layouts {
+
+/**
+ * @ingroup cxx
+ *
+ * A standard gamepad: face buttons, shoulders, triggers, two sticks and
+ * a dpad.
+ *
+ * A layout is a struct with the device type it applies to and a
+ * std::array of slots for each control type, with an unscoped enum of
+ * the same name naming the slots, see layout_binding.
+ */
+struct gamepad {
+	static constexpr enum js_device_type type = JS_TYPE_GAMEPAD;
+
+	enum button {
+		south,
+		east,
+		left_shoulder,
+		right_shoulder,
+		left_trigger,
+		right_trigger,
+		select,
+		start,
+		system,
+		left_thumb,
+		right_thumb,
+	};
+	static constexpr std::array<button_slot, 11> buttons = {{
+		{ { JS_BUTTON_CAP_OK } },
+		{ { JS_BUTTON_CAP_CANCEL } },
+		{ { JS_BUTTON_CAP_SHOULDER, JS_BUTTON_CAP_LEFT } },
+		{ { JS_BUTTON_CAP_SHOULDER, JS_BUTTON_CAP_RIGHT } },
+		{ { JS_BUTTON_CAP_TRIGGER, JS_BUTTON_CAP_LEFT } },
+		{ { JS_BUTTON_CAP_TRIGGER, JS_BUTTON_CAP_RIGHT } },
+		{ { JS_BUTTON_CAP_SELECT } },
+		{ { JS_BUTTON_CAP_START } },
+		{ { JS_BUTTON_CAP_SYSTEM } },
+		{ { JS_BUTTON_CAP_LEFT } },
+		{ { JS_BUTTON_CAP_RIGHT } },
+	}};
+
+	enum axis {
+		left_stick,
+		right_stick,
+	};
+	static constexpr std::array<axis_slot, 2> axes = {{
+		{ { JS_AXIS_CAP_LEFT } },
+		{ { JS_AXIS_CAP_RIGHT } },
+	}};
+
+	enum dpad {
+		left_dpad,
+	};
+	static constexpr std::array<dpad_slot, 1> dpads = {{
+		{ { JS_DPAD_CAP_LEFT } },
+	}};
+};
+
+/**
+ * @ingroup cxx
+ *
+ * A wheel with pedals and gear paddles. The axes are matched in device
+ * order: steering, gas, brake.
+ */
+struct wheel {
+	static constexpr enum js_device_type type = JS_TYPE_WHEEL;
+
+	enum button {
+		gear_down,
+		gear_up,
+	};
+	static constexpr std::array<button_slot, 2> buttons = {{
+		{ { JS_BUTTON_CAP_LEFT } },
+		{ { JS_BUTTON_CAP_RIGHT } },
+	}};
+
+	enum axis {
+		steering,
+		gas,
+		brake,
+	};
+	static constexpr std::array<axis_slot, 3> axes = {{
+		{ { JS_AXIS_CAP_ANALOG } },
+		{ { JS_AXIS_CAP_ANALOG } },
+		{ { JS_AXIS_CAP_ANALOG } },
+	}};
+
+	enum dpad {
+		hat,
+	};
+	static constexpr std::array<dpad_slot, 1> dpads = {{
+		{ {} },
+	}};
+};
+
+/**
+ * @ingroup cxx
+ *
+ * A flight stick with twist and throttle. The axes are matched in
+ * device order: x/y, twist, throttle.
+ */
+struct flight_stick {
+	static constexpr enum js_device_type type = JS_TYPE_JOYSTICK;
+
+	enum button {
+		trigger,
+	};
+	static constexpr std::array<button_slot, 1> buttons = {{
+		{ { JS_BUTTON_CAP_TRIGGER } },
+	}};
+
+	enum axis {
+		stick,
+		twist,
+		throttle,
+	};
+	static constexpr std::array<axis_slot, 3> axes = {{
+		{ { JS_AXIS_CAP_ANALOG } },
+		{ { JS_AXIS_CAP_ANALOG } },
+		{ { JS_AXIS_CAP_ANALOG } },
+	}};
+
+	enum dpad {
+		hat,
+	};
+	static constexpr std::array<dpad_slot, 1> dpads = {{
+		{ {} },
+	}};
+};
+
+} /* namespace layouts */
+
+/**
+ * @ingroup cxx
+ *
+ * The state of a device's controls in the order of its layout. The
+ * accessors take the slot as template argument and compile to a load
+ * at a constant offset.
+ */
+template<typename Layout>
+struct layout_state {
+	std::array<bool, Layout::buttons.size()> pressed{};
+	std::array<uint16_t, Layout::buttons.size()> values{};
+	std::array<std::array<int16_t, 3>, Layout::axes.size()> axes{};
+	std::array<uint32_t, Layout::dpads.size()> dpads{};
+	uint64_t frame_id = 0;
+
+	template<typename Layout::button B>
+	constexpr bool
+	button() const noexcept
+	{
+		return pressed[B];
+	}
+
+	template<typename Layout::button B>
+	constexpr uint16_t
+	value() const noexcept
+	{
+		return values[B];
+	}
+
+	template<typename Layout::axis A>
+	constexpr const std::array<int16_t, 3> &
+	axis() const noexcept
+	{
+		return axes[A];
+	}
+
+	template<typename Layout::dpad D>
+	constexpr uint32_t
+	dpad() const noexcept
+	{
+		return dpads[D];
+	}
+};
+
+namespace detail {
+
+template<typename Control, typename Slot, std::size_t N, typename Get, typename Has>
+inline bool
+bind_slots(js_device *device, std::size_t count,
+	   const std::array<Slot, N> &slots,
+	   std::array<uint16_t, N> &indices,
+	   Get get, Has has)
+{
+	for (std::size_t s = 0; s < N; s++) {
+		bool found = false;
+
+		for (std::size_t i = 0; i < count && !found; i++) {
+			Control *control = get(device, i);
+			bool used = false;
+
+			for (std::size_t prev = 0; prev < s; prev++)
+				used = used || indices[prev] == i;
+			if (used)
+				continue;
+
+			found = true;
+			for (auto cap : slots[s].caps) {
+				if (cap != 0 && !has(control, cap))
+					found = false;
+			}
+			if (found)
+				indices[s] = i;
+		}
+
+		if (!found)
+			return false;
+	}
+
+	return true;
+}
+
+} /* namespace detail */
+
+/**
+ * @ingroup cxx
+ *
+ * A device bound to a compile-time layout. bind() checks the device
+ * against the layout once and records where each slot's control is;
+ * update() then copies an event's values into a layout_state with one
+ * fixed-length loop per control type, without looking up any control.
+ *
+ * @code
+ * auto pad = js::layout_binding<js::layouts::gamepad>::bind(device);
+ * js::layout_state<js::layouts::gamepad> state;
+ *
+ * if (pad && pad->update(state, event) &&
+ *     state.button<js::layouts::gamepad::south>())
+ *	jump();
+ * @endcode
+ */
+template<typename Layout>
+class layout_binding {
+public:
+	/* The binding, or nothing if the device does not have the
+	 * layout's type or lacks one of its controls */
+	static std::optional<layout_binding>
+	bind(js_device *device) noexcept
+	{
+		layout_binding b;
+
+		if (!js_device_has_type(device, Layout::type))
+			return std::nullopt;
+
+		if (!detail::bind_slots<js_button>(device,
+						   js_device_get_button_count(device),
+						   Layout::buttons, b.buttons_,
+						   js_device_get_button,
+						   js_button_has_capability) ||
+		    !detail::bind_slots<js_axis>(device,
+						 js_device_get_axis_count(device),
+						 Layout::axes, b.axes_,
+						 js_device_get_axis,
+						 js_axis_has_capability) ||
+		    !detail::bind_slots<js_dpad>(device,
+						 js_device_get_dpad_count(device),
+						 Layout::dpads, b.dpads_,
+						 js_device_get_dpad,
+						 js_dpad_has_capability))
+			return std::nullopt;
+
+		b.device_ = device;
+		return b;
+	}
+
+	js_device *device() const noexcept { return device_; }
+
+	/* The device's index of the control in the given slot */
+	template<typename Layout::button B>
+	unsigned int button_index() const noexcept { return buttons_[B]; }
+	template<typename Layout::axis A>
+	unsigned int axis_index() const noexcept { return axes_[A]; }
+	template<typename Layout::dpad D>
+	unsigned int dpad_index() const noexcept { return dpads_[D]; }
+
+	/* Copy the values of an event of this device into the state,
+	 * returns false for events of other devices and types */
+	bool
+	update(layout_state<Layout> &state, js_event *event) const noexcept
+	{
+		const struct js_inline_event *e = js_inline_event(event);
+
+		if (e->device != device_)
+			return false;
+
+		switch (e->type) {
+		case JS_EVENT_BUTTON:
+			for (std::size_t i = 0; i < buttons_.size(); i++) {
+				state.pressed[i] = js_inline_bit_is_set(e->u.button.state,
+									buttons_[i]);
+				state.values[i] = e->u.button.value[buttons_[i]];
+			}
+			break;
+		case JS_EVENT_AXIS:
+			for (std::size_t i = 0; i < axes_.size(); i++) {
+				const int16_t *v = e->u.axis.value[axes_[i]];
+
+				state.axes[i] = { v[0], v[1], v[2] };
+			}
+			break;
+		case JS_EVENT_DPAD:
+			for (std::size_t i = 0; i < dpads_.size(); i++)
+				state.dpads[i] = e->u.dpad.state[dpads_[i]];
+			break;
+		default:
+			return false;
+		}
+
+		state.frame_id = e->frame_id;
+		return true;
+	}
+
+private:
+	layout_binding() = default;
+
+	js_device *device_ = nullptr;
+	std::array<uint16_t, Layout::buttons.size()> buttons_{};
+	std::array<uint16_t, Layout::axes.size()> axes_{};
+	std::array<uint16_t, Layout::dpads.size()> dpads_{};
+};
+
+#ifdef LIBJOYSTICK_HAVE_COROUTINES
+class async_context;
+
+namespace detail {
+
+/* A suspended coroutine and the events it waits for. Waiters live in the
+ * awaitable, i.e. in the coroutine frame, and are linked into the
+ * async_context while the coroutine is suspended. */
+struct waiter {
+	/* Called for each event while linked. Returns true, and stores
+	 * the result, if the coroutine is to be resumed. */
+	bool (*match)(waiter *w, js_event *event);
+	std::coroutine_handle<> coroutine;
+	async_context *owner = nullptr;
+	bool ready = false;	/* matched, in the list of waiters to resume */
+	waiter *next = nullptr;
+};
+
+} /* namespace detail */
+
+/**
+ * @ingroup cxx
+ *
+ * Awaitables for C++20 coroutines. The async_context does not own the
+ * js_ctx and does not block: add fd() to the event loop or job
+ * system and call process() whenever it is readable. process()
+ * dispatches and resumes, on the calling thread, every coroutine whose
+ * awaitable matches one of the new events, in the order they
+ * suspended. An event wakes all coroutines it matches, a coroutine
+ * that suspends again while being resumed waits for the next event.
+ *
+ * @code
+ * js::async_context async{ ctx.get() };
+ *
+ * task player(js::async_context &async) {
+ *	js::device pad = co_await async.device_added();
+ *	co_await async.button_pressed(pad, JS_BUTTON_CAP_START);
+ *	...
+ * }
+ * @endcode
+ *
+ * Destroying a suspended coroutine unlinks its awaitable, destroying
+ * the async_context leaves its coroutines suspended forever.
+ */
+class async_context {
+public:
+	explicit async_context(js_ctx *ctx) noexcept : ctx_(ctx) {}
+	async_context(const async_context &) = delete;
+	async_context &operator=(const async_context &) = delete;
+
+	~async_context()
+	{
+		for (detail::waiter *w = head_; w; w = w->next)
+			w->owner = nullptr;
+		for (detail::waiter *w = ready_; w; w = w->next)
+			w->owner = nullptr;
+	}
+
+	js_ctx *get() const noexcept { return ctx_; }
+	int fd() const noexcept { return js_ctx_get_fd(ctx_); }
+
+	/* Dispatch and deliver all queued events, returns the number of
+	 * events */
+	std::size_t
+	process()
+	{
+		std::size_t n = 0;
+		js_event *e;
+
+		js_ctx_dispatch(ctx_);
+		while ((e = js_ctx_get_event(ctx_))) {
+			deliver(e);
+			js_event_destroy(e);
+			n++;
+		}
+
+		return n;
+	}
+
+	template<typename Result, bool (*Match)(detail::waiter *, js_event *)>
+	class awaitable;
+
+	class next_event_awaitable;
+	class device_added_awaitable;
+	class device_removed_awaitable;
+	class button_pressed_awaitable;
+
+	/* The next event of any type. The event belongs to the
+	 * async_context and is valid until the coroutine suspends again. */
+	inline next_event_awaitable next_event() noexcept;
+
+	/* The next added device, with a new reference */
+	inline device_added_awaitable device_added() noexcept;
+
+	/* The removal of the given device */
+	inline device_removed_awaitable device_removed(js_device *device) noexcept;
+
+	/* The next press of a button with the given capability on the
+	 * given device, the result is the button */
+	inline button_pressed_awaitable button_pressed(js_device *device,
+						       enum js_button_capability cap) noexcept;
+
+	button_pressed_awaitable
+	button_pressed(const js::device &device,
+		       enum js_button_capability cap) noexcept;
+
+private:
+	static void
+	append(detail::waiter ***tail, detail::waiter *w) noexcept
+	{
+		w->next = nullptr;
+		**tail = w;
+		*tail = &w->next;
+	}
+
+	static void
+	remove(detail::waiter **head, detail::waiter ***tail,
+	       detail::waiter *w) noexcept
+	{
+		for (detail::waiter **p = head; *p; p = &(*p)->next) {
+			if (*p == w) {
+				*p = w->next;
+				if (*tail == &w->next)
+					*tail = p;
+				break;
+			}
+		}
+	}
+
+	void
+	link(detail::waiter *w) noexcept
+	{
+		w->owner = this;
+		w->ready = false;
+		append(&tail_, w);
+	}
+
+	void
+	unlink(detail::waiter *w) noexcept
+	{
+		if (w->ready)
+			remove(&ready_, &ready_tail_, w);
+		else
+			remove(&head_, &tail_, w);
+		w->owner = nullptr;
+		w->ready = false;
+	}
+
+	void
+	deliver(js_event *event)
+	{
+		detail::waiter *w = head_;
+
+		/* Split off the matching waiters first, those that link
+		 * again while being resumed wait for the next event */
+		head_ = nullptr;
+		tail_ = &head_;
+		while (w) {
+			detail::waiter *next = w->next;
+
+			if (w->match(w, event)) {
+				w->ready = true;
+				append(&ready_tail_, w);
+			} else {
+				link(w);
+			}
+			w = next;
+		}
+
+		/* The matched waiters stay linked until they are resumed: a
+		 * resumed coroutine may destroy another one that is still
+		 * waiting here, its awaitable then unlinks itself */
+		while (ready_) {
+			w = ready_;
+			unlink(w);
+			w->coroutine.resume();
+		}
+	}
+
+	js_ctx *ctx_;
+	detail::waiter *head_ = nullptr;
+	detail::waiter **tail_ = &head_;
+	detail::waiter *ready_ = nullptr;
+	detail::waiter **ready_tail_ = &ready_;
+};
+
+/* The common part of the awaitables: links the waiter on suspension and
+ * unlinks it if the coroutine is destroyed while suspended */
+template<typename Result, bool (*Match)(detail::waiter *, js_event *)>
+class async_context::awaitable : protected detail::waiter {
+public:
+	explicit awaitable(async_context *ctx) noexcept : ctx_(ctx)
+	{
+		match = Match;
+	}
+	awaitable(const awaitable &) = delete;
+	awaitable &operator=(const awaitable &) = delete;
+
+	~awaitable()
+	{
+		if (owner)
+			owner->unlink(this);
+	}
+
+	bool await_ready() const noexcept { return false; }
+
+	void
+	await_suspend(std::coroutine_handle<> handle) noexcept
+	{
+		coroutine = handle;
+		ctx_->link(this);
+	}
+
+	Result await_resume() noexcept { return std::move(result_); }
+
+protected:
+	async_context *ctx_;
+	Result result_{};
+};
+
+namespace detail {
+
+inline bool
+match_next_event(waiter *w, js_event *event);
+inline bool
+match_device_added(waiter *w, js_event *event);
+inline bool
+match_device_removed(waiter *w, js_event *event);
+inline bool
+match_button_pressed(waiter *w, js_event *event);
+
+} /* namespace detail */
+
+class async_context::next_event_awaitable
+	: public awaitable<js_event *, detail::match_next_event> {
+	using awaitable::awaitable;
+	friend bool detail::match_next_event(detail::waiter *, js_event *);
+};
+
+class async_context::device_added_awaitable
+	: public awaitable<js::device, detail::match_device_added> {
+	using awaitable::awaitable;
+	friend bool detail::match_device_added(detail::waiter *, js_event *);
+};
+
+class async_context::device_removed_awaitable
+	: public awaitable<bool, detail::match_device_removed> {
+public:
+	device_removed_awaitable(async_context *ctx, js_device *device) noexcept
+		: awaitable(ctx), device_(device) {}
+
+private:
+	js_device *device_;
+	friend bool detail::match_device_removed(detail::waiter *, js_event *);
+};
+
+class async_context::button_pressed_awaitable
+	: public awaitable<js_button *, detail::match_button_pressed> {
+public:
+	button_pressed_awaitable(async_context *ctx, js_device *device,
+				 enum js_button_capability cap) noexcept
+		: awaitable(ctx), device_(device), cap_(cap) {}
+
+private:
+	js_device *device_;
+	enum js_button_capability cap_;
+	friend bool detail::match_button_pressed(detail::waiter *, js_event *);
+};
+
+namespace detail {
+
+inline bool
+match_next_event(waiter *w, js_event *event)
+{
+	auto *a = static_cast<async_context::next_event_awaitable *>(w);
+
+	a->result_ = event;
+	return true;
+}
+
+inline bool
+match_device_added(waiter *w, js_event *event)
+{
+	auto *a = static_cast<async_context::device_added_awaitable *>(w);
+
+	if (js_event_get_type(event) != JS_EVENT_DEVICE_ADDED)
+		return false;
+
+	a->result_ = device::ref(js_event_get_device(event));
+	return true;
+}
+
+inline bool
+match_device_removed(waiter *w, js_event *event)
+{
+	auto *a = static_cast<async_context::device_removed_awaitable *>(w);
+
+	if (js_event_get_type(event) != JS_EVENT_DEVICE_REMOVED ||
+	    js_event_get_device(event) != a->device_)
+		return false;
+
+	a->result_ = true;
+	return true;
+}
+
+inline bool
+match_button_pressed(waiter *w, js_event *event)
+{
+	auto *a = static_cast<async_context::button_pressed_awaitable *>(w);
+	std::size_t n;
+
+	if (js_event_get_type(event) != JS_EVENT_BUTTON ||
+	    js_event_get_device(event) != a->device_)
+		return false;
+
+	n = js_device_get_button_count(a->device_);
+	for (unsigned int i = 0; i < n; i++) {
+		js_button *button = js_device_get_button(a->device_, i);
+		bool pressed;
+
+		if (!js_event_button_state_has_changed(event, button) ||
+		    !js_button_has_capability(button, a->cap_))
+			continue;
+
+		js_event_button_get_state(event, button, &pressed);
+		if (pressed) {
+			a->result_ = button;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+} /* namespace detail */
+
+inline async_context::next_event_awaitable
+async_context::next_event() noexcept
+{
+	return next_event_awaitable{ this };
+}
+
+inline async_context::device_added_awaitable
+async_context::device_added() noexcept
+{
+	return device_added_awaitable{ this };
+}
+
+inline async_context::device_removed_awaitable
+async_context::device_removed(js_device *device) noexcept
+{
+	return device_removed_awaitable{ this, device };
+}
+
+inline async_context::button_pressed_awaitable
+async_context::button_pressed(js_device *device,
+			      enum js_button_capability cap) noexcept
+{
+	return button_pressed_awaitable{ this, device, cap };
+}
+
+inline async_context::button_pressed_awaitable
+async_context::button_pressed(const js::device &device,
+			      enum js_button_capability cap) noexcept
+{
+	return button_pressed_awaitable{ this, device.get(), cap };
+}
+#endif /* LIBJOYSTICK_HAVE_COROUTINES */
+
+} /* namespace js */
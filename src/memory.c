@@ -0,0 +1,116 @@
+/*
+ * Copyright © 2019 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#include "config.h"
+
+#include "libjoystick-private.h"
+
+static size_t
+device_memory_usage(struct js_device *device,
+		    enum js_memory_category category)
+{
+	switch (category) {
+	case JS_MEMORY_TOTAL:
+		return device_memory_usage(device, JS_MEMORY_DEVICES) +
+		       device_memory_usage(device, JS_MEMORY_DESCRIPTORS) +
+		       device_memory_usage(device, JS_MEMORY_STATE) +
+		       device_memory_usage(device, JS_MEMORY_EVENT_QUEUE) +
+		       device_memory_usage(device, JS_MEMORY_STATISTICS);
+	case JS_MEMORY_CONTEXT:
+		return 0;
+	case JS_MEMORY_DEVICES:
+		return sizeof(*device) -
+		       device_memory_usage(device, JS_MEMORY_STATISTICS) -
+#if JS_FIXED_CONTROLS
+		       /* The arrays are part of the device */
+		       device->memory.descriptors - device->memory.state +
+#endif
+		       (device->source ? sizeof(*device->source) : 0);
+	case JS_MEMORY_DESCRIPTORS:
+		return device->memory.descriptors;
+	case JS_MEMORY_STATE:
+		return device->memory.state;
+	case JS_MEMORY_EVENT_QUEUE:
+		return device->memory.queued;
+	case JS_MEMORY_STATISTICS:
+#if HAVE_STATISTICS
+		return sizeof(device->stats);
+#else
+		return 0;
+#endif
+	}
+
+	return 0;
+}
+
+_public_ size_t
+js_device_get_memory_usage(struct js_device *device,
+			   enum js_memory_category category)
+{
+	return device_memory_usage(device, category);
+}
+
+_public_ size_t
+js_ctx_get_memory_usage(struct js_ctx *ctx,
+			enum js_memory_category category)
+{
+	struct js_device *device;
+	size_t statistics, bytes = 0;
+
+#if HAVE_STATISTICS
+	statistics = sizeof(ctx->stats) +
+		     sizeof(ctx->consumed_latency) +
+		     sizeof(ctx->wake_latency) +
+		     sizeof(ctx->frame_history) +
+		     sizeof(ctx->stage_cost);
+#else
+	statistics = 0;
+#endif
+
+	switch (category) {
+	case JS_MEMORY_TOTAL:
+		return js_ctx_get_memory_usage(ctx, JS_MEMORY_CONTEXT) +
+		       js_ctx_get_memory_usage(ctx, JS_MEMORY_DEVICES) +
+		       js_ctx_get_memory_usage(ctx, JS_MEMORY_DESCRIPTORS) +
+		       js_ctx_get_memory_usage(ctx, JS_MEMORY_STATE) +
+		       js_ctx_get_memory_usage(ctx, JS_MEMORY_EVENT_QUEUE) +
+		       js_ctx_get_memory_usage(ctx, JS_MEMORY_STATISTICS);
+	case JS_MEMORY_CONTEXT:
+		return sizeof(*ctx) - statistics +
+		       ctx->nfree_sources * sizeof(struct js_source) +
+		       js_pool_get_unused_memory(ctx->device_pool);
+	case JS_MEMORY_EVENT_QUEUE:
+		return ctx->queued_memory +
+		       js_pool_get_memory_usage(ctx->event_pool);
+	case JS_MEMORY_STATISTICS:
+		bytes = statistics + js_perf_get_memory_usage(ctx);
+		break;
+	case JS_MEMORY_DEVICES:
+	case JS_MEMORY_DESCRIPTORS:
+	case JS_MEMORY_STATE:
+		break;
+	default:
+		return 0;
+	}
+
+	list_for_each(device, &ctx->devices, link)
+		bytes += device_memory_usage(device, category);
+
+	return bytes;
+}
@@ -0,0 +1,234 @@
+/*
+ * Copyright © 2019 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <string.h>
+
+#include "libjoystick-private.h"
+
+_public_ bool
+js_device_has_output(struct js_device *device, enum js_output output)
+{
+	switch (output) {
+	case JS_OUTPUT_RUMBLE:
+		return js_device_has_ff_effect(device, JS_FF_EFFECT_RUMBLE);
+	case JS_OUTPUT_PLAYER_INDICATOR:
+	case JS_OUTPUT_LIGHTBAR:
+		return device->interface->write_output &&
+		       (device->output.supported & js_output_bit(output));
+	}
+
+	return false;
+}
+
+static int
+output_check(struct js_device *device, enum js_output output)
+{
+	if (device->removed)
+		return -ENODEV;
+
+	if (!js_device_has_output(device, output))
+		return -ENOTSUP;
+
+	return 0;
+}
+
+/* True if the latest value of the output is the one last written. The
+ * state of the device is unknown until the first successful write. */
+static bool
+output_on_device(struct js_device *device, enum js_output output)
+{
+	if (!(device->output.written & js_output_bit(output)))
+		return false;
+
+	switch (output) {
+	case JS_OUTPUT_RUMBLE:
+		return memcmp(device->output.rumble,
+			      device->output.on_device.rumble,
+			      sizeof(device->output.rumble)) == 0;
+	case JS_OUTPUT_PLAYER_INDICATOR:
+		return device->output.player_indicator ==
+		       device->output.on_device.player_indicator;
+	case JS_OUTPUT_LIGHTBAR:
+		return memcmp(device->output.lightbar,
+			      device->output.on_device.lightbar,
+			      sizeof(device->output.lightbar)) == 0;
+	}
+
+	return false;
+}
+
+static void
+output_written(struct js_device *device, enum js_output output)
+{
+	switch (output) {
+	case JS_OUTPUT_RUMBLE:
+		memcpy(device->output.on_device.rumble, device->output.rumble,
+		       sizeof(device->output.rumble));
+		break;
+	case JS_OUTPUT_PLAYER_INDICATOR:
+		device->output.on_device.player_indicator =
+			device->output.player_indicator;
+		break;
+	case JS_OUTPUT_LIGHTBAR:
+		memcpy(device->output.on_device.lightbar, device->output.lightbar,
+		       sizeof(device->output.lightbar));
+		break;
+	}
+
+	device->output.written |= js_output_bit(output);
+}
+
+/* Mark the output pending unless the latest value is already on the
+ * device. A value set back to what the device has, e.g. A -> B -> A
+ * within one dispatch, is no longer pending. */
+static void
+output_update(struct js_device *device, enum js_output output)
+{
+	uint32_t bit = js_output_bit(output);
+
+	if (output_on_device(device, output)) {
+		if (device->output.pending & bit) {
+			device->output.pending &= ~bit;
+			if (!device->output.pending)
+				list_remove(&device->output.link);
+		}
+		return;
+	}
+
+	if (!device->output.pending)
+		list_append(&device->ctx->output_pending, &device->output.link);
+	device->output.pending |= bit;
+}
+
+_public_ int
+js_device_set_rumble(struct js_device *device,
+		     uint16_t strong,
+		     uint16_t weak)
+{
+	int rc;
+
+	rc = output_check(device, JS_OUTPUT_RUMBLE);
+	if (rc < 0)
+		return rc;
+
+	device->output.rumble[0] = strong;
+	device->output.rumble[1] = weak;
+	output_update(device, JS_OUTPUT_RUMBLE);
+
+	return 0;
+}
+
+_public_ int
+js_device_set_player_indicator(struct js_device *device, uint32_t mask)
+{
+	int rc;
+
+	rc = output_check(device, JS_OUTPUT_PLAYER_INDICATOR);
+	if (rc < 0)
+		return rc;
+
+	device->output.player_indicator = mask;
+	output_update(device, JS_OUTPUT_PLAYER_INDICATOR);
+
+	return 0;
+}
+
+_public_ int
+js_device_set_lightbar(struct js_device *device,
+		       uint8_t red,
+		       uint8_t green,
+		       uint8_t blue)
+{
+	int rc;
+
+	rc = output_check(device, JS_OUTPUT_LIGHTBAR);
+	if (rc < 0)
+		return rc;
+
+	device->output.lightbar[0] = red;
+	device->output.lightbar[1] = green;
+	device->output.lightbar[2] = blue;
+	output_update(device, JS_OUTPUT_LIGHTBAR);
+
+	return 0;
+}
+
+void
+js_device_cancel_output(struct js_device *device)
+{
+	if (device->output.pending)
+		list_remove(&device->output.link);
+	device->output.pending = 0;
+}
+
+static int
+device_flush_output(struct js_device *device)
+{
+	int status = 0;
+
+	for (enum js_output output = JS_OUTPUT_RUMBLE;
+	     output <= JS_OUTPUT_LIGHTBAR;
+	     output++) {
+		uint32_t bit = js_output_bit(output);
+		int rc;
+
+		if (!(device->output.pending & bit) ||
+		    output_on_device(device, output))
+			continue;
+
+		if (output == JS_OUTPUT_RUMBLE)
+			rc = ff_device_write_rumble(device);
+		else
+			rc = device->interface->write_output(device, output);
+
+		/* A failed value is dropped, not retried, and the
+		 * device's state is unknown until the next write */
+		if (rc == 0) {
+			output_written(device, output);
+		} else {
+			device->output.written &= ~bit;
+			if (status == 0)
+				status = rc;
+		}
+	}
+
+	return status;
+}
+
+_public_ int
+js_ctx_flush_output(struct js_ctx *ctx)
+{
+	struct js_device *device, *tmp;
+	int status = 0;
+
+	list_for_each_safe(device, tmp, &ctx->output_pending, output.link) {
+		int rc = device_flush_output(device);
+
+		if (rc < 0 && status == 0)
+			status = rc;
+
+		list_remove(&device->output.link);
+		device->output.pending = 0;
+	}
+
+	return status;
+}
@@ -0,0 +1,125 @@
+/*
+ * Copyright © 2019 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#include "config.h"
+
+#include <errno.h>
+
+#include "libjoystick-private.h"
+
+struct path_ctx {
+	struct js_ctx base;
+};
+
+struct path_js_device {
+	struct js_device base;
+};
+
+static void
+path_device_remove(struct js_device *device)
+{
+	js_ctx_close_restricted(device->ctx, device->fd);
+}
+
+static const struct js_device_interface path_device_interface = {
+	.sync_state = evdev_device_sync_state_fd,
+	.upload_effect = evdev_device_upload_effect_fd,
+	.erase_effect = evdev_device_erase_effect_fd,
+	.write_events = evdev_device_write_fd,
+	.set_event_mask = evdev_device_set_event_mask_fd,
+	.remove = path_device_remove,
+};
+
+static void
+path_ctx_destroy(struct js_ctx *ctx)
+{
+	/* nothing to do, the devices are removed by the core */
+}
+
+static const struct js_backend_interface path_backend_interface = {
+	.destroy = path_ctx_destroy,
+	.device_size = sizeof(struct path_js_device),
+};
+
+_public_ struct js_ctx *
+js_ctx_path_create_context(const struct js_interface *interface,
+			   void *userdata)
+{
+	struct path_ctx *pctx;
+
+	if (!interface ||
+	    !interface->open_restricted ||
+	    !interface->close_restricted)
+		return NULL;
+
+	pctx = zalloc(sizeof *pctx);
+	if (js_ctx_init(&pctx->base, interface, userdata,
+			&path_backend_interface) != 0) {
+		zfree(pctx);
+		return NULL;
+	}
+
+	return &pctx->base;
+}
+
+_public_ struct js_device *
+js_ctx_path_add_device(struct js_ctx *ctx, const char *path)
+{
+	struct path_js_device *d;
+	struct libevdev *evdev;
+	int fd, rc;
+
+	if (ctx->backend != &path_backend_interface || !path)
+		return NULL;
+
+	fd = evdev_device_open(ctx, path, &evdev);
+	if (fd < 0)
+		return NULL;
+
+	d = js_ctx_new_device(ctx, sizeof *d);
+	if (!d) {
+		js_log_error(ctx, "%s: too many devices\n", path);
+		js_ctx_close_restricted(ctx, fd);
+		libevdev_free(evdev);
+		return NULL;
+	}
+
+	evdev_device_init(&d->base, ctx, evdev, fd, &path_device_interface);
+	evdev_device_classify(&d->base);
+
+	rc = evdev_device_added(&d->base);
+	if (rc != 0) {
+		js_log_error(ctx, "%s: failed to add device (%s)\n",
+			     path, strerror(-rc));
+		js_ctx_close_restricted(ctx, fd);
+		js_device_unref(&d->base);
+		return NULL;
+	}
+
+	return &d->base;
+}
+
+_public_ void
+js_ctx_path_remove_device(struct js_device *device)
+{
+	if (device->ctx->backend != &path_backend_interface)
+		return;
+
+	evdev_device_removed(device);
+}
@@ -0,0 +1,217 @@
+/*
+ * Copyright © 2019 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <linux/perf_event.h>
+#include <pthread.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "libjoystick-private.h"
+
+#if HAVE_STATISTICS
+struct js_perf {
+	int group_fd;		/* cycles, the group leader */
+	int instructions_fd;
+	bool user_only;
+	pthread_t thread;	/* the only thread the counters count */
+
+	/* Sum of the cost accounted to any stage so far */
+	uint64_t accounted_cycles;
+	uint64_t accounted_instructions;
+};
+
+/* PERF_FORMAT_GROUP layout for our two counters */
+struct perf_read_format {
+	uint64_t nr;
+	uint64_t values[2];
+};
+
+static int
+perf_open(uint64_t config, bool user_only, int group_fd)
+{
+	struct perf_event_attr attr;
+	int fd;
+
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = PERF_TYPE_HARDWARE;
+	attr.config = config;
+	attr.read_format = PERF_FORMAT_GROUP;
+	attr.exclude_kernel = user_only;
+	attr.exclude_hv = 1;
+
+	/* This thread, any CPU */
+	fd = syscall(SYS_perf_event_open, &attr, 0, -1, group_fd,
+		     PERF_FLAG_FD_CLOEXEC);
+
+	return fd < 0 ? -errno : fd;
+}
+
+static int
+perf_open_group(struct js_perf *perf, bool user_only)
+{
+	int fd;
+
+	fd = perf_open(PERF_COUNT_HW_CPU_CYCLES, user_only, -1);
+	if (fd < 0)
+		return fd;
+	perf->group_fd = fd;
+
+	fd = perf_open(PERF_COUNT_HW_INSTRUCTIONS, user_only, perf->group_fd);
+	if (fd < 0) {
+		close(perf->group_fd);
+		return fd;
+	}
+	perf->instructions_fd = fd;
+	perf->user_only = user_only;
+
+	return 0;
+}
+
+void
+js_perf_sample(struct js_ctx *ctx, struct js_perf_sample *sample)
+{
+	struct js_perf *perf = ctx->perf;
+	struct perf_read_format values;
+
+	/* On another thread the counters still count the thread that
+	 * enabled them */
+	sample->valid = pthread_equal(pthread_self(), perf->thread) &&
+			read(perf->group_fd, &values, sizeof(values)) == sizeof(values) &&
+			values.nr == 2;
+	if (!sample->valid)
+		memset(&values, 0, sizeof(values));
+
+	sample->cycles = values.values[0];
+	sample->instructions = values.values[1];
+	sample->nested_cycles = perf->accounted_cycles;
+	sample->nested_instructions = perf->accounted_instructions;
+}
+
+void
+js_perf_account(struct js_ctx *ctx, enum js_stage stage,
+		struct js_perf_sample *sample, uint64_t nevents)
+{
+	struct js_perf *perf = ctx->perf;
+	struct js_stage_cost *cost = &ctx->stage_cost[stage];
+	struct js_perf_sample now;
+	uint64_t cycles, instructions;
+
+	js_perf_sample(ctx, &now);
+
+	if (!sample->valid || !now.valid) {
+		*sample = now;
+		sample->nested_cycles = perf->accounted_cycles;
+		sample->nested_instructions = perf->accounted_instructions;
+		return;
+	}
+
+	/* Whatever was accounted to nested stages since the sample is not
+	 * this stage's cost */
+	cycles = now.cycles - sample->cycles -
+		 (now.nested_cycles - sample->nested_cycles);
+	instructions = now.instructions - sample->instructions -
+		       (now.nested_instructions - sample->nested_instructions);
+
+	cost->cycles += cycles;
+	cost->instructions += instructions;
+	cost->events += nevents;
+
+	perf->accounted_cycles += cycles;
+	perf->accounted_instructions += instructions;
+
+	*sample = now;
+	sample->nested_cycles = perf->accounted_cycles;
+	sample->nested_instructions = perf->accounted_instructions;
+}
+
+void
+js_perf_destroy(struct js_ctx *ctx)
+{
+	struct js_perf *perf = ctx->perf;
+
+	if (!perf)
+		return;
+
+	close(perf->instructions_fd);
+	close(perf->group_fd);
+	zfree(perf);
+	ctx->perf = NULL;
+}
+
+size_t
+js_perf_get_memory_usage(struct js_ctx *ctx)
+{
+	return ctx->perf ? sizeof(*ctx->perf) : 0;
+}
+
+_public_ int
+js_ctx_set_perf_counters(struct js_ctx *ctx, bool enable)
+{
+	struct js_perf *perf;
+	int rc;
+
+	if (!enable) {
+		js_perf_destroy(ctx);
+		return 0;
+	}
+
+	if (ctx->perf)
+		return 0;
+
+	perf = zalloc(sizeof *perf);
+
+	/* With perf_event_paranoid >= 2 we may only count user space, the
+	 * read stage then excludes the time spent in the kernel */
+	rc = perf_open_group(perf, false);
+	if (rc == -EACCES || rc == -EPERM)
+		rc = perf_open_group(perf, true);
+
+	if (rc != 0) {
+		zfree(perf);
+		return rc;
+	}
+
+	perf->thread = pthread_self();
+	ctx->perf = perf;
+
+	return 0;
+}
+#else
+void
+js_perf_destroy(struct js_ctx *ctx)
+{
+}
+
+size_t
+js_perf_get_memory_usage(struct js_ctx *ctx)
+{
+	return 0;
+}
+
+_public_ int
+js_ctx_set_perf_counters(struct js_ctx *ctx, bool enable)
+{
+	return enable ? -ENOTSUP : 0;
+}
+#endif
@@ -0,0 +1,173 @@
+/*
+ * Copyright © 2019 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#include "config.h"
+
+#include <assert.h>
+#include <errno.h>
+
+#include "libjoystick-private.h"
+
+/* Pool objects may outlive the context, so the pool is refcounted: the
+ * context holds one reference and each slot taken from the pool holds
+ * one. */
+struct js_pool {
+	int refcount;
+	size_t slot_size;
+	size_t nslots;
+	size_t nfree;
+	struct list free_slots;
+	struct list chunks;	/* struct pool_chunk.link */
+};
+
+struct pool_chunk {
+	struct list link;
+	size_t nslots;
+	unsigned long slots[];	/* nslots * slot_size bytes */
+};
+
+static void
+pool_put_slot(struct js_pool *pool, void *slot)
+{
+	struct list *node = slot;
+
+	/* The slot still has the object's data, list_insert() expects a
+	 * clean node */
+	node->prev = NULL;
+	node->next = NULL;
+	list_insert(&pool->free_slots, node);
+	pool->nfree++;
+}
+
+int
+js_pool_reserve(struct js_pool **pool_out, size_t slot_size, size_t nslots)
+{
+	struct js_pool *pool = *pool_out;
+	struct pool_chunk *chunk;
+	size_t n;
+
+	/* Rounded up so that every slot is aligned for any object */
+	slot_size = NLONGS(slot_size * 8) * sizeof(unsigned long);
+	assert(!pool || pool->slot_size == slot_size);
+
+	/* The whole pool must fit into a single chunk */
+	if (nslots > (ZALLOC_MAX - sizeof *chunk) / slot_size)
+		return -EINVAL;
+
+	if (!pool) {
+		pool = try_zalloc(sizeof *pool);
+		if (!pool)
+			return -ENOMEM;
+		pool->refcount = 1;
+		pool->slot_size = slot_size;
+		list_init(&pool->free_slots);
+		list_init(&pool->chunks);
+		*pool_out = pool;
+	}
+
+	if (nslots <= pool->nslots)
+		return 0;
+
+	n = nslots - pool->nslots;
+	chunk = try_zalloc(sizeof *chunk + n * slot_size);
+	if (!chunk)
+		return -ENOMEM;
+	chunk->nslots = n;
+	list_append(&pool->chunks, &chunk->link);
+
+	for (size_t i = 0; i < n; i++)
+		pool_put_slot(pool, (char *)chunk->slots + i * slot_size);
+
+	pool->nslots = nslots;
+
+	return 0;
+}
+
+void *
+js_pool_get(struct js_pool *pool, size_t size, size_t keep)
+{
+	struct list *slot;
+
+	if (size > pool->slot_size || pool->nfree <= keep)
+		return NULL;
+
+	slot = pool->free_slots.next;
+	list_remove(slot);
+	pool->nfree--;
+	memset(slot, 0, size);
+	pool->refcount++;
+
+	return slot;
+}
+
+void
+js_pool_put(struct js_pool *pool, void *slot)
+{
+	pool_put_slot(pool, slot);
+	js_pool_unref(pool);
+}
+
+size_t
+js_pool_get_free(struct js_pool *pool)
+{
+	return pool ? pool->nfree : 0;
+}
+
+void
+js_pool_unref(struct js_pool *pool)
+{
+	struct pool_chunk *chunk, *tmp;
+
+	if (!pool)
+		return;
+
+	assert(pool->refcount > 0);
+	if (--pool->refcount > 0)
+		return;
+
+	list_for_each_safe(chunk, tmp, &pool->chunks, link)
+		zfree(chunk);
+	zfree(pool);
+}
+
+size_t
+js_pool_get_memory_usage(struct js_pool *pool)
+{
+	struct pool_chunk *chunk;
+	size_t bytes;
+
+	if (!pool)
+		return 0;
+
+	bytes = sizeof(*pool);
+	list_for_each(chunk, &pool->chunks, link)
+		bytes += sizeof(*chunk) + chunk->nslots * pool->slot_size;
+
+	return bytes;
+}
+
+size_t
+js_pool_get_unused_memory(struct js_pool *pool)
+{
+	if (!pool)
+		return 0;
+
+	return js_pool_get_memory_usage(pool) -
+	       (pool->nslots - pool->nfree) * pool->slot_size;
+}
@@ -0,0 +1,221 @@
+/*
+ * Copyright © 2019 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#include "config.h"
+
+#include "simd.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define JS_SIMD_X86 1
+#include <immintrin.h>
+#else
+#define JS_SIMD_X86 0
+#endif
+
+/*
+ * The vector variants of normalize_abs compute in double: the numerator
+ * is at most 2^32 * 0xffff < 2^53 and exact, and a quotient that is not
+ * an integer is at least 1/range away from one, far more than the
+ * rounding error of the division. Truncating gives the same result as
+ * the integer division of the scalar reference.
+ */
+
+static void
+normalize_abs_scalar(const int32_t *value,
+		     const int32_t *minimum,
+		     const int32_t *maximum,
+		     int32_t *out,
+		     size_t n)
+{
+	for (size_t i = 0; i < n; i++)
+		out[i] = js_normalize_abs(minimum[i], maximum[i], value[i]);
+}
+
+#if JS_SIMD_X86
+__attribute__((target("sse2")))
+static void
+normalize_abs_sse2(const int32_t *value,
+		   const int32_t *minimum,
+		   const int32_t *maximum,
+		   int32_t *out,
+		   size_t n)
+{
+	const __m128d scale = _mm_set1_pd(0xffff);
+	const __m128d one = _mm_set1_pd(1.0);
+	const __m128d zero = _mm_setzero_pd();
+	size_t i = 0;
+
+	for (; i + 2 <= n; i += 2) {
+		__m128d v = _mm_cvtepi32_pd(_mm_loadl_epi64((const __m128i *)&value[i]));
+		__m128d lo = _mm_cvtepi32_pd(_mm_loadl_epi64((const __m128i *)&minimum[i]));
+		__m128d hi = _mm_cvtepi32_pd(_mm_loadl_epi64((const __m128i *)&maximum[i]));
+		__m128d range = _mm_sub_pd(hi, lo);
+		__m128d valid = _mm_cmpgt_pd(range, zero);
+		__m128d num;
+
+		v = _mm_min_pd(_mm_max_pd(v, lo), hi);
+		num = _mm_and_pd(_mm_mul_pd(_mm_sub_pd(v, lo), scale), valid);
+		range = _mm_max_pd(range, one);
+		_mm_storel_epi64((__m128i *)&out[i],
+				 _mm_cvttpd_epi32(_mm_div_pd(num, range)));
+	}
+
+	normalize_abs_scalar(value + i, minimum + i, maximum + i,
+			     out + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static void
+normalize_abs_avx2(const int32_t *value,
+		   const int32_t *minimum,
+		   const int32_t *maximum,
+		   int32_t *out,
+		   size_t n)
+{
+	const __m256d scale = _mm256_set1_pd(0xffff);
+	const __m256d one = _mm256_set1_pd(1.0);
+	const __m256d zero = _mm256_setzero_pd();
+	size_t i = 0;
+
+	for (; i + 4 <= n; i += 4) {
+		__m256d v = _mm256_cvtepi32_pd(_mm_loadu_si128((const __m128i *)&value[i]));
+		__m256d lo = _mm256_cvtepi32_pd(_mm_loadu_si128((const __m128i *)&minimum[i]));
+		__m256d hi = _mm256_cvtepi32_pd(_mm_loadu_si128((const __m128i *)&maximum[i]));
+		__m256d range = _mm256_sub_pd(hi, lo);
+		__m256d valid = _mm256_cmp_pd(range, zero, _CMP_GT_OQ);
+		__m256d num;
+
+		v = _mm256_min_pd(_mm256_max_pd(v, lo), hi);
+		num = _mm256_and_pd(_mm256_mul_pd(_mm256_sub_pd(v, lo), scale),
+				    valid);
+		range = _mm256_max_pd(range, one);
+		_mm_storeu_si128((__m128i *)&out[i],
+				 _mm256_cvttpd_epi32(_mm256_div_pd(num, range)));
+	}
+
+	normalize_abs_sse2(value + i, minimum + i, maximum + i,
+			   out + i, n - i);
+}
+
+__attribute__((target("avx512f")))
+static void
+normalize_abs_avx512(const int32_t *value,
+		     const int32_t *minimum,
+		     const int32_t *maximum,
+		     int32_t *out,
+		     size_t n)
+{
+	const __m512d scale = _mm512_set1_pd(0xffff);
+	const __m512d one = _mm512_set1_pd(1.0);
+	const __m512d zero = _mm512_setzero_pd();
+	size_t i = 0;
+
+	for (; i + 8 <= n; i += 8) {
+		__m512d v = _mm512_cvtepi32_pd(_mm256_loadu_si256((const __m256i *)&value[i]));
+		__m512d lo = _mm512_cvtepi32_pd(_mm256_loadu_si256((const __m256i *)&minimum[i]));
+		__m512d hi = _mm512_cvtepi32_pd(_mm256_loadu_si256((const __m256i *)&maximum[i]));
+		__m512d range = _mm512_sub_pd(hi, lo);
+		__mmask8 valid = _mm512_cmp_pd_mask(range, zero, _CMP_GT_OQ);
+		__m512d num;
+
+		v = _mm512_min_pd(_mm512_max_pd(v, lo), hi);
+		num = _mm512_maskz_mul_pd(valid, _mm512_sub_pd(v, lo), scale);
+		range = _mm512_max_pd(range, one);
+		_mm256_storeu_si256((__m256i *)&out[i],
+				    _mm512_cvttpd_epi32(_mm512_div_pd(num, range)));
+	}
+
+	normalize_abs_avx2(value + i, minimum + i, maximum + i,
+			   out + i, n - i);
+}
+#endif
+
+static const struct js_simd_kernels kernels[JS_SIMD_LEVEL_COUNT] = {
+	[JS_SIMD_SCALAR] = {
+		.name = "scalar",
+		.normalize_abs = normalize_abs_scalar,
+	},
+#if JS_SIMD_X86
+	[JS_SIMD_SSE2] = {
+		.name = "sse2",
+		.normalize_abs = normalize_abs_sse2,
+	},
+	[JS_SIMD_AVX2] = {
+		.name = "avx2",
+		.normalize_abs = normalize_abs_avx2,
+	},
+	[JS_SIMD_AVX512] = {
+		.name = "avx512",
+		.normalize_abs = normalize_abs_avx512,
+	},
+#endif
+};
+
+const struct js_simd_kernels *js_simd = &kernels[JS_SIMD_SCALAR];
+
+static bool
+cpu_supports(enum js_simd_level level)
+{
+#if JS_SIMD_X86
+	__builtin_cpu_init();
+
+	/* Each variant falls back to the one below for its tail, so each
+	 * level requires the ones below it */
+	switch (level) {
+	case JS_SIMD_SCALAR:
+		return true;
+	case JS_SIMD_SSE2:
+		return __builtin_cpu_supports("sse2");
+	case JS_SIMD_AVX2:
+		return __builtin_cpu_supports("sse2") &&
+		       __builtin_cpu_supports("avx2");
+	case JS_SIMD_AVX512:
+		return __builtin_cpu_supports("sse2") &&
+		       __builtin_cpu_supports("avx2") &&
+		       __builtin_cpu_supports("avx512f");
+	}
+
+	return false;
+#else
+	return level == JS_SIMD_SCALAR;
+#endif
+}
+
+const struct js_simd_kernels *
+js_simd_get_kernels(enum js_simd_level level)
+{
+	if (level >= JS_SIMD_LEVEL_COUNT || !cpu_supports(level))
+		return NULL;
+
+	return &kernels[level];
+}
+
+__attribute__((constructor))
+static void
+js_simd_init(void)
+{
+	for (int level = JS_SIMD_LEVEL_COUNT - 1; level > JS_SIMD_SCALAR; level--) {
+		const struct js_simd_kernels *k = js_simd_get_kernels(level);
+
+		if (k) {
+			js_simd = k;
+			return;
+		}
+	}
+}
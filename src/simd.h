@@ -0,0 +1,73 @@
+/*
+ * Copyright © 2019 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#pragma once
+
+#include "config.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Kernels with per-instruction-set variants. The best variant the CPU
+ * supports is picked once when the library is loaded, callers go through
+ * the js_simd table.
+ */
+
+enum js_simd_level {
+	JS_SIMD_SCALAR,
+	JS_SIMD_SSE2,
+	JS_SIMD_AVX2,
+	JS_SIMD_AVX512,
+};
+
+#define JS_SIMD_LEVEL_COUNT (JS_SIMD_AVX512 + 1)
+
+struct js_simd_kernels {
+	const char *name;
+
+	/* out[i] = js_normalize_abs(minimum[i], maximum[i], value[i]) */
+	void (*normalize_abs)(const int32_t *value,
+			      const int32_t *minimum,
+			      const int32_t *maximum,
+			      int32_t *out,
+			      size_t n);
+};
+
+extern const struct js_simd_kernels *js_simd;
+
+/* The variant for the given level, or NULL if this CPU or build does not
+ * support it. JS_SIMD_SCALAR is always available. */
+const struct js_simd_kernels *
+js_simd_get_kernels(enum js_simd_level level);
+
+/* Scale an absolute axis value to [0, 0xffff], 0 for an empty range */
+static inline int32_t
+js_normalize_abs(int32_t minimum, int32_t maximum, int32_t value)
+{
+	int64_t range = (int64_t)maximum - minimum;
+
+	if (range <= 0)
+		return 0;
+
+	value = value < minimum ? minimum : value > maximum ? maximum : value;
+
+	return ((int64_t)value - minimum) * 0xffff / range;
+}
@@ -0,0 +1,277 @@
+/*
+ * Copyright © 2019 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <string.h>
+
+#include "libjoystick-private.h"
+
+struct js_stats {
+	struct js_stats_data data;
+	struct js_histogram consumed_latency;
+	bool have_consumed_latency;
+	struct js_histogram wake_latency;
+	bool have_wake_latency;
+	struct js_stage_cost stage_cost[JS_STAGE_COUNT];
+	bool have_stage_cost;
+};
+
+uint64_t
+js_ctx_new_frame(struct js_ctx *ctx, uint64_t time)
+{
+	uint64_t id = ++ctx->last_frame_id;
+#if HAVE_STATISTICS
+	unsigned int slot = id % JS_FRAME_HISTORY;
+
+	ctx->frame_history[slot].id = id;
+	ctx->frame_history[slot].time = time;
+#endif
+
+	return id;
+}
+
+#if HAVE_STATISTICS
+_public_ int
+js_ctx_mark_consumed(struct js_ctx *ctx, uint64_t frame_id)
+{
+	uint64_t now = now_in_us();
+	uint64_t first;
+	int nframes = 0;
+
+	if (frame_id == 0 || frame_id > ctx->last_frame_id)
+		return -EINVAL;
+
+	if (frame_id <= ctx->last_consumed_frame_id)
+		return 0;
+
+	/* Older frames have been overwritten in the history */
+	first = ctx->last_consumed_frame_id + 1;
+	if (ctx->last_frame_id >= JS_FRAME_HISTORY)
+		first = max(first, ctx->last_frame_id - JS_FRAME_HISTORY + 1);
+
+	for (uint64_t id = first; id <= frame_id; id++) {
+		unsigned int slot = id % JS_FRAME_HISTORY;
+		uint64_t time = ctx->frame_history[slot].time;
+
+		if (ctx->frame_history[slot].id != id)
+			continue;
+
+		js_histogram_record(&ctx->consumed_latency,
+				    now > time ? now - time : 0);
+		nframes++;
+	}
+
+	ctx->last_consumed_frame_id = frame_id;
+
+	return nframes;
+}
+
+_public_ struct js_stats *
+js_ctx_get_stats(struct js_ctx *ctx)
+{
+	struct js_stats *stats = zalloc(sizeof *stats);
+
+	stats->data = ctx->stats;
+	stats->consumed_latency = ctx->consumed_latency;
+	stats->have_consumed_latency = true;
+	stats->wake_latency = ctx->wake_latency;
+	stats->have_wake_latency = true;
+	memcpy(stats->stage_cost, ctx->stage_cost, sizeof(stats->stage_cost));
+	stats->have_stage_cost = true;
+
+	return stats;
+}
+
+_public_ struct js_stats *
+js_device_get_stats(struct js_device *device)
+{
+	struct js_stats *stats = zalloc(sizeof *stats);
+
+	stats->data = device->stats;
+
+	return stats;
+}
+#else
+_public_ int
+js_ctx_mark_consumed(struct js_ctx *ctx, uint64_t frame_id)
+{
+	if (frame_id == 0 || frame_id > ctx->last_frame_id)
+		return -EINVAL;
+
+	return -ENOTSUP;
+}
+
+/* Built without statistics, all snapshots are empty */
+_public_ struct js_stats *
+js_ctx_get_stats(struct js_ctx *ctx)
+{
+	struct js_stats *stats = zalloc(sizeof *stats);
+
+	stats->have_consumed_latency = true;
+	stats->have_wake_latency = true;
+	stats->have_stage_cost = true;
+
+	return stats;
+}
+
+_public_ struct js_stats *
+js_device_get_stats(struct js_device *device)
+{
+	return zalloc(sizeof(struct js_stats));
+}
+#endif
+
+_public_ void
+js_stats_destroy(struct js_stats *stats)
+{
+	zfree(stats);
+}
+
+_public_ uint64_t
+js_stats_get_counter(struct js_stats *stats, enum js_stats_counter counter)
+{
+	const struct js_stats_data *d = &stats->data;
+
+	switch (counter) {
+	case JS_STATS_EVENTS_READ:
+		return d->events_read;
+	case JS_STATS_FRAMES:
+		return d->frames;
+	case JS_STATS_SYSCALLS:
+		return d->syscalls;
+	case JS_STATS_EVENTS_QUEUED:
+		return d->events_queued;
+	case JS_STATS_EVENTS_DEQUEUED:
+		return d->events_dequeued;
+	case JS_STATS_QUEUE_DEPTH:
+		return d->queue_depth;
+	case JS_STATS_QUEUE_HIGH_WATER:
+		return d->queue_high_water;
+	case JS_STATS_EVENTS_DROPPED:
+		return d->events_dropped;
+	case JS_STATS_SYN_DROPPED:
+		return d->syn_dropped;
+	case JS_STATS_TIMESTAMPED_REPORTS:
+		return d->timestamped_reports;
+	case JS_STATS_TIMESTAMP_GAPS:
+		return d->timestamp_gaps;
+	case JS_STATS_REPORTS_LOST:
+		return d->reports_lost;
+	case JS_STATS_REPORT_JITTER:
+		return d->report_jitter;
+	case JS_STATS_QUEUE_OVERFLOWS:
+		return d->queue_overflows;
+	}
+
+	return 0;
+}
+
+static const struct js_histogram *
+stats_histogram(struct js_stats *stats, enum js_stats_latency latency)
+{
+	switch (latency) {
+	case JS_STATS_LATENCY_DEQUEUE:
+		return &stats->data.dequeue_latency;
+	case JS_STATS_LATENCY_CONSUMED:
+		if (stats->have_consumed_latency)
+			return &stats->consumed_latency;
+		break;
+	case JS_STATS_LATENCY_WAKE:
+		if (stats->have_wake_latency)
+			return &stats->wake_latency;
+		break;
+	}
+
+	return NULL;
+}
+
+_public_ uint64_t
+js_stats_get_latency_count(struct js_stats *stats,
+			   enum js_stats_latency latency)
+{
+	const struct js_histogram *h = stats_histogram(stats, latency);
+
+	return h ? h->count : 0;
+}
+
+_public_ uint64_t
+js_stats_get_latency_percentile(struct js_stats *stats,
+				enum js_stats_latency latency,
+				double percentile)
+{
+	const struct js_histogram *h = stats_histogram(stats, latency);
+
+	return h ? js_histogram_percentile(h, percentile) : 0;
+}
+
+_public_ unsigned int
+js_stats_get_latency_bucket_count(struct js_stats *stats,
+				  enum js_stats_latency latency)
+{
+	const struct js_histogram *h = stats_histogram(stats, latency);
+
+	return h ? js_histogram_get_bucket_count(h) : 0;
+}
+
+_public_ bool
+js_stats_get_latency_bucket(struct js_stats *stats,
+			    enum js_stats_latency latency,
+			    unsigned int index,
+			    uint64_t *upper_bound,
+			    uint64_t *count)
+{
+	const struct js_histogram *h = stats_histogram(stats, latency);
+
+	return h && js_histogram_get_bucket(h, index, upper_bound, count);
+}
+
+_public_ bool
+js_stats_get_stage_cost(struct js_stats *stats,
+			enum js_stats_stage stage,
+			uint64_t *cycles,
+			uint64_t *instructions,
+			uint64_t *events)
+{
+	const struct js_stage_cost *cost;
+
+	if (!stats->have_stage_cost)
+		return false;
+
+	switch (stage) {
+	case JS_STATS_STAGE_READ:
+		cost = &stats->stage_cost[JS_STAGE_READ];
+		break;
+	case JS_STATS_STAGE_DECODE:
+		cost = &stats->stage_cost[JS_STAGE_DECODE];
+		break;
+	case JS_STATS_STAGE_QUEUE:
+		cost = &stats->stage_cost[JS_STAGE_QUEUE];
+		break;
+	default:
+		return false;
+	}
+
+	*cycles = cost->cycles;
+	*instructions = cost->instructions;
+	*events = cost->events;
+
+	return true;
+}
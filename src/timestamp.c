@@ -0,0 +1,163 @@
+/*
+ * Copyright © 2019 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#include "config.h"
+
+#include <errno.h>
+
+#include "libjoystick-private.h"
+
+/* The clock fit forgets old reports with this weight per report, i.e. it
+ * covers the last ~16 seconds of a 250 Hz device */
+#define CLOCK_DECAY (1.0 - 1.0 / 4096)
+#define CLOCK_MIN_SAMPLES 16
+
+/* Like RFC 3550, the jitter is smoothed over ~16 reports */
+#define JITTER_GAIN (1.0 / 16)
+
+static void
+timestamp_update_link(struct js_device *device,
+		      uint32_t delta,
+		      int64_t host_delta)
+{
+	struct js_device_clock *c = &device->clock;
+	double d = (double)(host_delta - (int64_t)delta);
+
+	c->jitter += ((d < 0 ? -d : d) - c->jitter) * JITTER_GAIN;
+#if HAVE_STATISTICS
+	device->stats.report_jitter = (uint64_t)c->jitter;
+#endif
+
+	if (delta == 0)
+		return;
+
+	/* The nominal interval is the usual distance between reports.
+	 * A much shorter one means our estimate was off, a much longer
+	 * one is a gap of lost reports */
+	if (c->interval == 0 || (uint64_t)delta * 3 < (uint64_t)c->interval * 2) {
+		c->interval = delta;
+	} else if ((uint64_t)delta * 2 > (uint64_t)c->interval * 3) {
+		js_stats_add(device, timestamp_gaps, 1);
+		js_stats_add(device, reports_lost,
+			     (delta + c->interval / 2) / c->interval - 1);
+	} else {
+		c->interval += ((int64_t)delta - c->interval) / 16;
+	}
+}
+
+static inline int64_t
+round_offset(double offset)
+{
+	return (int64_t)(offset < 0 ? offset - 0.5 : offset + 0.5);
+}
+
+/* Add a sample of y = host - device - offset_base at x = 0 s, after
+ * moving the previous samples dx seconds into the past */
+static void
+timestamp_fit(struct js_device *device, double dx, double y)
+{
+	struct js_device_clock *c = &device->clock;
+	double den;
+	int64_t shift;
+
+	c->w *= CLOCK_DECAY;
+	c->wx *= CLOCK_DECAY;
+	c->wxx *= CLOCK_DECAY;
+	c->wy *= CLOCK_DECAY;
+	c->wxy *= CLOCK_DECAY;
+
+	c->wxx += dx * (dx * c->w - 2 * c->wx);
+	c->wxy -= dx * c->wy;
+	c->wx -= dx * c->w;
+
+	c->w += 1;
+	c->wy += y;
+
+	den = c->w * c->wxx - c->wx * c->wx;
+	c->drift = den > 0 ? (c->w * c->wxy - c->wx * c->wy) / den : 0;
+	c->offset = (c->wy - c->drift * c->wx) / c->w;
+
+	/* Keep y close to zero so the sums do not lose precision */
+	shift = (int64_t)c->offset;
+	c->offset_base += shift;
+	c->offset -= shift;
+	c->wy -= shift * c->w;
+	c->wxy -= shift * c->wx;
+}
+
+void
+timestamp_update(struct js_device *device, uint64_t time)
+{
+	struct js_device_clock *c = &device->clock;
+	uint32_t raw = c->pending_raw;
+	double dx = 0;
+
+	device->frame.has_device_time = c->pending;
+	if (!c->pending)
+		return;
+
+	c->pending = false;
+
+	if (c->nsamples == 0) {
+		c->device_time = raw;
+		c->offset_base = (int64_t)time - (int64_t)raw;
+	} else {
+		/* The timestamp is a wrapping 32-bit µs counter */
+		uint32_t delta = raw - c->last_raw;
+
+		if (!c->resync)
+			timestamp_update_link(device, delta,
+					      (int64_t)(time - c->host_time));
+
+		c->device_time += delta;
+		dx = delta / 1e6;
+	}
+
+	timestamp_fit(device, dx,
+		      (double)((int64_t)time - (int64_t)c->device_time -
+			       c->offset_base));
+
+	c->nsamples++;
+	c->last_raw = raw;
+	c->host_time = time;
+	c->resync = false;
+	js_stats_add(device, timestamped_reports, 1);
+
+	device->frame.device_time = c->device_time;
+	if (c->nsamples >= CLOCK_MIN_SAMPLES)
+		device->frame.corrected_time = c->device_time + c->offset_base +
+					       round_offset(c->offset);
+	else
+		device->frame.corrected_time = time;
+}
+
+_public_ int
+js_device_get_clock_estimate(struct js_device *device,
+			     int64_t *offset_usec,
+			     double *drift_ppm)
+{
+	if (device->clock.nsamples < CLOCK_MIN_SAMPLES)
+		return -ENODATA;
+
+	*offset_usec = device->clock.offset_base +
+		       round_offset(device->clock.offset);
+	*drift_ppm = device->clock.drift;
+
+	return 0;
+}
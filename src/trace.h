@@ -0,0 +1,41 @@
+/*
+ * Copyright © 2019 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#pragma once
+
+#include "config.h"
+
+/*
+ * USDT probes, see the "Tracing" section in the README for the list.
+ *
+ * Each probe compiles to a single nop and a note in the .note.stapsdt
+ * section, the arguments are only evaluated into registers. bpftrace or
+ * perf patch the nop into a breakpoint when a probe is attached:
+ *
+ *     bpftrace -e 'usdt:/usr/lib64/libjoystick.so:libjoystick:frame_decoded { @[arg1] = count(); }'
+ *
+ * Without sys/sdt.h the probes compile to nothing and their arguments
+ * are not evaluated.
+ */
+#if HAVE_USDT
+#include <sys/sdt.h>
+#define js_trace(probe_, ...) STAP_PROBEV(libjoystick, probe_, ##__VA_ARGS__)
+#else
+#define js_trace(probe_, ...) do { } while (0)
+#endif
@@ -0,0 +1,674 @@
+/*
+ * Copyright © 2019 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "libjoystick-private.h"
+
+#if HAVE_UDEV
+#include <libudev.h>
+
+#define DEFAULT_SEAT "seat0"
+#define MAX_PLAYER_LEDS 8
+
+struct udev_ctx {
+	struct js_ctx base;
+
+	struct udev *udev;
+	struct udev_monitor *monitor;
+	struct js_source *monitor_source;
+	char *seat;
+};
+
+struct udev_js_device {
+	struct js_device base;
+
+	char *syspath;
+	char *hid_syspath;		/* NULL if not a HID device */
+	char *battery_syspath;		/* NULL if no battery */
+
+	/* Files of the LED class devices of the HID device, -1 if missing.
+	 * The lightbar is either a multicolor LED with multi_intensity and
+	 * brightness or three LEDs with a brightness each. */
+	int player_fds[MAX_PLAYER_LEDS];
+	uint32_t player_written;	/* valid if player_known */
+	bool player_known;
+	int lightbar_fds[3];
+	bool lightbar_multicolor;
+	bool lightbar_on;
+};
+
+static inline struct udev_ctx *
+udev_ctx(struct js_ctx *ctx)
+{
+	return container_of(ctx, struct udev_ctx, base);
+}
+
+static inline struct udev_js_device *
+udev_js_device(struct js_device *device)
+{
+	return container_of(device, struct udev_js_device, base);
+}
+
+static void
+close_fds(int *fds, size_t nfds)
+{
+	for (size_t i = 0; i < nfds; i++) {
+		if (fds[i] != -1)
+			close(fds[i]);
+		fds[i] = -1;
+	}
+}
+
+static void
+udev_device_remove(struct js_device *device)
+{
+	struct udev_js_device *d = udev_js_device(device);
+
+	js_ctx_close_restricted(device->ctx, device->fd);
+	close_fds(d->player_fds, ARRAY_LENGTH(d->player_fds));
+	close_fds(d->lightbar_fds, ARRAY_LENGTH(d->lightbar_fds));
+}
+
+static void
+udev_device_destroy(struct js_device *device)
+{
+	struct udev_js_device *d = udev_js_device(device);
+
+	/* Not removed if evdev_device_added() failed */
+	close_fds(d->player_fds, ARRAY_LENGTH(d->player_fds));
+	close_fds(d->lightbar_fds, ARRAY_LENGTH(d->lightbar_fds));
+	zfree(d->syspath);
+	zfree(d->hid_syspath);
+	zfree(d->battery_syspath);
+}
+
+static int
+led_write(struct js_device *device, int fd, const char *value)
+{
+	js_stats_add(device, syscalls, 1);
+	if (pwrite(fd, value, strlen(value), 0) < 0)
+		return -errno;
+
+	return 0;
+}
+
+static int
+udev_device_write_player_indicator(struct udev_js_device *d)
+{
+	struct js_device *device = &d->base;
+	uint32_t mask = device->output.player_indicator;
+	int rc;
+
+	/* Only the LEDs that change, all of them after a failure */
+	for (size_t i = 0; i < ARRAY_LENGTH(d->player_fds); i++) {
+		uint32_t bit = 1U << i;
+
+		if (d->player_fds[i] == -1 ||
+		    (d->player_known &&
+		     (mask & bit) == (d->player_written & bit)))
+			continue;
+
+		rc = led_write(device, d->player_fds[i],
+			       (mask & bit) ? "1" : "0");
+		if (rc < 0) {
+			d->player_known = false;
+			return rc;
+		}
+	}
+
+	d->player_written = mask;
+	d->player_known = true;
+	return 0;
+}
+
+static int
+udev_device_write_lightbar(struct udev_js_device *d)
+{
+	struct js_device *device = &d->base;
+	const uint8_t *color = device->output.lightbar;
+	char value[16];
+	int rc;
+
+	if (!d->lightbar_multicolor) {
+		for (size_t i = 0; i < 3; i++) {
+			snprintf(value, sizeof(value), "%u", color[i]);
+			rc = led_write(device, d->lightbar_fds[i], value);
+			if (rc < 0)
+				return rc;
+		}
+		return 0;
+	}
+
+	snprintf(value, sizeof(value), "%u %u %u",
+		 color[0], color[1], color[2]);
+	rc = led_write(device, d->lightbar_fds[0], value);
+	if (rc < 0)
+		return rc;
+
+	/* The intensities are scaled by the brightness, set it to the
+	 * maximum once */
+	if (!d->lightbar_on) {
+		rc = led_write(device, d->lightbar_fds[1], "255");
+		if (rc < 0)
+			return rc;
+		d->lightbar_on = true;
+	}
+
+	return 0;
+}
+
+static int
+udev_device_write_output(struct js_device *device, enum js_output output)
+{
+	struct udev_js_device *d = udev_js_device(device);
+
+	switch (output) {
+	case JS_OUTPUT_PLAYER_INDICATOR:
+		return udev_device_write_player_indicator(d);
+	case JS_OUTPUT_LIGHTBAR:
+		return udev_device_write_lightbar(d);
+	default:
+		return -ENOTSUP;
+	}
+}
+
+static const struct js_device_interface udev_device_interface = {
+	.sync_state = evdev_device_sync_state_fd,
+	.upload_effect = evdev_device_upload_effect_fd,
+	.erase_effect = evdev_device_erase_effect_fd,
+	.write_events = evdev_device_write_fd,
+	.set_event_mask = evdev_device_set_event_mask_fd,
+	.write_output = udev_device_write_output,
+	.remove = udev_device_remove,
+	.destroy = udev_device_destroy,
+};
+
+/* sysfs attributes are not device nodes, open_restricted implementations
+ * like logind's TakeDevice cannot open them */
+static int
+led_open(struct udev_device *led, const char *attribute)
+{
+	char path[PATH_MAX];
+
+	snprintf(path, sizeof(path), "%s/%s",
+		 udev_device_get_syspath(led), attribute);
+
+	return open(path, O_WRONLY | O_CLOEXEC);
+}
+
+static void
+udev_device_add_led(struct udev_js_device *d, struct udev_device *led)
+{
+	const char *name = udev_device_get_sysname(led);
+	const char *function = strrchr(name, ':');
+	unsigned int player;
+
+	/* LED class names are devicename:color:function, hid-sony uses
+	 * devicename:color for the lightbar */
+	if (!function)
+		return;
+
+	if (sscanf(function, ":player-%u", &player) == 1) {
+		if (player >= 1 && player <= MAX_PLAYER_LEDS &&
+		    d->player_fds[player - 1] == -1)
+			d->player_fds[player - 1] = led_open(led, "brightness");
+	} else if (streq(function, ":indicator") && strstr(name, ":rgb:")) {
+		close_fds(d->lightbar_fds, ARRAY_LENGTH(d->lightbar_fds));
+		d->lightbar_fds[0] = led_open(led, "multi_intensity");
+		d->lightbar_fds[1] = led_open(led, "brightness");
+		d->lightbar_multicolor = true;
+	} else if (!d->lightbar_multicolor) {
+		static const char *colors[] = { ":red", ":green", ":blue" };
+
+		for (size_t i = 0; i < ARRAY_LENGTH(colors); i++) {
+			if (streq(function, colors[i]) &&
+			    d->lightbar_fds[i] == -1)
+				d->lightbar_fds[i] = led_open(led, "brightness");
+		}
+	}
+}
+
+/* The LEDs are children of the HID device, not the input device. An LED
+ * we cannot open for writing is treated as missing. */
+static void
+udev_device_find_leds(struct udev_js_device *d,
+		      struct udev_device *udev_device)
+{
+	struct udev *udev = udev_device_get_udev(udev_device);
+	struct udev_device *hid;
+	struct udev_enumerate *e;
+	struct udev_list_entry *entry;
+
+	hid = udev_device_get_parent_with_subsystem_devtype(udev_device,
+							    "hid", NULL);
+	if (!hid)
+		return;
+
+	e = udev_enumerate_new(udev);
+	if (!e)
+		return;
+
+	udev_enumerate_add_match_subsystem(e, "leds");
+	udev_enumerate_add_match_parent(e, hid);
+	udev_enumerate_scan_devices(e);
+
+	udev_list_entry_foreach(entry, udev_enumerate_get_list_entry(e)) {
+		struct udev_device *led;
+
+		led = udev_device_new_from_syspath(udev,
+						   udev_list_entry_get_name(entry));
+		if (!led)
+			continue;
+
+		udev_device_add_led(d, led);
+		udev_device_unref(led);
+	}
+
+	udev_enumerate_unref(e);
+
+	for (size_t i = 0; i < ARRAY_LENGTH(d->player_fds); i++) {
+		if (d->player_fds[i] != -1)
+			d->base.output.supported |=
+				js_output_bit(JS_OUTPUT_PLAYER_INDICATOR);
+	}
+
+	if (d->lightbar_fds[0] != -1 && d->lightbar_fds[1] != -1 &&
+	    (d->lightbar_multicolor || d->lightbar_fds[2] != -1))
+		d->base.output.supported |= js_output_bit(JS_OUTPUT_LIGHTBAR);
+}
+
+static bool
+is_battery(struct udev_device *supply)
+{
+	const char *type, *scope;
+
+	type = udev_device_get_property_value(supply, "POWER_SUPPLY_TYPE");
+	scope = udev_device_get_property_value(supply, "POWER_SUPPLY_SCOPE");
+
+	return type && streq(type, "Battery") &&
+	       scope && streq(scope, "Device");
+}
+
+/* The values come from the uevent's properties. When the device is
+ * added, libudev reads them once from the supply's uevent file, after
+ * that only from udev's change events */
+static void
+udev_device_update_battery(struct udev_js_device *d,
+			   struct udev_device *supply)
+{
+	enum js_battery_status status = JS_BATTERY_STATUS_UNKNOWN;
+	const char *value;
+	int percent = -1;
+
+	value = udev_device_get_property_value(supply, "POWER_SUPPLY_STATUS");
+	if (value) {
+		if (streq(value, "Discharging"))
+			status = JS_BATTERY_STATUS_DISCHARGING;
+		else if (streq(value, "Not charging"))
+			status = JS_BATTERY_STATUS_NOT_CHARGING;
+		else if (streq(value, "Charging"))
+			status = JS_BATTERY_STATUS_CHARGING;
+		else if (streq(value, "Full"))
+			status = JS_BATTERY_STATUS_FULL;
+	}
+
+	value = udev_device_get_property_value(supply, "POWER_SUPPLY_CAPACITY");
+	if (value) {
+		char *end;
+		long v = strtol(value, &end, 10);
+
+		if (end != value && *end == '\0' && v >= 0 && v <= 100)
+			percent = v;
+	}
+
+	if (!d->battery_syspath)
+		d->battery_syspath = safe_strdup(udev_device_get_syspath(supply));
+
+	evdev_device_set_battery(&d->base, true, status, percent);
+}
+
+/* Like the LEDs, the battery of a gamepad is a power_supply child of the
+ * HID device */
+static void
+udev_device_find_battery(struct udev_js_device *d)
+{
+	struct udev *udev = udev_ctx(d->base.ctx)->udev;
+	struct udev_device *hid;
+	struct udev_enumerate *e;
+	struct udev_list_entry *entry;
+
+	if (!d->hid_syspath)
+		return;
+
+	hid = udev_device_new_from_syspath(udev, d->hid_syspath);
+	if (!hid)
+		return;
+
+	e = udev_enumerate_new(udev);
+	if (!e) {
+		udev_device_unref(hid);
+		return;
+	}
+
+	udev_enumerate_add_match_subsystem(e, "power_supply");
+	udev_enumerate_add_match_parent(e, hid);
+	udev_enumerate_scan_devices(e);
+
+	udev_list_entry_foreach(entry, udev_enumerate_get_list_entry(e)) {
+		struct udev_device *supply;
+
+		supply = udev_device_new_from_syspath(udev,
+						      udev_list_entry_get_name(entry));
+		if (!supply)
+			continue;
+
+		if (is_battery(supply))
+			udev_device_update_battery(d, supply);
+		udev_device_unref(supply);
+
+		if (d->battery_syspath)
+			break;
+	}
+
+	udev_enumerate_unref(e);
+	udev_device_unref(hid);
+}
+
+static void
+udev_ctx_device_added(struct udev_ctx *uctx, struct udev_device *udev_device)
+{
+	struct js_ctx *ctx = &uctx->base;
+	struct udev_js_device *d;
+	struct udev_device *hid;
+	struct libevdev *evdev;
+	const char *devnode, *seat, *joystick;
+	int fd, rc;
+
+	devnode = udev_device_get_devnode(udev_device);
+	if (!devnode || !strneq(devnode, "/dev/input/event", 16))
+		return;
+
+	joystick = udev_device_get_property_value(udev_device,
+						  "ID_INPUT_JOYSTICK");
+	if (!joystick || !streq(joystick, "1"))
+		return;
+
+	seat = udev_device_get_property_value(udev_device, "ID_SEAT");
+	if (!seat)
+		seat = DEFAULT_SEAT;
+	if (!streq(seat, uctx->seat))
+		return;
+
+	fd = evdev_device_open(ctx, devnode, &evdev);
+	if (fd < 0)
+		return;
+
+	d = js_ctx_new_device(ctx, sizeof *d);
+	if (!d) {
+		js_log_error(ctx, "%s: too many devices\n", devnode);
+		js_ctx_close_restricted(ctx, fd);
+		libevdev_free(evdev);
+		return;
+	}
+	d->syspath = safe_strdup(udev_device_get_syspath(udev_device));
+	hid = udev_device_get_parent_with_subsystem_devtype(udev_device,
+							    "hid", NULL);
+	if (hid)
+		d->hid_syspath = safe_strdup(udev_device_get_syspath(hid));
+	for (size_t i = 0; i < ARRAY_LENGTH(d->player_fds); i++)
+		d->player_fds[i] = -1;
+	for (size_t i = 0; i < ARRAY_LENGTH(d->lightbar_fds); i++)
+		d->lightbar_fds[i] = -1;
+
+	evdev_device_init(&d->base, ctx, evdev, fd, &udev_device_interface);
+	evdev_device_classify(&d->base);
+	udev_device_find_leds(d, udev_device);
+	udev_device_find_battery(d);
+
+	rc = evdev_device_added(&d->base);
+	if (rc != 0) {
+		js_log_error(ctx, "%s: failed to add device (%s)\n",
+			     devnode, strerror(-rc));
+		js_ctx_close_restricted(ctx, fd);
+		js_device_unref(&d->base);
+	}
+}
+
+static void
+udev_ctx_device_removed(struct udev_ctx *uctx, struct udev_device *udev_device)
+{
+	struct js_device *device, *tmp;
+	const char *syspath = udev_device_get_syspath(udev_device);
+
+	list_for_each_safe(device, tmp, &uctx->base.devices, link) {
+		if (streq(udev_js_device(device)->syspath, syspath)) {
+			evdev_device_removed(device);
+			break;
+		}
+	}
+}
+
+static bool
+is_child_of(const char *syspath, const char *parent)
+{
+	size_t len = strlen(parent);
+
+	return strneq(syspath, parent, len) && syspath[len] == '/';
+}
+
+static void
+udev_ctx_power_supply_changed(struct udev_ctx *uctx,
+			      struct udev_device *supply,
+			      const char *action)
+{
+	const char *syspath = udev_device_get_syspath(supply);
+	struct js_device *device;
+
+	list_for_each(device, &uctx->base.devices, link) {
+		struct udev_js_device *d = udev_js_device(device);
+
+		if (d->battery_syspath) {
+			if (!streq(d->battery_syspath, syspath))
+				continue;
+		} else if (!d->hid_syspath ||
+			   !is_child_of(syspath, d->hid_syspath) ||
+			   !is_battery(supply)) {
+			continue;
+		}
+
+		if (streq(action, "remove")) {
+			zfree(d->battery_syspath);
+			evdev_device_set_battery(device, false,
+						 JS_BATTERY_STATUS_UNKNOWN, -1);
+		} else {
+			udev_device_update_battery(d, supply);
+		}
+	}
+}
+
+static void
+udev_ctx_dispatch(void *data)
+{
+	struct udev_ctx *uctx = data;
+	struct udev_device *udev_device;
+	const char *action, *subsystem;
+
+	udev_device = udev_monitor_receive_device(uctx->monitor);
+	if (!udev_device)
+		return;
+
+	action = udev_device_get_action(udev_device);
+	subsystem = udev_device_get_subsystem(udev_device);
+	if (action && subsystem && streq(subsystem, "power_supply")) {
+		udev_ctx_power_supply_changed(uctx, udev_device, action);
+	} else if (action) {
+		if (streq(action, "add"))
+			udev_ctx_device_added(uctx, udev_device);
+		else if (streq(action, "remove"))
+			udev_ctx_device_removed(uctx, udev_device);
+	}
+
+	udev_device_unref(udev_device);
+}
+
+static int
+udev_ctx_enable_monitor(struct udev_ctx *uctx)
+{
+	int fd;
+
+	uctx->monitor = udev_monitor_new_from_netlink(uctx->udev, "udev");
+	if (!uctx->monitor)
+		return -ENOMEM;
+
+	udev_monitor_filter_add_match_subsystem_devtype(uctx->monitor,
+							"input",
+							NULL);
+	udev_monitor_filter_add_match_subsystem_devtype(uctx->monitor,
+							"power_supply",
+							NULL);
+
+	if (udev_monitor_enable_receiving(uctx->monitor) < 0)
+		return -EIO;
+
+	fd = udev_monitor_get_fd(uctx->monitor);
+	uctx->monitor_source = js_ctx_add_fd(&uctx->base, fd,
+					     udev_ctx_dispatch, uctx);
+	if (!uctx->monitor_source)
+		return -errno;
+
+	return 0;
+}
+
+static int
+udev_ctx_enumerate(struct udev_ctx *uctx)
+{
+	struct udev_enumerate *e;
+	struct udev_list_entry *entry;
+
+	e = udev_enumerate_new(uctx->udev);
+	if (!e)
+		return -ENOMEM;
+
+	udev_enumerate_add_match_subsystem(e, "input");
+	udev_enumerate_scan_devices(e);
+
+	udev_list_entry_foreach(entry, udev_enumerate_get_list_entry(e)) {
+		struct udev_device *udev_device;
+		const char *path = udev_list_entry_get_name(entry);
+
+		udev_device = udev_device_new_from_syspath(uctx->udev, path);
+		if (!udev_device)
+			continue;
+
+		udev_ctx_device_added(uctx, udev_device);
+		udev_device_unref(udev_device);
+	}
+
+	udev_enumerate_unref(e);
+
+	return 0;
+}
+
+static void
+udev_ctx_destroy(struct js_ctx *ctx)
+{
+	struct udev_ctx *uctx = udev_ctx(ctx);
+
+	if (uctx->monitor_source)
+		js_ctx_remove_source(ctx, uctx->monitor_source);
+	udev_monitor_unref(uctx->monitor);
+	udev_unref(uctx->udev);
+	zfree(uctx->seat);
+}
+
+static const struct js_backend_interface udev_backend_interface = {
+	.destroy = udev_ctx_destroy,
+	.device_size = sizeof(struct udev_js_device),
+};
+
+_public_ struct js_ctx *
+js_ctx_udev_create_context(const struct js_interface *interface,
+			   void *userdata)
+{
+	struct udev_ctx *uctx;
+
+	if (!interface ||
+	    !interface->open_restricted ||
+	    !interface->close_restricted)
+		return NULL;
+
+	uctx = zalloc(sizeof *uctx);
+	uctx->udev = udev_new();
+	if (!uctx->udev) {
+		zfree(uctx);
+		return NULL;
+	}
+
+	if (js_ctx_init(&uctx->base, interface, userdata,
+			&udev_backend_interface) != 0) {
+		udev_unref(uctx->udev);
+		zfree(uctx);
+		return NULL;
+	}
+
+	return &uctx->base;
+}
+
+_public_ int
+js_ctx_udev_assign_seat(struct js_ctx *ctx, const char *seat)
+{
+	struct udev_ctx *uctx = udev_ctx(ctx);
+	int rc;
+
+	if (ctx->backend != &udev_backend_interface)
+		return -EINVAL;
+
+	if (uctx->seat)
+		return -EBUSY;
+
+	uctx->seat = safe_strdup(seat ? seat : DEFAULT_SEAT);
+
+	rc = udev_ctx_enable_monitor(uctx);
+	if (rc != 0)
+		return rc;
+
+	return udev_ctx_enumerate(uctx);
+}
+#else
+/* Built without udev, only path contexts are available */
+_public_ struct js_ctx *
+js_ctx_udev_create_context(const struct js_interface *interface,
+			   void *userdata)
+{
+	return NULL;
+}
+
+_public_ int
+js_ctx_udev_assign_seat(struct js_ctx *ctx, const char *seat)
+{
+	return -ENOSYS;
+}
+#endif
@@ -0,0 +1,224 @@
+/*
+ * Copyright © 2019 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#pragma once
+
+#include "config.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define ARRAY_LENGTH(a) (sizeof (a) / sizeof (a)[0])
+#define ARRAY_FOR_EACH(_arr, _elem) \
+	for (size_t _i = 0; _i < ARRAY_LENGTH(_arr) && (_elem = &_arr[_i]); _i++)
+
+#define min(a, b) (((a) < (b)) ? (a) : (b))
+#define max(a, b) (((a) > (b)) ? (a) : (b))
+
+#define LONG_BITS (sizeof(unsigned long) * 8)
+#define NLONGS(x) (((x) + LONG_BITS - 1) / LONG_BITS)
+
+#define container_of(ptr, type, member)					\
+	(__typeof__(type) *)((char *)(ptr) -				\
+		 offsetof(__typeof__(type), member))
+
+#define _public_ __attribute__((visibility("default")))
+#define _unused_ __attribute__((unused))
+
+#define streq(s1, s2) (strcmp((s1), (s2)) == 0)
+#define strneq(s1, s2, n) (strncmp((s1), (s2), (n)) == 0)
+
+/*
+ * This list data structure is a verbatim copy from wayland-util.h from the
+ * Wayland project; except that wl_ prefix has been removed.
+ */
+
+struct list {
+	struct list *prev;
+	struct list *next;
+};
+
+void list_init(struct list *list);
+void list_insert(struct list *list, struct list *elm);
+void list_append(struct list *list, struct list *elm);
+void list_remove(struct list *elm);
+bool list_empty(const struct list *list);
+
+#define list_first_entry(head, pos, member)				\
+	container_of((head)->next, __typeof__(*pos), member)
+
+#define list_for_each(pos, head, member)				\
+	for (pos = 0, pos = list_first_entry(head, pos, member);	\
+	     &pos->member != (head);					\
+	     pos = list_first_entry(&pos->member, pos, member))
+
+#define list_for_each_safe(pos, tmp, head, member)			\
+	for (pos = 0, tmp = 0,						\
+	     pos = list_first_entry(head, pos, member),			\
+	     tmp = list_first_entry(&pos->member, tmp, member);		\
+	     &pos->member != (head);					\
+	     pos = tmp,							\
+	     tmp = list_first_entry(&pos->member, tmp, member))
+
+/* The allocator used by zalloc() and zfree(), libc's if the hooks are
+ * NULL */
+struct alloc_hooks {
+	void *(*malloc)(size_t size, void *user_data);
+	void (*free)(void *ptr, void *user_data);
+	void *user_data;
+};
+
+extern struct alloc_hooks alloc_hooks;
+
+/* We never need to alloc anything more than 1,5 MB so we can assume
+ * if we ever get above that something's going wrong */
+#define ZALLOC_MAX (1536 * 1024)
+
+/* Like zalloc() but returns NULL if the allocation fails, for the few
+ * callers that can report the failure */
+static inline void *
+try_zalloc(size_t size)
+{
+	void *p;
+
+	if (size > ZALLOC_MAX)
+		abort();
+
+	if (alloc_hooks.malloc) {
+		p = alloc_hooks.malloc(size, alloc_hooks.user_data);
+		if (p)
+			memset(p, 0, size);
+	} else {
+		p = calloc(1, size);
+	}
+
+	return p;
+}
+
+static inline void *
+zalloc(size_t size)
+{
+	void *p = try_zalloc(size);
+
+	if (!p)
+		abort();
+
+	return p;
+}
+
+/* Free memory allocated with zalloc() or safe_strdup() */
+static inline void
+zfree(void *p)
+{
+	if (!p)
+		return;
+
+	if (alloc_hooks.free)
+		alloc_hooks.free(p, alloc_hooks.user_data);
+	else
+		free(p);
+}
+
+static inline char *
+safe_strdup(const char *str)
+{
+	size_t len;
+	char *s;
+
+	if (!str)
+		return NULL;
+
+	len = strlen(str) + 1;
+	s = zalloc(len);
+	memcpy(s, str, len);
+	return s;
+}
+
+static inline bool
+long_bit_is_set(const unsigned long *array, int bit)
+{
+	return !!(array[bit / LONG_BITS] & (1ULL << (bit % LONG_BITS)));
+}
+
+static inline void
+long_set_bit(unsigned long *array, int bit)
+{
+	array[bit / LONG_BITS] |= (1ULL << (bit % LONG_BITS));
+}
+
+static inline void
+long_clear_bit(unsigned long *array, int bit)
+{
+	array[bit / LONG_BITS] &= ~(1ULL << (bit % LONG_BITS));
+}
+
+static inline void
+long_set_bit_state(unsigned long *array, int bit, int state)
+{
+	if (state)
+		long_set_bit(array, bit);
+	else
+		long_clear_bit(array, bit);
+}
+
+static inline bool
+long_any_bit_set(const unsigned long *array, size_t size)
+{
+	for (size_t i = 0; i < size; i++)
+		if (array[i] != 0)
+			return true;
+	return false;
+}
+
+static inline uint64_t
+us(uint64_t us)
+{
+	return us;
+}
+
+static inline uint64_t
+ms2us(uint64_t ms)
+{
+	return us(ms * 1000);
+}
+
+static inline uint64_t
+s2us(uint64_t s)
+{
+	return ms2us(s * 1000);
+}
+
+static inline uint64_t
+tv2us(const struct timeval *tv)
+{
+	return s2us(tv->tv_sec) + tv->tv_usec;
+}
+
+static inline uint64_t
+now_in_us(void)
+{
+	struct timespec ts = { 0, 0 };
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return s2us(ts.tv_sec) + ts.tv_nsec / 1000;
+}
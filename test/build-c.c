@@ -1,4 +1,5 @@
 #include <libjoystick.h>
+#include <libjoystick-inline.h>
 
 /* This is a build-test only */
 
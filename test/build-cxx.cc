@@ -1,4 +1,6 @@
 #include <libjoystick.h>
+#include <libjoystick-inline.h>
+#include <libjoystick.hpp>
 
 /* This is a build-test only */
 
@@ -0,0 +1,1013 @@
+/*
+ * Copyright © 2019 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#include "config.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "libjoystick-private.h"
+#include "mock-backend.h"
+
+#define MOCK_BUFFER_SIZE 128
+#define MOCK_FF_EFFECTS 16
+
+enum mock_action {
+	MOCK_ACTION_NONE = 0,
+	MOCK_ACTION_PLUG,
+	MOCK_ACTION_UNPLUG,
+	MOCK_ACTION_POWER,
+};
+
+struct mock_ctx {
+	struct js_ctx base;
+
+	int monitor_fd[2];
+	struct js_source *monitor_source;
+	struct list pending;		/* mock_device.pending_link */
+};
+
+struct mock_device {
+	struct js_device base;
+
+	int write_fd;
+
+	/* The state as the kernel would see it */
+	unsigned long keys[NLONGS(KEY_CNT)];
+	int32_t abs[ABS_CNT];
+
+	struct input_event buffer[MOCK_BUFFER_SIZE];
+	size_t nevents;
+
+	struct list pending_link;
+	enum mock_action pending_action;
+
+	/* The power_supply's uevent properties */
+	struct {
+		bool present;
+		enum js_battery_status status;
+		int percent;
+	} battery;
+
+	/* Force feedback, as the driver would see it */
+	struct {
+		struct ff_effect effect;
+		bool used;
+		bool playing;
+	} ff_effects[MOCK_FF_EFFECTS];
+	uint16_t ff_gain;
+	struct mock_ff_counts ff_counts;
+
+	/* EVIOCSMASK, events of other types are always delivered */
+	unsigned long key_mask[NLONGS(KEY_CNT)];
+	unsigned long abs_mask[NLONGS(ABS_CNT)];
+	unsigned long msc_mask[NLONGS(MSC_CNT)];
+	int mask_error;
+
+	/* LED outputs */
+	uint32_t player_indicator;
+	uint8_t lightbar[3];
+	unsigned int output_writes;
+	int output_error;
+};
+
+static void
+_mock_abort(const char *file, int line, const char *format, ...)
+	__attribute__((format(printf, 3, 4), noreturn));
+
+static void
+_mock_abort(const char *file, int line, const char *format, ...)
+{
+	va_list args;
+
+	fprintf(stderr, "%s:%d: ", file, line);
+	va_start(args, format);
+	vfprintf(stderr, format, args);
+	va_end(args);
+	fprintf(stderr, "\n");
+	abort();
+}
+
+#define mock_abort(...) _mock_abort(__FILE__, __LINE__, __VA_ARGS__)
+
+static inline struct mock_ctx *
+mock_ctx(struct js_ctx *ctx)
+{
+	return container_of(ctx, struct mock_ctx, base);
+}
+
+static inline struct mock_device *
+mock_device(struct js_device *device)
+{
+	return container_of(device, struct mock_device, base);
+}
+
+static char *
+mock_data_path(const char *dir, const char *name)
+{
+	char *path;
+	int rc;
+
+	/* Allocated by libc, the caller uses free() */
+	if (strchr(name, '/'))
+		rc = asprintf(&path, "%s", name);
+	else
+		rc = asprintf(&path, "%s/%s/%s.evemu",
+			      JS_TEST_DATA_DIR, dir, name);
+	if (rc < 0)
+		abort();
+
+	return path;
+}
+
+static void
+parse_bitmask_line(struct libevdev *evdev,
+		   const char *line,
+		   unsigned int *current_type,
+		   unsigned int *offset,
+		   unsigned long *abs_bits)
+{
+	unsigned int type, bytes[8];
+	int n;
+
+	n = sscanf(line, "B: %x %x %x %x %x %x %x %x %x",
+		   &type, &bytes[0], &bytes[1], &bytes[2], &bytes[3],
+		   &bytes[4], &bytes[5], &bytes[6], &bytes[7]);
+	if (n < 2)
+		return;
+
+	if (type != *current_type) {
+		*current_type = type;
+		*offset = 0;
+	}
+
+	for (int i = 0; i < n - 1; i++) {
+		for (unsigned int bit = 0; bit < 8; bit++) {
+			unsigned int code = (*offset + i) * 8 + bit;
+
+			if (!(bytes[i] & (1 << bit)))
+				continue;
+
+			switch (type) {
+			case EV_SYN:
+				break;
+			case EV_ABS:
+				/* needs the A: lines for the absinfo */
+				if (code < ABS_CNT)
+					long_set_bit(abs_bits, code);
+				break;
+			case EV_REP:
+				break;
+			default:
+				libevdev_enable_event_code(evdev, type, code, NULL);
+				break;
+			}
+		}
+	}
+	*offset += n - 1;
+}
+
+static struct libevdev *
+mock_parse_description(const char *path)
+{
+	struct libevdev *evdev;
+	FILE *fp;
+	char *line = NULL;
+	size_t size = 0;
+	unsigned int current_type = -1, offset = 0;
+	unsigned long abs_bits[NLONGS(ABS_CNT)] = {0};
+	struct input_absinfo absinfo[ABS_CNT];
+
+	fp = fopen(path, "r");
+	if (!fp)
+		mock_abort("Failed to open %s: %m", path);
+
+	memset(absinfo, 0, sizeof(absinfo));
+
+	evdev = libevdev_new();
+
+	while (getline(&line, &size, fp) != -1) {
+		unsigned int bustype, vendor, product, version;
+		unsigned int prop[8];
+		unsigned int code;
+		int minimum, maximum, fuzz, flat, resolution = 0;
+		int n;
+
+		line[strcspn(line, "\n")] = '\0';
+
+		switch (line[0]) {
+		case 'N':
+			if (strneq(line, "N: ", 3))
+				libevdev_set_name(evdev, &line[3]);
+			break;
+		case 'I':
+			if (sscanf(line, "I: %x %x %x %x",
+				   &bustype, &vendor, &product, &version) != 4)
+				mock_abort("Invalid line '%s' in %s", line, path);
+			libevdev_set_id_bustype(evdev, bustype);
+			libevdev_set_id_vendor(evdev, vendor);
+			libevdev_set_id_product(evdev, product);
+			libevdev_set_id_version(evdev, version);
+			break;
+		case 'P':
+			n = sscanf(line, "P: %x %x %x %x %x %x %x %x",
+				   &prop[0], &prop[1], &prop[2], &prop[3],
+				   &prop[4], &prop[5], &prop[6], &prop[7]);
+			for (int i = 0; i < n; i++) {
+				for (unsigned int bit = 0; bit < 8; bit++) {
+					if (prop[i] & (1 << bit))
+						libevdev_enable_property(evdev, i * 8 + bit);
+				}
+			}
+			break;
+		case 'B':
+			parse_bitmask_line(evdev, line, &current_type,
+					   &offset, abs_bits);
+			break;
+		case 'A':
+			n = sscanf(line, "A: %x %d %d %d %d %d", &code,
+				   &minimum, &maximum, &fuzz, &flat,
+				   &resolution);
+			if (n < 5 || code >= ABS_CNT)
+				mock_abort("Invalid line '%s' in %s", line, path);
+			absinfo[code].minimum = minimum;
+			absinfo[code].maximum = maximum;
+			absinfo[code].fuzz = fuzz;
+			absinfo[code].flat = flat;
+			absinfo[code].resolution = resolution;
+			break;
+		default:
+			break;
+		}
+	}
+
+	for (unsigned int code = 0; code < ABS_CNT; code++) {
+		if (long_bit_is_set(abs_bits, code))
+			libevdev_enable_event_code(evdev, EV_ABS, code,
+						   &absinfo[code]);
+	}
+
+	free(line);
+	fclose(fp);
+
+	return evdev;
+}
+
+static int
+mock_device_sync_state(struct js_device *device,
+		       unsigned long *keys,
+		       int32_t *abs)
+{
+	struct mock_device *d = mock_device(device);
+
+	memcpy(keys, d->keys, sizeof(d->keys));
+	memcpy(abs, d->abs, sizeof(d->abs));
+
+	return 0;
+}
+
+static void
+mock_device_remove(struct js_device *device)
+{
+	struct mock_device *d = mock_device(device);
+
+	close(device->fd);
+	close(d->write_fd);
+	d->write_fd = -1;
+}
+
+static void
+mock_device_destroy(struct js_device *device)
+{
+	struct mock_device *d = mock_device(device);
+
+	if (d->pending_action != MOCK_ACTION_NONE)
+		list_remove(&d->pending_link);
+}
+
+static int
+mock_device_upload_effect(struct js_device *device, struct ff_effect *effect)
+{
+	struct mock_device *d = mock_device(device);
+
+	if (d->write_fd == -1)
+		return -ENODEV;
+
+	if (effect->id == -1) {
+		for (int i = 0; i < MOCK_FF_EFFECTS; i++) {
+			if (!d->ff_effects[i].used) {
+				effect->id = i;
+				break;
+			}
+		}
+		if (effect->id == -1)
+			return -ENOSPC;
+	} else if (effect->id < 0 || effect->id >= MOCK_FF_EFFECTS ||
+		   !d->ff_effects[effect->id].used) {
+		return -EINVAL;
+	}
+
+	d->ff_effects[effect->id].effect = *effect;
+	d->ff_effects[effect->id].used = true;
+	d->ff_counts.uploads++;
+
+	return 0;
+}
+
+static int
+mock_device_erase_effect(struct js_device *device, int id)
+{
+	struct mock_device *d = mock_device(device);
+
+	if (d->write_fd == -1)
+		return -ENODEV;
+
+	if (id < 0 || id >= MOCK_FF_EFFECTS || !d->ff_effects[id].used)
+		return -EINVAL;
+
+	d->ff_effects[id].used = false;
+	d->ff_effects[id].playing = false;
+	d->ff_counts.erases++;
+
+	return 0;
+}
+
+static int
+mock_device_write_events(struct js_device *device,
+			 const struct input_event *events,
+			 size_t count)
+{
+	struct mock_device *d = mock_device(device);
+
+	if (d->write_fd == -1)
+		return -ENODEV;
+
+	for (size_t i = 0; i < count; i++) {
+		const struct input_event *ev = &events[i];
+
+		if (ev->type != EV_FF)
+			continue;
+
+		if (ev->code == FF_GAIN)
+			d->ff_gain = ev->value;
+		else if (ev->code < MOCK_FF_EFFECTS &&
+			 d->ff_effects[ev->code].used)
+			d->ff_effects[ev->code].playing = ev->value != 0;
+		else
+			return -EINVAL;
+	}
+
+	d->ff_counts.writes++;
+
+	return 0;
+}
+
+static int
+mock_device_write_output(struct js_device *device, enum js_output output)
+{
+	struct mock_device *d = mock_device(device);
+	int rc;
+
+	if (d->write_fd == -1)
+		return -ENODEV;
+
+	if (d->output_error) {
+		rc = d->output_error;
+		d->output_error = 0;
+		return rc;
+	}
+
+	switch (output) {
+	case JS_OUTPUT_PLAYER_INDICATOR:
+		d->player_indicator = device->output.player_indicator;
+		break;
+	case JS_OUTPUT_LIGHTBAR:
+		memcpy(d->lightbar, device->output.lightbar,
+		       sizeof(d->lightbar));
+		break;
+	default:
+		mock_abort("Unexpected output %d", output);
+	}
+
+	d->output_writes++;
+
+	return 0;
+}
+
+static unsigned long *
+mock_device_mask(struct mock_device *d, unsigned int type, size_t *ncodes)
+{
+	switch (type) {
+	case EV_KEY:
+		*ncodes = KEY_CNT;
+		return d->key_mask;
+	case EV_ABS:
+		*ncodes = ABS_CNT;
+		return d->abs_mask;
+	case EV_MSC:
+		*ncodes = MSC_CNT;
+		return d->msc_mask;
+	default:
+		return NULL;
+	}
+}
+
+static int
+mock_device_set_event_mask(struct js_device *device,
+			   unsigned int type,
+			   const unsigned long *codes,
+			   size_t ncodes)
+{
+	struct mock_device *d = mock_device(device);
+	unsigned long *mask;
+	size_t n;
+
+	if (d->mask_error)
+		return d->mask_error;
+
+	mask = mock_device_mask(d, type, &n);
+	if (!mask)
+		return -EINVAL;
+
+	memset(mask, 0, NLONGS(n) * sizeof(*mask));
+	memcpy(mask, codes, NLONGS(min(n, ncodes)) * sizeof(*mask));
+
+	return 0;
+}
+
+static const struct js_device_interface mock_device_interface = {
+	.sync_state = mock_device_sync_state,
+	.remove = mock_device_remove,
+	.destroy = mock_device_destroy,
+	.upload_effect = mock_device_upload_effect,
+	.erase_effect = mock_device_erase_effect,
+	.write_events = mock_device_write_events,
+	.write_output = mock_device_write_output,
+	.set_event_mask = mock_device_set_event_mask,
+};
+
+static inline uint64_t
+mock_now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return s2us(ts.tv_sec) * 1000 + ts.tv_nsec;
+}
+
+/* Add the time since *start to *phase and restart */
+static inline void
+mock_time_phase(uint64_t *phase, uint64_t *start)
+{
+	uint64_t now = mock_now_ns();
+
+	*phase += now - *start;
+	*start = now;
+}
+
+static struct mock_device *
+mock_device_create_from_path(struct js_ctx *ctx, const char *path,
+			     struct mock_startup_times *times)
+{
+	struct mock_device *d;
+	struct libevdev *evdev;
+	int fds[2];
+	uint64_t t = mock_now_ns();
+
+	if (pipe2(fds, O_NONBLOCK | O_CLOEXEC) < 0)
+		mock_abort("Failed to create pipe: %m");
+	mock_time_phase(&times->open_ns, &t);
+
+	evdev = mock_parse_description(path);
+	mock_time_phase(&times->probe_ns, &t);
+
+	d = js_ctx_new_device(ctx, sizeof *d);
+	if (!d)
+		mock_abort("Too many devices");
+	d->write_fd = fds[1];
+	memset(d->key_mask, 0xff, sizeof(d->key_mask));
+	memset(d->abs_mask, 0xff, sizeof(d->abs_mask));
+	memset(d->msc_mask, 0xff, sizeof(d->msc_mask));
+
+	for (unsigned int code = 0; code < ABS_CNT; code++) {
+		const struct input_absinfo *absinfo;
+
+		absinfo = libevdev_get_abs_info(evdev, code);
+		if (absinfo)
+			d->abs[code] = absinfo->value;
+	}
+
+	evdev_device_init(&d->base, ctx, evdev, fds[0],
+			  &mock_device_interface);
+	evdev_device_classify(&d->base);
+	mock_time_phase(&times->classify_ns, &t);
+
+	return d;
+}
+
+static struct mock_device *
+mock_device_create(struct js_ctx *ctx, const char *name)
+{
+	struct mock_startup_times times = {0};
+	struct mock_device *d;
+	char *path;
+
+	path = mock_data_path("devices", name);
+	d = mock_device_create_from_path(ctx, path, &times);
+	free(path);
+
+	return d;
+}
+
+static void
+mock_device_add(struct mock_device *d)
+{
+	int rc;
+
+	rc = evdev_device_added(&d->base);
+	if (rc != 0)
+		mock_abort("Failed to add device: %s", strerror(-rc));
+}
+
+static void
+mock_ctx_queue_action(struct mock_device *d, enum mock_action action)
+{
+	struct mock_ctx *mctx = mock_ctx(d->base.ctx);
+	char byte = 0;
+
+	/* The device is gone before its battery changes */
+	if (d->pending_action == MOCK_ACTION_POWER &&
+	    action == MOCK_ACTION_UNPLUG) {
+		list_remove(&d->pending_link);
+		d->pending_action = MOCK_ACTION_NONE;
+	}
+
+	if (d->pending_action != MOCK_ACTION_NONE)
+		mock_abort("Device already has a pending plug/unplug");
+
+	d->pending_action = action;
+	list_append(&mctx->pending, &d->pending_link);
+
+	if (write(mctx->monitor_fd[1], &byte, 1) != 1)
+		mock_abort("Failed to write to the monitor: %m");
+}
+
+static void
+mock_ctx_dispatch(void *data)
+{
+	struct mock_ctx *mctx = data;
+	struct mock_device *d, *tmp;
+	char buf[64];
+
+	while (read(mctx->monitor_fd[0], buf, sizeof(buf)) > 0)
+		;
+
+	list_for_each_safe(d, tmp, &mctx->pending, pending_link) {
+		enum mock_action action = d->pending_action;
+
+		list_remove(&d->pending_link);
+		d->pending_action = MOCK_ACTION_NONE;
+
+		switch (action) {
+		case MOCK_ACTION_PLUG:
+			mock_device_add(d);
+			break;
+		case MOCK_ACTION_UNPLUG:
+			evdev_device_removed(&d->base);
+			break;
+		case MOCK_ACTION_POWER:
+			evdev_device_set_battery(&d->base,
+						 d->battery.present,
+						 d->battery.status,
+						 d->battery.percent);
+			break;
+		default:
+			abort();
+		}
+	}
+}
+
+static void
+mock_ctx_destroy(struct js_ctx *ctx)
+{
+	struct mock_ctx *mctx = mock_ctx(ctx);
+	struct mock_device *d, *tmp;
+
+	/* Plugged but never added */
+	list_for_each_safe(d, tmp, &mctx->pending, pending_link) {
+		list_remove(&d->pending_link);
+		d->pending_action = MOCK_ACTION_NONE;
+		mock_device_remove(&d->base);
+		js_device_unref(&d->base);
+	}
+
+	js_ctx_remove_source(ctx, mctx->monitor_source);
+	close(mctx->monitor_fd[0]);
+	close(mctx->monitor_fd[1]);
+}
+
+static const struct js_backend_interface mock_backend_interface = {
+	.destroy = mock_ctx_destroy,
+	.device_size = sizeof(struct mock_device),
+};
+
+struct js_ctx *
+mock_ctx_new(void)
+{
+	struct mock_ctx *mctx;
+
+	mctx = zalloc(sizeof *mctx);
+	if (js_ctx_init(&mctx->base, NULL, NULL, &mock_backend_interface) != 0)
+		mock_abort("Failed to init context");
+
+	list_init(&mctx->pending);
+
+	if (pipe2(mctx->monitor_fd, O_NONBLOCK | O_CLOEXEC) < 0)
+		mock_abort("Failed to create pipe: %m");
+
+	mctx->monitor_source = js_ctx_add_fd(&mctx->base,
+					     mctx->monitor_fd[0],
+					     mock_ctx_dispatch,
+					     mctx);
+	if (!mctx->monitor_source)
+		mock_abort("Failed to add monitor source: %m");
+
+	return &mctx->base;
+}
+
+struct mock_device *
+mock_device_new(struct js_ctx *ctx, const char *name)
+{
+	struct mock_device *d = mock_device_create(ctx, name);
+
+	mock_device_add(d);
+
+	return d;
+}
+
+struct mock_device *
+mock_device_plug(struct js_ctx *ctx, const char *name)
+{
+	struct mock_device *d = mock_device_create(ctx, name);
+
+	mock_ctx_queue_action(d, MOCK_ACTION_PLUG);
+
+	return d;
+}
+
+static int
+is_description_file(const struct dirent *entry)
+{
+	size_t len = strlen(entry->d_name);
+
+	return len > 6 && streq(&entry->d_name[len - 6], ".evemu");
+}
+
+int
+mock_ctx_assign_seat(struct js_ctx *ctx, const char *dir,
+		     struct mock_startup_times *times)
+{
+	struct mock_startup_times unused = {0};
+	struct dirent **entries;
+	uint64_t t = mock_now_ns();
+	int n;
+
+	if (!times)
+		times = &unused;
+
+	n = scandir(dir, &entries, is_description_file, alphasort);
+	if (n < 0)
+		return -errno;
+	mock_time_phase(&times->enumerate_ns, &t);
+
+	for (int i = 0; i < n; i++) {
+		struct mock_device *d;
+		char *path;
+		int rc;
+
+		if (asprintf(&path, "%s/%s", dir, entries[i]->d_name) < 0)
+			abort();
+		free(entries[i]);
+
+		d = mock_device_create_from_path(ctx, path, times);
+		free(path);
+
+		t = mock_now_ns();
+		rc = evdev_device_added(&d->base);
+		if (rc != 0)
+			mock_abort("Failed to add device: %s", strerror(-rc));
+		mock_time_phase(&times->add_ns, &t);
+	}
+	free(entries);
+
+	return n;
+}
+
+void
+mock_device_unplug(struct mock_device *d)
+{
+	mock_ctx_queue_action(d, MOCK_ACTION_UNPLUG);
+}
+
+static void
+mock_device_queue_battery(struct mock_device *d)
+{
+	/* Like udev, only the latest uevent matters */
+	if (d->pending_action == MOCK_ACTION_POWER)
+		return;
+
+	mock_ctx_queue_action(d, MOCK_ACTION_POWER);
+}
+
+void
+mock_device_set_battery(struct mock_device *d,
+			enum js_battery_status status,
+			int percent)
+{
+	d->battery.present = true;
+	d->battery.status = status;
+	d->battery.percent = percent;
+
+	mock_device_queue_battery(d);
+}
+
+void
+mock_device_remove_battery(struct mock_device *d)
+{
+	d->battery.present = false;
+
+	mock_device_queue_battery(d);
+}
+
+struct js_device *
+mock_device_get_device(struct mock_device *d)
+{
+	return &d->base;
+}
+
+const struct ff_effect *
+mock_device_get_ff_effect(struct mock_device *d, int id)
+{
+	if (id < 0 || id >= MOCK_FF_EFFECTS || !d->ff_effects[id].used)
+		return NULL;
+
+	return &d->ff_effects[id].effect;
+}
+
+bool
+mock_device_ff_effect_is_playing(struct mock_device *d, int id)
+{
+	return mock_device_get_ff_effect(d, id) && d->ff_effects[id].playing;
+}
+
+uint16_t
+mock_device_get_ff_gain(struct mock_device *d)
+{
+	return d->ff_gain;
+}
+
+struct mock_ff_counts
+mock_device_get_ff_counts(struct mock_device *d)
+{
+	return d->ff_counts;
+}
+
+void
+mock_device_add_output(struct mock_device *d, enum js_output output)
+{
+	d->base.output.supported |= js_output_bit(output);
+}
+
+void
+mock_device_fail_output(struct mock_device *d, int error)
+{
+	d->output_error = error;
+}
+
+uint32_t
+mock_device_get_player_indicator(struct mock_device *d)
+{
+	return d->player_indicator;
+}
+
+void
+mock_device_get_lightbar(struct mock_device *d, uint8_t color[3])
+{
+	memcpy(color, d->lightbar, sizeof(d->lightbar));
+}
+
+unsigned int
+mock_device_get_output_writes(struct mock_device *d)
+{
+	return d->output_writes;
+}
+
+void
+mock_device_fail_event_mask(struct mock_device *d, int error)
+{
+	d->mask_error = error;
+}
+
+/* Like the kernel, drop masked events and the SYN_REPORTs of frames
+ * that are left empty */
+static void
+mock_device_apply_mask(struct mock_device *d)
+{
+	size_t n = 0, frame_start = 0;
+
+	for (size_t i = 0; i < d->nevents; i++) {
+		const struct input_event *ev = &d->buffer[i];
+		unsigned long *mask;
+		size_t ncodes;
+
+		mask = mock_device_mask(d, ev->type, &ncodes);
+		if (mask && (ev->code >= ncodes || !long_bit_is_set(mask, ev->code)))
+			continue;
+
+		if (ev->type == EV_SYN && ev->code == SYN_REPORT) {
+			if (n == frame_start)
+				continue;
+			frame_start = n + 1;
+		}
+
+		d->buffer[n++] = *ev;
+	}
+
+	d->nevents = n;
+}
+
+static void
+mock_device_flush(struct mock_device *d)
+{
+	size_t size;
+	ssize_t rc;
+
+	mock_device_apply_mask(d);
+	if (d->nevents == 0)
+		return;
+
+	size = d->nevents * sizeof(d->buffer[0]);
+	rc = write(d->write_fd, d->buffer, size);
+	if (rc < 0 || (size_t)rc != size)
+		mock_abort("Failed to write %zd events (pipe full?)",
+			   d->nevents);
+
+	d->nevents = 0;
+}
+
+void
+mock_device_event_with_time(struct mock_device *d,
+			    uint64_t time,
+			    unsigned int type,
+			    unsigned int code,
+			    int value)
+{
+	struct input_event *ev;
+
+	if (d->nevents == ARRAY_LENGTH(d->buffer))
+		mock_device_flush(d);
+
+	ev = &d->buffer[d->nevents++];
+	ev->input_event_sec = time / s2us(1);
+	ev->input_event_usec = time % s2us(1);
+	ev->type = type;
+	ev->code = code;
+	ev->value = value;
+
+	mock_device_set_state(d, type, code, value);
+
+	if (type == EV_SYN && code == SYN_REPORT)
+		mock_device_flush(d);
+}
+
+void
+mock_device_event(struct mock_device *d,
+		  unsigned int type, unsigned int code, int value)
+{
+	mock_device_event_with_time(d, js_ctx_now(d->base.ctx),
+				    type, code, value);
+}
+
+void
+mock_device_frame(struct mock_device *d)
+{
+	mock_device_event(d, EV_SYN, SYN_REPORT, 0);
+}
+
+void
+mock_device_set_state(struct mock_device *d,
+		      unsigned int type, unsigned int code, int value)
+{
+	switch (type) {
+	case EV_KEY:
+		if (code < KEY_CNT)
+			long_set_bit_state(d->keys, code, value);
+		break;
+	case EV_ABS:
+		if (code < ABS_CNT)
+			d->abs[code] = value;
+		break;
+	default:
+		break;
+	}
+}
+
+int
+mock_device_play(struct mock_device *d, const char *name)
+{
+	FILE *fp;
+	char *path;
+	char *line = NULL;
+	size_t size = 0;
+	uint64_t start = js_ctx_now(d->base.ctx);
+	int nframes = 0;
+
+	path = mock_data_path("recordings", name);
+	fp = fopen(path, "r");
+	free(path);
+	if (!fp)
+		return -errno;
+
+	while (getline(&line, &size, fp) != -1) {
+		unsigned long sec, usec;
+		unsigned int type, code;
+		int value;
+
+		if (sscanf(line, "E: %lu.%lu %x %x %d",
+			   &sec, &usec, &type, &code, &value) != 5)
+			continue;
+
+		mock_device_event_with_time(d, start + s2us(sec) + usec,
+					    type, code, value);
+		if (type == EV_SYN && code == SYN_REPORT)
+			nframes++;
+	}
+
+	free(line);
+	fclose(fp);
+
+	return nframes;
+}
+
+struct js_event *
+mock_expect_event(struct js_ctx *ctx, enum js_event_type type)
+{
+	struct js_event *event;
+
+	js_ctx_dispatch(ctx);
+
+	event = js_ctx_get_event(ctx);
+	if (!event)
+		mock_abort("Expected event type %d, got none", type);
+
+	if (js_event_get_type(event) != type)
+		mock_abort("Expected event type %d, got %d",
+			   type, js_event_get_type(event));
+
+	return event;
+}
+
+void
+mock_expect_no_events(struct js_ctx *ctx)
+{
+	struct js_event *event;
+
+	js_ctx_dispatch(ctx);
+
+	event = js_ctx_get_event(ctx);
+	if (event)
+		mock_abort("Expected no events, got type %d",
+			   js_event_get_type(event));
+}
+
+void
+mock_drain_events(struct js_ctx *ctx)
+{
+	struct js_event *event;
+
+	js_ctx_dispatch(ctx);
+
+	while ((event = js_ctx_get_event(ctx)))
+		js_event_destroy(event);
+}
@@ -0,0 +1,244 @@
+/*
+ * Copyright © 2019 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+/**
+ * An in-memory backend for the test suite and the benchmarks.
+ *
+ * Mock devices are created from evemu-style device descriptions (see
+ * test/devices). Each device is backed by a pipe, events written by the
+ * test are read by libjoystick exactly like events from an evdev fd, so
+ * the whole dispatch pipeline is exercised without any hardware or
+ * uinput access.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <linux/input.h>
+
+#include <libjoystick.h>
+
+struct mock_device;
+
+/**
+ * The number of force feedback requests a device received, each is one
+ * ioctl or write() on a real device.
+ */
+struct mock_ff_counts {
+	unsigned int uploads;	/* EVIOCSFF */
+	unsigned int erases;	/* EVIOCRMFF */
+	unsigned int writes;	/* write() of EV_FF events */
+};
+
+/**
+ * Create a new context with the mock backend. The context has no devices
+ * until mock_device_new() or mock_device_plug() is called.
+ */
+struct js_ctx *
+mock_ctx_new(void);
+
+/**
+ * Create a device from the description file and add it to the context
+ * immediately, like devices present at startup. If the name does not
+ * contain a '/', it is looked up in the test suite's device directory,
+ * with the ".evemu" suffix appended.
+ *
+ * The device is owned by the context, the returned pointer is valid until
+ * the device is removed.
+ */
+struct mock_device *
+mock_device_new(struct js_ctx *ctx, const char *name);
+
+/**
+ * Like mock_device_new() but the device is only added during the next
+ * js_ctx_dispatch(), like a device plugged in at runtime.
+ */
+struct mock_device *
+mock_device_plug(struct js_ctx *ctx, const char *name);
+
+/**
+ * The time spent in each phase of mock_ctx_assign_seat(), accumulated
+ * over all devices.
+ */
+struct mock_startup_times {
+	uint64_t enumerate_ns;	/* scanning the directory */
+	uint64_t open_ns;	/* creating the device fd */
+	uint64_t probe_ns;	/* building the libevdev device */
+	uint64_t classify_ns;	/* evdev_device_classify() */
+	uint64_t add_ns;	/* adding the fd and queuing the event */
+};
+
+/**
+ * Add all *.evemu device descriptions in the directory to the context,
+ * in alphabetical order. This is the mock equivalent of
+ * js_ctx_udev_assign_seat(), the directory takes the role of the sysfs
+ * tree.
+ *
+ * If times is not NULL, the time spent in each phase is added to it.
+ *
+ * @return the number of devices added or a negative errno
+ */
+int
+mock_ctx_assign_seat(struct js_ctx *ctx, const char *dir,
+		     struct mock_startup_times *times);
+
+/**
+ * Unplug the device. The device is removed during the next
+ * js_ctx_dispatch(), the mock_device must not be used after this call.
+ */
+void
+mock_device_unplug(struct mock_device *device);
+
+/**
+ * Change the device's battery, like a power_supply change uevent. The
+ * change is processed during the next js_ctx_dispatch().
+ */
+void
+mock_device_set_battery(struct mock_device *device,
+			enum js_battery_status status,
+			int percent);
+
+/**
+ * Remove the device's battery, like a power_supply remove uevent.
+ */
+void
+mock_device_remove_battery(struct mock_device *device);
+
+struct js_device *
+mock_device_get_device(struct mock_device *device);
+
+/**
+ * @return the effect uploaded to the device with this id or NULL
+ */
+const struct ff_effect *
+mock_device_get_ff_effect(struct mock_device *device, int id);
+
+bool
+mock_device_ff_effect_is_playing(struct mock_device *device, int id);
+
+uint16_t
+mock_device_get_ff_gain(struct mock_device *device);
+
+struct mock_ff_counts
+mock_device_get_ff_counts(struct mock_device *device);
+
+/**
+ * Fail EVIOCSMASK with the negative errno, like an old kernel, or 0 to
+ * succeed again.
+ */
+void
+mock_device_fail_event_mask(struct mock_device *device, int error);
+
+/**
+ * Give the device a player indicator or lightbar, like the LEDs the udev
+ * backend finds in sysfs.
+ */
+void
+mock_device_add_output(struct mock_device *device, enum js_output output);
+
+/**
+ * Fail the next write of an LED output with the negative errno.
+ */
+void
+mock_device_fail_output(struct mock_device *device, int error);
+
+uint32_t
+mock_device_get_player_indicator(struct mock_device *device);
+
+void
+mock_device_get_lightbar(struct mock_device *device, uint8_t color[3]);
+
+/**
+ * @return the number of LED output writes, each is at least one write()
+ * on a real device
+ */
+unsigned int
+mock_device_get_output_writes(struct mock_device *device);
+
+/**
+ * Queue an event on the device and update the device's kernel state. The
+ * events are written to the device on the next SYN_REPORT or when
+ * mock_device_frame() is called. The event is timestamped with the
+ * context's clock, see js_ctx_set_clock(), unlike a real kernel which
+ * always uses CLOCK_MONOTONIC.
+ */
+void
+mock_device_event(struct mock_device *device,
+		  unsigned int type, unsigned int code, int value);
+
+/**
+ * Like mock_device_event() with the given kernel timestamp in µs.
+ */
+void
+mock_device_event_with_time(struct mock_device *device,
+			    uint64_t time,
+			    unsigned int type,
+			    unsigned int code,
+			    int value);
+
+/**
+ * Terminate the current frame with a SYN_REPORT and write all queued
+ * events to the device.
+ */
+void
+mock_device_frame(struct mock_device *device);
+
+/**
+ * Update the device's kernel state without sending an event. Use this to
+ * simulate events lost during a SYN_DROPPED.
+ */
+void
+mock_device_set_state(struct mock_device *device,
+		      unsigned int type, unsigned int code, int value);
+
+/**
+ * Replay the E: lines from an evemu recording. Timestamps in the
+ * recording are relative to the context's time at this call, see
+ * js_ctx_set_clock(). The replay itself happens as fast as possible. If
+ * the name does not contain a '/', it is looked up in the test suite's
+ * recordings directory with the ".evemu" suffix appended.
+ *
+ * Because the events go through a pipe, the caller must call
+ * js_ctx_dispatch() often enough for the recording to fit.
+ *
+ * @return the number of frames written or a negative errno
+ */
+int
+mock_device_play(struct mock_device *device, const char *name);
+
+/**
+ * Dispatch the context and expect the next event to be of the given type.
+ * Aborts if the event is missing or of a different type.
+ */
+struct js_event *
+mock_expect_event(struct js_ctx *ctx, enum js_event_type type);
+
+/**
+ * Dispatch the context and abort if there are any events.
+ */
+void
+mock_expect_no_events(struct js_ctx *ctx);
+
+/**
+ * Dispatch the context and discard all events.
+ */
+void
+mock_drain_events(struct js_ctx *ctx);
@@ -0,0 +1,92 @@
+/*
+ * Copyright © 2019 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#include "config.h"
+
+#include <assert.h>
+#include <fcntl.h>
+#include <linux/input.h>
+
+#include <libjoystick-asio.hpp>
+
+extern "C" {
+#include "mock-backend.h"
+}
+
+static void
+test_dispatch(void)
+{
+	boost::asio::io_context io;
+	js_ctx *ctx = mock_ctx_new();
+	struct mock_device *pad = mock_device_new(ctx, "microsoft-xbox-360-pad");
+	unsigned int nadded = 0, nbuttons = 0, nevents = 0;
+
+	{
+		js::asio_source source{ io.get_executor(), ctx, [&](js_event *event) {
+			switch (js_event_get_type(event)) {
+			case JS_EVENT_DEVICE_ADDED:
+				nadded++;
+				break;
+			case JS_EVENT_BUTTON:
+				nbuttons++;
+				break;
+			default:
+				break;
+			}
+			nevents++;
+		} };
+
+		/* The events queued before are delivered on the first run */
+		io.poll();
+		assert(nadded == 1);
+		assert(nevents == 1);
+
+		io.poll();
+		assert(nevents == 1);
+
+		/* All events of one wakeup are handled in one go */
+		for (int i = 0; i < 4; i++) {
+			mock_device_event(pad, EV_KEY, BTN_SOUTH, (i + 1) % 2);
+			mock_device_frame(pad);
+		}
+		io.poll();
+		assert(nbuttons == 4);
+		assert(nevents == 9);
+	}
+
+	/* The source is gone, the context and its fd are still ours */
+	mock_device_event(pad, EV_KEY, BTN_SOUTH, 1);
+	mock_device_frame(pad);
+	io.restart();
+	io.poll();
+	assert(nevents == 9);
+	assert(fcntl(js_ctx_get_fd(ctx), F_GETFD) != -1);
+	js_ctx_dispatch(ctx);
+	mock_drain_events(ctx);
+
+	js_ctx_unref(ctx);
+}
+
+int
+main(void)
+{
+	test_dispatch();
+
+	return 0;
+}
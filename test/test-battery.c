@@ -0,0 +1,107 @@
+/*
+ * Copyright © 2019 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#include "config.h"
+
+#include <assert.h>
+#include <errno.h>
+
+#include <libjoystick.h>
+
+#include "mock-backend.h"
+
+static void
+expect_battery(struct js_device *device,
+	       enum js_battery_status status, int percent)
+{
+	enum js_battery_status s;
+	int p;
+
+	assert(js_device_get_battery(device, &s, &p) == 0);
+	assert(s == status);
+	assert(p == percent);
+}
+
+static void
+expect_power_event(struct js_ctx *ctx, struct js_device *device)
+{
+	struct js_event *event = mock_expect_event(ctx, JS_EVENT_DEVICE_POWER);
+
+	assert(js_event_get_device(event) == device);
+	js_event_destroy(event);
+}
+
+static void
+test_battery(void)
+{
+	struct js_ctx *ctx = mock_ctx_new();
+	struct mock_device *d = mock_device_new(ctx, "sony-dualshock-4");
+	struct js_device *device = mock_device_get_device(d);
+	struct js_event *event;
+	enum js_battery_status status;
+	int percent;
+
+	mock_drain_events(ctx);
+	assert(js_device_get_battery(device, &status, &percent) == -ENOENT);
+
+	mock_device_set_battery(d, JS_BATTERY_STATUS_DISCHARGING, 80);
+	expect_power_event(ctx, device);
+	mock_expect_no_events(ctx);
+	expect_battery(device, JS_BATTERY_STATUS_DISCHARGING, 80);
+
+	/* A uevent without a change is not an event */
+	mock_device_set_battery(d, JS_BATTERY_STATUS_DISCHARGING, 80);
+	mock_expect_no_events(ctx);
+
+	/* Only the latest of several uevents is reported */
+	mock_device_set_battery(d, JS_BATTERY_STATUS_DISCHARGING, 75);
+	mock_device_set_battery(d, JS_BATTERY_STATUS_CHARGING, 75);
+	expect_power_event(ctx, device);
+	mock_expect_no_events(ctx);
+	expect_battery(device, JS_BATTERY_STATUS_CHARGING, 75);
+
+	mock_device_set_battery(d, JS_BATTERY_STATUS_FULL, -1);
+	expect_power_event(ctx, device);
+	expect_battery(device, JS_BATTERY_STATUS_FULL, -1);
+
+	mock_device_set_battery(d, JS_BATTERY_STATUS_NOT_CHARGING, 80);
+	expect_power_event(ctx, device);
+	expect_battery(device, JS_BATTERY_STATUS_NOT_CHARGING, 80);
+
+	mock_device_remove_battery(d);
+	expect_power_event(ctx, device);
+	assert(js_device_get_battery(device, &status, &percent) == -ENOENT);
+
+	/* Unplugged with a change still pending */
+	mock_device_set_battery(d, JS_BATTERY_STATUS_CHARGING, 10);
+	mock_device_unplug(d);
+	event = mock_expect_event(ctx, JS_EVENT_DEVICE_REMOVED);
+	js_event_destroy(event);
+	mock_expect_no_events(ctx);
+
+	js_ctx_unref(ctx);
+}
+
+int
+main(void)
+{
+	test_battery();
+
+	return 0;
+}
@@ -0,0 +1,169 @@
+/*
+ * Copyright © 2019 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#include "config.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <linux/input.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <libjoystick.h>
+
+#include "mock-backend.h"
+
+static uint64_t
+now_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+static unsigned int
+count_frames(struct js_ctx *ctx)
+{
+	struct js_event *event;
+	unsigned int nframes = 0;
+
+	while ((event = js_ctx_get_event(ctx))) {
+		if (js_event_get_type(event) == JS_EVENT_SYNC)
+			nframes++;
+		js_event_destroy(event);
+	}
+
+	return nframes;
+}
+
+static void
+press(struct mock_device *d, int value)
+{
+	mock_device_event(d, EV_KEY, BTN_SOUTH, value);
+	mock_device_frame(d);
+}
+
+static void
+test_exclusive(void)
+{
+	struct js_ctx *ctx = mock_ctx_new();
+
+	assert(js_ctx_set_busy_poll(ctx, 1000) == 0);
+	assert(js_ctx_set_latency_tolerance(ctx, 1000) == -EBUSY);
+	assert(js_ctx_set_busy_poll(ctx, 0) == 0);
+	assert(js_ctx_set_latency_tolerance(ctx, 1000) == 0);
+	assert(js_ctx_set_busy_poll(ctx, 1000) == -EBUSY);
+
+	js_ctx_unref(ctx);
+}
+
+static void
+test_window(void)
+{
+	struct js_ctx *ctx = mock_ctx_new();
+	struct mock_device *d = mock_device_new(ctx, "microsoft-xbox-360-pad");
+	uint64_t start;
+
+	mock_drain_events(ctx);
+	assert(js_ctx_set_busy_poll(ctx, 20000) == 0);
+
+	/* No frame yet, no window */
+	start = now_us();
+	js_ctx_dispatch(ctx);
+	assert(now_us() - start < 10000);
+
+	/* A frame read through epoll returns right away and opens the
+	 * window */
+	press(d, 1);
+	js_ctx_dispatch(ctx);
+	assert(count_frames(ctx) == 1);
+
+	start = now_us();
+	js_ctx_dispatch(ctx);
+	assert(count_frames(ctx) == 0);
+	assert(now_us() - start >= 20000 - 1000);
+
+	/* The window expired */
+	start = now_us();
+	js_ctx_dispatch(ctx);
+	assert(now_us() - start < 10000);
+
+	js_ctx_unref(ctx);
+}
+
+static void *
+writer(void *data)
+{
+	struct mock_device *d = data;
+
+	usleep(5000);
+	press(d, 0);
+
+	return NULL;
+}
+
+static void
+test_spin(void)
+{
+	struct js_ctx *ctx = mock_ctx_new();
+	struct mock_device *d = mock_device_new(ctx, "microsoft-xbox-360-pad");
+	struct js_stats *stats;
+	pthread_t thread;
+	uint64_t start;
+
+	mock_drain_events(ctx);
+	assert(js_ctx_set_busy_poll(ctx, 2000000) == 0);
+
+	press(d, 1);
+	js_ctx_dispatch(ctx);
+	assert(count_frames(ctx) == 1);
+
+	/* The frame is picked up by the spinning dispatch, not epoll */
+	start = now_us();
+	assert(pthread_create(&thread, NULL, writer, d) == 0);
+	js_ctx_dispatch(ctx);
+	assert(count_frames(ctx) == 1);
+	assert(now_us() - start < 2000000);
+	pthread_join(thread, NULL);
+
+	stats = js_ctx_get_stats(ctx);
+	if (js_stats_get_latency_count(stats, JS_STATS_LATENCY_WAKE) > 0) {
+		assert(js_stats_get_latency_count(stats, JS_STATS_LATENCY_WAKE) == 2);
+		fprintf(stderr, "wake latency p50: %llu us\n",
+			(unsigned long long)js_stats_get_latency_percentile(stats,
+									   JS_STATS_LATENCY_WAKE,
+									   50));
+	}
+	js_stats_destroy(stats);
+
+	js_ctx_unref(ctx);
+}
+
+int
+main(void)
+{
+	test_exclusive();
+	test_window();
+	test_spin();
+
+	return 0;
+}
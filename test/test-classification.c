@@ -0,0 +1,193 @@
+/*
+ * Copyright © 2019 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#include "config.h"
+
+#include <assert.h>
+#include <string.h>
+
+#include <libjoystick.h>
+
+#include "mock-backend.h"
+
+static unsigned int
+count_buttons(struct js_device *device, enum js_button_capability cap)
+{
+	unsigned int count = 0;
+
+	for (size_t i = 0; i < js_device_get_button_count(device); i++) {
+		struct js_button *button = js_device_get_button(device, i);
+
+		if (js_button_has_capability(button, cap))
+			count++;
+	}
+
+	return count;
+}
+
+static void
+test_xbox_360_pad(void)
+{
+	struct js_ctx *ctx = mock_ctx_new();
+	struct mock_device *d = mock_device_new(ctx, "microsoft-xbox-360-pad");
+	struct js_device *device = mock_device_get_device(d);
+
+	assert(strcmp(js_device_get_name(device), "Microsoft X-Box 360 pad") == 0);
+	assert(js_device_has_type(device, JS_TYPE_GAMEPAD));
+	assert(!js_device_has_type(device, JS_TYPE_JOYSTICK));
+	assert(!js_device_has_type(device, JS_TYPE_PEDALS));
+	assert(!js_device_has_type(device, JS_TYPE_WHEEL));
+
+	/* 11 digital buttons, 2 analog triggers */
+	assert(js_device_get_button_count(device) == 13);
+	assert(count_buttons(device, JS_BUTTON_CAP_ANALOG) == 2);
+	assert(count_buttons(device, JS_BUTTON_CAP_TRIGGER) == 2);
+	assert(count_buttons(device, JS_BUTTON_CAP_SHOULDER) == 2);
+	assert(count_buttons(device, JS_BUTTON_CAP_OK) == 1);
+	assert(count_buttons(device, JS_BUTTON_CAP_CANCEL) == 1);
+	assert(count_buttons(device, JS_BUTTON_CAP_SYSTEM) == 1);
+
+	assert(js_device_get_axis_count(device) == 2);
+	assert(js_axis_has_capability(js_device_get_axis(device, 0),
+				      JS_AXIS_CAP_LEFT));
+	assert(js_axis_has_capability(js_device_get_axis(device, 1),
+				      JS_AXIS_CAP_RIGHT));
+	assert(js_device_get_axis(device, 2) == NULL);
+
+	assert(js_device_get_dpad_count(device) == 1);
+	assert(js_dpad_has_capability(js_device_get_dpad(device, 0),
+				      JS_DPAD_CAP_LEFT));
+
+	js_ctx_unref(ctx);
+}
+
+static void
+test_dualshock_4(void)
+{
+	struct js_ctx *ctx = mock_ctx_new();
+	struct mock_device *d = mock_device_new(ctx, "sony-dualshock-4");
+	struct js_device *device = mock_device_get_device(d);
+
+	assert(js_device_has_type(device, JS_TYPE_GAMEPAD));
+
+	/* BTN_TL2/BTN_TR2 are merged into the analog triggers */
+	assert(js_device_get_button_count(device) == 13);
+	assert(count_buttons(device, JS_BUTTON_CAP_ANALOG) == 2);
+	assert(count_buttons(device, JS_BUTTON_CAP_TRIGGER) == 2);
+
+	assert(js_device_get_axis_count(device) == 2);
+	assert(js_device_get_dpad_count(device) == 1);
+
+	js_ctx_unref(ctx);
+}
+
+static void
+test_flightstick(void)
+{
+	struct js_ctx *ctx = mock_ctx_new();
+	struct mock_device *d = mock_device_new(ctx, "logitech-extreme-3d-pro");
+	struct js_device *device = mock_device_get_device(d);
+
+	assert(js_device_has_type(device, JS_TYPE_JOYSTICK));
+	assert(js_device_has_type(device, JS_TYPE_THROTTLE));
+	assert(!js_device_has_type(device, JS_TYPE_GAMEPAD));
+
+	assert(js_device_get_button_count(device) == 12);
+	assert(count_buttons(device, JS_BUTTON_CAP_ANALOG) == 0);
+	assert(count_buttons(device, JS_BUTTON_CAP_TRIGGER) == 1);
+
+	/* x/y, twist, throttle */
+	assert(js_device_get_axis_count(device) == 3);
+	for (size_t i = 0; i < js_device_get_axis_count(device); i++) {
+		struct js_axis *axis = js_device_get_axis(device, i);
+
+		assert(js_axis_has_capability(axis, JS_AXIS_CAP_ANALOG));
+		assert(!js_axis_has_capability(axis, JS_AXIS_CAP_LEFT));
+		assert(!js_axis_has_capability(axis, JS_AXIS_CAP_RIGHT));
+	}
+
+	assert(js_device_get_dpad_count(device) == 1);
+	assert(!js_dpad_has_capability(js_device_get_dpad(device, 0),
+				       JS_DPAD_CAP_LEFT));
+
+	js_ctx_unref(ctx);
+}
+
+static void
+test_wheel(void)
+{
+	struct js_ctx *ctx = mock_ctx_new();
+	struct mock_device *d = mock_device_new(ctx, "generic-racing-wheel");
+	struct js_device *device = mock_device_get_device(d);
+
+	assert(js_device_has_type(device, JS_TYPE_WHEEL));
+	assert(js_device_has_type(device, JS_TYPE_PEDALS));
+	assert(!js_device_has_type(device, JS_TYPE_GAMEPAD));
+
+	/* gas/brake are pedals, not triggers on a wheel */
+	assert(js_device_get_button_count(device) == 8);
+	assert(count_buttons(device, JS_BUTTON_CAP_ANALOG) == 0);
+	assert(count_buttons(device, JS_BUTTON_CAP_LEFT) == 1);
+	assert(count_buttons(device, JS_BUTTON_CAP_RIGHT) == 1);
+
+	assert(js_device_get_axis_count(device) == 3);
+	assert(js_device_get_dpad_count(device) == 1);
+
+	js_ctx_unref(ctx);
+}
+
+static void
+test_button_priority(void)
+{
+	struct js_ctx *ctx = mock_ctx_new();
+	struct mock_device *d = mock_device_new(ctx, "microsoft-xbox-360-pad");
+	struct js_device *device = mock_device_get_device(d);
+	struct js_button *ok = NULL, *shoulder = NULL, *start = NULL;
+
+	for (size_t i = 0; i < js_device_get_button_count(device); i++) {
+		struct js_button *b = js_device_get_button(device, i);
+
+		if (js_button_has_capability(b, JS_BUTTON_CAP_OK))
+			ok = b;
+		else if (js_button_has_capability(b, JS_BUTTON_CAP_SHOULDER))
+			shoulder = b;
+		else if (js_button_has_capability(b, JS_BUTTON_CAP_START))
+			start = b;
+	}
+
+	assert(ok && shoulder && start);
+	assert(js_button_compare_priority(ok, shoulder) > 0);
+	assert(js_button_compare_priority(shoulder, start) > 0);
+	assert(js_button_compare_priority(start, ok) < 0);
+	assert(js_button_compare_priority(ok, ok) == 0);
+
+	js_ctx_unref(ctx);
+}
+
+int
+main(void)
+{
+	test_xbox_360_pad();
+	test_dualshock_4();
+	test_flightstick();
+	test_wheel();
+	test_button_priority();
+
+	return 0;
+}
@@ -0,0 +1,243 @@
+/*
+ * Copyright © 2019 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#include "config.h"
+
+#include <assert.h>
+#include <linux/input.h>
+#include <string.h>
+
+#include <libjoystick.h>
+
+#include "mock-backend.h"
+#include "util.h"
+
+/* A simulated clock that advances by step on each read */
+struct sim_clock {
+	uint64_t now;
+	uint64_t step;
+};
+
+static uint64_t
+sim_clock_now(void *user_data)
+{
+	struct sim_clock *clock = user_data;
+	uint64_t now = clock->now;
+
+	clock->now += clock->step;
+
+	return now;
+}
+
+static void
+test_clock_events(void)
+{
+	struct sim_clock clock = { .now = 5000000, .step = 0 };
+	struct js_ctx *ctx = mock_ctx_new();
+	struct mock_device *d;
+	struct js_event *event;
+
+	js_ctx_set_clock(ctx, sim_clock_now, &clock);
+
+	d = mock_device_plug(ctx, "sony-dualshock-4");
+	event = mock_expect_event(ctx, JS_EVENT_DEVICE_ADDED);
+	assert(js_event_get_time_usec(event) == 5000000);
+	js_event_destroy(event);
+
+	/* The mock timestamps its kernel events with the context's clock */
+	clock.now = 6000000;
+	mock_device_event(d, EV_KEY, BTN_SOUTH, 1);
+	mock_device_frame(d);
+	event = mock_expect_event(ctx, JS_EVENT_BUTTON);
+	assert(js_event_get_time_usec(event) == 6000000);
+	js_event_destroy(event);
+	mock_drain_events(ctx);
+
+	clock.now = 7000000;
+	mock_device_set_battery(d, JS_BATTERY_STATUS_CHARGING, 50);
+	event = mock_expect_event(ctx, JS_EVENT_DEVICE_POWER);
+	assert(js_event_get_time_usec(event) == 7000000);
+	js_event_destroy(event);
+
+	clock.now = 8000000;
+	mock_device_unplug(d);
+	event = mock_expect_event(ctx, JS_EVENT_DEVICE_REMOVED);
+	assert(js_event_get_time_usec(event) == 8000000);
+	js_event_destroy(event);
+
+	/* Back to CLOCK_MONOTONIC */
+	js_ctx_set_clock(ctx, NULL, NULL);
+	d = mock_device_plug(ctx, "sony-dualshock-4");
+	event = mock_expect_event(ctx, JS_EVENT_DEVICE_ADDED);
+	assert(js_event_get_time_usec(event) != 8000000);
+	js_event_destroy(event);
+
+	js_ctx_unref(ctx);
+}
+
+#if HAVE_STATISTICS
+static void
+test_clock_latency(void)
+{
+	/* Far away from CLOCK_MONOTONIC in either direction */
+	struct sim_clock clocks[] = {
+		{ .now = 1000, .step = 1000 },
+		{ .now = UINT64_MAX / 2, .step = 1000 },
+	};
+
+	for (size_t i = 0; i < ARRAY_LENGTH(clocks); i++) {
+		struct js_ctx *ctx = mock_ctx_new();
+		struct mock_device *d;
+		struct js_event *event;
+		struct js_stats *stats;
+		uint64_t frame_id, time;
+
+		js_ctx_set_clock(ctx, sim_clock_now, &clocks[i]);
+		d = mock_device_new(ctx, "sony-dualshock-4");
+		mock_drain_events(ctx);
+
+		/* A real device's frame, timestamped by the kernel */
+		time = now_in_us();
+		mock_device_event_with_time(d, time, EV_KEY, BTN_SOUTH, 1);
+		mock_device_event_with_time(d, time, EV_SYN, SYN_REPORT, 0);
+		event = mock_expect_event(ctx, JS_EVENT_BUTTON);
+		frame_id = js_event_get_frame_id(event);
+		js_event_destroy(event);
+		mock_drain_events(ctx);
+		assert(js_ctx_mark_consumed(ctx, frame_id) == 1);
+
+		stats = js_ctx_get_stats(ctx);
+		assert(js_stats_get_latency_count(stats,
+						  JS_STATS_LATENCY_DEQUEUE) == 1);
+		assert(js_stats_get_latency_percentile(stats,
+						       JS_STATS_LATENCY_DEQUEUE,
+						       99) < 1000000);
+		assert(js_stats_get_latency_percentile(stats,
+						       JS_STATS_LATENCY_WAKE,
+						       99) < 1000000);
+		assert(js_stats_get_latency_percentile(stats,
+						       JS_STATS_LATENCY_CONSUMED,
+						       99) < 1000000);
+		js_stats_destroy(stats);
+
+		js_ctx_unref(ctx);
+	}
+}
+#endif
+
+static uint64_t
+hash(uint64_t h, uint64_t value)
+{
+	/* FNV-1a */
+	for (int i = 0; i < 8; i++) {
+		h ^= (value >> (i * 8)) & 0xff;
+		h *= 0x100000001b3ull;
+	}
+
+	return h;
+}
+
+static uint64_t
+hash_event(uint64_t h, struct js_event *event)
+{
+	struct js_device *device = js_event_get_device(event);
+
+	h = hash(h, js_event_get_type(event));
+	h = hash(h, js_event_get_time_usec(event));
+	h = hash(h, js_event_get_frame_id(event));
+
+	switch (js_event_get_type(event)) {
+	case JS_EVENT_BUTTON:
+		for (size_t i = 0; i < js_device_get_button_count(device); i++) {
+			struct js_button *button = js_device_get_button(device, i);
+			uint16_t value;
+
+			h = hash(h, js_event_button_get_value(event, button, &value));
+			h = hash(h, value);
+		}
+		break;
+	case JS_EVENT_AXIS:
+		for (size_t i = 0; i < js_device_get_axis_count(device); i++) {
+			struct js_axis *axis = js_device_get_axis(device, i);
+			int16_t x = 0, y = 0, z = 0;
+
+			h = hash(h, js_event_axis_get_value(event, axis, &x, &y, &z));
+			h = hash(h, (uint16_t)x | (uint16_t)y << 16 |
+				    (uint64_t)(uint16_t)z << 32);
+		}
+		break;
+	default:
+		break;
+	}
+
+	return h;
+}
+
+/* Replay a recording on a simulated clock and hash the event stream */
+static uint64_t
+replay(void)
+{
+	struct sim_clock clock = { .now = 1000000, .step = 1000 };
+	struct js_ctx *ctx = mock_ctx_new();
+	struct mock_device *d;
+	struct js_event *event;
+	struct js_stats *stats;
+	uint64_t h = 0xcbf29ce484222325ull;
+
+	js_ctx_set_clock(ctx, sim_clock_now, &clock);
+	d = mock_device_new(ctx, "microsoft-xbox-360-pad");
+
+	assert(mock_device_play(d, "xbox-360-pad-buttons") == 25);
+
+	js_ctx_dispatch(ctx);
+	while ((event = js_ctx_get_event(ctx))) {
+		h = hash_event(h, event);
+		js_event_destroy(event);
+	}
+
+	/* The latencies are real time, only their number is the same */
+	stats = js_ctx_get_stats(ctx);
+	h = hash(h, js_stats_get_latency_count(stats, JS_STATS_LATENCY_DEQUEUE));
+	js_stats_destroy(stats);
+
+	js_ctx_unref(ctx);
+
+	return h;
+}
+
+static void
+test_replay_is_deterministic(void)
+{
+	uint64_t first = replay();
+
+	for (int i = 0; i < 3; i++)
+		assert(replay() == first);
+}
+
+int
+main(void)
+{
+	test_clock_events();
+#if HAVE_STATISTICS
+	test_clock_latency();
+#endif
+	test_replay_is_deterministic();
+
+	return 0;
+}
@@ -0,0 +1,196 @@
+/*
+ * Copyright © 2019 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#include "config.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <linux/input.h>
+#include <optional>
+
+#include <libjoystick.hpp>
+
+extern "C" {
+#include "mock-backend.h"
+}
+
+/* Starts eagerly, the frame lives until the task is destroyed */
+struct task {
+	struct promise_type {
+		task get_return_object() { return task{ handle::from_promise(*this) }; }
+		std::suspend_never initial_suspend() noexcept { return {}; }
+		std::suspend_always final_suspend() noexcept { return {}; }
+		void return_void() noexcept {}
+		void unhandled_exception() noexcept { abort(); }
+	};
+	using handle = std::coroutine_handle<promise_type>;
+
+	explicit task(handle h) : coroutine(h) {}
+	task(task &&other) noexcept : coroutine(std::exchange(other.coroutine, nullptr)) {}
+	~task()
+	{
+		if (coroutine)
+			coroutine.destroy();
+	}
+
+	bool done() const { return coroutine.done(); }
+
+	handle coroutine;
+};
+
+static task
+player(js::async_context &async, int *step)
+{
+	js::device pad = co_await async.device_added();
+
+	assert(pad);
+	*step = 1;
+
+	js_button *button = co_await async.button_pressed(pad, JS_BUTTON_CAP_OK);
+	assert(js_button_has_capability(button, JS_BUTTON_CAP_OK));
+	*step = 2;
+
+	co_await async.device_removed(pad.get());
+	*step = 3;
+}
+
+static void
+test_sequence(void)
+{
+	js::context ctx{ mock_ctx_new() };
+	js::async_context async{ ctx.get() };
+	int step = 0;
+	task t = player(async, &step);
+
+	assert(step == 0);
+	assert(async.process() == 0);
+
+	struct mock_device *pad = mock_device_new(ctx.get(), "microsoft-xbox-360-pad");
+	async.process();
+	assert(step == 1);
+
+	/* Releases and other buttons don't count */
+	mock_device_event(pad, EV_KEY, BTN_TR, 1);
+	mock_device_frame(pad);
+	async.process();
+	assert(step == 1);
+
+	mock_device_event(pad, EV_KEY, BTN_SOUTH, 1);
+	mock_device_frame(pad);
+	async.process();
+	assert(step == 2);
+
+	mock_device_unplug(pad);
+	async.process();
+	assert(step == 3);
+	assert(t.done());
+}
+
+static task
+count_events(js::async_context &async, unsigned int n, unsigned int *count)
+{
+	for (unsigned int i = 0; i < n; i++) {
+		js_event *event = co_await async.next_event();
+
+		assert(event);
+		(*count)++;
+	}
+}
+
+static void
+test_next_event(void)
+{
+	js::context ctx{ mock_ctx_new() };
+	js::async_context async{ ctx.get() };
+	struct mock_device *pad = mock_device_new(ctx.get(), "microsoft-xbox-360-pad");
+	unsigned int count1 = 0, count2 = 0;
+	std::size_t nevents;
+
+	mock_drain_events(ctx.get());
+
+	/* Every event wakes both coroutines, once */
+	task t1 = count_events(async, 1000, &count1);
+	task t2 = count_events(async, 1000, &count2);
+	for (int i = 0; i < 4; i++) {
+		mock_device_event(pad, EV_KEY, BTN_SOUTH, (i + 1) % 2);
+		mock_device_event(pad, EV_ABS, ABS_X, (i + 1) * 1000);
+		mock_device_frame(pad);
+	}
+	nevents = async.process();
+	assert(nevents > 0);
+	assert(count1 == nevents);
+	assert(count2 == nevents);
+}
+
+static void
+test_destroy_suspended(void)
+{
+	js::context ctx{ mock_ctx_new() };
+	js::async_context async{ ctx.get() };
+	int step = 0;
+
+	/* The destroyed coroutine's awaitable is unlinked and never
+	 * resumed */
+	{
+		task t = player(async, &step);
+	}
+	mock_device_new(ctx.get(), "microsoft-xbox-360-pad");
+	async.process();
+	assert(step == 0);
+}
+
+/* Destroys the other task when resumed */
+static task
+destroy_other(js::async_context &async, std::optional<task> *other)
+{
+	js::device pad = co_await async.device_added();
+
+	other->reset();
+}
+
+static void
+test_destroy_while_resuming(void)
+{
+	js::context ctx{ mock_ctx_new() };
+	js::async_context async{ ctx.get() };
+	std::optional<task> other;
+	int step = 0;
+
+	/* Both match the same event, the first one resumed destroys the
+	 * second before it is resumed */
+	task t = destroy_other(async, &other);
+	other.emplace(player(async, &step));
+
+	mock_device_new(ctx.get(), "microsoft-xbox-360-pad");
+	async.process();
+	assert(t.done());
+	assert(!other);
+	assert(step == 0);
+}
+
+int
+main(void)
+{
+	test_sequence();
+	test_next_event();
+	test_destroy_suspended();
+	test_destroy_while_resuming();
+
+	return 0;
+}
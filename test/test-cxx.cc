@@ -0,0 +1,295 @@
+/*
+ * Copyright © 2019 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#include "config.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <linux/input.h>
+#include <type_traits>
+#include <unistd.h>
+
+#include <libjoystick.hpp>
+
+extern "C" {
+#include "mock-backend.h"
+}
+
+static int
+open_restricted(const char *path, int flags, void *user_data)
+{
+	return -ENODEV;
+}
+
+static void
+close_restricted(int fd, void *user_data)
+{
+	close(fd);
+}
+
+static void
+test_factories(void)
+{
+	static const js_interface interface = {
+		open_restricted,
+		close_restricted,
+	};
+
+	/* The context keeps the pointer, so a temporary interface must not
+	 * be accepted */
+	static_assert(!std::is_invocable_v<decltype(&js::context::path),
+					   js_interface, void *>);
+	static_assert(!std::is_invocable_v<decltype(&js::context::udev),
+					   js_interface, void *>);
+
+	js::context ctx = js::context::path(&interface);
+	assert(ctx);
+	assert(!ctx.add_device("/dev/input/event0"));
+}
+
+static void
+test_handles(void)
+{
+	js::context ctx{ mock_ctx_new() };
+	struct mock_device *pad = mock_device_new(ctx.get(), "microsoft-xbox-360-pad");
+	js::device device = js::device::ref(mock_device_get_device(pad));
+	js_ctx *raw = ctx.get();
+
+	assert(ctx);
+	assert(device);
+	assert(device.button_count() > 0);
+	assert(device.axis_count() > 0);
+	assert(device.dpad_count() > 0);
+	assert(device.button(0) == js_device_get_button(device.get(), 0));
+
+	/* Moving transfers the reference, the source is empty */
+	js::context other = std::move(ctx);
+	assert(!ctx);
+	assert(other.get() == raw);
+	ctx = std::move(other);
+	assert(ctx.get() == raw);
+	assert(!other);
+
+	js::event event = ctx.next_event();
+	assert(event);
+	assert(event.type() == JS_EVENT_DEVICE_ADDED);
+	assert(event.device() == device.get());
+	event.reset();
+	assert(!event);
+	mock_drain_events(ctx.get());
+
+	/* Our reference keeps the device alive after the removal */
+	mock_device_unplug(pad);
+	ctx.dispatch();
+	event = ctx.next_event();
+	assert(event.type() == JS_EVENT_DEVICE_REMOVED);
+	assert(js_device_get_name(device.get()));
+	event = js::event{};
+	mock_drain_events(ctx.get());
+
+	device.reset();
+	assert(!ctx.next_event());
+}
+
+static void
+check_button_event(js::device &device, js::button_event ev)
+{
+	auto values = ev.values();
+
+	assert(values.size() == device.button_count());
+	for (std::size_t i = 0; i < values.size(); i++) {
+		js_button *button = device.button(i);
+
+		assert(values[i] == ev.value(button));
+		assert(js::bit_is_set(ev.state_bits(), i) == ev.pressed(button));
+		assert(js::bit_is_set(ev.state_changed_bits(), i) ==
+		       ev.state_changed(button));
+		assert(js::bit_is_set(ev.value_changed_bits(), i) ==
+		       ev.value_changed(button));
+	}
+}
+
+static void
+check_axis_event(js::device &device, js::axis_event ev)
+{
+	auto values = ev.values();
+
+	assert(values.size() == device.axis_count());
+	for (std::size_t i = 0; i < values.size(); i++) {
+		js_axis *axis = device.axis(i);
+		int16_t x, y, z;
+
+		assert(ev.value(axis, x, y, z) ==
+		       js::bit_is_set(ev.changed_bits(), i));
+		assert(values[i][0] == x);
+		assert(values[i][1] == y);
+		assert(values[i][2] == z);
+		assert(ev.changed(axis) == js::bit_is_set(ev.changed_bits(), i));
+	}
+}
+
+static void
+check_dpad_event(js::device &device, js::dpad_event ev)
+{
+	auto states = ev.states();
+
+	assert(states.size() == device.dpad_count());
+	for (std::size_t i = 0; i < states.size(); i++) {
+		js_dpad *dpad = device.dpad(i);
+
+		assert(states[i] == ev.state(dpad));
+		assert(ev.changed(dpad) == js::bit_is_set(ev.changed_bits(), i));
+	}
+}
+
+static void
+test_visit(void)
+{
+	js::context ctx{ mock_ctx_new() };
+	struct mock_device *pad = mock_device_new(ctx.get(), "microsoft-xbox-360-pad");
+	js::device device = js::device::ref(mock_device_get_device(pad));
+	unsigned int nbuttons = 0, naxes = 0, ndpads = 0, nsyncs = 0;
+	std::size_t nevents, nall = 0;
+
+	mock_drain_events(ctx.get());
+
+	for (int i = 0; i < 4; i++) {
+		mock_device_event(pad, EV_KEY, BTN_SOUTH, (i + 1) % 2);
+		mock_device_event(pad, EV_KEY, BTN_TR, i % 2);
+		mock_device_event(pad, EV_ABS, ABS_X, (i + 1) * 1000);
+		mock_device_event(pad, EV_ABS, ABS_RZ, i * 50);
+		mock_device_event(pad, EV_ABS, ABS_HAT0X, i % 3 - 1);
+		mock_device_frame(pad);
+	}
+	ctx.dispatch();
+
+	/* Event types without an overload are skipped */
+	nevents = ctx.drain(js::overloaded{
+		[&](js::button_event ev) {
+			check_button_event(device, ev);
+			nbuttons++;
+		},
+		[&](js::axis_event ev) {
+			check_axis_event(device, ev);
+			naxes++;
+		},
+		[&](js::dpad_event ev) {
+			check_dpad_event(device, ev);
+			ndpads++;
+		},
+		[&](js::sync_event ev) {
+			assert(ev.device() == device.get());
+			nsyncs++;
+		},
+	});
+	assert(nbuttons == 4);
+	assert(naxes == 4);
+	assert(ndpads > 0);
+	assert(nsyncs == 4);
+	assert(nevents == nbuttons + naxes + ndpads + nsyncs);
+
+	/* A generic lambda gets all of them */
+	mock_device_event(pad, EV_KEY, BTN_SOUTH, 1);
+	mock_device_frame(pad);
+	ctx.dispatch();
+	nevents = ctx.drain([&](auto ev) {
+		assert(ev.device() == device.get());
+		nall++;
+	});
+	assert(nevents == 2);
+	assert(nall == nevents);
+}
+
+static void
+test_layouts(void)
+{
+	using gamepad = js::layouts::gamepad;
+	js::context ctx{ mock_ctx_new() };
+	struct mock_device *pad = mock_device_new(ctx.get(), "microsoft-xbox-360-pad");
+	struct mock_device *wheel = mock_device_new(ctx.get(), "generic-racing-wheel");
+	struct mock_device *stick = mock_device_new(ctx.get(), "logitech-extreme-3d-pro");
+	js_device *pad_device = mock_device_get_device(pad);
+	js_device *wheel_device = mock_device_get_device(wheel);
+	js::layout_state<gamepad> state;
+	unsigned int nupdates = 0;
+
+	/* Bound against the device's type and controls */
+	auto binding = js::layout_binding<gamepad>::bind(pad_device);
+	assert(binding);
+	assert(binding->device() == pad_device);
+	assert(js_button_has_capability(js_device_get_button(pad_device,
+							     binding->button_index<gamepad::south>()),
+					JS_BUTTON_CAP_OK));
+	assert(binding->button_index<gamepad::left_thumb>() !=
+	       binding->button_index<gamepad::left_shoulder>());
+	assert(!js::layout_binding<gamepad>::bind(wheel_device));
+	assert(!js::layout_binding<js::layouts::wheel>::bind(pad_device));
+	assert(js::layout_binding<js::layouts::wheel>::bind(wheel_device));
+	assert(js::layout_binding<js::layouts::flight_stick>::bind(mock_device_get_device(stick)));
+	mock_drain_events(ctx.get());
+
+	mock_device_event(pad, EV_KEY, BTN_SOUTH, 1);
+	mock_device_event(pad, EV_KEY, BTN_TL, 1);
+	mock_device_event(pad, EV_ABS, ABS_X, 1000);
+	mock_device_event(pad, EV_ABS, ABS_HAT0X, 1);
+	mock_device_frame(pad);
+	mock_device_event(wheel, EV_KEY, BTN_GEAR_UP, 1);
+	mock_device_frame(wheel);
+	ctx.dispatch();
+
+	ctx.drain([&](auto ev) {
+		js_event *event = ev.get();
+
+		if (!binding->update(state, event))
+			return;
+		nupdates++;
+
+		if (js_event_get_type(event) == JS_EVENT_AXIS) {
+			int16_t x, y, z;
+
+			js_event_axis_get_value(event,
+						js_device_get_axis(pad_device,
+								   binding->axis_index<gamepad::left_stick>()),
+						&x, &y, &z);
+			assert(state.axis<gamepad::left_stick>()[0] == x);
+			assert(state.axis<gamepad::left_stick>()[1] == y);
+		}
+	});
+
+	/* Only the pad's button, axis and dpad events */
+	assert(nupdates == 3);
+	assert(state.button<gamepad::south>());
+	assert(state.button<gamepad::left_shoulder>());
+	assert(!state.button<gamepad::east>());
+	assert(!state.button<gamepad::right_shoulder>());
+	assert(state.value<gamepad::south>() > 0);
+	assert(state.axis<gamepad::left_stick>()[0] != 0);
+	assert(state.dpad<gamepad::left_dpad>() & JS_DPAD_E);
+}
+
+int
+main(void)
+{
+	test_factories();
+	test_handles();
+	test_visit();
+	test_layouts();
+
+	return 0;
+}
@@ -0,0 +1,413 @@
+/*
+ * Copyright © 2019 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#include "config.h"
+
+#include <assert.h>
+#include <linux/input.h>
+
+#include <libjoystick.h>
+
+#include "mock-backend.h"
+#include "util.h"
+
+static struct js_button *
+find_button(struct js_device *device, enum js_button_capability cap)
+{
+	for (size_t i = 0; i < js_device_get_button_count(device); i++) {
+		struct js_button *button = js_device_get_button(device, i);
+
+		if (js_button_has_capability(button, cap))
+			return button;
+	}
+
+	return NULL;
+}
+
+static void
+test_button_press_release(void)
+{
+	struct js_ctx *ctx = mock_ctx_new();
+	struct mock_device *d = mock_device_new(ctx, "microsoft-xbox-360-pad");
+	struct js_device *device = mock_device_get_device(d);
+	struct js_button *ok = find_button(device, JS_BUTTON_CAP_OK);
+	struct js_button *cancel = find_button(device, JS_BUTTON_CAP_CANCEL);
+	struct js_event *event;
+	uint16_t value;
+	bool state;
+
+	assert(ok);
+	assert(cancel);
+	mock_drain_events(ctx);
+
+	mock_device_event(d, EV_KEY, BTN_SOUTH, 1);
+	mock_device_frame(d);
+
+	event = mock_expect_event(ctx, JS_EVENT_BUTTON);
+	assert(js_event_get_device(event) == device);
+	assert(js_event_button_state_has_changed(event, ok));
+	assert(js_event_button_value_has_changed(event, ok));
+	assert(js_event_button_get_state(event, ok, &state));
+	assert(state);
+	assert(js_event_button_get_value(event, ok, &value));
+	assert(value == 0xffff);
+	assert(!js_event_button_state_has_changed(event, cancel));
+	assert(!js_event_button_get_state(event, cancel, &state));
+	assert(!state);
+	js_event_destroy(event);
+
+	event = mock_expect_event(ctx, JS_EVENT_SYNC);
+	js_event_destroy(event);
+	mock_expect_no_events(ctx);
+
+	mock_device_event(d, EV_KEY, BTN_SOUTH, 0);
+	mock_device_frame(d);
+
+	event = mock_expect_event(ctx, JS_EVENT_BUTTON);
+	assert(js_event_button_get_state(event, ok, &state));
+	assert(!state);
+	js_event_destroy(event);
+	event = mock_expect_event(ctx, JS_EVENT_SYNC);
+	js_event_destroy(event);
+	mock_expect_no_events(ctx);
+
+	js_ctx_unref(ctx);
+}
+
+static void
+test_button_state_is_sticky(void)
+{
+	struct js_ctx *ctx = mock_ctx_new();
+	struct mock_device *d = mock_device_new(ctx, "microsoft-xbox-360-pad");
+	struct js_device *device = mock_device_get_device(d);
+	struct js_button *ok = find_button(device, JS_BUTTON_CAP_OK);
+	struct js_button *cancel = find_button(device, JS_BUTTON_CAP_CANCEL);
+	struct js_event *event;
+	bool state;
+
+	mock_drain_events(ctx);
+
+	mock_device_event(d, EV_KEY, BTN_SOUTH, 1);
+	mock_device_frame(d);
+	mock_device_event(d, EV_KEY, BTN_EAST, 1);
+	mock_device_frame(d);
+
+	event = mock_expect_event(ctx, JS_EVENT_BUTTON);
+	js_event_destroy(event);
+	event = mock_expect_event(ctx, JS_EVENT_SYNC);
+	js_event_destroy(event);
+
+	/* Second event carries the first button's state but it didn't
+	 * change */
+	event = mock_expect_event(ctx, JS_EVENT_BUTTON);
+	assert(!js_event_button_get_state(event, ok, &state));
+	assert(state);
+	assert(js_event_button_get_state(event, cancel, &state));
+	assert(state);
+	js_event_destroy(event);
+	mock_drain_events(ctx);
+
+	js_ctx_unref(ctx);
+}
+
+static void
+test_frame_without_changes(void)
+{
+	struct js_ctx *ctx = mock_ctx_new();
+	struct mock_device *d = mock_device_new(ctx, "microsoft-xbox-360-pad");
+
+	mock_drain_events(ctx);
+
+	/* Unmapped and unchanged values must not generate events */
+	mock_device_event(d, EV_KEY, BTN_SOUTH, 0);
+	mock_device_event(d, EV_MSC, MSC_SCAN, 1234);
+	mock_device_frame(d);
+	mock_expect_no_events(ctx);
+
+	js_ctx_unref(ctx);
+}
+
+static void
+test_axis(void)
+{
+	struct js_ctx *ctx = mock_ctx_new();
+	struct mock_device *d = mock_device_new(ctx, "microsoft-xbox-360-pad");
+	struct js_device *device = mock_device_get_device(d);
+	struct js_axis *left = js_device_get_axis(device, 0),
+		       *right = js_device_get_axis(device, 1);
+	struct js_event *event;
+	int16_t x, y, z;
+
+	assert(js_axis_has_capability(left, JS_AXIS_CAP_LEFT));
+	assert(js_axis_has_capability(right, JS_AXIS_CAP_RIGHT));
+	mock_drain_events(ctx);
+
+	mock_device_event(d, EV_ABS, ABS_X, 32767);
+	mock_device_event(d, EV_ABS, ABS_Y, -32768);
+	mock_device_frame(d);
+
+	event = mock_expect_event(ctx, JS_EVENT_AXIS);
+	assert(js_event_axis_has_changed(event, left));
+	assert(js_event_axis_get_value(event, left, &x, &y, &z));
+	assert(x == 32767);
+	assert(y == -32768);
+	assert(z == 0);
+	assert(!js_event_axis_has_changed(event, right));
+	assert(!js_event_axis_get_value(event, right, &x, &y, NULL));
+	assert(x == 0);
+	assert(y == 0);
+	js_event_destroy(event);
+
+	event = mock_expect_event(ctx, JS_EVENT_SYNC);
+	js_event_destroy(event);
+	mock_expect_no_events(ctx);
+
+	js_ctx_unref(ctx);
+}
+
+static void
+test_analog_trigger(void)
+{
+	struct js_ctx *ctx = mock_ctx_new();
+	struct mock_device *d = mock_device_new(ctx, "microsoft-xbox-360-pad");
+	struct js_device *device = mock_device_get_device(d);
+	struct js_button *trigger = NULL;
+	struct js_event *event;
+	uint16_t value;
+	bool state;
+
+	for (size_t i = 0; i < js_device_get_button_count(device); i++) {
+		struct js_button *b = js_device_get_button(device, i);
+
+		if (js_button_has_capability(b, JS_BUTTON_CAP_TRIGGER) &&
+		    js_button_has_capability(b, JS_BUTTON_CAP_LEFT))
+			trigger = b;
+	}
+	assert(trigger);
+	assert(js_button_has_capability(trigger, JS_BUTTON_CAP_ANALOG));
+	mock_drain_events(ctx);
+
+	/* below the press threshold */
+	mock_device_event(d, EV_ABS, ABS_Z, 100);
+	mock_device_frame(d);
+	event = mock_expect_event(ctx, JS_EVENT_BUTTON);
+	assert(js_event_button_value_has_changed(event, trigger));
+	assert(!js_event_button_state_has_changed(event, trigger));
+	assert(js_event_button_get_value(event, trigger, &value));
+	assert(value == 100 * 0xffff / 255);
+	js_event_destroy(event);
+	mock_drain_events(ctx);
+
+	mock_device_event(d, EV_ABS, ABS_Z, 255);
+	mock_device_frame(d);
+	event = mock_expect_event(ctx, JS_EVENT_BUTTON);
+	assert(js_event_button_get_state(event, trigger, &state));
+	assert(state);
+	js_event_destroy(event);
+	mock_drain_events(ctx);
+
+	/* Between the release and press threshold, still down */
+	mock_device_event(d, EV_ABS, ABS_Z, 100);
+	mock_device_frame(d);
+	event = mock_expect_event(ctx, JS_EVENT_BUTTON);
+	assert(!js_event_button_get_state(event, trigger, &state));
+	assert(state);
+	js_event_destroy(event);
+	mock_drain_events(ctx);
+
+	mock_device_event(d, EV_ABS, ABS_Z, 0);
+	mock_device_frame(d);
+	event = mock_expect_event(ctx, JS_EVENT_BUTTON);
+	assert(js_event_button_get_state(event, trigger, &state));
+	assert(!state);
+	js_event_destroy(event);
+	mock_drain_events(ctx);
+
+	js_ctx_unref(ctx);
+}
+
+static void
+test_dpad(void)
+{
+	struct js_ctx *ctx = mock_ctx_new();
+	struct mock_device *d = mock_device_new(ctx, "microsoft-xbox-360-pad");
+	struct js_device *device = mock_device_get_device(d);
+	struct js_dpad *dpad = js_device_get_dpad(device, 0);
+	struct js_event *event;
+	uint32_t state;
+
+	assert(dpad);
+	mock_drain_events(ctx);
+
+	mock_device_event(d, EV_ABS, ABS_HAT0X, -1);
+	mock_device_event(d, EV_ABS, ABS_HAT0Y, -1);
+	mock_device_frame(d);
+	event = mock_expect_event(ctx, JS_EVENT_DPAD);
+	assert(js_event_dpad_get_state(event, dpad, &state));
+	assert(state == (JS_DPAD_N | JS_DPAD_W));
+	js_event_destroy(event);
+	mock_drain_events(ctx);
+
+	mock_device_event(d, EV_ABS, ABS_HAT0X, 1);
+	mock_device_frame(d);
+	event = mock_expect_event(ctx, JS_EVENT_DPAD);
+	assert(js_event_dpad_get_state(event, dpad, &state));
+	assert(state == (JS_DPAD_N | JS_DPAD_E));
+	js_event_destroy(event);
+	mock_drain_events(ctx);
+
+	js_ctx_unref(ctx);
+}
+
+static void
+test_event_order_within_frame(void)
+{
+	struct js_ctx *ctx = mock_ctx_new();
+	struct mock_device *d = mock_device_new(ctx, "microsoft-xbox-360-pad");
+	struct js_event *event;
+
+	mock_drain_events(ctx);
+
+	mock_device_event(d, EV_KEY, BTN_SOUTH, 1);
+	mock_device_event(d, EV_ABS, ABS_HAT0X, 1);
+	mock_device_event(d, EV_ABS, ABS_RX, 1000);
+	mock_device_frame(d);
+
+	event = mock_expect_event(ctx, JS_EVENT_AXIS);
+	js_event_destroy(event);
+	event = mock_expect_event(ctx, JS_EVENT_BUTTON);
+	js_event_destroy(event);
+	event = mock_expect_event(ctx, JS_EVENT_DPAD);
+	js_event_destroy(event);
+	event = mock_expect_event(ctx, JS_EVENT_SYNC);
+	js_event_destroy(event);
+	mock_expect_no_events(ctx);
+
+	js_ctx_unref(ctx);
+}
+
+static void
+test_controls_of_other_device(void)
+{
+	struct js_ctx *ctx = mock_ctx_new();
+	struct mock_device *d1 = mock_device_new(ctx, "microsoft-xbox-360-pad");
+	struct mock_device *d2 = mock_device_new(ctx, "microsoft-xbox-360-pad");
+	struct js_device *device2 = mock_device_get_device(d2);
+	struct js_button *ok2 = find_button(device2, JS_BUTTON_CAP_OK);
+	struct js_event *event;
+	bool state = true;
+
+	mock_drain_events(ctx);
+
+	mock_device_event(d1, EV_KEY, BTN_SOUTH, 1);
+	mock_device_frame(d1);
+
+	event = mock_expect_event(ctx, JS_EVENT_BUTTON);
+	assert(!js_event_button_state_has_changed(event, ok2));
+	assert(!js_event_button_get_state(event, ok2, &state));
+	assert(!state);
+	js_event_destroy(event);
+	mock_drain_events(ctx);
+
+	js_ctx_unref(ctx);
+}
+
+static void
+test_event_time(void)
+{
+	struct js_ctx *ctx = mock_ctx_new();
+	struct mock_device *d = mock_device_new(ctx, "microsoft-xbox-360-pad");
+	struct js_event *button, *sync;
+	uint64_t before, after;
+
+	mock_drain_events(ctx);
+
+	before = now_in_us();
+	mock_device_event(d, EV_KEY, BTN_SOUTH, 1);
+	mock_device_frame(d);
+	after = now_in_us();
+
+	button = mock_expect_event(ctx, JS_EVENT_BUTTON);
+	sync = mock_expect_event(ctx, JS_EVENT_SYNC);
+
+	/* The time is the SYN_REPORT's time for all events in the frame */
+	assert(js_event_get_time_usec(button) >= before);
+	assert(js_event_get_time_usec(button) <= after);
+	assert(js_event_get_time_usec(button) == js_event_get_time_usec(sync));
+
+	js_event_destroy(button);
+	js_event_destroy(sync);
+	js_ctx_unref(ctx);
+}
+
+static void
+test_recording(void)
+{
+	struct js_ctx *ctx = mock_ctx_new();
+	struct mock_device *d = mock_device_new(ctx, "microsoft-xbox-360-pad");
+	struct js_event *event;
+	int nframes;
+	int nbutton = 0, naxis = 0, nsync = 0;
+
+	mock_drain_events(ctx);
+
+	nframes = mock_device_play(d, "xbox-360-pad-buttons");
+	assert(nframes == 25);
+
+	js_ctx_dispatch(ctx);
+	while ((event = js_ctx_get_event(ctx))) {
+		switch (js_event_get_type(event)) {
+		case JS_EVENT_BUTTON:
+			nbutton++;
+			break;
+		case JS_EVENT_AXIS:
+			naxis++;
+			break;
+		case JS_EVENT_SYNC:
+			nsync++;
+			break;
+		default:
+			assert(!"unexpected event type");
+		}
+		js_event_destroy(event);
+	}
+
+	assert(nbutton == 8);
+	assert(naxis == 17);
+	assert(nsync == nframes);
+
+	js_ctx_unref(ctx);
+}
+
+int
+main(void)
+{
+	test_button_press_release();
+	test_button_state_is_sticky();
+	test_frame_without_changes();
+	test_axis();
+	test_analog_trigger();
+	test_dpad();
+	test_event_order_within_frame();
+	test_controls_of_other_device();
+	test_event_time();
+	test_recording();
+
+	return 0;
+}
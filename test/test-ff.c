@@ -0,0 +1,248 @@
+/*
+ * Copyright © 2019 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#include "config.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <linux/input.h>
+
+#include <libjoystick.h>
+
+#include "mock-backend.h"
+
+static void
+test_supported_effects(void)
+{
+	struct js_ctx *ctx = mock_ctx_new();
+	struct js_device *pad, *wheel, *stick;
+
+	pad = mock_device_get_device(mock_device_new(ctx, "microsoft-xbox-360-pad"));
+	wheel = mock_device_get_device(mock_device_new(ctx, "generic-racing-wheel"));
+	stick = mock_device_get_device(mock_device_new(ctx, "logitech-extreme-3d-pro"));
+	mock_drain_events(ctx);
+
+	assert(js_device_has_ff_effect(pad, JS_FF_EFFECT_RUMBLE));
+	assert(js_device_has_ff_effect(pad, JS_FF_EFFECT_PERIODIC));
+	assert(!js_device_has_ff_effect(pad, JS_FF_EFFECT_CONSTANT));
+	assert(!js_device_has_ff_effect(pad, JS_FF_EFFECT_SPRING));
+	assert(js_device_create_ff_effect(pad, JS_FF_EFFECT_CONSTANT) == NULL);
+
+	assert(!js_device_has_ff_effect(wheel, JS_FF_EFFECT_RUMBLE));
+	assert(js_device_has_ff_effect(wheel, JS_FF_EFFECT_CONSTANT));
+	assert(js_device_has_ff_effect(wheel, JS_FF_EFFECT_SPRING));
+
+	for (int type = JS_FF_EFFECT_RUMBLE; type <= JS_FF_EFFECT_SPRING; type++)
+		assert(!js_device_has_ff_effect(stick, type));
+	assert(js_device_set_ff_gain(stick, 0x8000) == -ENOTSUP);
+
+	js_ctx_unref(ctx);
+}
+
+static void
+test_upload_on_play(void)
+{
+	struct js_ctx *ctx = mock_ctx_new();
+	struct mock_device *d = mock_device_new(ctx, "microsoft-xbox-360-pad");
+	struct js_device *device = mock_device_get_device(d);
+	struct js_ff_effect *effect;
+	const struct ff_effect *uploaded;
+	struct mock_ff_counts counts;
+
+	mock_drain_events(ctx);
+
+	effect = js_device_create_ff_effect(device, JS_FF_EFFECT_RUMBLE);
+	assert(effect);
+	assert(js_ff_effect_get_device(effect) == device);
+
+	/* Nothing reaches the device before the effect is played */
+	assert(js_ff_effect_set_rumble(effect, 0x8000, 0x4000) == 0);
+	assert(js_ff_effect_set_rumble(effect, 0xffff, 0x1000) == 0);
+	assert(js_ff_effect_set_duration(effect, 200) == 0);
+	assert(js_ff_effect_set_constant(effect, 100) == -EINVAL);
+	counts = mock_device_get_ff_counts(d);
+	assert(counts.uploads == 0 && counts.writes == 0);
+	assert(mock_device_get_ff_effect(d, 0) == NULL);
+
+	assert(js_ff_effect_play(effect) == 0);
+	counts = mock_device_get_ff_counts(d);
+	assert(counts.uploads == 1 && counts.writes == 1);
+
+	uploaded = mock_device_get_ff_effect(d, 0);
+	assert(uploaded);
+	assert(uploaded->type == FF_RUMBLE);
+	assert(uploaded->direction == 0x4000);
+	assert(uploaded->replay.length == 200);
+	assert(uploaded->u.rumble.strong_magnitude == 0xffff);
+	assert(uploaded->u.rumble.weak_magnitude == 0x1000);
+	assert(mock_device_ff_effect_is_playing(d, 0));
+
+	/* A finite effect may have ended, playing restarts it */
+	assert(js_ff_effect_play(effect) == 0);
+	counts = mock_device_get_ff_counts(d);
+	assert(counts.uploads == 1 && counts.writes == 2);
+
+	assert(js_ff_effect_stop(effect) == 0);
+	assert(!mock_device_ff_effect_is_playing(d, 0));
+	assert(js_ff_effect_stop(effect) == 0);
+	counts = mock_device_get_ff_counts(d);
+	assert(counts.writes == 3);
+
+	js_ff_effect_destroy(effect);
+	counts = mock_device_get_ff_counts(d);
+	assert(counts.erases == 1);
+	assert(mock_device_get_ff_effect(d, 0) == NULL);
+
+	js_ctx_unref(ctx);
+}
+
+static void
+test_update_in_place(void)
+{
+	struct js_ctx *ctx = mock_ctx_new();
+	struct mock_device *d = mock_device_new(ctx, "generic-racing-wheel");
+	struct js_device *device = mock_device_get_device(d);
+	struct js_ff_effect *force, *spring;
+	struct mock_ff_counts counts;
+
+	mock_drain_events(ctx);
+
+	force = js_device_create_ff_effect(device, JS_FF_EFFECT_CONSTANT);
+	spring = js_device_create_ff_effect(device, JS_FF_EFFECT_SPRING);
+	assert(force && spring);
+
+	assert(js_ff_effect_set_spring(spring, 0, 0x2000, 0x100) == 0);
+	assert(js_ff_effect_play(spring) == 0);
+	assert(js_ff_effect_set_constant(force, -1000) == 0);
+	assert(js_ff_effect_play(force) == 0);
+	counts = mock_device_get_ff_counts(d);
+	assert(counts.uploads == 2 && counts.writes == 2);
+	assert(mock_device_get_ff_effect(d, 0)->u.condition[1].right_coeff == 0x2000);
+
+	/* An infinite effect that is still playing is not restarted */
+	assert(js_ff_effect_play(force) == 0);
+	counts = mock_device_get_ff_counts(d);
+	assert(counts.writes == 2);
+
+	/* Every change is one upload to the same slot, no play needed */
+	for (int level = 0; level < 10; level++)
+		assert(js_ff_effect_set_constant(force, level * 100) == 0);
+	counts = mock_device_get_ff_counts(d);
+	assert(counts.uploads == 12 && counts.writes == 2);
+	assert(mock_device_get_ff_effect(d, 1)->u.constant.level == 900);
+	assert(mock_device_get_ff_effect(d, 2) == NULL);
+	assert(mock_device_ff_effect_is_playing(d, 1));
+
+	/* The same values again are not sent at all */
+	assert(js_ff_effect_set_constant(force, 900) == 0);
+	assert(js_ff_effect_set_direction(force, 0x4000) == 0);
+	assert(js_ff_effect_set_spring(spring, 0, 0x2000, 0x100) == 0);
+	counts = mock_device_get_ff_counts(d);
+	assert(counts.uploads == 12);
+
+	assert(js_ff_effect_set_direction(force, 0xc000) == 0);
+	counts = mock_device_get_ff_counts(d);
+	assert(counts.uploads == 13);
+	assert(mock_device_get_ff_effect(d, 1)->direction == 0xc000);
+
+	assert(js_ff_effect_set_periodic(force, JS_FF_WAVEFORM_SINE,
+					 100, 1000, 0) == -EINVAL);
+	assert(js_ff_effect_set_rumble(spring, 1, 1) == -EINVAL);
+
+	assert(js_device_set_ff_gain(device, 0x8000) == 0);
+	assert(mock_device_get_ff_gain(d) == 0x8000);
+
+	js_ff_effect_destroy(force);
+	js_ff_effect_destroy(spring);
+	counts = mock_device_get_ff_counts(d);
+	assert(counts.erases == 2);
+
+	js_ctx_unref(ctx);
+}
+
+static void
+test_periodic(void)
+{
+	struct js_ctx *ctx = mock_ctx_new();
+	struct js_device *wheel, *pad;
+	struct js_ff_effect *effect;
+
+	wheel = mock_device_get_device(mock_device_new(ctx, "generic-racing-wheel"));
+	pad = mock_device_get_device(mock_device_new(ctx, "sony-dualshock-4"));
+	mock_drain_events(ctx);
+
+	/* The wheel has sine but no square waves */
+	effect = js_device_create_ff_effect(wheel, JS_FF_EFFECT_PERIODIC);
+	assert(effect);
+	assert(js_ff_effect_set_periodic(effect, JS_FF_WAVEFORM_SINE,
+					 100, 1000, 0) == 0);
+	assert(js_ff_effect_set_periodic(effect, JS_FF_WAVEFORM_SQUARE,
+					 100, 1000, 0) == -ENOTSUP);
+	assert(js_ff_effect_set_periodic(effect, 0, 100, 1000, 0) == -EINVAL);
+	js_ff_effect_destroy(effect);
+
+	effect = js_device_create_ff_effect(pad, JS_FF_EFFECT_PERIODIC);
+	assert(effect);
+	assert(js_ff_effect_set_periodic(effect, JS_FF_WAVEFORM_SQUARE,
+					 100, 1000, 0) == 0);
+	assert(js_ff_effect_set_periodic(effect, JS_FF_WAVEFORM_SAW_UP,
+					 100, 1000, 0) == -ENOTSUP);
+	js_ff_effect_destroy(effect);
+
+	js_ctx_unref(ctx);
+}
+
+static void
+test_unplug(void)
+{
+	struct js_ctx *ctx = mock_ctx_new();
+	struct mock_device *d = mock_device_new(ctx, "microsoft-xbox-360-pad");
+	struct js_device *device = mock_device_get_device(d);
+	struct js_ff_effect *effect;
+
+	mock_drain_events(ctx);
+
+	effect = js_device_create_ff_effect(device, JS_FF_EFFECT_RUMBLE);
+	assert(js_ff_effect_play(effect) == 0);
+
+	mock_device_unplug(d);
+	mock_drain_events(ctx);
+
+	/* The effect keeps the device alive */
+	assert(js_ff_effect_get_device(effect) == device);
+	assert(js_ff_effect_set_rumble(effect, 1, 1) == -ENODEV);
+	assert(js_ff_effect_play(effect) == -ENODEV);
+	assert(js_ff_effect_stop(effect) == -ENODEV);
+	assert(js_device_set_ff_gain(device, 0) == -ENODEV);
+	js_ff_effect_destroy(effect);
+
+	js_ctx_unref(ctx);
+}
+
+int
+main(void)
+{
+	test_supported_effects();
+	test_upload_on_play();
+	test_update_in_place();
+	test_periodic();
+	test_unplug();
+
+	return 0;
+}
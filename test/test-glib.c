@@ -0,0 +1,73 @@
+/*
+ * Copyright © 2019 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#include "config.h"
+
+#include <assert.h>
+#include <linux/input.h>
+
+#include <libjoystick-glib.h>
+
+#include "mock-backend.h"
+
+static void
+handle_event(struct js_event *event, void *data)
+{
+	unsigned int *nevents = data;
+
+	(*nevents)++;
+}
+
+static void
+test_dispatch(void)
+{
+	struct js_ctx *ctx = mock_ctx_new();
+	struct mock_device *pad = mock_device_new(ctx, "microsoft-xbox-360-pad");
+	unsigned int nevents = 0;
+	GMainContext *main_context = g_main_context_new();
+	GSource *source = js_glib_source_new(ctx);
+
+	js_glib_source_set_handler(source, handle_event, &nevents, NULL);
+	g_source_attach(source, main_context);
+
+	/* The events queued before are delivered on the first iteration */
+	while (g_main_context_iteration(main_context, FALSE))
+		;
+	assert(nevents == 1);
+
+	/* A button event and its sync */
+	mock_device_event(pad, EV_KEY, BTN_SOUTH, 1);
+	mock_device_frame(pad);
+	while (g_main_context_iteration(main_context, FALSE))
+		;
+	assert(nevents == 3);
+
+	g_source_destroy(source);
+	g_source_unref(source);
+	g_main_context_unref(main_context);
+	js_ctx_unref(ctx);
+}
+
+int
+main(void)
+{
+	test_dispatch();
+
+	return 0;
+}
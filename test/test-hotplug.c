@@ -0,0 +1,182 @@
+/*
+ * Copyright © 2019 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#include "config.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <linux/input.h>
+
+#include <libjoystick.h>
+
+#include "mock-backend.h"
+
+static void
+test_plug_unplug(void)
+{
+	struct js_ctx *ctx = mock_ctx_new();
+	struct mock_device *d;
+	struct js_device *device;
+	struct js_event *event;
+
+	mock_expect_no_events(ctx);
+
+	d = mock_device_plug(ctx, "microsoft-xbox-360-pad");
+	device = mock_device_get_device(d);
+
+	event = mock_expect_event(ctx, JS_EVENT_DEVICE_ADDED);
+	assert(js_event_get_device(event) == device);
+	js_event_destroy(event);
+	mock_expect_no_events(ctx);
+
+	js_device_ref(device);
+	mock_device_unplug(d);
+
+	event = mock_expect_event(ctx, JS_EVENT_DEVICE_REMOVED);
+	assert(js_event_get_device(event) == device);
+	js_event_destroy(event);
+	mock_expect_no_events(ctx);
+
+	/* Our reference keeps the device valid after removal */
+	assert(js_device_get_button_count(device) == 13);
+	assert(js_device_unref(device) == NULL);
+
+	js_ctx_unref(ctx);
+}
+
+static void
+test_unplug_with_pending_events(void)
+{
+	struct js_ctx *ctx = mock_ctx_new();
+	struct mock_device *d = mock_device_new(ctx, "microsoft-xbox-360-pad");
+	struct js_device *device = mock_device_get_device(d);
+	struct js_event *event;
+
+	mock_drain_events(ctx);
+
+	mock_device_event(d, EV_KEY, BTN_SOUTH, 1);
+	mock_device_frame(d);
+	js_ctx_dispatch(ctx);
+
+	mock_device_unplug(d);
+
+	/* Events already queued still reference the device */
+	event = mock_expect_event(ctx, JS_EVENT_BUTTON);
+	assert(js_event_get_device(event) == device);
+	js_event_destroy(event);
+	event = mock_expect_event(ctx, JS_EVENT_SYNC);
+	js_event_destroy(event);
+	event = mock_expect_event(ctx, JS_EVENT_DEVICE_REMOVED);
+	js_event_destroy(event);
+	mock_expect_no_events(ctx);
+
+	js_ctx_unref(ctx);
+}
+
+static void
+test_user_index(void)
+{
+	struct js_ctx *ctx = mock_ctx_new();
+	struct mock_device *d1, *d2, *d3;
+
+	d1 = mock_device_new(ctx, "microsoft-xbox-360-pad");
+	d2 = mock_device_new(ctx, "sony-dualshock-4");
+	d3 = mock_device_new(ctx, "logitech-extreme-3d-pro");
+	mock_drain_events(ctx);
+
+	assert(js_device_get_user_index(mock_device_get_device(d1)) == 0);
+	assert(js_device_get_user_index(mock_device_get_device(d2)) == 1);
+	assert(js_device_get_user_index(mock_device_get_device(d3)) == 2);
+
+	/* The lowest free index is reused */
+	mock_device_unplug(d2);
+	mock_drain_events(ctx);
+
+	d2 = mock_device_new(ctx, "generic-racing-wheel");
+	assert(js_device_get_user_index(mock_device_get_device(d2)) == 1);
+
+	d2 = mock_device_new(ctx, "sony-dualshock-4");
+	assert(js_device_get_user_index(mock_device_get_device(d2)) == 3);
+
+	js_ctx_unref(ctx);
+}
+
+static void
+test_assign_seat(void)
+{
+	struct js_ctx *ctx = mock_ctx_new();
+	struct mock_startup_times times = {0};
+	struct js_event *event;
+	int ndevices;
+
+	ndevices = mock_ctx_assign_seat(ctx, JS_TEST_DATA_DIR "/devices", &times);
+	assert(ndevices == 4);
+	assert(times.probe_ns > 0);
+	assert(times.classify_ns > 0);
+
+	/* alphabetical order */
+	for (int i = 0; i < ndevices; i++) {
+		event = mock_expect_event(ctx, JS_EVENT_DEVICE_ADDED);
+		assert(js_device_get_user_index(js_event_get_device(event)) ==
+		       (unsigned int)i);
+		if (i == 0)
+			assert(js_device_has_type(js_event_get_device(event),
+						  JS_TYPE_WHEEL));
+		js_event_destroy(event);
+	}
+	mock_expect_no_events(ctx);
+
+	assert(mock_ctx_assign_seat(ctx, "/does/not/exist", NULL) == -ENOENT);
+
+	js_ctx_unref(ctx);
+}
+
+static void
+test_ctx_unref_with_devices(void)
+{
+	struct js_ctx *ctx = mock_ctx_new();
+	struct js_device *device;
+	struct mock_device *d;
+
+	mock_device_new(ctx, "microsoft-xbox-360-pad");
+	d = mock_device_new(ctx, "sony-dualshock-4");
+	mock_device_plug(ctx, "generic-racing-wheel");
+
+	/* A device reference outlives the context's device list */
+	device = js_device_ref(mock_device_get_device(d));
+
+	/* No dispatch, the plugged device is never added and the events
+	 * are never read */
+	js_ctx_unref(ctx);
+
+	assert(js_device_get_axis_count(device) == 2);
+	js_device_unref(device);
+}
+
+int
+main(void)
+{
+	test_plug_unplug();
+	test_unplug_with_pending_events();
+	test_user_index();
+	test_assign_seat();
+	test_ctx_unref_with_devices();
+
+	return 0;
+}
@@ -0,0 +1,144 @@
+/*
+ * Copyright © 2019 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#include "config.h"
+
+#include <assert.h>
+#include <linux/input.h>
+
+/* We compare the inline accessors against the exported ones */
+#define LIBJOYSTICK_INLINE_NO_REDIRECT
+#include <libjoystick-inline.h>
+
+#include "mock-backend.h"
+
+static void
+compare_buttons(struct js_event *event, struct js_button *button)
+{
+	uint16_t value, inline_value;
+	bool state, inline_state;
+
+	assert(js_inline_event_button_value_has_changed(event, button) ==
+	       js_event_button_value_has_changed(event, button));
+	assert(js_inline_event_button_state_has_changed(event, button) ==
+	       js_event_button_state_has_changed(event, button));
+	assert(js_inline_event_button_get_value(event, button, &inline_value) ==
+	       js_event_button_get_value(event, button, &value));
+	assert(inline_value == value);
+	assert(js_inline_event_button_get_state(event, button, &inline_state) ==
+	       js_event_button_get_state(event, button, &state));
+	assert(inline_state == state);
+}
+
+static void
+compare_axes(struct js_event *event, struct js_axis *axis)
+{
+	int16_t x, y, z, inline_x, inline_y, inline_z;
+
+	assert(js_inline_event_axis_has_changed(event, axis) ==
+	       js_event_axis_has_changed(event, axis));
+	assert(js_inline_event_axis_get_value(event, axis,
+					      &inline_x, &inline_y, &inline_z) ==
+	       js_event_axis_get_value(event, axis, &x, &y, &z));
+	assert(inline_x == x);
+	assert(inline_y == y);
+	assert(inline_z == z);
+	assert(js_inline_event_axis_get_value(event, axis, NULL, NULL, NULL) ==
+	       js_event_axis_get_value(event, axis, NULL, NULL, NULL));
+}
+
+static void
+compare_dpads(struct js_event *event, struct js_dpad *dpad)
+{
+	uint32_t state, inline_state;
+
+	assert(js_inline_event_dpad_get_state(event, dpad, &inline_state) ==
+	       js_event_dpad_get_state(event, dpad, &state));
+	assert(inline_state == state);
+}
+
+static void
+compare_event(struct js_event *event, struct js_device *device)
+{
+	assert(js_inline_event_get_type(event) == js_event_get_type(event));
+	assert(js_inline_event_get_device(event) == js_event_get_device(event));
+	assert(js_inline_event_get_time_usec(event) ==
+	       js_event_get_time_usec(event));
+	assert(js_inline_event_get_frame_id(event) ==
+	       js_event_get_frame_id(event));
+
+	/* Controls of another device or of another type never match */
+	for (unsigned int i = 0; i < js_device_get_button_count(device); i++)
+		compare_buttons(event, js_device_get_button(device, i));
+	for (unsigned int i = 0; i < js_device_get_axis_count(device); i++)
+		compare_axes(event, js_device_get_axis(device, i));
+	for (unsigned int i = 0; i < js_device_get_dpad_count(device); i++)
+		compare_dpads(event, js_device_get_dpad(device, i));
+
+	compare_buttons(event, NULL);
+	compare_axes(event, NULL);
+	compare_dpads(event, NULL);
+}
+
+static void
+test_accessors(void)
+{
+	struct js_ctx *ctx = mock_ctx_new();
+	struct mock_device *pad = mock_device_new(ctx, "microsoft-xbox-360-pad");
+	struct mock_device *stick = mock_device_new(ctx, "logitech-extreme-3d-pro");
+	struct js_device *devices[] = {
+		mock_device_get_device(pad),
+		mock_device_get_device(stick),
+	};
+	struct js_event *event;
+	unsigned int nevents = 0;
+
+	mock_drain_events(ctx);
+
+	for (int i = 0; i < 4; i++) {
+		mock_device_event(pad, EV_KEY, BTN_SOUTH, (i + 1) % 2);
+		mock_device_event(pad, EV_KEY, BTN_TR, i % 2);
+		mock_device_event(pad, EV_ABS, ABS_X, (i + 1) * 1000);
+		mock_device_event(pad, EV_ABS, ABS_RZ, i * 50);
+		mock_device_event(pad, EV_ABS, ABS_HAT0X, i % 3 - 1);
+		mock_device_frame(pad);
+		mock_device_event(stick, EV_KEY, BTN_TRIGGER, (i + 1) % 2);
+		mock_device_event(stick, EV_ABS, ABS_Y, (i + 1) * 100);
+		mock_device_frame(stick);
+	}
+	js_ctx_dispatch(ctx);
+
+	while ((event = js_ctx_get_event(ctx))) {
+		for (size_t i = 0; i < sizeof(devices)/sizeof(devices[0]); i++)
+			compare_event(event, devices[i]);
+		js_event_destroy(event);
+		nevents++;
+	}
+	assert(nevents > 8);
+
+	js_ctx_unref(ctx);
+}
+
+int
+main(void)
+{
+	test_accessors();
+
+	return 0;
+}
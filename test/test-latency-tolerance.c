@@ -0,0 +1,178 @@
+/*
+ * Copyright © 2019 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#include "config.h"
+
+#include <assert.h>
+#include <linux/input.h>
+#include <poll.h>
+#include <stdio.h>
+#include <time.h>
+
+#include <libjoystick.h>
+
+#include "mock-backend.h"
+
+#define TOLERANCE_MS 20
+
+static bool
+wait_readable(struct js_ctx *ctx, int timeout_ms)
+{
+	struct pollfd fds = { .fd = js_ctx_get_fd(ctx), .events = POLLIN };
+
+	return poll(&fds, 1, timeout_ms) == 1;
+}
+
+static uint64_t
+now_ms(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static unsigned int
+count_frames(struct js_ctx *ctx)
+{
+	struct js_event *event;
+	unsigned int nframes = 0;
+
+	js_ctx_dispatch(ctx);
+	while ((event = js_ctx_get_event(ctx))) {
+		if (js_event_get_type(event) == JS_EVENT_SYNC)
+			nframes++;
+		js_event_destroy(event);
+	}
+
+	return nframes;
+}
+
+static void
+press(struct mock_device *d, int value)
+{
+	mock_device_event(d, EV_KEY, BTN_SOUTH, value);
+	mock_device_frame(d);
+}
+
+static void
+test_delay(void)
+{
+	struct js_ctx *ctx = mock_ctx_new();
+	struct mock_device *d = mock_device_new(ctx, "microsoft-xbox-360-pad");
+	uint64_t start;
+
+	mock_drain_events(ctx);
+	assert(js_ctx_set_latency_tolerance(ctx, TOLERANCE_MS * 1000) == 0);
+
+	/* The first input wakes us up once to start the timer */
+	start = now_ms();
+	press(d, 1);
+	assert(wait_readable(ctx, 0));
+	assert(count_frames(ctx) == 0);
+	assert(!wait_readable(ctx, 0));
+
+	press(d, 0);
+	assert(wait_readable(ctx, 1000));
+	assert(now_ms() - start >= TOLERANCE_MS - 1);
+	assert(count_frames(ctx) == 2);
+
+	/* While input keeps coming, it only shows up with the timer */
+	press(d, 1);
+	assert(!wait_readable(ctx, 0));
+	assert(wait_readable(ctx, 1000));
+	assert(count_frames(ctx) == 1);
+
+	/* A period without input stops the timer */
+	assert(wait_readable(ctx, 1000));
+	assert(count_frames(ctx) == 0);
+	assert(!wait_readable(ctx, 2 * TOLERANCE_MS));
+
+	press(d, 0);
+	assert(wait_readable(ctx, 0));
+
+	js_ctx_unref(ctx);
+}
+
+static void
+test_wakeups(void)
+{
+	struct js_ctx *ctx = mock_ctx_new();
+	struct mock_device *d = mock_device_new(ctx, "microsoft-xbox-360-pad");
+	unsigned int wakeups = 0, nframes = 0;
+	const unsigned int nsent = 200;
+
+	mock_drain_events(ctx);
+	assert(js_ctx_set_latency_tolerance(ctx, 10000) == 0);
+
+	/* A 1 kHz device, give or take the scheduler */
+	for (unsigned int i = 0; i < nsent; i++) {
+		press(d, i % 2 == 0);
+		if (wait_readable(ctx, 1)) {
+			wakeups++;
+			nframes += count_frames(ctx);
+		}
+	}
+
+	/* Disabling the tolerance releases what is still waiting */
+	assert(js_ctx_set_latency_tolerance(ctx, 0) == 0);
+	nframes += count_frames(ctx);
+
+	fprintf(stderr, "%u frames, %u wakeups\n", nframes, wakeups);
+	assert(nframes == nsent);
+	assert(wakeups < nsent / 4);
+
+	js_ctx_unref(ctx);
+}
+
+static void
+test_hotplug(void)
+{
+	struct js_ctx *ctx = mock_ctx_new();
+	struct mock_device *d;
+	struct js_event *event;
+
+	assert(js_ctx_set_latency_tolerance(ctx, TOLERANCE_MS * 1000) == 0);
+
+	/* Hotplug is not delayed, the new device's input is */
+	d = mock_device_plug(ctx, "sony-dualshock-4");
+	event = mock_expect_event(ctx, JS_EVENT_DEVICE_ADDED);
+	js_event_destroy(event);
+
+	press(d, 1);
+	assert(count_frames(ctx) == 0);
+	assert(wait_readable(ctx, 1000));
+	assert(count_frames(ctx) == 1);
+
+	mock_device_unplug(d);
+	event = mock_expect_event(ctx, JS_EVENT_DEVICE_REMOVED);
+	js_event_destroy(event);
+
+	js_ctx_unref(ctx);
+}
+
+int
+main(void)
+{
+	test_delay();
+	test_wakeups();
+	test_hotplug();
+
+	return 0;
+}
@@ -0,0 +1,353 @@
+/*
+ * Copyright © 2019 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#include "config.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <limits.h>
+#include <linux/input.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <libjoystick.h>
+
+#include "mock-backend.h"
+
+/* The per-device footprint we promise to keep below, libevdev and the
+ * backend excluded. Raise it only with good reason. */
+#define DEVICE_BUDGET (8 * 1024)
+
+static const char *devices[] = {
+	"microsoft-xbox-360-pad",
+	"sony-dualshock-4",
+	"logitech-extreme-3d-pro",
+	"generic-racing-wheel",
+};
+
+static void
+test_device_budget(void)
+{
+	for (size_t i = 0; i < sizeof(devices)/sizeof(devices[0]); i++) {
+		struct js_ctx *ctx = mock_ctx_new();
+		struct mock_device *d = mock_device_new(ctx, devices[i]);
+		struct js_device *device = mock_device_get_device(d);
+		size_t total;
+
+		mock_drain_events(ctx);
+
+		total = js_device_get_memory_usage(device, JS_MEMORY_TOTAL);
+		if (total > DEVICE_BUDGET) {
+			fprintf(stderr,
+				"%s: %zu bytes exceeds the budget of %d bytes\n",
+				devices[i], total, DEVICE_BUDGET);
+			abort();
+		}
+
+		assert(js_device_get_memory_usage(device, JS_MEMORY_CONTEXT) == 0);
+		assert(js_device_get_memory_usage(device, JS_MEMORY_DESCRIPTORS) > 0);
+		assert(js_device_get_memory_usage(device, JS_MEMORY_STATE) > 0);
+		assert(js_device_get_memory_usage(device, JS_MEMORY_EVENT_QUEUE) == 0);
+
+		js_ctx_unref(ctx);
+	}
+}
+
+/* Without the context itself: a device may take a source the context
+ * had reserved */
+static size_t
+ctx_usage(struct js_ctx *ctx)
+{
+	return js_ctx_get_memory_usage(ctx, JS_MEMORY_TOTAL) -
+	       js_ctx_get_memory_usage(ctx, JS_MEMORY_CONTEXT);
+}
+
+static void
+test_ctx_usage(void)
+{
+	struct js_ctx *ctx = mock_ctx_new();
+	struct mock_device *d1, *d2;
+	size_t empty, one, two, reserved;
+
+	assert(js_ctx_get_memory_usage(ctx, JS_MEMORY_TOTAL) > 0);
+	empty = ctx_usage(ctx);
+	assert(js_ctx_get_memory_usage(ctx, JS_MEMORY_DEVICES) == 0);
+
+	d1 = mock_device_new(ctx, "microsoft-xbox-360-pad");
+	mock_drain_events(ctx);
+	one = ctx_usage(ctx);
+	assert(one == empty +
+	       js_device_get_memory_usage(mock_device_get_device(d1),
+					  JS_MEMORY_TOTAL));
+
+	d2 = mock_device_new(ctx, "sony-dualshock-4");
+	mock_drain_events(ctx);
+	two = ctx_usage(ctx);
+	assert(two == one +
+	       js_device_get_memory_usage(mock_device_get_device(d2),
+					  JS_MEMORY_TOTAL));
+
+	/* Queued events count until they are retrieved. Events taken from
+	 * the pool, if the build reserves one, are part of the pool. */
+	reserved = js_ctx_get_memory_usage(ctx, JS_MEMORY_EVENT_QUEUE);
+	mock_device_event(d1, EV_KEY, BTN_SOUTH, 1);
+	mock_device_frame(d1);
+	js_ctx_dispatch(ctx);
+	assert(reserved > 0 ||
+	       js_ctx_get_memory_usage(ctx, JS_MEMORY_EVENT_QUEUE) > 0);
+	assert(js_ctx_get_memory_usage(ctx, JS_MEMORY_EVENT_QUEUE) - reserved ==
+	       js_device_get_memory_usage(mock_device_get_device(d1),
+					  JS_MEMORY_EVENT_QUEUE));
+	mock_drain_events(ctx);
+	assert(js_ctx_get_memory_usage(ctx, JS_MEMORY_EVENT_QUEUE) == reserved);
+	assert(ctx_usage(ctx) == two);
+
+	/* Removed devices are no longer part of the context */
+	mock_device_unplug(d2);
+	mock_drain_events(ctx);
+	for (enum js_memory_category c = JS_MEMORY_DEVICES;
+	     c <= JS_MEMORY_STATE;
+	     c++) {
+		assert(js_ctx_get_memory_usage(ctx, c) ==
+		       js_device_get_memory_usage(mock_device_get_device(d1), c));
+	}
+
+	js_ctx_unref(ctx);
+}
+
+struct alloc_counter {
+	unsigned int nallocs;
+	unsigned int nfrees;
+	bool fail;
+};
+
+static void *
+counting_malloc(size_t size, void *user_data)
+{
+	struct alloc_counter *counter = user_data;
+
+	if (counter->fail)
+		return NULL;
+
+	counter->nallocs++;
+	return malloc(size);
+}
+
+static void
+counting_free(void *ptr, void *user_data)
+{
+	struct alloc_counter *counter = user_data;
+
+	counter->nfrees++;
+	free(ptr);
+}
+
+static void
+test_reserve(void)
+{
+	struct alloc_counter counter = {0};
+	struct js_allocator allocator = {
+		.malloc = counting_malloc,
+		.free = counting_free,
+		.user_data = &counter,
+	};
+	struct js_ctx *ctx;
+	struct mock_device *d;
+	struct js_event *event;
+	unsigned int nallocs;
+	size_t before;
+
+	js_set_allocator(&allocator);
+
+	ctx = mock_ctx_new();
+	before = js_ctx_get_memory_usage(ctx, JS_MEMORY_EVENT_QUEUE);
+	/* On top of what an embedded build reserves by default */
+	assert(js_ctx_reserve(ctx, 2, JS_MAX_QUEUED_EVENTS + 16) == 0);
+	assert(js_ctx_get_memory_usage(ctx, JS_MEMORY_EVENT_QUEUE) > before);
+
+	d = mock_device_new(ctx, "microsoft-xbox-360-pad");
+	mock_device_unplug(mock_device_new(ctx, "sony-dualshock-4"));
+	mock_drain_events(ctx);
+	assert(counter.nallocs > 0);
+
+	/* Steady state: no allocations, not even for events retrieved and
+	 * held by the caller */
+	nallocs = counter.nallocs;
+	for (int i = 0; i < 20; i++) {
+		mock_device_event(d, EV_KEY, BTN_SOUTH, (i + 1) % 2);
+		mock_device_event(d, EV_ABS, ABS_X, (i + 1) * 100);
+		mock_device_frame(d);
+		mock_drain_events(ctx);
+	}
+	assert(counter.nallocs == nallocs);
+
+	/* Events may outlive the context and its pool */
+	mock_device_event(d, EV_KEY, BTN_SOUTH, 1);
+	mock_device_frame(d);
+	event = mock_expect_event(ctx, JS_EVENT_BUTTON);
+	js_ctx_unref(ctx);
+	assert(js_event_get_type(event) == JS_EVENT_BUTTON);
+	js_event_destroy(event);
+
+	assert(counter.nallocs == counter.nfrees);
+
+	js_set_allocator(NULL);
+}
+
+static unsigned int
+plug_allocs(struct js_ctx *ctx, struct alloc_counter *counter)
+{
+	unsigned int nallocs = counter->nallocs;
+
+	mock_device_new(ctx, "microsoft-xbox-360-pad");
+	mock_drain_events(ctx);
+
+	return counter->nallocs - nallocs;
+}
+
+static void
+test_reserve_latency_tolerance(void)
+{
+	struct alloc_counter counter = {0};
+	struct js_allocator allocator = {
+		.malloc = counting_malloc,
+		.free = counting_free,
+		.user_data = &counter,
+	};
+	struct js_ctx *ctx;
+	unsigned int first;
+
+	js_set_allocator(&allocator);
+
+	/* The tolerance's sources do not come out of the devices' share,
+	 * the last device allocates just as much as the first */
+	ctx = mock_ctx_new();
+	assert(js_ctx_reserve(ctx, 2, 0) == 0);
+	assert(js_ctx_set_latency_tolerance(ctx, 1000) == 0);
+	first = plug_allocs(ctx, &counter);
+	assert(plug_allocs(ctx, &counter) == first);
+	js_ctx_unref(ctx);
+
+	assert(counter.nallocs == counter.nfrees);
+
+	js_set_allocator(NULL);
+}
+
+static void
+test_reserve_errors(void)
+{
+	struct alloc_counter counter = {0};
+	struct js_allocator allocator = {
+		.malloc = counting_malloc,
+		.free = counting_free,
+		.user_data = &counter,
+	};
+	struct js_ctx *ctx = mock_ctx_new();
+
+	assert(js_ctx_reserve(ctx, UINT_MAX, 0) == -EINVAL);
+	assert(js_ctx_reserve(ctx, 1025, 0) == -EINVAL);
+	assert(js_ctx_reserve(ctx, 0, UINT_MAX) == -EINVAL);
+
+	js_set_allocator(&allocator);
+	counter.fail = true;
+	assert(js_ctx_reserve(ctx, 2, JS_MAX_QUEUED_EVENTS + 64) == -ENOMEM);
+	counter.fail = false;
+	js_ctx_unref(ctx);
+	js_set_allocator(NULL);
+}
+
+#if JS_MAX_QUEUED_EVENTS > 0
+/* With max-queued-events, a full queue drops frames instead of
+ * allocating more events */
+static void
+test_fixed_queue(void)
+{
+	struct alloc_counter counter = {0};
+	struct js_allocator allocator = {
+		.malloc = counting_malloc,
+		.free = counting_free,
+		.user_data = &counter,
+	};
+	struct js_ctx *ctx = mock_ctx_new();
+	struct mock_device *d;
+	struct js_event *event;
+	unsigned int nevents = 0;
+
+	d = mock_device_new(ctx, "microsoft-xbox-360-pad");
+	mock_drain_events(ctx);
+
+	js_set_allocator(&allocator);
+
+	/* Three events per frame, the queue fills up long before this */
+	for (int i = 0; i < JS_MAX_QUEUED_EVENTS; i++) {
+		mock_device_event(d, EV_KEY, BTN_SOUTH, (i + 1) % 2);
+		mock_device_event(d, EV_ABS, ABS_X, (i + 1) * 100);
+		mock_device_frame(d);
+		js_ctx_dispatch(ctx);
+	}
+	assert(counter.nallocs == 0);
+
+	/* The hotplug events have their own slots */
+	mock_device_unplug(mock_device_new(ctx, "sony-dualshock-4"));
+	js_ctx_dispatch(ctx);
+
+	while ((event = js_ctx_get_event(ctx))) {
+		nevents++;
+		js_event_destroy(event);
+	}
+	assert(nevents == JS_MAX_QUEUED_EVENTS / 3 * 3 + 2);
+
+#if HAVE_STATISTICS
+	{
+		struct js_stats *stats = js_ctx_get_stats(ctx);
+
+		assert(js_stats_get_counter(stats, JS_STATS_QUEUE_OVERFLOWS) ==
+		       JS_MAX_QUEUED_EVENTS - JS_MAX_QUEUED_EVENTS / 3);
+		js_stats_destroy(stats);
+	}
+#endif
+
+	/* The changes of the dropped frames come with the next frame */
+	mock_device_event(d, EV_ABS, ABS_X, 0);
+	mock_device_frame(d);
+	js_event_destroy(mock_expect_event(ctx, JS_EVENT_AXIS));
+	js_event_destroy(mock_expect_event(ctx, JS_EVENT_BUTTON));
+	js_event_destroy(mock_expect_event(ctx, JS_EVENT_SYNC));
+	mock_expect_no_events(ctx);
+
+	js_set_allocator(NULL);
+	js_ctx_unref(ctx);
+}
+#endif
+
+int
+main(void)
+{
+	test_device_budget();
+	test_ctx_usage();
+	test_reserve();
+	test_reserve_latency_tolerance();
+	test_reserve_errors();
+#if JS_MAX_QUEUED_EVENTS > 0
+	test_fixed_queue();
+#endif
+
+	return 0;
+}
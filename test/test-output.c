@@ -0,0 +1,277 @@
+/*
+ * Copyright © 2019 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#include "config.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <linux/input.h>
+
+#include <libjoystick.h>
+
+#include "mock-backend.h"
+
+#define NPADS 4		/* within -Dmax-devices=4 */
+
+static void
+test_has_output(void)
+{
+	struct js_ctx *ctx = mock_ctx_new();
+	struct mock_device *d = mock_device_new(ctx, "sony-dualshock-4");
+	struct js_device *pad = mock_device_get_device(d);
+	struct js_device *stick;
+
+	stick = mock_device_get_device(mock_device_new(ctx, "logitech-extreme-3d-pro"));
+	mock_drain_events(ctx);
+
+	assert(js_device_has_output(pad, JS_OUTPUT_RUMBLE));
+	assert(!js_device_has_output(pad, JS_OUTPUT_LIGHTBAR));
+	assert(js_device_set_lightbar(pad, 0, 0, 255) == -ENOTSUP);
+
+	mock_device_add_output(d, JS_OUTPUT_LIGHTBAR);
+	assert(js_device_has_output(pad, JS_OUTPUT_LIGHTBAR));
+	assert(!js_device_has_output(pad, JS_OUTPUT_PLAYER_INDICATOR));
+
+	assert(!js_device_has_output(stick, JS_OUTPUT_RUMBLE));
+	assert(js_device_set_rumble(stick, 0xffff, 0xffff) == -ENOTSUP);
+	assert(js_device_set_player_indicator(stick, 0x1) == -ENOTSUP);
+
+	js_ctx_unref(ctx);
+}
+
+static void
+test_coalesce(void)
+{
+	struct js_ctx *ctx = mock_ctx_new();
+	struct mock_device *pads[NPADS];
+	struct mock_ff_counts counts;
+	uint8_t color[3];
+
+	for (int i = 0; i < NPADS; i++) {
+		pads[i] = mock_device_new(ctx, "sony-dualshock-4");
+		mock_device_add_output(pads[i], JS_OUTPUT_PLAYER_INDICATOR);
+		mock_device_add_output(pads[i], JS_OUTPUT_LIGHTBAR);
+	}
+	mock_drain_events(ctx);
+
+	/* A game updating everything several times per frame */
+	for (int update = 0; update < 10; update++) {
+		for (int i = 0; i < NPADS; i++) {
+			struct js_device *device = mock_device_get_device(pads[i]);
+
+			assert(js_device_set_rumble(device, update * 100, i) == 0);
+			assert(js_device_set_player_indicator(device, update) == 0);
+			assert(js_device_set_lightbar(device, i, update, 0) == 0);
+		}
+	}
+
+	for (int i = 0; i < NPADS; i++) {
+		counts = mock_device_get_ff_counts(pads[i]);
+		assert(counts.uploads == 0 && counts.writes == 0);
+		assert(mock_device_get_output_writes(pads[i]) == 0);
+	}
+
+	assert(js_ctx_flush_output(ctx) == 0);
+
+	/* Only the latest values, once */
+	for (int i = 0; i < NPADS; i++) {
+		const struct ff_effect *effect;
+
+		counts = mock_device_get_ff_counts(pads[i]);
+		assert(counts.uploads == 1 && counts.writes == 1);
+		effect = mock_device_get_ff_effect(pads[i], 0);
+		assert(effect->u.rumble.strong_magnitude == 900);
+		assert(effect->u.rumble.weak_magnitude == i);
+		assert(mock_device_ff_effect_is_playing(pads[i], 0));
+
+		assert(mock_device_get_output_writes(pads[i]) == 2);
+		assert(mock_device_get_player_indicator(pads[i]) == 9);
+		mock_device_get_lightbar(pads[i], color);
+		assert(color[0] == i && color[1] == 9 && color[2] == 0);
+	}
+
+	/* Nothing pending, nothing written */
+	assert(js_ctx_flush_output(ctx) == 0);
+	for (int i = 0; i < NPADS; i++) {
+		struct js_device *device = mock_device_get_device(pads[i]);
+
+		assert(js_device_set_rumble(device, 900, i) == 0);
+		assert(js_device_set_player_indicator(device, 9) == 0);
+	}
+	assert(js_ctx_flush_output(ctx) == 0);
+	for (int i = 0; i < NPADS; i++) {
+		counts = mock_device_get_ff_counts(pads[i]);
+		assert(counts.uploads == 1 && counts.writes == 1);
+		assert(mock_device_get_output_writes(pads[i]) == 2);
+	}
+
+	js_ctx_unref(ctx);
+}
+
+static void
+test_flush_on_dispatch(void)
+{
+	struct js_ctx *ctx = mock_ctx_new();
+	struct mock_device *d = mock_device_new(ctx, "microsoft-xbox-360-pad");
+	struct js_device *device = mock_device_get_device(d);
+	struct mock_ff_counts counts;
+
+	mock_device_add_output(d, JS_OUTPUT_PLAYER_INDICATOR);
+	mock_drain_events(ctx);
+
+	assert(js_device_set_player_indicator(device, 0x2) == 0);
+	assert(js_device_set_rumble(device, 0x8000, 0x8000) == 0);
+	js_ctx_dispatch(ctx);
+	assert(mock_device_get_player_indicator(d) == 0x2);
+	assert(mock_device_ff_effect_is_playing(d, 0));
+
+	/* Changing the rumble updates the playing effect in place */
+	assert(js_device_set_rumble(device, 0x1000, 0) == 0);
+	js_ctx_dispatch(ctx);
+	counts = mock_device_get_ff_counts(d);
+	assert(counts.uploads == 2 && counts.writes == 1);
+	assert(mock_device_get_ff_effect(d, 0)->u.rumble.strong_magnitude == 0x1000);
+
+	assert(js_device_set_rumble(device, 0, 0) == 0);
+	js_ctx_dispatch(ctx);
+	counts = mock_device_get_ff_counts(d);
+	assert(counts.uploads == 2 && counts.writes == 2);
+	assert(!mock_device_ff_effect_is_playing(d, 0));
+
+	assert(js_device_set_rumble(device, 0xffff, 0) == 0);
+	js_ctx_dispatch(ctx);
+	counts = mock_device_get_ff_counts(d);
+	assert(counts.uploads == 3 && counts.writes == 3);
+	assert(mock_device_get_ff_effect(d, 1) == NULL);
+	assert(mock_device_ff_effect_is_playing(d, 0));
+
+	js_ctx_unref(ctx);
+}
+
+static void
+test_set_back(void)
+{
+	struct js_ctx *ctx = mock_ctx_new();
+	struct mock_device *d = mock_device_new(ctx, "sony-dualshock-4");
+	struct js_device *device = mock_device_get_device(d);
+	struct mock_ff_counts counts;
+	uint8_t color[3];
+
+	mock_device_add_output(d, JS_OUTPUT_PLAYER_INDICATOR);
+	mock_device_add_output(d, JS_OUTPUT_LIGHTBAR);
+	mock_drain_events(ctx);
+
+	assert(js_device_set_player_indicator(device, 0x1) == 0);
+	assert(js_device_set_lightbar(device, 0, 0, 255) == 0);
+	assert(js_device_set_rumble(device, 0x4000, 0) == 0);
+	assert(js_ctx_flush_output(ctx) == 0);
+	assert(mock_device_get_output_writes(d) == 2);
+
+	/* A -> B -> A within one dispatch writes nothing */
+	assert(js_device_set_player_indicator(device, 0x2) == 0);
+	assert(js_device_set_player_indicator(device, 0x1) == 0);
+	assert(js_device_set_lightbar(device, 255, 0, 0) == 0);
+	assert(js_device_set_lightbar(device, 0, 0, 255) == 0);
+	assert(js_device_set_rumble(device, 0xffff, 0xffff) == 0);
+	assert(js_device_set_rumble(device, 0x4000, 0) == 0);
+	assert(js_ctx_flush_output(ctx) == 0);
+	assert(mock_device_get_output_writes(d) == 2);
+	counts = mock_device_get_ff_counts(d);
+	assert(counts.uploads == 1 && counts.writes == 1);
+
+	/* Only the output that ends up different is written */
+	assert(js_device_set_player_indicator(device, 0x2) == 0);
+	assert(js_device_set_lightbar(device, 255, 0, 0) == 0);
+	assert(js_device_set_lightbar(device, 0, 0, 255) == 0);
+	assert(js_ctx_flush_output(ctx) == 0);
+	assert(mock_device_get_output_writes(d) == 3);
+	assert(mock_device_get_player_indicator(d) == 0x2);
+	mock_device_get_lightbar(d, color);
+	assert(color[0] == 0 && color[1] == 0 && color[2] == 255);
+
+	js_ctx_unref(ctx);
+}
+
+static void
+test_failed_write(void)
+{
+	struct js_ctx *ctx = mock_ctx_new();
+	struct mock_device *d = mock_device_new(ctx, "sony-dualshock-4");
+	struct js_device *device = mock_device_get_device(d);
+	uint8_t color[3];
+
+	mock_device_add_output(d, JS_OUTPUT_LIGHTBAR);
+	mock_drain_events(ctx);
+
+	mock_device_fail_output(d, -EIO);
+	assert(js_device_set_lightbar(device, 255, 0, 0) == 0);
+	assert(js_ctx_flush_output(ctx) == -EIO);
+	assert(mock_device_get_output_writes(d) == 0);
+
+	/* Not retried by itself, but the same value is written again */
+	assert(js_ctx_flush_output(ctx) == 0);
+	assert(mock_device_get_output_writes(d) == 0);
+	assert(js_device_set_lightbar(device, 255, 0, 0) == 0);
+	assert(js_ctx_flush_output(ctx) == 0);
+	assert(mock_device_get_output_writes(d) == 1);
+	mock_device_get_lightbar(d, color);
+	assert(color[0] == 255 && color[1] == 0 && color[2] == 0);
+
+	js_ctx_unref(ctx);
+}
+
+static void
+test_unplug_pending(void)
+{
+	struct js_ctx *ctx = mock_ctx_new();
+	struct mock_device *d = mock_device_new(ctx, "sony-dualshock-4");
+	struct mock_device *other = mock_device_new(ctx, "sony-dualshock-4");
+	struct js_device *device = mock_device_get_device(d);
+
+	mock_device_add_output(d, JS_OUTPUT_LIGHTBAR);
+	mock_device_add_output(other, JS_OUTPUT_LIGHTBAR);
+	mock_drain_events(ctx);
+
+	assert(js_device_set_lightbar(device, 1, 2, 3) == 0);
+	assert(js_device_set_lightbar(mock_device_get_device(other), 4, 5, 6) == 0);
+
+	js_device_ref(device);
+	mock_device_unplug(d);
+	mock_drain_events(ctx);
+	assert(mock_device_get_output_writes(other) == 1);
+
+	assert(js_device_set_lightbar(device, 0, 0, 0) == -ENODEV);
+	assert(js_device_set_rumble(device, 0, 0) == -ENODEV);
+	js_device_unref(device);
+
+	js_ctx_unref(ctx);
+}
+
+int
+main(void)
+{
+	test_has_output();
+	test_coalesce();
+	test_set_back();
+	test_flush_on_dispatch();
+	test_failed_write();
+	test_unplug_pending();
+
+	return 0;
+}
@@ -0,0 +1,187 @@
+/*
+ * Copyright © 2019 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#include "config.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <linux/input.h>
+#include <poll.h>
+
+#include <libjoystick.h>
+
+#include "mock-backend.h"
+
+static struct js_button *
+find_button(struct js_device *device, enum js_button_capability cap)
+{
+	for (size_t i = 0; i < js_device_get_button_count(device); i++) {
+		struct js_button *button = js_device_get_button(device, i);
+
+		if (js_button_has_capability(button, cap))
+			return button;
+	}
+
+	return NULL;
+}
+
+static bool
+ctx_is_readable(struct js_ctx *ctx)
+{
+	struct pollfd fds = { .fd = js_ctx_get_fd(ctx), .events = POLLIN };
+
+	return poll(&fds, 1, 0) == 1;
+}
+
+static void
+background_input(struct mock_device *d)
+{
+	mock_device_event(d, EV_ABS, ABS_X, 20000);
+	mock_device_frame(d);
+	mock_device_event(d, EV_KEY, BTN_SOUTH, 1);
+	mock_device_frame(d);
+	mock_device_event(d, EV_ABS, ABS_Y, -20000);
+	mock_device_event(d, EV_KEY, BTN_SOUTH, 0);
+	mock_device_frame(d);
+}
+
+static void
+test_background(bool kernel_mask)
+{
+	struct js_ctx *ctx = mock_ctx_new();
+	struct mock_device *d = mock_device_new(ctx, "microsoft-xbox-360-pad");
+	struct js_device *device = mock_device_get_device(d);
+	struct js_button *home = find_button(device, JS_BUTTON_CAP_SYSTEM),
+			 *ok = find_button(device, JS_BUTTON_CAP_OK);
+	struct js_axis *left = js_device_get_axis(device, 0);
+	struct js_event *event;
+	bool state;
+	int16_t x, y;
+
+	if (!kernel_mask)
+		mock_device_fail_event_mask(d, -EINVAL);
+	mock_drain_events(ctx);
+
+	assert(js_ctx_set_power_mode(ctx, 42) == -EINVAL);
+	assert(js_ctx_set_power_mode(ctx, JS_POWER_MODE_BACKGROUND) == 0);
+	assert(js_ctx_set_power_mode(ctx, JS_POWER_MODE_BACKGROUND) == 0);
+
+	/* With EVIOCSMASK, these never wake us up */
+	background_input(d);
+	assert(ctx_is_readable(ctx) == !kernel_mask);
+	mock_expect_no_events(ctx);
+
+	/* The system button still gets through */
+	mock_device_event(d, EV_KEY, BTN_MODE, 1);
+	mock_device_frame(d);
+	event = mock_expect_event(ctx, JS_EVENT_BUTTON);
+	assert(js_event_button_get_state(event, home, &state));
+	assert(state);
+	assert(!js_event_button_state_has_changed(event, ok));
+	js_event_destroy(event);
+	event = mock_expect_event(ctx, JS_EVENT_SYNC);
+	js_event_destroy(event);
+	mock_expect_no_events(ctx);
+
+	/* Back to active, the stick moved in the meantime */
+	assert(js_ctx_set_power_mode(ctx, JS_POWER_MODE_ACTIVE) == 0);
+	event = mock_expect_event(ctx, JS_EVENT_AXIS);
+	assert(js_event_axis_get_value(event, left, &x, &y, NULL));
+	assert(x == 20000);
+	assert(y == -20000);
+	js_event_destroy(event);
+	event = mock_expect_event(ctx, JS_EVENT_SYNC);
+	js_event_destroy(event);
+	mock_expect_no_events(ctx);
+
+	mock_device_event(d, EV_KEY, BTN_SOUTH, 1);
+	mock_device_frame(d);
+	event = mock_expect_event(ctx, JS_EVENT_BUTTON);
+	assert(js_event_button_get_state(event, ok, &state));
+	assert(state);
+	js_event_destroy(event);
+	mock_drain_events(ctx);
+
+	js_ctx_unref(ctx);
+}
+
+static void
+test_background_other_keys(void)
+{
+	struct js_ctx *ctx = mock_ctx_new();
+	struct mock_device *d = mock_device_new(ctx, "sony-dualshock-4");
+	struct js_event *event;
+
+	/* Filtered by libjoystick, including keys outside the button
+	 * range */
+	mock_device_fail_event_mask(d, -EINVAL);
+	mock_drain_events(ctx);
+	assert(js_ctx_set_power_mode(ctx, JS_POWER_MODE_BACKGROUND) == 0);
+
+	mock_device_event(d, EV_KEY, KEY_HOMEPAGE, 1);
+	mock_device_frame(d);
+	mock_device_event(d, EV_KEY, KEY_RECORD, 1);
+	mock_device_event(d, EV_KEY, KEY_HOMEPAGE, 0);
+	mock_device_frame(d);
+	mock_expect_no_events(ctx);
+
+	mock_device_event(d, EV_KEY, BTN_MODE, 1);
+	mock_device_frame(d);
+	event = mock_expect_event(ctx, JS_EVENT_BUTTON);
+	js_event_destroy(event);
+	mock_drain_events(ctx);
+
+	js_ctx_unref(ctx);
+}
+
+static void
+test_background_hotplug(void)
+{
+	struct js_ctx *ctx = mock_ctx_new();
+	struct mock_device *d;
+	struct js_event *event;
+
+	assert(js_ctx_set_power_mode(ctx, JS_POWER_MODE_BACKGROUND) == 0);
+
+	/* Hotplug is still reported and new devices are masked too */
+	d = mock_device_plug(ctx, "sony-dualshock-4");
+	event = mock_expect_event(ctx, JS_EVENT_DEVICE_ADDED);
+	js_event_destroy(event);
+
+	background_input(d);
+	assert(!ctx_is_readable(ctx));
+	mock_expect_no_events(ctx);
+
+	mock_device_unplug(d);
+	event = mock_expect_event(ctx, JS_EVENT_DEVICE_REMOVED);
+	js_event_destroy(event);
+
+	js_ctx_unref(ctx);
+}
+
+int
+main(void)
+{
+	test_background(true);
+	test_background(false);
+	test_background_other_keys();
+	test_background_hotplug();
+
+	return 0;
+}
@@ -0,0 +1,72 @@
+/*
+ * Copyright © 2019 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#include "config.h"
+
+#include <assert.h>
+#include <linux/input.h>
+
+#include <libjoystick-sd-event.h>
+
+#include "mock-backend.h"
+
+static void
+handle_event(struct js_event *event, void *data)
+{
+	unsigned int *nevents = data;
+
+	(*nevents)++;
+}
+
+static void
+test_dispatch(void)
+{
+	struct js_ctx *ctx = mock_ctx_new();
+	struct mock_device *pad = mock_device_new(ctx, "microsoft-xbox-360-pad");
+	unsigned int nevents = 0;
+	struct js_sd_event_source *source;
+	sd_event *event;
+
+	assert(sd_event_new(&event) == 0);
+	assert(js_sd_event_add(event, ctx, handle_event, &nevents, &source) == 0);
+
+	/* The events queued before are delivered on the first iteration */
+	while (sd_event_run(event, 0) > 0)
+		;
+	assert(nevents == 1);
+
+	/* A button event and its sync */
+	mock_device_event(pad, EV_KEY, BTN_SOUTH, 1);
+	mock_device_frame(pad);
+	while (sd_event_run(event, 0) > 0)
+		;
+	assert(nevents == 3);
+
+	js_sd_event_source_free(source);
+	sd_event_unref(event);
+	js_ctx_unref(ctx);
+}
+
+int
+main(void)
+{
+	test_dispatch();
+
+	return 0;
+}
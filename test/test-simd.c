@@ -0,0 +1,138 @@
+/*
+ * Copyright © 2019 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#include "config.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "simd.h"
+
+#define MAX_LEN 67
+
+static uint32_t seed = 1;
+
+static uint32_t
+next_random(void)
+{
+	/* Numerical Recipes LCG, good enough and the same everywhere */
+	seed = seed * 1664525 + 1013904223;
+	return seed;
+}
+
+static int32_t
+random_value(void)
+{
+	/* Mostly device-like ranges, with the occasional extreme */
+	switch (next_random() % 8) {
+	case 0:
+		return INT32_MIN;
+	case 1:
+		return INT32_MAX;
+	case 2:
+		return (int32_t)next_random();
+	default:
+		return (int32_t)(next_random() % 70000) - 35000;
+	}
+}
+
+static void
+test_normalize_abs(const struct js_simd_kernels *reference,
+		   const struct js_simd_kernels *k)
+{
+	int32_t value[MAX_LEN], minimum[MAX_LEN], maximum[MAX_LEN];
+	int32_t expected[MAX_LEN], out[MAX_LEN + 1];
+
+	for (int iteration = 0; iteration < 2000; iteration++) {
+		size_t len = iteration % (MAX_LEN + 1);
+
+		for (size_t i = 0; i < len; i++) {
+			value[i] = random_value();
+			switch (next_random() % 4) {
+			case 0:
+				/* Empty and inverted ranges normalize to 0 */
+				minimum[i] = random_value();
+				maximum[i] = random_value();
+				break;
+			case 1:
+				minimum[i] = INT32_MIN;
+				maximum[i] = INT32_MAX;
+				break;
+			default:
+				minimum[i] = -(int32_t)(next_random() % 33000);
+				maximum[i] = next_random() % 33000;
+				break;
+			}
+		}
+
+		reference->normalize_abs(value, minimum, maximum, expected, len);
+		out[len] = 0x5a5a5a5a;
+		k->normalize_abs(value, minimum, maximum, out, len);
+
+		for (size_t i = 0; i < len; i++) {
+			if (out[i] != expected[i]) {
+				fprintf(stderr,
+					"%s: normalize(%d, [%d, %d]) is %d, expected %d\n",
+					k->name, value[i], minimum[i], maximum[i],
+					out[i], expected[i]);
+				abort();
+			}
+			assert(out[i] >= 0 && out[i] <= 0xffff);
+		}
+		assert(out[len] == 0x5a5a5a5a);
+	}
+
+	/* The boundaries of the range */
+	value[0] = -32768;
+	minimum[0] = -32768;
+	maximum[0] = 32767;
+	value[1] = 32767;
+	minimum[1] = -32768;
+	maximum[1] = 32767;
+	k->normalize_abs(value, minimum, maximum, out, 2);
+	assert(out[0] == 0);
+	assert(out[1] == 0xffff);
+}
+
+int
+main(void)
+{
+	const struct js_simd_kernels *reference =
+		js_simd_get_kernels(JS_SIMD_SCALAR);
+
+	assert(reference);
+	assert(js_simd);
+
+	for (int level = JS_SIMD_SCALAR; level < JS_SIMD_LEVEL_COUNT; level++) {
+		const struct js_simd_kernels *k = js_simd_get_kernels(level);
+
+		if (!k) {
+			fprintf(stderr, "level %d: not supported, skipped\n", level);
+			continue;
+		}
+
+		seed = 1;
+		test_normalize_abs(reference, k);
+		fprintf(stderr, "%s: ok%s\n", k->name,
+			k == js_simd ? " (selected)" : "");
+	}
+
+	return 0;
+}
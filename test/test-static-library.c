@@ -0,0 +1,69 @@
+/*
+ * Copyright © 2019 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+
+#include "config.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include <libjoystick.h>
+
+/*
+ * Linked against libjoystick.a as installed, not against the internal
+ * library. The library's non-public symbols are local to it, so a
+ * program may use the same names.
+ */
+
+int evdev_device_added = 1;
+int alloc_hooks = 2;
+
+static int
+open_restricted(const char *path, int flags, void *user_data)
+{
+	return -ENODEV;
+}
+
+static void
+close_restricted(int fd, void *user_data)
+{
+	close(fd);
+}
+
+static const struct js_interface interface = {
+	.open_restricted = open_restricted,
+	.close_restricted = close_restricted,
+};
+
+int
+main(void)
+{
+	struct js_ctx *ctx = js_ctx_path_create_context(&interface, NULL);
+
+	assert(ctx);
+	assert(js_ctx_get_fd(ctx) >= 0);
+	assert(!js_ctx_path_add_device(ctx, "/dev/input/event0"));
+	js_ctx_unref(ctx);
+
+	assert(evdev_device_added == 1);
+	assert(alloc_hooks == 2);
+
+	return 0;
+}
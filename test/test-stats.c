@@ -0,0 +1,353 @@
+/*
+ * Copyright © 2019 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#include "config.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <linux/input.h>
+#include <pthread.h>
+
+#include <libjoystick.h>
+
+#include "mock-backend.h"
+
+static uint64_t
+counter(struct js_stats *stats, enum js_stats_counter counter)
+{
+	return js_stats_get_counter(stats, counter);
+}
+
+static void
+test_counters(void)
+{
+	struct js_ctx *ctx = mock_ctx_new();
+	struct mock_device *d = mock_device_new(ctx, "microsoft-xbox-360-pad");
+	struct js_device *device = mock_device_get_device(d);
+	struct js_stats *stats;
+	uint64_t nread;
+
+	mock_drain_events(ctx);
+
+	stats = js_ctx_get_stats(ctx);
+	assert(counter(stats, JS_STATS_EVENTS_QUEUED) == 1);
+	assert(counter(stats, JS_STATS_EVENTS_DEQUEUED) == 1);
+	assert(counter(stats, JS_STATS_QUEUE_DEPTH) == 0);
+	assert(counter(stats, JS_STATS_FRAMES) == 0);
+	nread = counter(stats, JS_STATS_EVENTS_READ);
+	js_stats_destroy(stats);
+
+	for (int i = 0; i < 3; i++) {
+		mock_device_event(d, EV_KEY, BTN_SOUTH, (i + 1) % 2);
+		mock_device_frame(d);
+	}
+	js_ctx_dispatch(ctx);
+
+	/* One button event and one sync event per frame */
+	stats = js_device_get_stats(device);
+	assert(counter(stats, JS_STATS_EVENTS_READ) == nread + 6);
+	assert(counter(stats, JS_STATS_FRAMES) == 3);
+	assert(counter(stats, JS_STATS_QUEUE_DEPTH) == 6);
+	assert(counter(stats, JS_STATS_QUEUE_HIGH_WATER) == 6);
+	assert(counter(stats, JS_STATS_SYSCALLS) > 0);
+	assert(js_stats_get_latency_count(stats, JS_STATS_LATENCY_DEQUEUE) == 0);
+	js_stats_destroy(stats);
+
+	mock_drain_events(ctx);
+
+	stats = js_device_get_stats(device);
+	assert(counter(stats, JS_STATS_QUEUE_DEPTH) == 0);
+	assert(counter(stats, JS_STATS_QUEUE_HIGH_WATER) == 6);
+	assert(counter(stats, JS_STATS_EVENTS_DEQUEUED) == 7);
+	assert(js_stats_get_latency_count(stats, JS_STATS_LATENCY_DEQUEUE) == 3);
+	assert(js_stats_get_latency_count(stats, JS_STATS_LATENCY_CONSUMED) == 0);
+	js_stats_destroy(stats);
+
+	/* The context's counters include the epoll_wait calls */
+	stats = js_ctx_get_stats(ctx);
+	assert(counter(stats, JS_STATS_FRAMES) == 3);
+	assert(counter(stats, JS_STATS_SYSCALLS) >
+	       counter(stats, JS_STATS_EVENTS_READ) / 64);
+	js_stats_destroy(stats);
+
+	js_ctx_unref(ctx);
+}
+
+static void
+test_syn_dropped(void)
+{
+	struct js_ctx *ctx = mock_ctx_new();
+	struct mock_device *d = mock_device_new(ctx, "microsoft-xbox-360-pad");
+	struct js_stats *stats;
+
+	mock_drain_events(ctx);
+
+	mock_device_event(d, EV_SYN, SYN_DROPPED, 0);
+	mock_device_event(d, EV_KEY, BTN_EAST, 1);
+	mock_device_event(d, EV_ABS, ABS_Y, 1000);
+	mock_device_frame(d);
+	mock_drain_events(ctx);
+
+	stats = js_device_get_stats(mock_device_get_device(d));
+	assert(counter(stats, JS_STATS_SYN_DROPPED) == 1);
+	assert(counter(stats, JS_STATS_EVENTS_DROPPED) == 2);
+	assert(counter(stats, JS_STATS_FRAMES) == 1);
+	js_stats_destroy(stats);
+
+	js_ctx_unref(ctx);
+}
+
+static void
+test_latency_histogram(void)
+{
+	struct js_ctx *ctx = mock_ctx_new();
+	struct mock_device *d = mock_device_new(ctx, "microsoft-xbox-360-pad");
+	struct js_stats *stats;
+	uint64_t total = 0, upper, count, last = 0;
+	unsigned int nbuckets;
+
+	mock_drain_events(ctx);
+
+	for (int i = 0; i < 20; i++) {
+		mock_device_event(d, EV_ABS, ABS_X, (i + 1) * 100);
+		mock_device_frame(d);
+	}
+	mock_drain_events(ctx);
+
+	stats = js_ctx_get_stats(ctx);
+	assert(js_stats_get_latency_count(stats, JS_STATS_LATENCY_DEQUEUE) == 20);
+	assert(js_stats_get_latency_percentile(stats, JS_STATS_LATENCY_DEQUEUE, 0) <=
+	       js_stats_get_latency_percentile(stats, JS_STATS_LATENCY_DEQUEUE, 50));
+	assert(js_stats_get_latency_percentile(stats, JS_STATS_LATENCY_DEQUEUE, 50) <=
+	       js_stats_get_latency_percentile(stats, JS_STATS_LATENCY_DEQUEUE, 100));
+
+	nbuckets = js_stats_get_latency_bucket_count(stats,
+						     JS_STATS_LATENCY_DEQUEUE);
+	assert(nbuckets > 0);
+	for (unsigned int i = 0; i < nbuckets; i++) {
+		assert(js_stats_get_latency_bucket(stats,
+						   JS_STATS_LATENCY_DEQUEUE,
+						   i, &upper, &count));
+		assert(i == 0 || upper > last);
+		assert(count > 0);
+		last = upper;
+		total += count;
+	}
+	assert(total == 20);
+	assert(!js_stats_get_latency_bucket(stats, JS_STATS_LATENCY_DEQUEUE,
+					    nbuckets, &upper, &count));
+	js_stats_destroy(stats);
+
+	js_ctx_unref(ctx);
+}
+
+static void
+test_frame_ids(void)
+{
+	struct js_ctx *ctx = mock_ctx_new();
+	struct mock_device *d = mock_device_new(ctx, "microsoft-xbox-360-pad");
+	struct js_event *event;
+	struct js_stats *stats;
+	uint64_t first, second;
+
+	event = mock_expect_event(ctx, JS_EVENT_DEVICE_ADDED);
+	assert(js_event_get_frame_id(event) == 0);
+	js_event_destroy(event);
+
+	mock_device_event(d, EV_KEY, BTN_SOUTH, 1);
+	mock_device_event(d, EV_ABS, ABS_X, 1000);
+	mock_device_frame(d);
+	mock_device_event(d, EV_KEY, BTN_SOUTH, 0);
+	mock_device_frame(d);
+
+	event = mock_expect_event(ctx, JS_EVENT_AXIS);
+	first = js_event_get_frame_id(event);
+	assert(first > 0);
+	js_event_destroy(event);
+	event = mock_expect_event(ctx, JS_EVENT_BUTTON);
+	assert(js_event_get_frame_id(event) == first);
+	js_event_destroy(event);
+	event = mock_expect_event(ctx, JS_EVENT_SYNC);
+	assert(js_event_get_frame_id(event) == first);
+	js_event_destroy(event);
+
+	event = mock_expect_event(ctx, JS_EVENT_BUTTON);
+	second = js_event_get_frame_id(event);
+	assert(second > first);
+	js_event_destroy(event);
+	event = mock_expect_event(ctx, JS_EVENT_SYNC);
+	assert(js_event_get_frame_id(event) == second);
+	js_event_destroy(event);
+
+	assert(js_ctx_mark_consumed(ctx, 0) == -EINVAL);
+	assert(js_ctx_mark_consumed(ctx, second + 1) == -EINVAL);
+	assert(js_ctx_mark_consumed(ctx, first) == 1);
+	assert(js_ctx_mark_consumed(ctx, second) == 1);
+	assert(js_ctx_mark_consumed(ctx, first) == 0);
+
+	stats = js_ctx_get_stats(ctx);
+	assert(js_stats_get_latency_count(stats, JS_STATS_LATENCY_CONSUMED) == 2);
+	js_stats_destroy(stats);
+
+	js_ctx_unref(ctx);
+}
+
+static void
+test_mark_consumed_history(void)
+{
+	struct js_ctx *ctx = mock_ctx_new();
+	struct mock_device *d = mock_device_new(ctx, "microsoft-xbox-360-pad");
+	struct js_event *event;
+	uint64_t last = 0;
+
+	mock_drain_events(ctx);
+
+	/* Retrieved in batches, a build with max-queued-events drops
+	 * frames beyond the queue */
+	for (int i = 0; i < 100; i++) {
+		mock_device_event(d, EV_ABS, ABS_X, (i + 1) * 100);
+		mock_device_frame(d);
+		if (i % 10 != 9)
+			continue;
+
+		js_ctx_dispatch(ctx);
+		while ((event = js_ctx_get_event(ctx))) {
+			last = js_event_get_frame_id(event);
+			js_event_destroy(event);
+		}
+	}
+
+	/* Only the most recent frames are remembered */
+	assert(js_ctx_mark_consumed(ctx, last) == 64);
+
+	js_ctx_unref(ctx);
+}
+
+static void
+test_perf_counters(void)
+{
+	struct js_ctx *ctx = mock_ctx_new();
+	struct mock_device *d = mock_device_new(ctx, "microsoft-xbox-360-pad");
+	struct js_stats *stats;
+	uint64_t cycles = 0, instructions = 0, events = 0;
+	int rc;
+
+	mock_drain_events(ctx);
+
+	/* Device snapshots never have a stage cost */
+	stats = js_device_get_stats(mock_device_get_device(d));
+	assert(!js_stats_get_stage_cost(stats, JS_STATS_STAGE_READ,
+					&cycles, &instructions, &events));
+	js_stats_destroy(stats);
+
+	rc = js_ctx_set_perf_counters(ctx, true);
+	if (rc != 0) {
+		/* No PMU or not permitted, nothing must be collected */
+		assert(rc < 0);
+		mock_device_event(d, EV_KEY, BTN_SOUTH, 1);
+		mock_device_frame(d);
+		mock_drain_events(ctx);
+
+		stats = js_ctx_get_stats(ctx);
+		assert(js_stats_get_stage_cost(stats, JS_STATS_STAGE_DECODE,
+					       &cycles, &instructions, &events));
+		assert(cycles == 0 && instructions == 0 && events == 0);
+		js_stats_destroy(stats);
+
+		js_ctx_unref(ctx);
+		return;
+	}
+
+	for (int i = 0; i < 10; i++) {
+		mock_device_event(d, EV_KEY, BTN_SOUTH, (i + 1) % 2);
+		mock_device_frame(d);
+	}
+	mock_drain_events(ctx);
+	assert(js_ctx_set_perf_counters(ctx, false) == 0);
+
+	stats = js_ctx_get_stats(ctx);
+	assert(js_stats_get_stage_cost(stats, JS_STATS_STAGE_DECODE,
+				       &cycles, &instructions, &events));
+	assert(events == 20);
+	assert(instructions > 0);
+	assert(js_stats_get_stage_cost(stats, JS_STATS_STAGE_QUEUE,
+				       &cycles, &instructions, &events));
+	assert(events == 20);
+	js_stats_destroy(stats);
+
+	js_ctx_unref(ctx);
+}
+
+static void *
+dispatch_thread(void *data)
+{
+	struct js_ctx *ctx = data;
+
+	mock_drain_events(ctx);
+
+	return NULL;
+}
+
+static void
+test_perf_counters_other_thread(void)
+{
+	struct js_ctx *ctx = mock_ctx_new();
+	struct mock_device *d = mock_device_new(ctx, "microsoft-xbox-360-pad");
+	struct js_stats *stats;
+	uint64_t cycles = 0, instructions = 0, events = 0;
+	pthread_t thread;
+
+	mock_drain_events(ctx);
+	if (js_ctx_set_perf_counters(ctx, true) != 0) {
+		js_ctx_unref(ctx);
+		return;
+	}
+
+	/* The counters count this thread, not the dispatching one */
+	mock_device_event(d, EV_KEY, BTN_SOUTH, 1);
+	mock_device_frame(d);
+	assert(pthread_create(&thread, NULL, dispatch_thread, ctx) == 0);
+	assert(pthread_join(thread, NULL) == 0);
+
+	stats = js_ctx_get_stats(ctx);
+	for (int stage = JS_STATS_STAGE_READ;
+	     stage <= JS_STATS_STAGE_QUEUE;
+	     stage++) {
+		assert(js_stats_get_stage_cost(stats, stage,
+					       &cycles, &instructions, &events));
+		assert(cycles == 0 && instructions == 0 && events == 0);
+	}
+	js_stats_destroy(stats);
+
+	js_ctx_unref(ctx);
+}
+
+int
+main(void)
+{
+	test_counters();
+	test_syn_dropped();
+	test_latency_histogram();
+	test_frame_ids();
+	test_mark_consumed_history();
+	test_perf_counters();
+	test_perf_counters_other_thread();
+
+	return 0;
+}
@@ -0,0 +1,162 @@
+/*
+ * Copyright © 2019 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#include "config.h"
+
+#include <assert.h>
+#include <linux/input.h>
+
+#include <libjoystick.h>
+
+#include "mock-backend.h"
+
+static struct js_button *
+find_button(struct js_device *device, enum js_button_capability cap)
+{
+	for (size_t i = 0; i < js_device_get_button_count(device); i++) {
+		struct js_button *button = js_device_get_button(device, i);
+
+		if (js_button_has_capability(button, cap))
+			return button;
+	}
+
+	return NULL;
+}
+
+static void
+test_syn_dropped_resync(void)
+{
+	struct js_ctx *ctx = mock_ctx_new();
+	struct mock_device *d = mock_device_new(ctx, "microsoft-xbox-360-pad");
+	struct js_device *device = mock_device_get_device(d);
+	struct js_button *ok = find_button(device, JS_BUTTON_CAP_OK),
+			 *cancel = find_button(device, JS_BUTTON_CAP_CANCEL);
+	struct js_axis *left = js_device_get_axis(device, 0);
+	struct js_event *event;
+	bool state;
+	int16_t x, y;
+
+	mock_drain_events(ctx);
+
+	/* The events lost in the overflow */
+	mock_device_set_state(d, EV_KEY, BTN_SOUTH, 1);
+	mock_device_set_state(d, EV_ABS, ABS_X, 32767);
+
+	/* Everything up to the next SYN_REPORT is garbage but still
+	 * reflected in the kernel state */
+	mock_device_event(d, EV_SYN, SYN_DROPPED, 0);
+	mock_device_event(d, EV_KEY, BTN_EAST, 1);
+	mock_device_event(d, EV_ABS, ABS_Y, 1000);
+	mock_device_frame(d);
+
+	event = mock_expect_event(ctx, JS_EVENT_AXIS);
+	assert(js_event_axis_get_value(event, left, &x, &y, NULL));
+	assert(x == 32767);
+	assert(y == 1000);
+	js_event_destroy(event);
+
+	event = mock_expect_event(ctx, JS_EVENT_BUTTON);
+	assert(js_event_button_get_state(event, ok, &state));
+	assert(state);
+	assert(js_event_button_get_state(event, cancel, &state));
+	assert(state);
+	js_event_destroy(event);
+
+	event = mock_expect_event(ctx, JS_EVENT_SYNC);
+	js_event_destroy(event);
+	mock_expect_no_events(ctx);
+
+	/* Back to normal processing */
+	mock_device_event(d, EV_KEY, BTN_SOUTH, 0);
+	mock_device_frame(d);
+	event = mock_expect_event(ctx, JS_EVENT_BUTTON);
+	assert(js_event_button_get_state(event, ok, &state));
+	assert(!state);
+	js_event_destroy(event);
+	mock_drain_events(ctx);
+
+	js_ctx_unref(ctx);
+}
+
+static void
+test_syn_dropped_no_change(void)
+{
+	struct js_ctx *ctx = mock_ctx_new();
+	struct mock_device *d = mock_device_new(ctx, "microsoft-xbox-360-pad");
+
+	mock_drain_events(ctx);
+
+	/* A press and release both lost, nothing to report */
+	mock_device_event(d, EV_SYN, SYN_DROPPED, 0);
+	mock_device_event(d, EV_KEY, BTN_SOUTH, 1);
+	mock_device_event(d, EV_KEY, BTN_SOUTH, 0);
+	mock_device_frame(d);
+	mock_expect_no_events(ctx);
+
+	js_ctx_unref(ctx);
+}
+
+static void
+test_syn_dropped_release(void)
+{
+	struct js_ctx *ctx = mock_ctx_new();
+	struct mock_device *d = mock_device_new(ctx, "microsoft-xbox-360-pad");
+	struct js_device *device = mock_device_get_device(d);
+	struct js_button *ok = find_button(device, JS_BUTTON_CAP_OK);
+	struct js_dpad *dpad = js_device_get_dpad(device, 0);
+	struct js_event *event;
+	uint32_t direction;
+	bool state;
+
+	mock_device_event(d, EV_KEY, BTN_SOUTH, 1);
+	mock_device_event(d, EV_ABS, ABS_HAT0Y, 1);
+	mock_device_frame(d);
+	mock_drain_events(ctx);
+
+	mock_device_set_state(d, EV_KEY, BTN_SOUTH, 0);
+	mock_device_set_state(d, EV_ABS, ABS_HAT0Y, 0);
+	mock_device_event(d, EV_SYN, SYN_DROPPED, 0);
+	mock_device_frame(d);
+
+	event = mock_expect_event(ctx, JS_EVENT_BUTTON);
+	assert(js_event_button_get_state(event, ok, &state));
+	assert(!state);
+	js_event_destroy(event);
+
+	event = mock_expect_event(ctx, JS_EVENT_DPAD);
+	assert(js_event_dpad_get_state(event, dpad, &direction));
+	assert(direction == 0);
+	js_event_destroy(event);
+
+	event = mock_expect_event(ctx, JS_EVENT_SYNC);
+	js_event_destroy(event);
+	mock_expect_no_events(ctx);
+
+	js_ctx_unref(ctx);
+}
+
+int
+main(void)
+{
+	test_syn_dropped_resync();
+	test_syn_dropped_no_change();
+	test_syn_dropped_release();
+
+	return 0;
+}
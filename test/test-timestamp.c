@@ -0,0 +1,161 @@
+/*
+ * Copyright © 2019 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#include "config.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <linux/input.h>
+
+#include <libjoystick.h>
+
+#include "mock-backend.h"
+
+#define NREPORTS 1000
+#define INTERVAL 4000		/* 250 Hz */
+#define LATENCY 2000
+#define DRIFT 100.0		/* ppm, the device clock is slow */
+#define RAW_START 0xffff0000u	/* wraps after 16 reports */
+
+static uint64_t host_start;
+
+static bool
+is_lost(int i)
+{
+	return i == 500 || (i >= 800 && i <= 802);
+}
+
+/* The kernel time of report i without jitter */
+static double
+nominal_host_time(uint64_t device_elapsed)
+{
+	return host_start + LATENCY + device_elapsed * (1 + DRIFT / 1e6);
+}
+
+static void
+check_events(struct js_ctx *ctx, uint64_t *last_device_time, int *nframes)
+{
+	struct js_event *event;
+
+	js_ctx_dispatch(ctx);
+	while ((event = js_ctx_get_event(ctx))) {
+		uint64_t device_time, corrected, elapsed;
+		double error;
+
+		if (js_event_get_type(event) != JS_EVENT_SYNC) {
+			js_event_destroy(event);
+			continue;
+		}
+
+		assert(js_event_get_device_time_usec(event, &device_time));
+		assert(device_time > *last_device_time);
+		assert(device_time >= RAW_START);
+		elapsed = device_time - RAW_START;
+		assert(elapsed % INTERVAL == 0);
+		*last_device_time = device_time;
+
+		/* Once the estimate settled, the corrected time has no
+		 * jitter */
+		corrected = js_event_get_corrected_time_usec(event);
+		error = corrected - nominal_host_time(elapsed);
+		if (elapsed >= 100 * INTERVAL)
+			assert(error > -50 && error < 50);
+
+		(*nframes)++;
+		js_event_destroy(event);
+	}
+}
+
+static void
+test_device_time(void)
+{
+	struct js_ctx *ctx = mock_ctx_new();
+	struct mock_device *d = mock_device_new(ctx, "sony-dualshock-4");
+	struct js_device *device = mock_device_get_device(d);
+	struct js_event *event;
+	struct js_stats *stats;
+	uint64_t time, last_device_time = 0;
+	int64_t offset;
+	double drift;
+	int nframes = 0;
+
+	mock_drain_events(ctx);
+
+	/* Without MSC_TIMESTAMP, there is no device time */
+	mock_device_event(d, EV_ABS, ABS_X, 1000);
+	mock_device_frame(d);
+	event = mock_expect_event(ctx, JS_EVENT_AXIS);
+	assert(!js_event_get_device_time_usec(event, &time));
+	assert(js_event_get_corrected_time_usec(event) ==
+	       js_event_get_time_usec(event));
+	js_event_destroy(event);
+	mock_drain_events(ctx);
+	assert(js_device_get_clock_estimate(device, &offset, &drift) == -ENODATA);
+
+	host_start = 1000000000;
+	for (int i = 0; i < NREPORTS; i++) {
+		uint64_t elapsed = (uint64_t)i * INTERVAL;
+		int jitter = (i * 7919) % 401 - 200;
+		uint64_t host = nominal_host_time(elapsed) + jitter;
+
+		if (!is_lost(i)) {
+			mock_device_event_with_time(d, host, EV_MSC,
+						    MSC_TIMESTAMP,
+						    (int32_t)(RAW_START + elapsed));
+			mock_device_event_with_time(d, host, EV_ABS, ABS_X,
+						    i % 2 ? 1000 : -1000);
+			mock_device_event_with_time(d, host, EV_SYN,
+						    SYN_REPORT, 0);
+		}
+
+		if (i % 32 == 31)
+			check_events(ctx, &last_device_time, &nframes);
+	}
+	check_events(ctx, &last_device_time, &nframes);
+	assert(nframes > NREPORTS / 2);
+	assert(last_device_time == RAW_START + (uint64_t)(NREPORTS - 1) * INTERVAL);
+
+	assert(js_device_get_clock_estimate(device, &offset, &drift) == 0);
+	assert(drift > DRIFT - 20 && drift < DRIFT + 20);
+	time = nominal_host_time((uint64_t)(NREPORTS - 1) * INTERVAL);
+	assert(offset > (int64_t)(time - last_device_time) - 50);
+	assert(offset < (int64_t)(time - last_device_time) + 50);
+
+	stats = js_device_get_stats(device);
+#if HAVE_STATISTICS
+	assert(js_stats_get_counter(stats, JS_STATS_TIMESTAMPED_REPORTS) == NREPORTS - 4);
+	assert(js_stats_get_counter(stats, JS_STATS_TIMESTAMP_GAPS) == 2);
+	assert(js_stats_get_counter(stats, JS_STATS_REPORTS_LOST) == 4);
+	assert(js_stats_get_counter(stats, JS_STATS_REPORT_JITTER) > 0);
+	assert(js_stats_get_counter(stats, JS_STATS_REPORT_JITTER) < 400);
+#else
+	assert(js_stats_get_counter(stats, JS_STATS_REPORTS_LOST) == 0);
+#endif
+	js_stats_destroy(stats);
+
+	js_ctx_unref(ctx);
+}
+
+int
+main(void)
+{
+	test_device_time();
+
+	return 0;
+}
@@ -0,0 +1,71 @@
+/*
+ * Copyright © 2019 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#include "config.h"
+
+#include <assert.h>
+#include <linux/input.h>
+
+#include <libjoystick-uv.h>
+
+#include "mock-backend.h"
+
+static void
+handle_event(struct js_event *event, void *data)
+{
+	unsigned int *nevents = data;
+
+	(*nevents)++;
+}
+
+static void
+test_dispatch(void)
+{
+	struct js_ctx *ctx = mock_ctx_new();
+	struct mock_device *pad = mock_device_new(ctx, "microsoft-xbox-360-pad");
+	unsigned int nevents = 0;
+	struct js_uv_source source;
+	uv_loop_t loop;
+
+	assert(uv_loop_init(&loop) == 0);
+	assert(js_uv_source_start(&source, &loop, ctx, handle_event, &nevents) == 0);
+
+	/* The events queued before are delivered on the first iteration */
+	uv_run(&loop, UV_RUN_NOWAIT);
+	assert(nevents == 1);
+
+	/* A button event and its sync */
+	mock_device_event(pad, EV_KEY, BTN_SOUTH, 1);
+	mock_device_frame(pad);
+	uv_run(&loop, UV_RUN_NOWAIT);
+	assert(nevents == 3);
+
+	js_uv_source_close(&source, NULL);
+	uv_run(&loop, UV_RUN_DEFAULT);
+	assert(uv_loop_close(&loop) == 0);
+	js_ctx_unref(ctx);
+}
+
+int
+main(void)
+{
+	test_dispatch();
+
+	return 0;
+}